@@ -14,18 +14,20 @@ ImageSlice::ImageSlice(const til::size cellSize) noexcept :
 {
 }
 
-void ImageSlice::BumpRevision() noexcept
+static uint64_t nextRevision() noexcept
 {
-    // Avoid setting the revision to 0. This allows the renderer to use 0 as a sentinel value.
-    do
+    // Avoid returning a revision of 0. This allows the renderer to use 0 as a sentinel value.
+    auto revision = s_revision.fetch_add(1, std::memory_order_relaxed);
+    while (revision == 0)
     {
-        _revision = s_revision.fetch_add(1, std::memory_order_relaxed);
-    } while (_revision == 0);
+        revision = s_revision.fetch_add(1, std::memory_order_relaxed);
+    }
+    return revision;
 }
 
 uint64_t ImageSlice::Revision() const noexcept
 {
-    return _revision;
+    return _tile ? _tile->revision : 0;
 }
 
 til::size ImageSlice::CellSize() const noexcept
@@ -45,35 +47,41 @@ til::CoordType ImageSlice::PixelWidth() const noexcept
 
 std::span<const RGBQUAD> ImageSlice::Pixels() const noexcept
 {
-    return _pixelBuffer;
+    if (!_tile)
+    {
+        return {};
+    }
+    return _tile->pixels;
 }
 
 const RGBQUAD* ImageSlice::Pixels(const til::CoordType columnBegin) const noexcept
 {
     const auto pixelOffset = (columnBegin - _columnBegin) * _cellSize.width;
-    return &til::at(_pixelBuffer, pixelOffset);
+    return &til::at(Pixels(), pixelOffset);
 }
 
 RGBQUAD* ImageSlice::MutablePixels(const til::CoordType columnBegin, const til::CoordType columnEnd)
 {
     // IF the buffer is empty or isn't large enough for the requested range, we'll need to resize it.
-    if (_pixelBuffer.empty() || columnBegin < _columnBegin || columnEnd > _columnEnd)
+    const auto existingData = !Pixels().empty();
+    if (!existingData || columnBegin < _columnBegin || columnEnd > _columnEnd)
     {
         const auto oldColumnBegin = _columnBegin;
         const auto oldPixelWidth = _pixelWidth;
-        const auto existingData = !_pixelBuffer.empty();
         _columnBegin = existingData ? std::min(_columnBegin, columnBegin) : columnBegin;
         _columnEnd = existingData ? std::max(_columnEnd, columnEnd) : columnEnd;
         _pixelWidth = (_columnEnd - _columnBegin) * _cellSize.width;
         const auto bufferSize = _pixelWidth * _cellSize.height;
+        // The resized buffer always goes into a new tile, so if the old one is
+        // shared with other slices, it's left untouched for them to use.
+        auto newPixelBuffer = std::vector<RGBQUAD>(bufferSize);
         if (existingData)
         {
             // If there is existing data in the buffer, we need to copy it
             // across to the appropriate position in the new buffer.
-            auto newPixelBuffer = std::vector<RGBQUAD>(bufferSize);
             const auto newPixelOffset = (oldColumnBegin - _columnBegin) * _cellSize.width;
             auto newIterator = std::next(newPixelBuffer.data(), newPixelOffset);
-            auto oldIterator = _pixelBuffer.data();
+            auto oldIterator = Pixels().data();
             // Because widths are rounded up to multiples of 4, it's possible
             // that the old width will extend past the right border of the new
             // buffer, so the range that we copy must be clamped to fit.
@@ -84,16 +92,33 @@ RGBQUAD* ImageSlice::MutablePixels(const til::CoordType columnBegin, const til::
                 std::advance(oldIterator, oldPixelWidth);
                 std::advance(newIterator, _pixelWidth);
             }
-            _pixelBuffer = std::move(newPixelBuffer);
-        }
-        else
-        {
-            // Otherwise we just initialize the buffer to the correct size.
-            _pixelBuffer.resize(bufferSize);
         }
+        const auto pixelOffset = (columnBegin - _columnBegin) * _cellSize.width;
+        return std::next(_replacePixels(std::move(newPixelBuffer)), pixelOffset);
     }
     const auto pixelOffset = (columnBegin - _columnBegin) * _cellSize.width;
-    return &til::at(_pixelBuffer, pixelOffset);
+    return std::next(_writablePixels(), pixelOffset);
+}
+
+RGBQUAD* ImageSlice::_writablePixels()
+{
+    // If the tile is shared with any other slices, we need to make our own
+    // copy before it can be written to. Either way, the content is about to
+    // change, so it also needs a new revision to let the renderer know.
+    if (_tile.use_count() > 1)
+    {
+        _tile = std::make_shared<Tile>(*_tile);
+    }
+    _tile->revision = nextRevision();
+    return _tile->pixels.data();
+}
+
+RGBQUAD* ImageSlice::_replacePixels(std::vector<RGBQUAD>&& pixels)
+{
+    _tile = std::make_shared<Tile>();
+    _tile->revision = nextRevision();
+    _tile->pixels = std::move(pixels);
+    return _tile->pixels.data();
 }
 
 void ImageSlice::CopyBlock(const TextBuffer& srcBuffer, const til::rect srcRect, TextBuffer& dstBuffer, const til::rect dstRect)
@@ -123,6 +148,7 @@ void ImageSlice::CopyBlock(const TextBuffer& srcBuffer, const til::rect srcRect,
 
 void ImageSlice::CopyRow(const ROW& srcRow, ROW& dstRow)
 {
+    // This only copies the slice. The pixels are shared with the source.
     const auto srcSlice = srcRow.GetImageSlice();
     dstRow.SetImageSlice(srcSlice ? std::make_unique<ImageSlice>(*srcSlice) : nullptr);
 }
@@ -160,6 +186,20 @@ bool ImageSlice::_copyCells(const ImageSlice& srcSlice, const til::CoordType src
 {
     const auto srcColumnEnd = srcColumn + dstColumnEnd - dstColumnBegin;
 
+    // When the source content is copied to the same columns in the destination,
+    // and there's nothing in the destination that would survive the copy (the
+    // typical case when scrolling a margin area), we can just share the tile.
+    const auto srcCovered = srcColumn <= srcSlice._columnBegin && srcColumnEnd >= srcSlice._columnEnd;
+    const auto dstCovered = !_tile || (dstColumnBegin <= _columnBegin && dstColumnEnd >= _columnEnd);
+    if (srcColumn == dstColumnBegin && srcCovered && dstCovered && srcSlice._tile && srcSlice._cellSize == _cellSize)
+    {
+        _tile = srcSlice._tile;
+        _columnBegin = srcSlice._columnBegin;
+        _columnEnd = srcSlice._columnEnd;
+        _pixelWidth = srcSlice._pixelWidth;
+        return false;
+    }
+
     // First we determine the portions of the copy range that are currently in use.
     const auto srcUsedBegin = std::max(srcColumn, srcSlice._columnBegin);
     const auto srcUsedEnd = std::max(std::min(srcColumnEnd, srcSlice._columnEnd), srcUsedBegin);
@@ -248,7 +288,7 @@ bool ImageSlice::_eraseCells(const til::CoordType columnBegin, const til::CoordT
         {
             const auto eraseOffset = (eraseBegin - _columnBegin) * _cellSize.width;
             const auto eraseLength = (eraseEnd - eraseBegin) * _cellSize.width;
-            auto eraseIterator = std::next(_pixelBuffer.data(), eraseOffset);
+            auto eraseIterator = std::next(_writablePixels(), eraseOffset);
             for (auto y = 0; y < _cellSize.height; y++)
             {
                 std::memset(eraseIterator, 0, eraseLength * sizeof(RGBQUAD));
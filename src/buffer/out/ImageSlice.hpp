@@ -7,11 +7,15 @@ Module Name:
 
 Abstract:
 - This serves as a structure to represent a slice of an image covering one textbuffer row.
+- The pixels are held in a refcounted tile, which can be shared by any number
+  of slices when rows are copied or scrolled. A tile is treated as immutable
+  once it's shared, and is only copied when one of its slices is written to.
 --*/
 
 #pragma once
 
 #include "til.h"
+#include <memory>
 #include <span>
 #include <vector>
 
@@ -26,7 +30,6 @@ public:
     ImageSlice(const ImageSlice& rhs) = default;
     ImageSlice(const til::size cellSize) noexcept;
 
-    void BumpRevision() noexcept;
     uint64_t Revision() const noexcept;
 
     til::size CellSize() const noexcept;
@@ -47,10 +50,19 @@ public:
 private:
     bool _copyCells(const ImageSlice& srcSlice, const til::CoordType srcColumn, const til::CoordType dstColumnBegin, const til::CoordType dstColumnEnd);
     bool _eraseCells(const til::CoordType columnBegin, const til::CoordType columnEnd);
+    RGBQUAD* _writablePixels();
+    RGBQUAD* _replacePixels(std::vector<RGBQUAD>&& pixels);
+
+    struct Tile
+    {
+        // The revision uniquely identifies the content of the tile, so
+        // renderers can use it as a key for caching their uploads.
+        uint64_t revision = 0;
+        std::vector<RGBQUAD> pixels;
+    };
 
-    uint64_t _revision = 0;
     til::size _cellSize;
-    std::vector<RGBQUAD> _pixelBuffer;
+    std::shared_ptr<Tile> _tile;
     til::CoordType _columnBegin = 0;
     til::CoordType _columnEnd = 0;
     til::CoordType _pixelWidth = 0;
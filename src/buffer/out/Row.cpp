@@ -5,6 +5,7 @@
 #include "Row.hpp"
 
 #include <isa_availability.h>
+#include <til/hash.h>
 
 #include "../../types/inc/CodepointWidthDetector.hpp"
 
@@ -204,6 +205,42 @@ LineRendition ROW::GetLineRendition() const noexcept
     return _lineRendition;
 }
 
+void ROW::SetRevision(const uint64_t revision) noexcept
+{
+    _revision = revision;
+}
+
+uint64_t ROW::GetRevision() const noexcept
+{
+    return _revision;
+}
+
+// Returns a hash of everything that affects how this row is drawn. Unlike the revision, which only tells
+// us that a row was handed out for modification, this allows the renderer to detect rows that were
+// rewritten with the same contents. The result is never 0, so that callers can use 0 as "unknown".
+size_t ROW::ContentHash() const noexcept
+{
+    til::hasher h;
+
+    const auto text = GetText();
+    h.write(text.data(), text.size());
+    h.write(_charOffsets.data(), _charOffsets.size());
+
+    for (const auto& run : _attr.runs())
+    {
+        h.write(static_cast<const void*>(&run.value), sizeof(run.value));
+        h.write(static_cast<const void*>(&run.length), sizeof(run.length));
+    }
+
+    const auto imageRevision = _imageSlice ? _imageSlice->Revision() : uint64_t{ 0 };
+    h.write(static_cast<const void*>(&_lineRendition), sizeof(_lineRendition));
+    h.write(static_cast<const void*>(&_wrapForced), sizeof(_wrapForced));
+    h.write(static_cast<const void*>(&_doubleBytePadded), sizeof(_doubleBytePadded));
+    h.write(static_cast<const void*>(&imageRevision), sizeof(imageRevision));
+
+    return h.finalize() | 1;
+}
+
 // Returns the index 1 past the last (technically) valid column in the row.
 // The interplay between the old console and newer VT APIs which support line renditions is
 // still unclear so it might be necessary to add two kinds of this function in the future.
@@ -357,6 +394,7 @@ void ROW::CopyFrom(const ROW& source)
 {
     _lineRendition = source._lineRendition;
     _wrapForced = source._wrapForced;
+    _promptData = source._promptData;
 
     RowCopyTextFromState state{
         .source = source,
@@ -368,6 +406,203 @@ void ROW::CopyFrom(const ROW& source)
     _attr.resize_trailing_extent(_columnCount);
 }
 
+// Returns the compact form of this ROW and appends its text to `pool`. The ROW itself remains unchanged.
+//
+// Trailing whitespace isn't stored at all and the remaining text is run-length encoded:
+// Each run starts with a header whose lower 15 bits are the run's length. If the highest bit is set,
+// the header is followed by a single character that repeats that many times. Otherwise, it's
+// followed by that many literal characters. Lastly, the char offsets of the stored columns are
+// appended, unless they're trivial (as is the case for most rows that only contain ASCII).
+CompactRow ROW::Compact(std::vector<uint16_t>& pool) const
+{
+    static constexpr size_t maxRunLength = 0x7fff;
+    static constexpr size_t minRepeatLength = 4;
+
+    // Safety: Whitespace is only skipped if the column is a single character wide,
+    // which means that `col` always points to a leading column and `ch` to its text.
+    uint16_t col = _columnCount;
+    uint16_t ch = _charSize();
+    while (col != 0 && til::at(_charOffsets, col - 1) == ch - 1 && til::at(_chars, ch - 1) == L' ')
+    {
+        --col;
+        --ch;
+    }
+
+    auto hasCharOffsets = false;
+    for (uint16_t i = 0; i < col; ++i)
+    {
+        if (til::at(_charOffsets, i) != i)
+        {
+            hasCharOffsets = true;
+            break;
+        }
+    }
+
+    CompactRow compact{
+        .attr = _attr,
+        .promptData = _promptData,
+        .revision = _revision,
+        .poolOffset = gsl::narrow<uint32_t>(pool.size()),
+        .columnCount = col,
+        .charCount = ch,
+        .hasCharOffsets = hasCharOffsets,
+        .lineRendition = _lineRendition,
+        .wrapForced = _wrapForced,
+        .doubleBytePadded = _doubleBytePadded,
+    };
+
+    const auto chars = _chars.first(ch);
+    const auto appendLiteral = [&](size_t beg, const size_t end) {
+        while (beg != end)
+        {
+            const auto count = std::min(end - beg, maxRunLength);
+            pool.emplace_back(gsl::narrow_cast<uint16_t>(count));
+            pool.insert(pool.end(), chars.begin() + beg, chars.begin() + beg + count);
+            beg += count;
+        }
+    };
+
+    size_t literalBeg = 0;
+    for (size_t i = 0; i < chars.size();)
+    {
+        auto j = i + 1;
+        while (j < chars.size() && chars[j] == chars[i] && j - i < maxRunLength)
+        {
+            ++j;
+        }
+        if (j - i >= minRepeatLength)
+        {
+            appendLiteral(literalBeg, i);
+            pool.emplace_back(gsl::narrow_cast<uint16_t>(0x8000 | (j - i)));
+            pool.emplace_back(chars[i]);
+            literalBeg = j;
+        }
+        i = j;
+    }
+    appendLiteral(literalBeg, chars.size());
+
+    if (hasCharOffsets)
+    {
+        pool.insert(pool.end(), _charOffsets.begin(), _charOffsets.begin() + col);
+    }
+
+    return compact;
+}
+
+// Restores a ROW from its compact form. See Compact().
+// This ROW must have just been constructed or Reset() and have the same width as the compacted one.
+void ROW::Expand(CompactRow&& compact, const std::span<const uint16_t> pool)
+{
+    const auto col = compact.columnCount;
+    const auto ch = compact.charCount;
+    const size_t charSize = ch + (_columnCount - col);
+
+    // Wide glyphs may make the text shorter than the row is wide, but text that consists
+    // of many surrogate pairs or combining marks may exceed the row's own buffer.
+    if (charSize > _chars.size())
+    {
+        _charsHeap = std::make_unique_for_overwrite<wchar_t[]>(charSize);
+        _chars = { _charsHeap.get(), charSize };
+        std::fill(_chars.begin() + ch, _chars.end(), L' ');
+    }
+
+    auto in = pool.begin() + compact.poolOffset;
+    auto out = _chars.begin();
+    const auto outEnd = out + ch;
+    while (out != outEnd)
+    {
+        const auto header = *in++;
+        const auto count = header & 0x7fff;
+        if (header & 0x8000)
+        {
+            out = std::fill_n(out, count, static_cast<wchar_t>(*in++));
+        }
+        else
+        {
+            out = std::copy_n(in, count, out);
+            in += count;
+        }
+    }
+
+    if (compact.hasCharOffsets)
+    {
+        const auto it = std::copy_n(in, col, _charOffsets.begin());
+        iota_n(it, _columnCount + 1 - col, ch);
+    }
+
+    _attr = std::move(compact.attr);
+    _promptData = compact.promptData;
+    _revision = compact.revision;
+    _lineRendition = compact.lineRendition;
+    _wrapForced = compact.wrapForced;
+    _doubleBytePadded = compact.doubleBytePadded;
+}
+
+// Returns true if `compact` and its text in `pool` could have been produced by Compact() for a ROW that's
+// `columnCount` wide. Expand() trusts its input, so this needs to be checked for anything read from disk.
+bool ROW::IsValidCompact(const CompactRow& compact, const std::span<const uint16_t> pool, const uint16_t columnCount) noexcept
+{
+    const size_t col = compact.columnCount;
+    const size_t ch = compact.charCount;
+
+    if (col > columnCount || compact.attr.size() != columnCount || compact.poolOffset > pool.size() ||
+        ch + (columnCount - col) > CharOffsetsMask || (!compact.hasCharOffsets && ch != col))
+    {
+        return false;
+    }
+
+    auto in = pool.subspan(compact.poolOffset);
+    size_t decoded = 0;
+    while (decoded < ch)
+    {
+        if (in.empty())
+        {
+            return false;
+        }
+
+        const auto header = in.front();
+        const size_t count = header & 0x7fff;
+        const size_t stored = header & 0x8000 ? 1 : count;
+        if (count == 0 || in.size() - 1 < stored)
+        {
+            return false;
+        }
+
+        in = in.subspan(1 + stored);
+        decoded += count;
+    }
+
+    if (decoded != ch)
+    {
+        return false;
+    }
+
+    if (compact.hasCharOffsets)
+    {
+        if (in.size() < col)
+        {
+            return false;
+        }
+
+        // Every glyph must be at least 1 character long and its trailing columns must share its offset.
+        // The columns past the stored ones start at `ch` (see Expand()), which ends the last glyph.
+        size_t prev = 0;
+        for (size_t i = 0; i < col; ++i)
+        {
+            const auto offset = til::at(in, i) & CharOffsetsMask;
+            const auto trailer = (til::at(in, i) & CharOffsetsTrailer) != 0;
+            const auto valid = trailer ? i != 0 && offset == prev : (i == 0 ? offset == 0 : offset > prev);
+            if (!valid || offset >= ch)
+            {
+                return false;
+            }
+            prev = offset;
+        }
+    }
+
+    return true;
+}
+
 // Returns the previous possible cursor position, preceding the given column.
 // Returns 0 if column is less than or equal to 0.
 til::CoordType ROW::NavigateToPrevious(til::CoordType column) const noexcept
@@ -643,26 +878,26 @@ catch (...)
 
 [[msvc::forceinline]] void ROW::WriteHelper::ReplaceText() noexcept
 {
-    // This function starts with a fast-pass for ASCII. ASCII is still predominant in technical areas.
+    // This function starts with a fast-pass for narrow text. ASCII is still predominant in technical areas,
+    // and most other Latin, Greek or Cyrillic text consists of 1 column wide, non-joining characters as well.
     //
     // We can infer the "end" from the amount of columns we're given (colLimit - colBeg),
-    // because ASCII is always 1 column wide per character.
-    auto it = chars.begin();
-    const auto end = it + std::min<size_t>(chars.size(), colLimit - colBeg);
+    // because such text is always 1 column wide per character.
+    const auto limit = std::min<size_t>(chars.size(), colLimit - colBeg);
+    const auto narrow = CodepointWidthDetector::Singleton().NarrowRunLength(chars.substr(0, limit));
     size_t ch = chBeg;
 
-    while (it != end)
+    for (size_t i = 0; i < narrow; ++i)
     {
-        if (*it >= 0x80) [[unlikely]]
-        {
-            _replaceTextUnicode(ch, it);
-            return;
-        }
-
         til::at(row._charOffsets, colEnd) = gsl::narrow_cast<uint16_t>(ch);
         ++colEnd;
         ++ch;
-        ++it;
+    }
+
+    if (narrow != limit) [[unlikely]]
+    {
+        _replaceTextUnicode(ch, chars.begin() + narrow);
+        return;
     }
 
     colEndDirty = colEnd;
@@ -718,9 +953,9 @@ catch (...)
     }
     else
     {
-        // The non-ASCII character we have encountered may be a combining mark, like "a^" which is then displayed as "â".
-        // In order to recognize both characters as a single grapheme, we need to back up by 1 ASCII character
-        // and let MeasureNext() find the next proper grapheme boundary.
+        // The character we have encountered may be a combining mark, like "a^" which is then displayed as "â".
+        // In order to recognize both characters as a single grapheme, we need to back up by 1 narrow character
+        // and let GraphemeNext() find the next proper grapheme boundary.
         --colEnd;
         --ch;
         --it;
@@ -983,13 +1218,8 @@ const ImageSlice* ROW::GetImageSlice() const noexcept
 
 ImageSlice* ROW::GetMutableImageSlice() noexcept
 {
-    const auto ptr = _imageSlice.get();
-    if (!ptr)
-    {
-        return nullptr;
-    }
-    ptr->BumpRevision();
-    return ptr;
+    // The slice takes care of updating its revision when the content changes.
+    return _imageSlice.get();
 }
 
 uint16_t ROW::size() const noexcept
@@ -90,6 +90,30 @@ private:
     til::CoordType _columnCount;
 };
 
+// A ROW that has been moved out of the TextBuffer's row memory into its compact tier.
+// The text is run-length encoded into a pool shared by several rows, whereas the
+// attributes and metadata are stored as-is. See ROW::Compact() and ROW::Expand().
+struct CompactRow
+{
+    til::small_rle<TextAttribute, uint16_t, 1> attr;
+    std::optional<ScrollbarData> promptData;
+    uint64_t revision = 0;
+    // The offset of the encoded text in the pool.
+    uint32_t poolOffset = 0;
+    // If TextBuffer interned the attributes of this row, attr is empty and they're stored as
+    // attrRunCount runs of attribute IDs at attrRunOffset instead. See TextBuffer::_compactChunk().
+    uint32_t attrRunOffset = 0;
+    uint16_t attrRunCount = 0;
+    // The number of leading columns and characters that were stored. The remaining columns are whitespace.
+    uint16_t columnCount = 0;
+    uint16_t charCount = 0;
+    // If false, each of the stored columns consists of exactly 1 character and the char offsets weren't stored.
+    bool hasCharOffsets = false;
+    LineRendition lineRendition = LineRendition::SingleWidth;
+    bool wrapForced = false;
+    bool doubleBytePadded = false;
+};
+
 class ROW final
 {
 public:
@@ -131,10 +155,16 @@ public:
     bool WasDoubleBytePadded() const noexcept;
     void SetLineRendition(const LineRendition lineRendition) noexcept;
     LineRendition GetLineRendition() const noexcept;
+    void SetRevision(uint64_t revision) noexcept;
+    uint64_t GetRevision() const noexcept;
+    size_t ContentHash() const noexcept;
     til::CoordType GetReadableColumnCount() const noexcept;
 
     void Reset(const TextAttribute& attr) noexcept;
     void CopyFrom(const ROW& source);
+    CompactRow Compact(std::vector<uint16_t>& pool) const;
+    void Expand(CompactRow&& compact, std::span<const uint16_t> pool);
+    static bool IsValidCompact(const CompactRow& compact, std::span<const uint16_t> pool, uint16_t columnCount) noexcept;
 
     til::CoordType NavigateToPrevious(til::CoordType column) const noexcept;
     til::CoordType NavigateToNext(til::CoordType column) const noexcept;
@@ -307,6 +337,9 @@ private:
     bool _wrapForced = false;
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded = false;
+    // The TextBuffer::GetLastMutationId() at the time this row was last handed out for modification.
+    // The contents of a row can only have changed if its revision changed. See TextBuffer::SearchIndex.
+    uint64_t _revision = 0;
 
     std::optional<ScrollbarData> _promptData = std::nullopt;
 
@@ -25,7 +25,7 @@ void Search::Reset(Microsoft::Console::Render::IRenderData& renderData, const st
     _flags = flags;
     _lastMutationId = textBuffer.GetLastMutationId();
 
-    auto result = textBuffer.SearchText(needle, _flags);
+    auto result = textBuffer.SearchText(needle, _flags, _searchIndex);
     _ok = result.has_value();
     _results = std::move(result).value_or(std::vector<til::point_span>{});
     _index = reverse ? gsl::narrow_cast<ptrdiff_t>(_results.size()) - 1 : 0;
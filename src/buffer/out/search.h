@@ -56,6 +56,8 @@ private:
     std::wstring _needle;
     SearchFlag _flags{};
     uint64_t _lastMutationId = 0;
+    // Allows Reset() to only search through the rows that changed since the last search.
+    TextBuffer::SearchIndex _searchIndex;
 
     bool _ok{ false };
     std::vector<til::point_span> _results;
@@ -5,6 +5,7 @@
 #include "textBuffer.hpp"
 
 #include <til/hash.h>
+#include <til/virtual_memory.h>
 
 #include "UTextAdapter.h"
 #include "../../types/inc/CodepointWidthDetector.hpp"
@@ -107,9 +108,7 @@ void TextBuffer::_reserve(til::size screenBufferSize, const TextAttribute& defau
 
     // NOTE: Modifications to this block of code might have to be mirrored over to ResizeTraditional().
     // It constructs a temporary TextBuffer and then extracts the members below, overwriting itself.
-    _buffer = wil::unique_virtualalloc_ptr<std::byte>{
-        static_cast<std::byte*>(THROW_LAST_ERROR_IF_NULL(VirtualAlloc(nullptr, allocSize, MEM_RESERVE, PAGE_READWRITE)))
-    };
+    _buffer = til::virtual_memory{ allocSize };
     _bufferEnd = _buffer.get() + allocSize;
     _commitWatermark = _buffer.get();
     _initialAttributes = defaultAttributes;
@@ -128,17 +127,23 @@ void TextBuffer::_reserve(til::size screenBufferSize, const TextAttribute& defau
 // The compiler doesn't understand the likelihood of our branches. (PGO does, but that's imperfect.)
 __declspec(noinline) void TextBuffer::_commit(const std::byte* row)
 {
-    assert(row >= _commitWatermark);
+    // Another reader may have committed the row while we waited for the lock.
+    const std::lock_guard guard{ _materializeLock };
+    const auto watermark = _commitWatermark.load(std::memory_order_relaxed);
+    if (row < watermark)
+    {
+        return;
+    }
 
     const auto rowEnd = row + _bufferRowStride;
-    const auto remaining = gsl::narrow_cast<uintptr_t>(_bufferEnd - _commitWatermark);
-    const auto minimum = gsl::narrow_cast<uintptr_t>(rowEnd - _commitWatermark);
+    const auto remaining = gsl::narrow_cast<uintptr_t>(_bufferEnd - watermark);
+    const auto minimum = gsl::narrow_cast<uintptr_t>(rowEnd - watermark);
     const auto ideal = minimum + _bufferRowStride * _commitReadAheadRowCount;
     const auto size = std::min(remaining, ideal);
 
-    THROW_LAST_ERROR_IF_NULL(VirtualAlloc(_commitWatermark, size, MEM_COMMIT, PAGE_READWRITE));
+    _buffer.commit(watermark, size);
 
-    _construct(_commitWatermark + size);
+    _construct(watermark + size);
 }
 
 // Destructs and MEM_DECOMMITs all previously constructed ROWs.
@@ -146,30 +151,412 @@ __declspec(noinline) void TextBuffer::_commit(const std::byte* row)
 void TextBuffer::_decommit() noexcept
 {
     _destroy();
-    VirtualFree(_buffer.get(), 0, MEM_DECOMMIT);
+    _buffer.decommit(_buffer.get(), _buffer.size());
     _commitWatermark = _buffer.get();
+    _compactChunks = {};
+    _compactChunkCount = 0;
+    _clearCompactAttributes();
+    _rowMap = {};
+    _rowMapInverse = {};
+    // All ROWs are blank now, so none of them hold on to any hyperlinks.
+    _hyperlinkRefCounts = {};
+    _hyperlinkRowRefs = {};
+    _hyperlinkDirtyRows = {};
+    _hyperlinkRefsStale = false;
+    _markPositions = {};
+}
+
+// Like _decommit(), but only for the ROWs from the given offset onwards. ClearScrollback() uses this
+// to return the memory of the cleared rows to the OS. Compact chunks among them are dropped as well.
+void TextBuffer::_decommitFrom(const size_t offset)
+{
+    const auto begRow = _buffer.get() + offset * _bufferRowStride;
+    const auto watermark = _commitWatermark.load(std::memory_order_relaxed);
+    if (begRow >= watermark)
+    {
+        return;
+    }
+
+    // A compact chunk that straddles the boundary is expanded, so that the rows before it survive.
+    // This is the only thing that can throw, which is why it happens before anything gets destroyed.
+    if (offset % _compactChunkRowCount != 0 && _isCompactRow(offset))
+    {
+        _expandChunk(offset / _compactChunkRowCount);
+    }
+
+    auto it = begRow;
+    for (auto o = offset; it < watermark; it += _bufferRowStride, ++o)
+    {
+        if (!_isCompactRow(o))
+        {
+            std::destroy_at(reinterpret_cast<ROW*>(it));
+        }
+    }
+
+    for (auto chunk = offset / _compactChunkRowCount; chunk < _compactChunks.size(); ++chunk)
+    {
+        auto& slot = til::at(_compactChunks, chunk);
+        if (slot.compact)
+        {
+            _releaseCompactAttributes(slot.attrRuns);
+            slot = {};
+            _compactChunkCount--;
+        }
+    }
+    if (_compactChunkCount == 0)
+    {
+        _clearCompactAttributes();
+    }
+
+    // This includes the read-ahead beyond _commitWatermark and leaves the page that's shared with the row before alone.
+    _buffer.decommit(begRow, _buffer.get() + _buffer.size() - begRow);
+    _commitWatermark = begRow;
+
+    // The destroyed rows may have held hyperlinks.
+    if (_hyperlinkTracking)
+    {
+        _hyperlinkRefsStale = true;
+    }
+}
+
+// Moves the contents of the rows [0,count) into the ROWs that _rowMap would assign to them if it was the identity,
+// and then resets it to be so. The contents of all other rows are lost. _firstRow must be 0. See ClearScrollback().
+void TextBuffer::_resetRowMap(const til::CoordType count)
+{
+    if (_rowMap.empty())
+    {
+        return;
+    }
+
+    const auto copy = [](const ROW& src, ROW& dst) {
+        dst.CopyFrom(src);
+        ImageSlice::CopyRow(src, dst);
+    };
+
+    _lastMutationId++;
+    auto& scratch = _getRowByOffsetDirect(0);
+    for (size_t position = 0; position < gsl::narrow_cast<size_t>(count); ++position)
+    {
+        // The position that currently refers to the ROW that belongs to this position.
+        const auto other = gsl::narrow_cast<size_t>(til::at(_rowMapInverse, position));
+        if (other == position)
+        {
+            continue;
+        }
+
+        auto& dst = _getRowByOffsetDirect(position + 1);
+        auto& src = _getRowByOffsetDirect(til::at(_rowMap, position) + 1);
+        // Positions before this one are already in place, so other > position. If other is within
+        // the rows we keep, its contents get moved into the ROW that this position refers to now.
+        if (other < gsl::narrow_cast<size_t>(count))
+        {
+            copy(dst, scratch);
+            copy(src, dst);
+            copy(scratch, src);
+        }
+        else
+        {
+            copy(src, dst);
+        }
+        dst.SetRevision(_lastMutationId);
+        src.SetRevision(_lastMutationId);
+
+        std::swap(til::at(_rowMap, position), til::at(_rowMap, other));
+        til::at(_rowMapInverse, til::at(_rowMap, position)) = gsl::narrow_cast<uint16_t>(position);
+        til::at(_rowMapInverse, til::at(_rowMap, other)) = gsl::narrow_cast<uint16_t>(other);
+    }
+
+    _rowMap = {};
+    _rowMapInverse = {};
+
+    // The hyperlink references are tracked by ROW offset and the contents just moved between ROWs.
+    if (_hyperlinkTracking)
+    {
+        _hyperlinkRefsStale = true;
+    }
 }
 
-// Constructs ROWs between [_commitWatermark,until).
+// Constructs ROWs between [_commitWatermark,until). The watermark is only advanced afterwards,
+// because readers that see a ROW below it access it without holding _materializeLock.
 void TextBuffer::_construct(const std::byte* until) noexcept
 {
-    for (; _commitWatermark < until; _commitWatermark += _bufferRowStride)
+    auto it = _commitWatermark.load(std::memory_order_relaxed);
+    for (; it < until; it += _bufferRowStride)
     {
-        const auto row = reinterpret_cast<ROW*>(_commitWatermark);
-        const auto chars = reinterpret_cast<wchar_t*>(_commitWatermark + _bufferOffsetChars);
-        const auto indices = reinterpret_cast<uint16_t*>(_commitWatermark + _bufferOffsetCharOffsets);
-        std::construct_at(row, chars, indices, _width, _initialAttributes);
+        _constructRow(it);
     }
+    _commitWatermark.store(it, std::memory_order_release);
+}
+
+// Constructs the ROW at the given address in the arena, which must point at the start of a row.
+void TextBuffer::_constructRow(std::byte* row) const noexcept
+{
+    const auto chars = reinterpret_cast<wchar_t*>(row + _bufferOffsetChars);
+    const auto indices = reinterpret_cast<uint16_t*>(row + _bufferOffsetCharOffsets);
+    std::construct_at(reinterpret_cast<ROW*>(row), chars, indices, _width, _initialAttributes);
 }
 
-// Destructs ROWs between [_buffer,_commitWatermark).
+// Destructs ROWs between [_buffer,_commitWatermark), except for those in the compact tier.
 void TextBuffer::_destroy() const noexcept
 {
-    for (auto it = _buffer.get(); it < _commitWatermark; it += _bufferRowStride)
+    size_t offset = 0;
+    const auto watermark = _commitWatermark.load(std::memory_order_relaxed);
+    for (auto it = _buffer.get(); it < watermark; it += _bufferRowStride, ++offset)
+    {
+        if (!_isCompactRow(offset))
+        {
+            std::destroy_at(reinterpret_cast<ROW*>(it));
+        }
+    }
+}
+
+// Returns true if the ROW at the given offset was moved into the compact tier and isn't constructed.
+// Once this returns false, the ROW can be accessed without holding _materializeLock. See _expandChunk().
+bool TextBuffer::_isCompactRow(size_t offset) const noexcept
+{
+    if (_compactChunkCount.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
+    auto& compact = const_cast<bool&>(til::at(_compactChunks, offset / _compactChunkRowCount).compact);
+    return std::atomic_ref{ compact }.load(std::memory_order_acquire);
+}
+
+// Moves the ROWs of the given chunk into the compact tier, if all of them are more than _compactDistance rows
+// above the cursor. Their text is run-length encoded (see ROW::Compact()), the ROWs are destroyed
+// and the pages that the chunk doesn't share with its neighbors are MEM_DECOMMIT'd.
+void TextBuffer::_compactChunk(size_t chunk)
+{
+    const auto beg = chunk * _compactChunkRowCount;
+    const auto end = std::min(beg + _compactChunkRowCount, static_cast<size_t>(_height) + 1);
+    const auto begRow = _buffer.get() + beg * _bufferRowStride;
+    const auto endRow = _buffer.get() + end * _bufferRowStride;
+
+    // The first chunk holds the scratchpad row, which callers may hold on to at any time.
+    // Chunks that aren't fully committed yet can't be far enough above the cursor anyways.
+    if (beg == 0 || beg >= end || endRow > _commitWatermark.load(std::memory_order_relaxed) || til::at(_compactChunks, chunk).compact)
+    {
+        return;
+    }
+
+    // The first row is excluded, because IncrementCircularBuffer() is about to recycle it. This also excludes
+    // chunks that contain both the last row and the first row (the wrap-around point) of the circular buffer.
+    const auto limit = _cursor.GetPosition().y - _compactDistance;
+    for (auto offset = beg; offset < end; ++offset)
+    {
+        const auto y = _rowIndexOfOffset(offset);
+        if (y == 0 || y >= limit)
+        {
+            return;
+        }
+    }
+
+    // ImageSlices are too large to be worth compacting the rest of their row.
+    for (auto it = begRow; it < endRow; it += _bufferRowStride)
+    {
+        if (reinterpret_cast<const ROW*>(it)->GetImageSlice())
+        {
+            return;
+        }
+    }
+
+    CompactChunk compact;
+    compact.compact = true;
+    auto release = wil::scope_exit([&]() noexcept {
+        _releaseCompactAttributes(compact.attrRuns);
+    });
+    compact.rows.reserve(end - beg);
+    for (auto it = begRow; it < endRow; it += _bufferRowStride)
+    {
+        auto row = reinterpret_cast<const ROW*>(it)->Compact(compact.pool);
+        _internCompactAttributes(row, compact);
+        compact.rows.emplace_back(std::move(row));
+    }
+    compact.pool.shrink_to_fit();
+    compact.attrRuns.shrink_to_fit();
+
+    // Nothing below this point may throw, or the ROWs would be lost.
+    release.release();
+    til::at(_compactChunks, chunk) = std::move(compact);
+    _compactChunkCount++;
+
+    for (auto it = begRow; it < endRow; it += _bufferRowStride)
     {
         std::destroy_at(reinterpret_cast<ROW*>(it));
     }
+
+    // This skips the pages that are shared with the neighboring chunks.
+    _buffer.decommit(begRow, endRow - begRow);
+}
+
+// MEM_COMMITs the memory of a compact chunk and reconstructs its ROWs. See _compactChunk().
+//
+// This is the counterpart to _commit() and noinline for the same reason.
+__declspec(noinline) void TextBuffer::_expandChunk(size_t chunk)
+{
+    // Another reader may have expanded the chunk while we waited for the lock.
+    const std::lock_guard guard{ _materializeLock };
+    auto& slot = til::at(_compactChunks, chunk);
+    if (!slot.compact)
+    {
+        return;
+    }
+
+    const auto beg = chunk * _compactChunkRowCount;
+    const auto begRow = _buffer.get() + beg * _bufferRowStride;
+    const auto size = slot.rows.size() * _bufferRowStride;
+
+    _buffer.commit(begRow, size);
+
+    // slot.compact remains set, because readers that don't hold _materializeLock only look at that.
+    CompactChunk compact{ true, std::exchange(slot.rows, {}), std::exchange(slot.pool, {}), std::exchange(slot.attrRuns, {}) };
+
+    for (auto it = begRow; it < begRow + size; it += _bufferRowStride)
+    {
+        _constructRow(it);
+    }
+
+    // Once the ROWs are constructed the chunk is hot again, even if ROW::Expand() were to fail.
+    // It's published as such only after they've been filled in, so that other readers can't observe them blank.
+    const auto publish = wil::scope_exit([&]() noexcept {
+        std::atomic_ref{ slot.compact }.store(false, std::memory_order_release);
+        _releaseCompactAttributes(compact.attrRuns);
+        if (_compactChunkCount.fetch_sub(1, std::memory_order_release) == 1)
+        {
+            _clearCompactAttributes();
+        }
+    });
+
+    auto it = begRow;
+    for (auto& row : compact.rows)
+    {
+        if (row.attrRunCount != 0)
+        {
+            decltype(row.attr)::container runs;
+            for (const auto& run : std::span{ compact.attrRuns }.subspan(row.attrRunOffset, row.attrRunCount))
+            {
+                runs.emplace_back(til::at(_compactAttributes, run.id), run.length);
+            }
+            row.attr = decltype(row.attr){ std::move(runs) };
+        }
+
+        reinterpret_cast<ROW*>(it)->Expand(std::move(row), compact.pool);
+        it += _bufferRowStride;
+    }
+}
+
+// Moves the attribute runs of a compacted ROW into the chunk's attrRuns, as IDs into _compactAttributes.
+// Rows with a single run keep it, because CompactRow stores it inline anyways. So do the rows
+// whose attributes don't fit into the 16-bit IDs anymore.
+void TextBuffer::_internCompactAttributes(CompactRow& row, CompactChunk& chunk)
+{
+    const auto& runs = row.attr.runs();
+    if (runs.size() <= 1)
+    {
+        return;
+    }
+
+    const auto beg = chunk.attrRuns.size();
+    // If anything below throws, the references this row took so far must be released again.
+    auto rollback = wil::scope_exit([&]() noexcept {
+        _releaseCompactAttributes(std::span{ chunk.attrRuns }.subspan(beg));
+        chunk.attrRuns.resize(beg);
+    });
+
+    for (const auto& run : runs)
+    {
+        auto id = _compactAttributes.size();
+        if (const auto it = _compactAttributeIds.find(run.value); it != _compactAttributeIds.end())
+        {
+            id = it->second;
+        }
+        else if (!_compactAttributeFreeIds.empty())
+        {
+            id = _compactAttributeFreeIds.back();
+            _compactAttributeIds.emplace(run.value, gsl::narrow_cast<uint16_t>(id));
+            _compactAttributeFreeIds.pop_back();
+            til::at(_compactAttributes, id) = run.value;
+        }
+        else if (id > UINT16_MAX)
+        {
+            return;
+        }
+        else
+        {
+            _compactAttributes.emplace_back(run.value);
+            _compactAttributeRefCounts.emplace_back(0);
+            _compactAttributeFreeIds.reserve(_compactAttributes.capacity());
+            _compactAttributeIds.emplace(run.value, gsl::narrow_cast<uint16_t>(id));
+        }
+
+        chunk.attrRuns.push_back({ gsl::narrow_cast<uint16_t>(id), run.length });
+        til::at(_compactAttributeRefCounts, id)++;
+    }
+
+    rollback.release();
+
+    row.attrRunOffset = gsl::narrow<uint32_t>(beg);
+    row.attrRunCount = gsl::narrow<uint16_t>(chunk.attrRuns.size() - beg);
+    row.attr = {};
+}
+
+// Releases the references that _internCompactAttributes() took for the given runs.
+// The IDs that aren't referenced anymore get reused by the next attributes that are interned.
+void TextBuffer::_releaseCompactAttributes(const std::span<const CompactAttributeRun> runs) noexcept
+{
+    for (const auto& run : runs)
+    {
+        auto& refCount = til::at(_compactAttributeRefCounts, run.id);
+        if (--refCount == 0)
+        {
+            _compactAttributeIds.erase(til::at(_compactAttributes, run.id));
+            // Can't throw, since the capacity was reserved by _internCompactAttributes().
+            _compactAttributeFreeIds.push_back(run.id);
+        }
+    }
+}
+
+// Drops the interned attributes. Only valid once no chunk is compact.
+void TextBuffer::_clearCompactAttributes() noexcept
+{
+    _compactAttributes = {};
+    _compactAttributeIds = {};
+    _compactAttributeRefCounts = {};
+    _compactAttributeFreeIds = {};
+}
+
+size_t TextBuffer::TextAttributeHasher::operator()(const TextAttribute& attr) const noexcept
+{
+    return til::hash(&attr, sizeof(attr));
+}
+
+// Called whenever a row scrolls out at the top. Compacts the chunk that contains the row that just
+// moved _compactDistance rows above the cursor, as well as one more chunk in round-robin order.
+// The latter eventually returns chunks to the compact tier, which were expanded by reading them.
+//
+// This never happens as part of accessing a row, because callers may hold on to several ROW references at once.
+void TextBuffer::_compactScrollback() noexcept
+try
+{
+    const auto limit = _cursor.GetPosition().y - _compactDistance;
+    if (_compactDistance <= 0 || limit <= 0)
+    {
+        return;
+    }
+
+    const auto chunkCount = (static_cast<size_t>(_height) + _compactChunkRowCount) / _compactChunkRowCount;
+    if (_compactChunks.empty())
+    {
+        _compactChunks.resize(chunkCount);
+    }
+
+    _compactChunk(_rowOffset(limit - 1) / _compactChunkRowCount);
+
+    _compactSweep = (_compactSweep + 1) % chunkCount;
+    _compactChunk(_compactSweep);
 }
+CATCH_LOG()
 
 // This function is "direct" because it trusts the caller to properly
 // wrap the "offset" parameter modulo the _height of the buffer.
@@ -178,31 +565,77 @@ ROW& TextBuffer::_getRowByOffsetDirect(size_t offset)
     const auto row = _buffer.get() + _bufferRowStride * offset;
     THROW_HR_IF(E_UNEXPECTED, row < _buffer.get() || row >= _bufferEnd);
 
-    if (row >= _commitWatermark)
+    if (row >= _commitWatermark.load(std::memory_order_acquire))
     {
         _commit(row);
     }
+    else if (_isCompactRow(offset))
+    {
+        _expandChunk(offset / _compactChunkRowCount);
+    }
 
     return *reinterpret_cast<ROW*>(row);
 }
 
 // See GetRowByOffset().
 ROW& TextBuffer::_getRow(til::CoordType y) const
+{
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
+    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(_rowOffset(y));
+}
+
+// Returns the offset of the ROW for the given row index in _buffer, in units of _bufferRowStride.
+size_t TextBuffer::_rowOffset(til::CoordType y) const noexcept
 {
     // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
-    auto offset = (_firstRow + y) % _height;
+    auto position = (_firstRow + y) % _height;
 
     // Support negative wrap around. This way an index of -1 will
     // wrap to _rowCount-1 and make implementing scrolling easier.
-    if (offset < 0)
+    if (position < 0)
     {
-        offset += _height;
+        position += _height;
+    }
+
+    auto offset = gsl::narrow_cast<size_t>(position);
+    if (!_rowMap.empty())
+    {
+        offset = til::at(_rowMap, offset);
     }
 
     // We add 1 to the row offset, because row "0" is the one returned by GetScratchpadRow().
     // See GetScratchpadRow() for more explanation.
-#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
-    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(gsl::narrow_cast<size_t>(offset) + 1);
+    return offset + 1;
+}
+
+// Returns the position `(_firstRow + y) % _height` of the given row index in the circular buffer.
+// Unlike the offset returned by _rowOffset() it's unaffected by _rowMap.
+til::CoordType TextBuffer::_rowPosition(const til::CoordType y) const noexcept
+{
+    auto position = (_firstRow + y) % _height;
+    if (position < 0)
+    {
+        position += _height;
+    }
+    return position;
+}
+
+// Returns the compact form of the ROW at the given offset, which must be in the compact tier.
+const CompactRow& TextBuffer::_compactRowAt(const size_t offset) const
+{
+    const auto chunk = offset / _compactChunkRowCount;
+    return til::at(til::at(_compactChunks, chunk).rows, offset - chunk * _compactChunkRowCount);
+}
+
+// The reverse of _rowOffset(). The offset must not be the one of the scratchpad row.
+til::CoordType TextBuffer::_rowIndexOfOffset(size_t offset) const noexcept
+{
+    auto position = gsl::narrow_cast<til::CoordType>(offset - 1);
+    if (!_rowMapInverse.empty())
+    {
+        position = til::at(_rowMapInverse, offset - 1);
+    }
+    return (position - _firstRow + _height) % _height;
 }
 
 // Returns the "user-visible" index of the last committed row, which can be used
@@ -210,7 +643,7 @@ ROW& TextBuffer::_getRow(til::CoordType y) const
 // Returns 0 if no rows are committed in.
 til::CoordType TextBuffer::_estimateOffsetOfLastCommittedRow() const noexcept
 {
-    const auto lastRowOffset = (_commitWatermark - _buffer.get()) / _bufferRowStride;
+    const auto lastRowOffset = (_commitWatermark.load(std::memory_order_relaxed) - _buffer.get()) / _bufferRowStride;
     // This subtracts 2 from the offset to account for the:
     // * scratchpad row at offset 0, whereas regular rows start at offset 1.
     // * fact that _commitWatermark points _past_ the last committed row,
@@ -220,6 +653,11 @@ til::CoordType TextBuffer::_estimateOffsetOfLastCommittedRow() const noexcept
 
 // Retrieves a row from the buffer by its offset from the first row of the text buffer
 // (what corresponds to the top row of the screen buffer).
+//
+// Accessing a compact row expands its entire chunk, because callers may hold on to any number
+// of ROW references at once. Scanning the entire buffer (e.g. searching it) thus undoes compaction.
+// That's temporary: _compactScrollback() visits one chunk per IncrementCircularBuffer() call and
+// compacts it again, so the memory is recovered after scrolling as many lines as there are chunks.
 const ROW& TextBuffer::GetRowByOffset(const til::CoordType index) const
 {
     return _getRow(index);
@@ -230,7 +668,14 @@ const ROW& TextBuffer::GetRowByOffset(const til::CoordType index) const
 ROW& TextBuffer::GetMutableRowByOffset(const til::CoordType index)
 {
     _lastMutationId++;
-    return _getRow(index);
+    const auto offset = _rowOffset(index);
+    auto& row = _getRowByOffsetDirect(offset);
+    row.SetRevision(_lastMutationId);
+    if (_hyperlinkTracking) [[unlikely]]
+    {
+        _trackHyperlinkRow(offset);
+    }
+    return row;
 }
 
 // Returns a row filled with whitespace and the current attributes, for you to freely use.
@@ -263,6 +708,7 @@ ROW& TextBuffer::GetScratchpadRow(const TextAttribute& attributes)
 void TextBuffer::CopyProperties(const TextBuffer& OtherBuffer) noexcept
 {
     GetCursor().CopyProperties(OtherBuffer.GetCursor());
+    _compactDistance = OtherBuffer._compactDistance;
 }
 
 // Routine Description:
@@ -416,10 +862,8 @@ size_t TextBuffer::FitTextIntoColumns(const std::wstring_view& chars, til::Coord
     auto it = beg;
     const auto asciiEnd = beg + std::min(chars.size(), gsl::narrow_cast<size_t>(columnLimit));
 
-    // ASCII fast-path: 1 char always corresponds to 1 column.
-    for (; it != asciiEnd && *it < 0x80; ++it)
-    {
-    }
+    // Narrow fast-path: 1 char always corresponds to 1 column for ASCII and most other non-joining narrow text.
+    it += CodepointWidthDetector::Singleton().NarrowRunLength({ beg, asciiEnd });
 
     auto dist = gsl::narrow_cast<size_t>(it - beg);
     auto col = gsl::narrow_cast<til::CoordType>(dist);
@@ -434,8 +878,8 @@ size_t TextBuffer::FitTextIntoColumns(const std::wstring_view& chars, til::Coord
     auto& cwd = CodepointWidthDetector::Singleton();
     const auto len = chars.size();
 
-    // The non-ASCII character we have encountered may be a combining mark, like "a^" which is then displayed as "â".
-    // In order to recognize both characters as a single grapheme, we need to back up by 1 ASCII character
+    // The character we have encountered may be a combining mark, like "a^" which is then displayed as "â".
+    // In order to recognize both characters as a single grapheme, we need to back up by 1 narrow character
     // and let GraphemeNext() find the next proper grapheme boundary.
     if (dist != 0)
     {
@@ -719,6 +1163,7 @@ void TextBuffer::IncrementCircularBuffer(const TextAttribute& fillAttributes)
     _PruneHyperlinks();
 
     // Second, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
+    _removeMarks(0, 1);
     GetMutableRowByOffset(0).Reset(fillAttributes);
     {
         // Now proceed to increment.
@@ -731,6 +1176,8 @@ void TextBuffer::IncrementCircularBuffer(const TextAttribute& fillAttributes)
             _firstRow = 0;
         }
     }
+
+    _compactScrollback();
 }
 
 //Routine Description:
@@ -786,6 +1233,50 @@ const Viewport TextBuffer::GetSize() const noexcept
     return Viewport::FromDimensions({}, { _width, _height });
 }
 
+// Sets how many ROWs _commit() constructs beyond the one that's being accessed. Larger values mean fewer
+// calls into the OS while filling the buffer, smaller ones less memory for buffers that are rarely full.
+void TextBuffer::SetCommitReadAhead(const size_t rows) noexcept
+{
+    _commitReadAheadRowCount = rows;
+}
+
+// Sets how many rows above the cursor a row needs to be before it's moved into the compact tier.
+// Values <= 0 disable the compact tier. Rows that are already compact remain so until they're accessed.
+void TextBuffer::SetCompactDistance(const til::CoordType distance) noexcept
+{
+    _compactDistance = distance;
+}
+
+TextBuffer::MemoryStatistics TextBuffer::GetMemoryStatistics() const noexcept
+{
+    MemoryStatistics stats;
+
+    const auto committedRows = gsl::narrow_cast<size_t>((_commitWatermark.load(std::memory_order_relaxed) - _buffer.get()) / _bufferRowStride);
+    for (const auto& chunk : _compactChunks)
+    {
+        stats.compactRows += chunk.rows.size();
+        stats.compactBytes += chunk.rows.capacity() * sizeof(CompactRow) + chunk.pool.capacity() * sizeof(uint16_t);
+        stats.compactBytes += chunk.attrRuns.capacity() * sizeof(CompactAttributeRun);
+        for (const auto& row : chunk.rows)
+        {
+            // Only runs beyond the inline capacity of 1 are stored on the heap.
+            const auto capacity = row.attr.runs().capacity();
+            stats.compactBytes += capacity > 1 ? capacity * sizeof(til::rle_pair<TextAttribute, uint16_t>) : 0;
+        }
+    }
+
+    // The interned attributes shared by all chunks. The map's nodes are roughly 2 pointers + key + value.
+    stats.compactBytes += _compactAttributes.capacity() * sizeof(TextAttribute);
+    stats.compactBytes += _compactAttributeIds.size() * (2 * sizeof(void*) + sizeof(TextAttribute) + sizeof(uint16_t));
+    stats.compactBytes += _compactAttributeRefCounts.capacity() * sizeof(uint32_t);
+    stats.compactBytes += _compactAttributeFreeIds.capacity() * sizeof(uint16_t);
+
+    stats.hotRows = committedRows - stats.compactRows;
+    stats.hotBytes = stats.hotRows * _bufferRowStride;
+    stats.committedBytes = _buffer.committed(_buffer.get(), _buffer.size());
+    return stats;
+}
+
 void TextBuffer::_SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept
 {
     _firstRow = FirstRowIndex;
@@ -802,6 +1293,33 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size,
     // A negative size doesn't make any sense anyways.
     size = std::max(0, size);
 
+    // If the source and the destination overlap (as is the case for scroll regions, IL and DL) we don't need to
+    // copy the rows. Instead, we rotate the ROWs within the union of both ranges into place. This leaves `distance`
+    // rows at the other end of the range that contain what got scrolled out. Since they're expected to still hold
+    // their previous contents, like with the copy loop further below, we copy those back. So, scrolling a region
+    // by 1 line copies 1 row instead of all of them. Most callers will erase those rows right after anyways.
+    if (const auto distance = std::abs(delta); distance < size && size + distance <= _height)
+    {
+        if (delta < 0)
+        {
+            const auto end = firstRow + size;
+            _rotateRows(firstRow + delta, end, delta);
+            for (auto y = end - distance; y < end; ++y)
+            {
+                CopyRow(y - distance, y, *this);
+            }
+        }
+        else
+        {
+            _rotateRows(firstRow, firstRow + size + delta, delta);
+            for (auto y = firstRow; y < firstRow + distance; ++y)
+            {
+                CopyRow(y + distance, y, *this);
+            }
+        }
+        return;
+    }
+
     til::CoordType y = 0;
     til::CoordType end = 0;
     til::CoordType step = 0;
@@ -861,33 +1379,113 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size,
     }
 }
 
-void TextBuffer::CopyRow(const til::CoordType srcRowIndex, const til::CoordType dstRowIndex, TextBuffer& dstBuffer) const
-{
-    auto& dstRow = dstBuffer.GetMutableRowByOffset(dstRowIndex);
-    const auto& srcRow = GetRowByOffset(srcRowIndex);
-    dstRow.CopyFrom(srcRow);
-    ImageSlice::CopyRow(srcRow, dstRow);
-}
-
-Cursor& TextBuffer::GetCursor() noexcept
+// Moves the ROWs in the range [beg,end) by `shift` rows, wrapping around within the range, without copying them.
+// In other words, the row at `y` ends up at `beg + (y - beg + shift) % (end - beg)`. See ScrollRows().
+void TextBuffer::_rotateRows(const til::CoordType beg, const til::CoordType end, const til::CoordType shift)
 {
-    return _cursor;
-}
+    const auto count = end - beg;
+    if (count <= 0)
+    {
+        return;
+    }
 
-const Cursor& TextBuffer::GetCursor() const noexcept
-{
-    return _cursor;
-}
+    // All of the ROWs changed their position, so they need to be marked as modified. This also commits
+    // (or expands) them, which ensures that the permutation never involves any uncommitted ROWs.
+    // _estimateOffsetOfLastCommittedRow() relies on this.
+    _lastMutationId++;
+    for (auto y = beg; y < end; ++y)
+    {
+        _getRow(y).SetRevision(_lastMutationId);
+    }
 
-uint64_t TextBuffer::GetLastMutationId() const noexcept
-{
-    return _lastMutationId;
-}
+    if (_rowMap.empty())
+    {
+        _rowMap.resize(_height);
+        std::iota(_rowMap.begin(), _rowMap.end(), uint16_t{ 0 });
+        _rowMapInverse = _rowMap;
+    }
 
-const TextAttribute& TextBuffer::GetCurrentAttributes() const noexcept
-{
-    return _currentAttributes;
-}
+    const auto position = [&](const til::CoordType y) noexcept {
+        auto p = (_firstRow + y) % _height;
+        if (p < 0)
+        {
+            p += _height;
+        }
+        return gsl::narrow_cast<size_t>(p);
+    };
+    // Like std::reverse(), but the range may wrap around the end of the circular buffer.
+    const auto reverse = [&](til::CoordType lo, til::CoordType hi) noexcept {
+        for (--hi; lo < hi; ++lo, --hi)
+        {
+            std::swap(til::at(_rowMap, position(lo)), til::at(_rowMap, position(hi)));
+        }
+    };
+
+    // Rotating right by k is the same as reversing the entire range and then the first k and the remaining items.
+    auto k = shift % count;
+    if (k < 0)
+    {
+        k += count;
+    }
+    reverse(beg, end);
+    reverse(beg, beg + k);
+    reverse(beg + k, end);
+
+    // The marks move along with their rows.
+    if (!_markPositions.empty())
+    {
+        const auto begPosition = _rowPosition(beg);
+        for (auto& p : _markPositions)
+        {
+            const auto i = (p - begPosition + _height) % _height;
+            if (i < count)
+            {
+                p = _rowPosition(beg + (i + k) % count);
+            }
+        }
+        std::sort(_markPositions.begin(), _markPositions.end());
+    }
+
+    for (auto y = beg; y < end; ++y)
+    {
+        const auto p = position(y);
+        til::at(_rowMapInverse, til::at(_rowMap, p)) = gsl::narrow_cast<uint16_t>(p);
+    }
+}
+
+void TextBuffer::CopyRow(const til::CoordType srcRowIndex, const til::CoordType dstRowIndex, TextBuffer& dstBuffer) const
+{
+    auto& dstRow = dstBuffer.GetMutableRowByOffset(dstRowIndex);
+    const auto& srcRow = GetRowByOffset(srcRowIndex);
+    dstRow.CopyFrom(srcRow);
+    ImageSlice::CopyRow(srcRow, dstRow);
+
+    // The mark was copied along with the contents. Stale entries in _markPositions are fine, missing ones aren't.
+    if (dstRow.GetScrollbarData().has_value())
+    {
+        dstBuffer._addMark(dstRowIndex);
+    }
+}
+
+Cursor& TextBuffer::GetCursor() noexcept
+{
+    return _cursor;
+}
+
+const Cursor& TextBuffer::GetCursor() const noexcept
+{
+    return _cursor;
+}
+
+uint64_t TextBuffer::GetLastMutationId() const noexcept
+{
+    return _lastMutationId;
+}
+
+const TextAttribute& TextBuffer::GetCurrentAttributes() const noexcept
+{
+    return _currentAttributes;
+}
 
 void TextBuffer::SetCurrentAttributes(const TextAttribute& currentAttributes) noexcept
 {
@@ -1006,11 +1604,13 @@ void TextBuffer::ClearScrollback(const til::CoordType newFirstRow, const til::Co
     _firstRow = 0;
     ScrollRows(startAbsolute, rowsToKeep, -startAbsolute);
 
-    const auto end = _estimateOffsetOfLastCommittedRow();
-    for (auto y = rowsToKeep; y <= end; ++y)
-    {
-        GetMutableRowByOffset(y).Reset(_initialAttributes);
-    }
+    // Instead of resetting the remaining rows one by one, we destroy them and return their memory to the OS.
+    // They get committed and constructed on demand again, with _initialAttributes, just like after Reset().
+    // This requires the rows we kept to be stored in order at the start of the buffer, which _rowMap may not be.
+    _resetRowMap(rowsToKeep);
+    _decommitFrom(gsl::narrow_cast<size_t>(rowsToKeep) + 1);
+
+    _rebuildMarks();
 }
 
 // Routine Description:
@@ -1044,15 +1644,24 @@ void TextBuffer::ResizeTraditional(til::size newSize)
     // NOTE: Keep this in sync with _reserve().
     _buffer = std::move(newBuffer._buffer);
     _bufferEnd = newBuffer._bufferEnd;
-    _commitWatermark = newBuffer._commitWatermark;
+    _commitWatermark = newBuffer._commitWatermark.load(std::memory_order_relaxed);
     _initialAttributes = newBuffer._initialAttributes;
     _bufferRowStride = newBuffer._bufferRowStride;
     _bufferOffsetChars = newBuffer._bufferOffsetChars;
     _bufferOffsetCharOffsets = newBuffer._bufferOffsetCharOffsets;
     _width = newBuffer._width;
     _height = newBuffer._height;
+    _compactChunks = {};
+    _compactChunkCount = 0;
+    _clearCompactAttributes();
+    _rowMap = {};
+    _rowMapInverse = {};
+    _compactSweep = 0;
+    // The ROW offsets have all changed, so the hyperlink references need to be recounted.
+    _hyperlinkRefsStale = _hyperlinkTracking;
 
     _SetFirstRowIndex(0);
+    _rebuildMarks();
 }
 
 void TextBuffer::SetAsActiveBuffer(const bool isActiveBuffer) noexcept
@@ -1624,50 +2233,154 @@ til::point TextBuffer::_GetWordEndForSelection(const til::point target, const st
     return result;
 }
 
+// Releases the hyperlink references of the old first row, which is about to be recycled.
+// Any hyperlink that isn't referenced by another row anymore is removed from our map.
+// This way, obsolete hyperlink references are cleared from our hyperlink map instead of hanging around.
 void TextBuffer::_PruneHyperlinks()
 {
-    // Check the old first row for hyperlink references
-    // If there are any, search the entire buffer for the same reference
-    // If the buffer does not contain the same reference, we can remove that hyperlink from our map
-    // This way, obsolete hyperlink references are cleared from our hyperlink map instead of hanging around
-    // Get all the hyperlink references in the row we're erasing
-    const auto hyperlinks = GetRowByOffset(0).GetHyperlinks();
+    if (!_hyperlinkTracking) [[likely]]
+    {
+        return;
+    }
+
+    _reconcileHyperlinkRefs();
 
-    if (!hyperlinks.empty())
+    const auto it = _hyperlinkRowRefs.find(_rowOffset(0));
+    if (it == _hyperlinkRowRefs.end())
     {
-        // Move to unordered set so we can use hashed lookup of IDs instead of linear search.
-        // Only make it an unordered set now because set always heap allocates but vector
-        // doesn't when the set is empty (saving an allocation in the common case of no links.)
-        std::unordered_set<uint16_t> firstRowRefs{ hyperlinks.cbegin(), hyperlinks.cend() };
+        return;
+    }
 
-        const auto total = TotalRowCount();
-        // Loop through all the rows in the buffer except the first row -
-        // we have found all hyperlink references in the first row and put them in refs,
-        // now we need to search the rest of the buffer (i.e. all the rows except the first)
-        // to see if those references are anywhere else
-        for (til::CoordType i = 1; i < total; ++i)
+    for (const auto id : it->second)
+    {
+        if (_releaseHyperlinkRef(id))
         {
-            const auto nextRowRefs = GetRowByOffset(i).GetHyperlinks();
-            for (auto id : nextRowRefs)
-            {
-                if (firstRowRefs.find(id) != firstRowRefs.end())
-                {
-                    firstRowRefs.erase(id);
-                }
-            }
-            if (firstRowRefs.empty())
+            RemoveHyperlinkFromMap(id);
+        }
+    }
+    _hyperlinkRowRefs.erase(it);
+}
+
+// Remembers that the ROW at the given offset may have changed its hyperlinks. See GetMutableRowByOffset().
+void TextBuffer::_trackHyperlinkRow(const size_t offset)
+{
+    // Writes tend to hit the same row many times in a row, so this catches most duplicates.
+    if (!_hyperlinkDirtyRows.empty() && _hyperlinkDirtyRows.back() == offset)
+    {
+        return;
+    }
+    // Once more rows were modified than the buffer has, rebuilding the counts is cheaper than recounting them.
+    if (_hyperlinkRefsStale || _hyperlinkDirtyRows.size() >= _height)
+    {
+        _hyperlinkDirtyRows.clear();
+        _hyperlinkRefsStale = true;
+        return;
+    }
+    _hyperlinkDirtyRows.emplace_back(offset);
+}
+
+// Brings _hyperlinkRefCounts up to date with the current contents of the buffer.
+void TextBuffer::_reconcileHyperlinkRefs()
+{
+    if (_hyperlinkRefsStale)
+    {
+        _hyperlinkRefCounts.clear();
+        _hyperlinkRowRefs.clear();
+        _hyperlinkDirtyRows.clear();
+        _hyperlinkRefsStale = false;
+
+        const auto committedRows = gsl::narrow_cast<size_t>((_commitWatermark.load(std::memory_order_relaxed) - _buffer.get()) / _bufferRowStride);
+        // Offset 0 is the scratchpad row, which isn't part of the buffer.
+        for (size_t offset = 1; offset < committedRows; ++offset)
+        {
+            _addHyperlinkRefs(offset, _hyperlinksOfRow(offset));
+        }
+        return;
+    }
+
+    for (const auto offset : _hyperlinkDirtyRows)
+    {
+        // The old references are released after adding the new ones, so that
+        // IDs the row still contains don't drop to zero in between.
+        auto oldIds = std::move(_hyperlinkRowRefs[offset]);
+        _hyperlinkRowRefs.erase(offset);
+        _addHyperlinkRefs(offset, _hyperlinksOfRow(offset));
+        for (const auto id : oldIds)
+        {
+            // IDs that are only overwritten stay in the map, because the current
+            // attributes may still refer to them. Only evictions remove them.
+            _releaseHyperlinkRef(id);
+        }
+    }
+    _hyperlinkDirtyRows.clear();
+}
+
+// Returns the sorted, unique hyperlink IDs used by the ROW at the given offset.
+// Compact ROWs are read from the compact tier, without reconstructing them.
+std::vector<uint16_t> TextBuffer::_hyperlinksOfRow(const size_t offset) const
+{
+    std::vector<uint16_t> ids;
+    if (_isCompactRow(offset))
+    {
+        const auto collect = [&](const TextAttribute& attr) {
+            if (attr.IsHyperlink())
             {
-                // No more hyperlink references left to search for, terminate early
-                break;
+                ids.emplace_back(attr.GetHyperlinkId());
             }
+        };
+
+        const auto& row = _compactRowAt(offset);
+        for (const auto& run : row.attr.runs())
+        {
+            collect(run.value);
         }
 
-        // Now delete obsolete references from our map
-        for (auto hyperlinkReference : firstRowRefs)
+        const auto& chunk = til::at(_compactChunks, offset / _compactChunkRowCount);
+        for (const auto& run : std::span{ chunk.attrRuns }.subspan(row.attrRunOffset, row.attrRunCount))
+        {
+            collect(til::at(_compactAttributes, run.id));
+        }
+    }
+    else
+    {
+        const auto row = _buffer.get() + _bufferRowStride * offset;
+        if (row < _commitWatermark.load(std::memory_order_relaxed))
         {
-            RemoveHyperlinkFromMap(hyperlinkReference);
+            ids = reinterpret_cast<const ROW*>(row)->GetHyperlinks();
         }
     }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+void TextBuffer::_addHyperlinkRefs(const size_t offset, std::vector<uint16_t>&& ids)
+{
+    if (ids.empty())
+    {
+        return;
+    }
+    for (const auto id : ids)
+    {
+        ++_hyperlinkRefCounts[id];
+    }
+    _hyperlinkRowRefs.insert_or_assign(offset, std::move(ids));
+}
+
+// Returns true if that was the last reference to the given hyperlink ID.
+bool TextBuffer::_releaseHyperlinkRef(const uint16_t id) noexcept
+{
+    const auto it = _hyperlinkRefCounts.find(id);
+    if (it == _hyperlinkRefCounts.end())
+    {
+        return false;
+    }
+    if (--it->second != 0)
+    {
+        return false;
+    }
+    _hyperlinkRefCounts.erase(it);
+    return true;
 }
 
 // Method Description:
@@ -2680,117 +3393,560 @@ void TextBuffer::SerializeToPath(const wchar_t* destination) const
     }
 }
 
-// Serializes one row of the text buffer including ANSI escape code control sequences.
-// Arguments:
-// - row - A reference to the row being serialized.
-// - startX - The first column (inclusive) to include in the serialized content.
-// - endX - The last column (exclusive) to include in the serialized content.
-// - addLineBreak - Whether to add a line break at the end of the serialized row.
-// - isLastRow - Whether this is the final row to be serialized.
-// - buffer - A string to write the serialized row into.
-// - previousTextAttr - Used for tracking state across multiple calls to `_SerializeRow` for sequential rows.
-//      The value will be mutated by the call. The initial call should contain `nullopt`, and subsequent calls
-//      should pass the value that was written by the previous call.
-// - delayedLineBreak - Similarly used for tracking state across multiple calls, and similarly will be mutated
-//      by the call. The initial call should pass `false` and subsequent calls should pass the value that was
-//      written by the previous call.
-void TextBuffer::_SerializeRow(const ROW& row, const til::CoordType startX, const til::CoordType endX, const bool addLineBreak, const bool isLastRow, std::wstring& buffer, std::optional<TextAttribute>& previousTextAttr, bool& delayedLineBreak) const
+// Snapshots are a binary alternative to SerializeToPath() that preserve the buffer contents exactly and can be
+// read straight out of a memory mapped file: A SnapshotHeader is followed by the hyperlink tables and then by one
+// SnapshotRow per row. All values are in native byte order and all records are padded to a multiple of 4 bytes.
+// TextAttributes are stored as-is, which is why attributeSize and the version need to match when reading.
+// They're validated field by field when reading, see isValidSnapshotAttribute().
+namespace
 {
-    if (const auto lr = row.GetLineRendition(); lr != LineRendition::SingleWidth)
+    constexpr uint32_t snapshotMagic = 0x57544253; // "SBTW" in little endian
+    constexpr uint32_t snapshotVersion = 1;
+
+    struct SnapshotHeader
+    {
+        uint32_t magic = snapshotMagic;
+        uint32_t version = snapshotVersion;
+        uint32_t attributeSize = sizeof(TextAttribute);
+        uint32_t rowCount = 0;
+        uint16_t width = 0;
+        uint16_t currentHyperlinkId = 0;
+        // Each hyperlink is a SnapshotString with the id and the URI, and each custom id one with the id and the custom id.
+        uint32_t hyperlinkCount = 0;
+        uint32_t customIdCount = 0;
+    };
+
+    struct SnapshotString
     {
-        static constexpr std::wstring_view mappings[] = {
-            L"\x1b#6", // LineRendition::DoubleWidth
-            L"\x1b#3", // LineRendition::DoubleHeightTop
-            L"\x1b#4", // LineRendition::DoubleHeightBottom
-        };
-        const auto idx = std::clamp(static_cast<int>(lr) - 1, 0, 2);
-        buffer.append(til::at(mappings, idx));
+        uint16_t id = 0;
+        uint16_t length = 0;
+    };
+
+    // Followed by `attrRunCount` pairs of TextAttribute and uint16_t run length, an optional SnapshotScrollbarData
+    // and `textLength` uint16_t of text in the format of ROW::Compact() (the charOffsets are part of the text).
+    struct SnapshotRow
+    {
+        static constexpr uint16_t hasCharOffsets = 0x01;
+        static constexpr uint16_t wrapForced = 0x02;
+        static constexpr uint16_t doubleBytePadded = 0x04;
+        static constexpr uint16_t hasScrollbarData = 0x08;
+        static constexpr uint16_t lineRenditionShift = 4;
+
+        uint16_t columnCount = 0;
+        uint16_t charCount = 0;
+        uint16_t attrRunCount = 0;
+        uint16_t flags = 0;
+        uint32_t textLength = 0;
+    };
+
+    struct SnapshotScrollbarData
+    {
+        uint8_t category = 0;
+        uint8_t hasColor = 0;
+        uint8_t hasExitCode = 0;
+        uint8_t reserved = 0;
+        uint32_t color = 0;
+        uint32_t exitCode = 0;
+    };
+
+    static_assert(std::is_trivially_copyable_v<TextAttribute>);
+    static_assert(sizeof(SnapshotHeader) % 4 == 0 && sizeof(SnapshotString) % 4 == 0 && sizeof(SnapshotRow) % 4 == 0 && sizeof(SnapshotScrollbarData) % 4 == 0);
+
+    constexpr size_t snapshotAlign(const size_t size) noexcept
+    {
+        return (size + 3) & ~size_t{ 3 };
     }
 
-    const auto startXU16 = gsl::narrow_cast<uint16_t>(startX);
-    const auto endXU16 = gsl::narrow_cast<uint16_t>(endX);
-    const auto runs = row.Attributes().slice(startXU16, endXU16).runs();
+    // Snapshots may be corrupted or crafted, but the rest of the code assumes that colors are in their canonical
+    // form and indices are in range. Unused bytes must be zero, just like TextColor's constructors leave them.
+    bool isValidSnapshotColor(const TextColor& color) noexcept
+    {
+        switch (color.GetType())
+        {
+        case ColorType::IsDefault:
+            return color.GetIndex() == 0 && color.GetG() == 0 && color.GetB() == 0;
+        case ColorType::IsIndex16:
+            return color.GetIndex() < 16 && color.GetG() == 0 && color.GetB() == 0;
+        case ColorType::IsIndex256:
+            return color.GetG() == 0 && color.GetB() == 0;
+        case ColorType::IsRgb:
+            return true;
+        default:
+            return false;
+        }
+    }
 
-    const auto beg = runs.begin();
-    const auto end = runs.end();
-    auto it = beg;
-    // Don't try to get `end - 1` if it's an empty iterator; in this case we're going to ignore the `last`
-    // value anyway so just use `end`.
-    const auto last = it == end ? end : end - 1;
-    const auto lastCharX = row.MeasureRight();
-    til::CoordType oldX = startX;
+    // Hyperlink IDs must refer to a hyperlink in the snapshot, or TextBuffer::GetHyperlinkUriFromId() would throw.
+    bool isValidSnapshotAttribute(const TextAttribute& attr, const std::unordered_map<uint16_t, std::wstring>& hyperlinkMap) noexcept
+    {
+        const auto attrs = attr.GetCharacterAttributes();
+        const auto hyperlinkId = attr.GetHyperlinkId();
+        return isValidSnapshotColor(attr.GetForeground()) &&
+               isValidSnapshotColor(attr.GetBackground()) &&
+               isValidSnapshotColor(attr.GetUnderlineColor()) &&
+               WI_IsFlagClear(attrs, CharacterAttributes::Unused1) &&
+               attr.GetUnderlineStyle() <= UnderlineStyle::Max &&
+               attr.GetMarkAttributes() <= MarkKind::Output &&
+               (hyperlinkId == 0 || hyperlinkMap.contains(hyperlinkId));
+    }
 
-    for (; it != end; ++it)
+    // Accumulates the snapshot and writes it to the file in chunks, just like SerializeToPath().
+    class SnapshotWriter
     {
-        const auto effectivePreviousTextAttr = previousTextAttr.value_or(TextAttribute{ CharacterAttributes::Unused1, TextColor{}, TextColor{}, 0, TextColor{} });
-        const auto previousAttr = effectivePreviousTextAttr.GetCharacterAttributes();
-        const auto previousHyperlinkId = effectivePreviousTextAttr.GetHyperlinkId();
-        const auto previousFg = effectivePreviousTextAttr.GetForeground();
-        const auto previousBg = effectivePreviousTextAttr.GetBackground();
-        const auto previousUl = effectivePreviousTextAttr.GetUnderlineColor();
+    public:
+        explicit SnapshotWriter(HANDLE file) noexcept :
+            _file{ file }
+        {
+            _buffer.reserve(writeThreshold + writeThreshold / 2);
+        }
 
-        const auto attr = it->value.GetCharacterAttributes();
-        const auto hyperlinkId = it->value.GetHyperlinkId();
-        const auto fg = it->value.GetForeground();
-        const auto bg = it->value.GetBackground();
-        const auto ul = it->value.GetUnderlineColor();
+        void Write(const void* data, const size_t size)
+        {
+            const auto beg = static_cast<const std::byte*>(data);
+            _buffer.insert(_buffer.end(), beg, beg + size);
+        }
 
-        if (previousAttr != attr)
+        template<typename T>
+        void Write(const T& value)
         {
-            auto attrDelta = attr ^ previousAttr;
+            Write(&value, sizeof(T));
+        }
 
-            // There's no escape sequence that only turns off either bold/intense or dim/faint. SGR 22 turns off both.
-            // This results in two issues in our generic "Mapping" code below. Assuming, both Intense and Faint were on...
-            // * ...and either turned off, it would emit SGR 22 which turns both attributes off = Wrong.
-            // * ...and both are now off, it would emit SGR 22 twice.
-            //
-            // This extra branch takes care of both issues. If both attributes turned off it'll emit a single \x1b[22m,
-            // if faint turned off \x1b[22;1m (intense is still on), and \x1b[22;2m if intense turned off (vice versa).
-            if (WI_AreAllFlagsSet(previousAttr, CharacterAttributes::Intense | CharacterAttributes::Faint) &&
-                WI_IsAnyFlagSet(attrDelta, CharacterAttributes::Intense | CharacterAttributes::Faint))
+        void Align()
+        {
+            _buffer.resize(snapshotAlign(_buffer.size()));
+        }
+
+        void Flush(const bool force)
+        {
+            if (_buffer.size() >= writeThreshold || (force && !_buffer.empty()))
             {
-                wchar_t buf[8] = L"\x1b[22m";
-                size_t len = 5;
+                const auto fileSize = gsl::narrow<DWORD>(_buffer.size());
+                DWORD bytesWritten = 0;
+                THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file, _buffer.data(), fileSize, &bytesWritten, nullptr));
+                THROW_WIN32_IF_MSG(ERROR_WRITE_FAULT, bytesWritten != fileSize, "failed to write");
+                _buffer.clear();
+            }
+        }
 
-                if (WI_IsAnyFlagSet(attr, CharacterAttributes::Intense | CharacterAttributes::Faint))
-                {
-                    buf[4] = L';';
-                    buf[5] = WI_IsAnyFlagSet(attr, CharacterAttributes::Intense) ? L'1' : L'2';
-                    buf[6] = L'm';
-                    len = 7;
-                }
+    private:
+        static constexpr size_t writeThreshold = 32 * 1024;
 
-                buffer.append(&buf[0], len);
-                WI_ClearAllFlags(attrDelta, CharacterAttributes::Intense | CharacterAttributes::Faint);
+        HANDLE _file;
+        std::vector<std::byte> _buffer;
+    };
+
+    // A bounds checked cursor over the snapshot. All Read*() functions return false/empty spans once the data is exhausted.
+    class SnapshotReader
+    {
+    public:
+        explicit SnapshotReader(const std::span<const std::byte> data) noexcept :
+            _data{ data }
+        {
+        }
+
+        template<typename T>
+        bool Read(T& value) noexcept
+        {
+            const auto bytes = ReadBytes(sizeof(T));
+            if (bytes.size() != sizeof(T))
+            {
+                return false;
             }
+            memcpy(&value, bytes.data(), sizeof(T));
+            return true;
+        }
 
+        std::span<const std::byte> ReadBytes(const size_t size) noexcept
+        {
+            const auto aligned = snapshotAlign(size);
+            if (aligned < size || aligned > _data.size())
             {
-                struct Mapping
-                {
-                    CharacterAttributes attr;
-                    uint8_t change[2]; // [0] = off, [1] = on
-                };
-                static constexpr Mapping mappings[] = {
-                    { CharacterAttributes::Intense, { 22, 1 } },
-                    { CharacterAttributes::Italics, { 23, 3 } },
-                    { CharacterAttributes::Blinking, { 25, 5 } },
-                    { CharacterAttributes::Invisible, { 28, 8 } },
-                    { CharacterAttributes::CrossedOut, { 29, 9 } },
-                    { CharacterAttributes::Faint, { 22, 2 } },
-                    { CharacterAttributes::TopGridline, { 55, 53 } },
-                    { CharacterAttributes::ReverseVideo, { 27, 7 } },
-                };
-                for (const auto& mapping : mappings)
-                {
-                    if (WI_IsAnyFlagSet(attrDelta, mapping.attr))
-                    {
-                        const auto n = til::at(mapping.change, WI_IsAnyFlagSet(attr, mapping.attr));
-                        fmt::format_to(std::back_inserter(buffer), FMT_COMPILE(L"\x1b[{}m"), n);
-                    }
-                }
+                _data = {};
+                return {};
             }
+            const auto bytes = _data.first(size);
+            _data = _data.subspan(aligned);
+            return bytes;
+        }
 
-            if (WI_IsAnyFlagSet(attrDelta, CharacterAttributes::UnderlineStyle))
+        // Returns an empty span if the data is exhausted or if `count` is 0. The caller needs to handle the latter.
+        template<typename T>
+        std::span<const T> ReadArray(const size_t count) noexcept
+        {
+            if (count > _data.size() / sizeof(T))
+            {
+                _data = {};
+                return {};
+            }
+            const auto bytes = ReadBytes(count * sizeof(T));
+            // The snapshot is aligned to 4 bytes throughout, as long as it starts out that way.
+            if (bytes.size() != count * sizeof(T) || reinterpret_cast<uintptr_t>(bytes.data()) % alignof(T) != 0)
+            {
+                _data = {};
+                return {};
+            }
+#pragma warning(suppress : 26490) // Don't use reinterpret_cast (type.1).
+            return { reinterpret_cast<const T*>(bytes.data()), count };
+        }
+
+        bool Exhausted() const noexcept
+        {
+            return _data.empty();
+        }
+
+    private:
+        std::span<const std::byte> _data;
+    };
+}
+
+// Writes the contents of the buffer up to the last non-space character in the snapshot format
+// described above. DeserializeSnapshot() turns it back into a TextBuffer.
+void TextBuffer::SerializeSnapshotToPath(const wchar_t* destination) const
+{
+    const wil::unique_handle file{ CreateFileW(destination, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    THROW_LAST_ERROR_IF(!file);
+
+    SnapshotWriter writer{ file.get() };
+
+    const auto rowCount = GetLastNonSpaceCharacter(nullptr).y + 1;
+
+    writer.Write(SnapshotHeader{
+        .rowCount = gsl::narrow<uint32_t>(rowCount),
+        .width = _width,
+        .currentHyperlinkId = _currentHyperlinkId,
+        .hyperlinkCount = gsl::narrow<uint32_t>(_hyperlinkMap.size()),
+        .customIdCount = gsl::narrow<uint32_t>(_hyperlinkCustomIdMap.size()),
+    });
+
+    const auto writeString = [&](const uint16_t id, const std::wstring_view str) {
+        writer.Write(SnapshotString{ .id = id, .length = gsl::narrow<uint16_t>(str.size()) });
+        writer.Write(str.data(), str.size() * sizeof(wchar_t));
+        writer.Align();
+    };
+    for (const auto& [id, uri] : _hyperlinkMap)
+    {
+        writeString(id, uri);
+    }
+    for (const auto& [customId, id] : _hyperlinkCustomIdMap)
+    {
+        writeString(id, customId);
+    }
+
+    std::vector<uint16_t> pool;
+
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        const auto& row = GetRowByOffset(y);
+
+        pool.clear();
+        const auto compact = row.Compact(pool);
+        const auto& runs = compact.attr.runs();
+        const auto& scrollbarData = compact.promptData;
+
+        auto flags = gsl::narrow_cast<uint16_t>(static_cast<uint16_t>(compact.lineRendition) << SnapshotRow::lineRenditionShift);
+        WI_SetFlagIf(flags, SnapshotRow::hasCharOffsets, compact.hasCharOffsets);
+        WI_SetFlagIf(flags, SnapshotRow::wrapForced, compact.wrapForced);
+        WI_SetFlagIf(flags, SnapshotRow::doubleBytePadded, compact.doubleBytePadded);
+        WI_SetFlagIf(flags, SnapshotRow::hasScrollbarData, scrollbarData.has_value());
+
+        writer.Write(SnapshotRow{
+            .columnCount = compact.columnCount,
+            .charCount = compact.charCount,
+            .attrRunCount = gsl::narrow<uint16_t>(runs.size()),
+            .flags = flags,
+            .textLength = gsl::narrow<uint32_t>(pool.size()),
+        });
+
+        for (const auto& run : runs)
+        {
+            writer.Write(run.value);
+            writer.Write(run.length);
+        }
+        writer.Align();
+
+        if (scrollbarData)
+        {
+            writer.Write(SnapshotScrollbarData{
+                .category = static_cast<uint8_t>(scrollbarData->category),
+                .hasColor = scrollbarData->color.has_value(),
+                .hasExitCode = scrollbarData->exitCode.has_value(),
+                .color = scrollbarData->color.value_or(til::color{}).abgr,
+                .exitCode = scrollbarData->exitCode.value_or(0),
+            });
+        }
+
+        writer.Write(pool.data(), pool.size() * sizeof(uint16_t));
+        writer.Align();
+        writer.Flush(false);
+    }
+
+    writer.Flush(true);
+}
+
+// Turns a snapshot written by SerializeSnapshotToPath() back into a TextBuffer of the same width, that's just
+// tall enough to hold all rows, with the cursor on the line after the last one. The snapshot must be 4-byte aligned.
+// Returns nullptr if the snapshot is invalid or from an incompatible version.
+std::unique_ptr<TextBuffer> TextBuffer::DeserializeSnapshot(const std::span<const std::byte> snapshot)
+{
+    SnapshotReader reader{ snapshot };
+
+    SnapshotHeader header;
+    if (!reader.Read(header) ||
+        header.magic != snapshotMagic ||
+        header.version != snapshotVersion ||
+        header.attributeSize != sizeof(TextAttribute) ||
+        header.width == 0 ||
+        header.rowCount >= SHRT_MAX)
+    {
+        return nullptr;
+    }
+
+    const auto readString = [&](SnapshotString& str) -> std::optional<std::wstring> {
+        if (!reader.Read(str))
+        {
+            return std::nullopt;
+        }
+        const auto chars = reader.ReadArray<wchar_t>(str.length);
+        if (chars.size() != str.length)
+        {
+            return std::nullopt;
+        }
+        return std::wstring{ chars.begin(), chars.end() };
+    };
+
+    std::unordered_map<uint16_t, std::wstring> hyperlinkMap;
+    std::unordered_map<std::wstring, uint16_t> hyperlinkCustomIdMap;
+    for (uint32_t i = 0; i < header.hyperlinkCount; ++i)
+    {
+        SnapshotString str;
+        auto uri = readString(str);
+        if (!uri)
+        {
+            return nullptr;
+        }
+        hyperlinkMap.insert_or_assign(str.id, std::move(*uri));
+    }
+    for (uint32_t i = 0; i < header.customIdCount; ++i)
+    {
+        SnapshotString str;
+        auto customId = readString(str);
+        if (!customId)
+        {
+            return nullptr;
+        }
+        hyperlinkCustomIdMap.insert_or_assign(std::move(*customId), str.id);
+    }
+
+    const auto width = header.width;
+    const auto rowCount = gsl::narrow_cast<til::CoordType>(header.rowCount);
+    auto buffer = std::make_unique<TextBuffer>(til::size{ width, rowCount + 1 }, TextAttribute{}, 0, false, nullptr);
+
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        SnapshotRow record;
+        if (!reader.Read(record))
+        {
+            return nullptr;
+        }
+
+        CompactRow compact{
+            .columnCount = record.columnCount,
+            .charCount = record.charCount,
+            .hasCharOffsets = WI_IsFlagSet(record.flags, SnapshotRow::hasCharOffsets),
+            .lineRendition = static_cast<LineRendition>((record.flags >> SnapshotRow::lineRenditionShift) & 3),
+            .wrapForced = WI_IsFlagSet(record.flags, SnapshotRow::wrapForced),
+            .doubleBytePadded = WI_IsFlagSet(record.flags, SnapshotRow::doubleBytePadded),
+        };
+
+        const auto runs = reader.ReadBytes(record.attrRunCount * (sizeof(TextAttribute) + sizeof(uint16_t)));
+        if (runs.size() != record.attrRunCount * (sizeof(TextAttribute) + sizeof(uint16_t)))
+        {
+            return nullptr;
+        }
+        decltype(compact.attr)::container attrRuns;
+        size_t attrLength = 0;
+        for (auto it = runs.begin(); it != runs.end(); it += sizeof(TextAttribute) + sizeof(uint16_t))
+        {
+            TextAttribute attr;
+            uint16_t length = 0;
+            memcpy(&attr, &*it, sizeof(attr));
+            memcpy(&length, &*it + sizeof(attr), sizeof(length));
+            if (length == 0 || !isValidSnapshotAttribute(attr, hyperlinkMap))
+            {
+                return nullptr;
+            }
+            attrRuns.emplace_back(attr, length);
+            attrLength += length;
+        }
+        if (attrLength != width)
+        {
+            return nullptr;
+        }
+        compact.attr = decltype(compact.attr){ std::move(attrRuns) };
+
+        if (WI_IsFlagSet(record.flags, SnapshotRow::hasScrollbarData))
+        {
+            SnapshotScrollbarData data;
+            if (!reader.Read(data) || data.category > static_cast<uint8_t>(MarkCategory::Prompt))
+            {
+                return nullptr;
+            }
+            ScrollbarData& scrollbarData = compact.promptData.emplace();
+            scrollbarData.category = static_cast<MarkCategory>(data.category);
+            if (data.hasColor)
+            {
+                til::color color;
+                color.abgr = data.color;
+                scrollbarData.color = color;
+            }
+            if (data.hasExitCode)
+            {
+                scrollbarData.exitCode = data.exitCode;
+            }
+        }
+
+        const auto text = reader.ReadArray<uint16_t>(record.textLength);
+        if (text.size() != record.textLength || !ROW::IsValidCompact(compact, text, width))
+        {
+            return nullptr;
+        }
+
+        buffer->GetMutableRowByOffset(y).Expand(std::move(compact), text);
+    }
+
+    if (!reader.Exhausted())
+    {
+        return nullptr;
+    }
+
+    for (const auto& [customId, id] : hyperlinkCustomIdMap)
+    {
+        buffer->_hyperlinkIdToCustomIdMap.insert_or_assign(id, customId);
+    }
+    buffer->_hyperlinkMap = std::move(hyperlinkMap);
+    buffer->_hyperlinkCustomIdMap = std::move(hyperlinkCustomIdMap);
+    buffer->_currentHyperlinkId = std::max<uint16_t>(header.currentHyperlinkId, 1);
+    if (!buffer->_hyperlinkMap.empty())
+    {
+        buffer->_startHyperlinkTracking();
+    }
+    buffer->_rebuildMarks();
+    buffer->GetCursor().SetPosition({ 0, rowCount });
+    return buffer;
+}
+
+// Serializes one row of the text buffer including ANSI escape code control sequences.
+// Arguments:
+// - row - A reference to the row being serialized.
+// - startX - The first column (inclusive) to include in the serialized content.
+// - endX - The last column (exclusive) to include in the serialized content.
+// - addLineBreak - Whether to add a line break at the end of the serialized row.
+// - isLastRow - Whether this is the final row to be serialized.
+// - buffer - A string to write the serialized row into.
+// - previousTextAttr - Used for tracking state across multiple calls to `_SerializeRow` for sequential rows.
+//      The value will be mutated by the call. The initial call should contain `nullopt`, and subsequent calls
+//      should pass the value that was written by the previous call.
+// - delayedLineBreak - Similarly used for tracking state across multiple calls, and similarly will be mutated
+//      by the call. The initial call should pass `false` and subsequent calls should pass the value that was
+//      written by the previous call.
+void TextBuffer::_SerializeRow(const ROW& row, const til::CoordType startX, const til::CoordType endX, const bool addLineBreak, const bool isLastRow, std::wstring& buffer, std::optional<TextAttribute>& previousTextAttr, bool& delayedLineBreak) const
+{
+    if (const auto lr = row.GetLineRendition(); lr != LineRendition::SingleWidth)
+    {
+        static constexpr std::wstring_view mappings[] = {
+            L"\x1b#6", // LineRendition::DoubleWidth
+            L"\x1b#3", // LineRendition::DoubleHeightTop
+            L"\x1b#4", // LineRendition::DoubleHeightBottom
+        };
+        const auto idx = std::clamp(static_cast<int>(lr) - 1, 0, 2);
+        buffer.append(til::at(mappings, idx));
+    }
+
+    const auto startXU16 = gsl::narrow_cast<uint16_t>(startX);
+    const auto endXU16 = gsl::narrow_cast<uint16_t>(endX);
+    const auto runs = row.Attributes().slice(startXU16, endXU16).runs();
+
+    const auto beg = runs.begin();
+    const auto end = runs.end();
+    auto it = beg;
+    // Don't try to get `end - 1` if it's an empty iterator; in this case we're going to ignore the `last`
+    // value anyway so just use `end`.
+    const auto last = it == end ? end : end - 1;
+    const auto lastCharX = row.MeasureRight();
+    til::CoordType oldX = startX;
+
+    for (; it != end; ++it)
+    {
+        const auto effectivePreviousTextAttr = previousTextAttr.value_or(TextAttribute{ CharacterAttributes::Unused1, TextColor{}, TextColor{}, 0, TextColor{} });
+        const auto previousAttr = effectivePreviousTextAttr.GetCharacterAttributes();
+        const auto previousHyperlinkId = effectivePreviousTextAttr.GetHyperlinkId();
+        const auto previousFg = effectivePreviousTextAttr.GetForeground();
+        const auto previousBg = effectivePreviousTextAttr.GetBackground();
+        const auto previousUl = effectivePreviousTextAttr.GetUnderlineColor();
+
+        const auto attr = it->value.GetCharacterAttributes();
+        const auto hyperlinkId = it->value.GetHyperlinkId();
+        const auto fg = it->value.GetForeground();
+        const auto bg = it->value.GetBackground();
+        const auto ul = it->value.GetUnderlineColor();
+
+        if (previousAttr != attr)
+        {
+            auto attrDelta = attr ^ previousAttr;
+
+            // There's no escape sequence that only turns off either bold/intense or dim/faint. SGR 22 turns off both.
+            // This results in two issues in our generic "Mapping" code below. Assuming, both Intense and Faint were on...
+            // * ...and either turned off, it would emit SGR 22 which turns both attributes off = Wrong.
+            // * ...and both are now off, it would emit SGR 22 twice.
+            //
+            // This extra branch takes care of both issues. If both attributes turned off it'll emit a single \x1b[22m,
+            // if faint turned off \x1b[22;1m (intense is still on), and \x1b[22;2m if intense turned off (vice versa).
+            if (WI_AreAllFlagsSet(previousAttr, CharacterAttributes::Intense | CharacterAttributes::Faint) &&
+                WI_IsAnyFlagSet(attrDelta, CharacterAttributes::Intense | CharacterAttributes::Faint))
+            {
+                wchar_t buf[8] = L"\x1b[22m";
+                size_t len = 5;
+
+                if (WI_IsAnyFlagSet(attr, CharacterAttributes::Intense | CharacterAttributes::Faint))
+                {
+                    buf[4] = L';';
+                    buf[5] = WI_IsAnyFlagSet(attr, CharacterAttributes::Intense) ? L'1' : L'2';
+                    buf[6] = L'm';
+                    len = 7;
+                }
+
+                buffer.append(&buf[0], len);
+                WI_ClearAllFlags(attrDelta, CharacterAttributes::Intense | CharacterAttributes::Faint);
+            }
+
+            {
+                struct Mapping
+                {
+                    CharacterAttributes attr;
+                    uint8_t change[2]; // [0] = off, [1] = on
+                };
+                static constexpr Mapping mappings[] = {
+                    { CharacterAttributes::Intense, { 22, 1 } },
+                    { CharacterAttributes::Italics, { 23, 3 } },
+                    { CharacterAttributes::Blinking, { 25, 5 } },
+                    { CharacterAttributes::Invisible, { 28, 8 } },
+                    { CharacterAttributes::CrossedOut, { 29, 9 } },
+                    { CharacterAttributes::Faint, { 22, 2 } },
+                    { CharacterAttributes::TopGridline, { 55, 53 } },
+                    { CharacterAttributes::ReverseVideo, { 27, 7 } },
+                };
+                for (const auto& mapping : mappings)
+                {
+                    if (WI_IsAnyFlagSet(attrDelta, mapping.attr))
+                    {
+                        const auto n = til::at(mapping.change, WI_IsAnyFlagSet(attr, mapping.attr));
+                        fmt::format_to(std::back_inserter(buffer), FMT_COMPILE(L"\x1b[{}m"), n);
+                    }
+                }
+            }
+
+            if (WI_IsAnyFlagSet(attrDelta, CharacterAttributes::UnderlineStyle))
             {
                 static constexpr std::wstring_view mappings[] = {
                     L"\x1b[24m", // UnderlineStyle::NoUnderline
@@ -2961,225 +4117,530 @@ void TextBuffer::_SerializeRow(const ROW& row, const til::CoordType startX, cons
     }
 }
 
-// Function Description:
-// - Reflow the contents from the old buffer into the new buffer. The new buffer
-//   can have different dimensions than the old buffer. If it does, then this
-//   function will attempt to maintain the logical contents of the old buffer,
-//   by continuing wrapped lines onto the next line in the new buffer.
-// Arguments:
-// - oldBuffer - the text buffer to copy the contents FROM
-// - newBuffer - the text buffer to copy the contents TO
-// - lastCharacterViewport - Optional. If the caller knows that the last
-//   nonspace character is in a particular Viewport, the caller can provide this
-//   parameter as an optimization, as opposed to searching the entire buffer.
-// - positionInfo - Optional. The caller can provide a pair of rows in this
-//   parameter and we'll calculate the position of the _end_ of those rows in
-//   the new buffer. The rows's new value is placed back into this parameter.
-// Return Value:
-// - S_OK if we successfully copied the contents to the new buffer, otherwise an appropriate HRESULT.
-void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo)
+namespace
 {
-    const auto& oldCursor = oldBuffer.GetCursor();
-    auto& newCursor = newBuffer.GetCursor();
+    // Below this many rows, splitting up the work costs more than it saves.
+    constexpr til::CoordType reflowParallelMinRows = 4096;
+    // reflowParallel() splits the buffer into ranges of (at least) this many rows.
+    constexpr til::CoordType reflowParallelChunkRows = 512;
+
+    struct ReflowParams
+    {
+        til::point oldCursorPos;
+        til::CoordType oldHeight = 0;
+        til::CoordType newWidth = 0;
+        til::CoordType newHeight = 0;
+        til::CoordType mutableViewportTop = til::CoordTypeMax;
+        til::CoordType visibleViewportTop = til::CoordTypeMax;
+        TextAttribute initialAttributes;
+    };
 
-    til::point oldCursorPos = oldCursor.GetPosition();
-    til::point newCursorPos;
+    struct ReflowResult
+    {
+        // The first old row that wasn't copied and the first new row that wasn't written to.
+        til::CoordType oldY = 0;
+        til::CoordType newY = 0;
+        til::point newCursorPos;
+        std::optional<til::CoordType> newMutableViewportTop;
+        std::optional<til::CoordType> newVisibleViewportTop;
+    };
 
-    // BODGY: We use oldCursorPos in two critical places below:
-    // * To compute an oldHeight that includes at a minimum the cursor row
-    // * For REFLOW_JANK_CURSOR_WRAP (see comment below)
-    // Both of these would break the reflow algorithm, but the latter of the two in particular
-    // would cause the main copy loop below to deadlock. In other words, these two lines
-    // protect this function against yet-unknown bugs in other parts of the code base.
-    oldCursorPos.x = std::clamp(oldCursorPos.x, 0, oldBuffer._width - 1);
-    oldCursorPos.y = std::clamp(oldCursorPos.y, 0, oldBuffer._height - 1);
+    // This copies the rows of the old buffer into the new one, one row at a time, on behalf of TextBuffer::Reflow().
+    // `getRow(y, enter)` returns the new row at y. `enter` is true if it's about to be written to from column 0.
+    template<typename GetRow>
+    struct ReflowWriter
+    {
+        const ReflowParams& params;
+        GetRow getRow;
+        // If true, only the text is copied, which is all that's needed to compute the new positions.
+        bool measureOnly = false;
+
+        til::CoordType mutableViewportTop = params.mutableViewportTop;
+        til::CoordType visibleViewportTop = params.visibleViewportTop;
+        til::CoordType newX = 0;
+        til::CoordType newY = 0;
+        til::CoordType newYLimit = til::CoordTypeMax;
+        std::optional<til::point> newCursorPos;
+        std::optional<til::CoordType> newMutableViewportTop;
+        std::optional<til::CoordType> newVisibleViewportTop;
+
+        void WriteRow(const ROW& oldRow, const til::CoordType oldY)
+        {
+            const auto& oldCursorPos = params.oldCursorPos;
+            const auto newWidth = params.newWidth;
 
-    const auto lastRowWithText = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport).y;
+            // A pair of double height rows should optimally wrap as a union (i.e. after wrapping there should be 4 lines).
+            // But for this initial implementation I chose the alternative approach: Just truncate them.
+            if (oldRow.GetLineRendition() != LineRendition::SingleWidth)
+            {
+                // Since rows with a non-standard line rendition should be truncated it's important
+                // that we pretend as if the previous row ended in a newline, even if it didn't.
+                // This is what this if does: It newlines.
+                if (newX)
+                {
+                    newX = 0;
+                    newY++;
+                }
 
-    auto mutableViewportTop = positionInfo ? positionInfo->mutableViewportTop : til::CoordTypeMax;
-    auto visibleViewportTop = positionInfo ? positionInfo->visibleViewportTop : til::CoordTypeMax;
+                auto& newRow = getRow(newY, true);
+                newRow.CopyFrom(oldRow);
+                newRow.SetWrapForced(false);
 
-    til::CoordType oldY = 0;
-    til::CoordType newY = 0;
-    til::CoordType newX = 0;
-    til::CoordType newWidth = newBuffer.GetSize().Width();
-    til::CoordType newYLimit = til::CoordTypeMax;
+                if (oldY == oldCursorPos.y)
+                {
+                    newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x), newY };
+                }
+                _trackViewportTops(oldY);
 
-    const auto oldHeight = std::max(lastRowWithText, oldCursorPos.y) + 1;
-    const auto newHeight = newBuffer.GetSize().Height();
-    const auto newWidthU16 = gsl::narrow_cast<uint16_t>(newWidth);
+                newY++;
+                return;
+            }
 
-    // Copy oldBuffer into newBuffer until oldBuffer has been fully consumed.
-    for (; oldY < oldHeight && newY < newYLimit; ++oldY)
-    {
-        const auto& oldRow = oldBuffer.GetRowByOffset(oldY);
+            // Rows don't store any information for what column the last written character is in.
+            // We simply truncate all trailing whitespace in this implementation.
+            auto oldRowLimit = oldRow.MeasureRight();
+            if (oldY == oldCursorPos.y)
+            {
+                // REFLOW_JANK_CURSOR_WRAP:
+                // Pretending as if there's always at least whitespace in front of the cursor has the benefit that
+                // * the cursor retains its distance from any preceding text.
+                // * when a client application starts writing on this new, empty line,
+                //   enlarging the buffer unwraps the text onto the preceding line.
+                oldRowLimit = std::max(oldRowLimit, oldCursorPos.x + 1);
+            }
 
-        // A pair of double height rows should optimally wrap as a union (i.e. after wrapping there should be 4 lines).
-        // But for this initial implementation I chose the alternative approach: Just truncate them.
-        if (oldRow.GetLineRendition() != LineRendition::SingleWidth)
-        {
-            // Since rows with a non-standard line rendition should be truncated it's important
-            // that we pretend as if the previous row ended in a newline, even if it didn't.
-            // This is what this if does: It newlines.
-            if (newX)
+            // Immediately copy this mark over to our new row. The positions of the
+            // marks themselves will be preserved, since they're just text
+            // attributes. But the "bookmark" needs to get moved to the new row too.
+            // * If a row wraps as it reflows, that's fine - we want to leave the
+            //   mark on the row it started on.
+            // * If the second row of a wrapped row had a mark, and it de-flows onto a
+            //   single row, that's fine! The mark was on that logical row.
+            if (!measureOnly && oldRow.GetScrollbarData().has_value())
             {
-                newX = 0;
-                newY++;
+                getRow(newY, false).SetScrollbarData(oldRow.GetScrollbarData());
             }
 
-            auto& newRow = newBuffer.GetMutableRowByOffset(newY);
+            til::CoordType oldX = 0;
 
-            // See the comment marked with "REFLOW_RESET".
-            if (newY >= newHeight)
+            // Copy oldRow into newBuffer until oldRow has been fully consumed.
+            // We use a do-while loop to ensure that line wrapping occurs and
+            // that attributes are copied over even for seemingly empty rows.
+            do
             {
-                newRow.Reset(newBuffer._initialAttributes);
-            }
+                // This if condition handles line wrapping.
+                // Only if we write past the last column we should wrap and as such this if
+                // condition is in front of the text insertion code instead of behind it.
+                // A SetWrapForced of false implies an explicit newline, which is the default.
+                if (newX >= newWidth)
+                {
+                    if (!measureOnly)
+                    {
+                        getRow(newY, false).SetWrapForced(true);
+                    }
+                    newX = 0;
+                    newY++;
+                }
+
+                // We need to ensure not to overwrite the row the cursor is on.
+                if (newX == 0 && newY >= newYLimit)
+                {
+                    break;
+                }
 
-            newRow.CopyFrom(oldRow);
-            newRow.SetWrapForced(false);
+                auto& newRow = getRow(newY, newX == 0);
 
-            if (oldY == oldCursorPos.y)
+                RowCopyTextFromState state{
+                    .source = oldRow,
+                    .columnBegin = newX,
+                    .columnLimit = til::CoordTypeMax,
+                    .sourceColumnBegin = oldX,
+                    .sourceColumnLimit = oldRowLimit,
+                };
+                newRow.CopyTextFrom(state);
+
+                if (!measureOnly)
+                {
+                    // If we're at the start of the old row, copy its image content.
+                    if (oldX == 0)
+                    {
+                        ImageSlice::CopyRow(oldRow, newRow);
+                    }
+
+                    const auto& oldAttr = oldRow.Attributes();
+                    auto& newAttr = newRow.Attributes();
+                    const auto attributes = oldAttr.slice(gsl::narrow_cast<uint16_t>(oldX), oldAttr.size());
+                    newAttr.replace(gsl::narrow_cast<uint16_t>(newX), newAttr.size(), attributes);
+                    newAttr.resize_trailing_extent(gsl::narrow_cast<uint16_t>(newWidth));
+                }
+
+                if (oldY == oldCursorPos.y && oldCursorPos.x >= oldX)
+                {
+                    // In theory AdjustToGlyphStart ensures we don't put the cursor on a trailing wide glyph.
+                    // In practice I don't think that this can possibly happen. Better safe than sorry.
+                    newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x - oldX + newX), newY };
+                    // If there's so much text past the old cursor position that it doesn't fit into new buffer,
+                    // then the new cursor position will be "lost", because it's overwritten by unrelated text.
+                    // We have two choices how can handle this:
+                    // * If the new cursor is at an y < 0, just put the cursor at (0,0)
+                    // * Stop writing into the new buffer before we overwrite the new cursor position
+                    // This implements the second option. There's no fundamental reason why this is better.
+                    newYLimit = newY + params.newHeight;
+                }
+                _trackViewportTops(oldY);
+
+                oldX = state.sourceColumnEnd;
+                newX = state.columnEnd;
+            } while (oldX < oldRowLimit);
+
+            // If the row had an explicit newline we also need to newline. :)
+            if (!oldRow.WasWrapForced())
             {
-                newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x), newY };
+                newX = 0;
+                newY++;
             }
+        }
+
+        // Returns the number of rows that have been written to, including the current one, if it's not empty.
+        // TextBuffer::Reflow() copies entire rows of attributes after this point, which assumes that
+        // the "write cursor" (newX, newY) is at the start of a row. Otherwise, we may copy attributes
+        // from a later row into a previous one.
+        til::CoordType RowsWritten() const noexcept
+        {
+            return newY + (newX != 0);
+        }
+
+    private:
+        void _trackViewportTops(const til::CoordType oldY) noexcept
+        {
             if (oldY >= mutableViewportTop)
             {
-                positionInfo->mutableViewportTop = newY;
+                newMutableViewportTop = newY;
                 mutableViewportTop = til::CoordTypeMax;
             }
             if (oldY >= visibleViewportTop)
             {
-                positionInfo->visibleViewportTop = newY;
+                newVisibleViewportTop = newY;
                 visibleViewportTop = til::CoordTypeMax;
             }
+        }
+    };
 
-            newY++;
-            continue;
+    template<typename GetRow>
+    ReflowWriter<GetRow> makeReflowWriter(const ReflowParams& params, GetRow getRow, const bool measureOnly)
+    {
+        return { .params = params, .getRow = std::move(getRow), .measureOnly = measureOnly };
+    }
+
+    ReflowResult reflowSerial(const TextBuffer& oldBuffer, TextBuffer& newBuffer, const ReflowParams& params)
+    {
+        auto writer = makeReflowWriter(
+            params,
+            [&](const til::CoordType y, const bool enter) -> ROW& {
+                auto& row = newBuffer.GetMutableRowByOffset(y);
+                // REFLOW_RESET:
+                // If we shrink the buffer vertically, for instance from 100 rows to 90 rows, we will write 10 rows in the
+                // new buffer twice. We need to reset them before copying text, or otherwise we'll see the previous contents.
+                // We don't need to be smart about this. Reset() is fast and shrinking doesn't occur often.
+                if (enter && y >= params.newHeight)
+                {
+                    row.Reset(params.initialAttributes);
+                }
+                return row;
+            },
+            false);
+
+        til::CoordType oldY = 0;
+        for (; oldY < params.oldHeight && writer.newY < writer.newYLimit; ++oldY)
+        {
+            writer.WriteRow(oldBuffer.GetRowByOffset(oldY), oldY);
         }
 
-        // Rows don't store any information for what column the last written character is in.
-        // We simply truncate all trailing whitespace in this implementation.
-        auto oldRowLimit = oldRow.MeasureRight();
-        if (oldY == oldCursorPos.y)
+        return {
+            .oldY = oldY,
+            .newY = writer.RowsWritten(),
+            .newCursorPos = writer.newCursorPos.value_or(til::point{}),
+            .newMutableViewportTop = writer.newMutableViewportTop,
+            .newVisibleViewportTop = writer.newVisibleViewportTop,
+        };
+    }
+
+    // Runs func(i) for all i in [0, count) on the calling thread and as many thread pool workers as there are
+    // other CPU cores. Rethrows the first exception that any of the calls threw, after all workers have finished.
+    template<typename Func>
+    void parallelFor(const size_t count, const Func& func)
+    {
+        std::atomic<size_t> next{ 0 };
+        std::exception_ptr exception;
+        std::mutex exceptionMutex;
+
+        const auto worker = [&]() noexcept {
+            for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed))
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    const std::scoped_lock lock{ exceptionMutex };
+                    if (!exception)
+                    {
+                        exception = std::current_exception();
+                    }
+                    next.store(count, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        // Failing to create the work object just means that the calling thread has to do all the work.
+        const wil::unique_threadpool_work work{ CreateThreadpoolWork(
+            [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) noexcept {
+                (*static_cast<const decltype(worker)*>(context))();
+            },
+            const_cast<void*>(static_cast<const void*>(&worker)),
+            nullptr) };
+        if (work)
         {
-            // REFLOW_JANK_CURSOR_WRAP:
-            // Pretending as if there's always at least whitespace in front of the cursor has the benefit that
-            // * the cursor retains its distance from any preceding text.
-            // * when a client application starts writing on this new, empty line,
-            //   enlarging the buffer unwraps the text onto the preceding line.
-            oldRowLimit = std::max(oldRowLimit, oldCursorPos.x + 1);
+            const auto workerCount = std::min<size_t>(std::thread::hardware_concurrency(), count);
+            for (size_t i = 1; i < workerCount; ++i)
+            {
+                SubmitThreadpoolWork(work.get());
+            }
         }
 
-        // Immediately copy this mark over to our new row. The positions of the
-        // marks themselves will be preserved, since they're just text
-        // attributes. But the "bookmark" needs to get moved to the new row too.
-        // * If a row wraps as it reflows, that's fine - we want to leave the
-        //   mark on the row it started on.
-        // * If the second row of a wrapped row had a mark, and it de-flows onto a
-        //   single row, that's fine! The mark was on that logical row.
-        if (oldRow.GetScrollbarData().has_value())
+        worker();
+
+        if (work)
         {
-            newBuffer.GetMutableRowByOffset(newY).SetScrollbarData(oldRow.GetScrollbarData());
+            WaitForThreadpoolWorkCallbacks(work.get(), FALSE);
         }
 
-        til::CoordType oldX = 0;
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
 
-        // Copy oldRow into newBuffer until oldRow has been fully consumed.
-        // We use a do-while loop to ensure that line wrapping occurs and
-        // that attributes are copied over even for seemingly empty rows.
-        do
+    // Reflows the buffer like reflowSerial(), but concurrently. Returns std::nullopt if it can't do so.
+    //
+    // A logical line that was wrapped over several rows needs to be re-wrapped as a whole, but logical lines are
+    // independent of each other. This splits the old buffer into chunks of logical lines and first measures how
+    // many new rows each chunk results in. Once we know where each chunk starts in the new buffer,
+    // the chunks are copied into their respective rows.
+    std::optional<ReflowResult> reflowParallel(const TextBuffer& oldBuffer, TextBuffer& newBuffer, const ReflowParams& params)
+    {
+        const auto newHeight = params.newHeight;
+
+        // The row accessors aren't thread-safe, so we get a hold of all the rows we need upfront.
+        std::vector<const ROW*> oldRows;
+        oldRows.reserve(gsl::narrow_cast<size_t>(params.oldHeight));
+        for (til::CoordType y = 0; y < params.oldHeight; ++y)
         {
-            // This if condition handles line wrapping.
-            // Only if we write past the last column we should wrap and as such this if
-            // condition is in front of the text insertion code instead of behind it.
-            // A SetWrapForced of false implies an explicit newline, which is the default.
-            if (newX >= newWidth)
+            oldRows.emplace_back(&oldBuffer.GetRowByOffset(y));
+        }
+
+        // Each chunk ends right before a row, at which ReflowWriter would start writing at column 0 anyway:
+        // After a row that ended in a newline, as well as before and after rows with a non-standard line rendition.
+        std::vector<til::CoordType> chunkBegs{ 0 };
+        for (til::CoordType y = 1; y < params.oldHeight; ++y)
+        {
+            const auto& prev = *til::at(oldRows, y - 1);
+            const auto singleWidth = prev.GetLineRendition() == LineRendition::SingleWidth &&
+                                     til::at(oldRows, y)->GetLineRendition() == LineRendition::SingleWidth;
+            if (y - chunkBegs.back() >= reflowParallelChunkRows && (!prev.WasWrapForced() || !singleWidth))
             {
-                newBuffer.GetMutableRowByOffset(newY).SetWrapForced(true);
-                newX = 0;
-                newY++;
+                chunkBegs.emplace_back(y);
+            }
+        }
+        chunkBegs.emplace_back(params.oldHeight);
+
+        const auto chunkCount = chunkBegs.size() - 1;
+        std::vector<ReflowResult> chunks(chunkCount);
+
+        // Every thread needs its own rows to write into, when it isn't supposed to write into the new buffer.
+        const auto makeScratchRow = [&](std::vector<wchar_t>& chars, std::vector<uint16_t>& charOffsets) {
+            chars.resize(gsl::narrow_cast<size_t>(params.newWidth));
+            charOffsets.resize(gsl::narrow_cast<size_t>(params.newWidth) + 1);
+            return ROW{ chars.data(), charOffsets.data(), gsl::narrow_cast<uint16_t>(params.newWidth), params.initialAttributes };
+        };
+
+        // Pass 1: Measure each chunk. The resulting positions are relative to the start of the chunk.
+        parallelFor(chunkCount, [&](const size_t i) {
+            std::vector<wchar_t> chars;
+            std::vector<uint16_t> charOffsets;
+            auto scratch = makeScratchRow(chars, charOffsets);
+
+            auto writer = makeReflowWriter(
+                params,
+                [&](til::CoordType, const bool enter) -> ROW& {
+                    if (enter)
+                    {
+                        scratch.Reset(params.initialAttributes);
+                    }
+                    return scratch;
+                },
+                true);
+
+            for (auto y = til::at(chunkBegs, i); y < til::at(chunkBegs, i + 1); ++y)
+            {
+                writer.WriteRow(*til::at(oldRows, y), y);
             }
 
-            // REFLOW_RESET:
-            // If we shrink the buffer vertically, for instance from 100 rows to 90 rows, we will write 10 rows in the
-            // new buffer twice. We need to reset them before copying text, or otherwise we'll see the previous contents.
-            // We don't need to be smart about this. Reset() is fast and shrinking doesn't occur often.
-            if (newY >= newHeight && newX == 0)
+            auto& chunk = til::at(chunks, i);
+            chunk.newY = writer.RowsWritten();
+            chunk.newCursorPos = writer.newCursorPos.value_or(til::point{ -1, -1 });
+            chunk.newMutableViewportTop = writer.newMutableViewportTop;
+            chunk.newVisibleViewportTop = writer.newVisibleViewportTop;
+        });
+
+        // Turn the relative positions into absolute ones.
+        std::vector<til::CoordType> chunkNewBegs;
+        chunkNewBegs.reserve(chunkCount);
+        ReflowResult result{ .oldY = params.oldHeight };
+        for (const auto& chunk : chunks)
+        {
+            chunkNewBegs.emplace_back(result.newY);
+            if (chunk.newCursorPos.y >= 0)
             {
-                // We need to ensure not to overwrite the row the cursor is on.
-                if (newY >= newYLimit)
-                {
-                    break;
-                }
-                newBuffer.GetMutableRowByOffset(newY).Reset(newBuffer._initialAttributes);
+                result.newCursorPos = { chunk.newCursorPos.x, chunk.newCursorPos.y + result.newY };
+            }
+            if (chunk.newMutableViewportTop && !result.newMutableViewportTop)
+            {
+                result.newMutableViewportTop = *chunk.newMutableViewportTop + result.newY;
+            }
+            if (chunk.newVisibleViewportTop && !result.newVisibleViewportTop)
+            {
+                result.newVisibleViewportTop = *chunk.newVisibleViewportTop + result.newY;
             }
+            result.newY += chunk.newY;
+        }
+
+        // reflowSerial() stops writing once it would overwrite the cursor row, which can only happen if there are more
+        // than newHeight rows below the cursor. That's rare enough that we leave it to reflowSerial() to handle.
+        if (result.newY >= result.newCursorPos.y + newHeight)
+        {
+            return std::nullopt;
+        }
 
-            auto& newRow = newBuffer.GetMutableRowByOffset(newY);
+        // Only the last newHeight rows remain in the new buffer. Rows before windowBeg would get overwritten,
+        // so we write them into a scratch row instead, which avoids conflicts between the chunks.
+        const auto windowBeg = std::max(0, result.newY - newHeight);
+        std::vector<ROW*> newRows;
+        newRows.reserve(gsl::narrow_cast<size_t>(result.newY - windowBeg));
+        for (auto y = windowBeg; y < result.newY; ++y)
+        {
+            newRows.emplace_back(&newBuffer.GetMutableRowByOffset(y));
+        }
+
+        // Pass 2: Copy each chunk (that overlaps the window) into its rows.
+        parallelFor(chunkCount, [&](const size_t i) {
+            const auto newBeg = til::at(chunkNewBegs, i);
+            if (newBeg + til::at(chunks, i).newY <= windowBeg)
+            {
+                return;
+            }
+
+            std::vector<wchar_t> chars;
+            std::vector<uint16_t> charOffsets;
+            auto scratch = makeScratchRow(chars, charOffsets);
+
+            auto writer = makeReflowWriter(
+                params,
+                [&](const til::CoordType y, const bool enter) -> ROW& {
+                    const auto absoluteY = newBeg + y;
+                    auto& row = absoluteY < windowBeg ? scratch : *til::at(newRows, absoluteY - windowBeg);
+                    // Rows within the window are fresh, but reflowSerial() resets them as well (see REFLOW_RESET).
+                    if (enter && (absoluteY < windowBeg || absoluteY >= newHeight))
+                    {
+                        row.Reset(params.initialAttributes);
+                    }
+                    return row;
+                },
+                false);
+
+            for (auto y = til::at(chunkBegs, i); y < til::at(chunkBegs, i + 1); ++y)
+            {
+                writer.WriteRow(*til::at(oldRows, y), y);
+            }
+        });
+
+        return result;
+    }
+}
+
+// Function Description:
+// - Reflow the contents from the old buffer into the new buffer. The new buffer
+//   can have different dimensions than the old buffer. If it does, then this
+//   function will attempt to maintain the logical contents of the old buffer,
+//   by continuing wrapped lines onto the next line in the new buffer.
+//   Large buffers are reflowed concurrently (see reflowParallel()).
+// Arguments:
+// - oldBuffer - the text buffer to copy the contents FROM
+// - newBuffer - the text buffer to copy the contents TO
+// - lastCharacterViewport - Optional. If the caller knows that the last
+//   nonspace character is in a particular Viewport, the caller can provide this
+//   parameter as an optimization, as opposed to searching the entire buffer.
+// - positionInfo - Optional. The caller can provide a pair of rows in this
+//   parameter and we'll calculate the position of the _end_ of those rows in
+//   the new buffer. The rows's new value is placed back into this parameter.
+// - allowParallel - Optional. Tests pass false to compare the concurrent reflow against the serial one.
+// Return Value:
+// - S_OK if we successfully copied the contents to the new buffer, otherwise an appropriate HRESULT.
+void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo, const bool allowParallel)
+{
+    const auto& oldCursor = oldBuffer.GetCursor();
+    auto& newCursor = newBuffer.GetCursor();
 
-            RowCopyTextFromState state{
-                .source = oldRow,
-                .columnBegin = newX,
-                .columnLimit = til::CoordTypeMax,
-                .sourceColumnBegin = oldX,
-                .sourceColumnLimit = oldRowLimit,
-            };
-            newRow.CopyTextFrom(state);
+    til::point oldCursorPos = oldCursor.GetPosition();
 
-            // If we're at the start of the old row, copy its image content.
-            if (oldX == 0)
-            {
-                ImageSlice::CopyRow(oldRow, newRow);
-            }
+    // BODGY: We use oldCursorPos in two critical places below:
+    // * To compute an oldHeight that includes at a minimum the cursor row
+    // * For REFLOW_JANK_CURSOR_WRAP (see comment below)
+    // Both of these would break the reflow algorithm, but the latter of the two in particular
+    // would cause the main copy loop below to deadlock. In other words, these two lines
+    // protect this function against yet-unknown bugs in other parts of the code base.
+    oldCursorPos.x = std::clamp(oldCursorPos.x, 0, oldBuffer._width - 1);
+    oldCursorPos.y = std::clamp(oldCursorPos.y, 0, oldBuffer._height - 1);
 
-            const auto& oldAttr = oldRow.Attributes();
-            auto& newAttr = newRow.Attributes();
-            const auto attributes = oldAttr.slice(gsl::narrow_cast<uint16_t>(oldX), oldAttr.size());
-            newAttr.replace(gsl::narrow_cast<uint16_t>(newX), newAttr.size(), attributes);
-            newAttr.resize_trailing_extent(newWidthU16);
+    const auto lastRowWithText = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport).y;
 
-            if (oldY == oldCursorPos.y && oldCursorPos.x >= oldX)
-            {
-                // In theory AdjustToGlyphStart ensures we don't put the cursor on a trailing wide glyph.
-                // In practice I don't think that this can possibly happen. Better safe than sorry.
-                newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x - oldX + newX), newY };
-                // If there's so much text past the old cursor position that it doesn't fit into new buffer,
-                // then the new cursor position will be "lost", because it's overwritten by unrelated text.
-                // We have two choices how can handle this:
-                // * If the new cursor is at an y < 0, just put the cursor at (0,0)
-                // * Stop writing into the new buffer before we overwrite the new cursor position
-                // This implements the second option. There's no fundamental reason why this is better.
-                newYLimit = newY + newHeight;
-            }
-            if (oldY >= mutableViewportTop)
-            {
-                positionInfo->mutableViewportTop = newY;
-                mutableViewportTop = til::CoordTypeMax;
-            }
-            if (oldY >= visibleViewportTop)
-            {
-                positionInfo->visibleViewportTop = newY;
-                visibleViewportTop = til::CoordTypeMax;
-            }
+    const auto newWidth = newBuffer.GetSize().Width();
+    const auto oldHeight = std::max(lastRowWithText, oldCursorPos.y) + 1;
+    const auto newHeight = newBuffer.GetSize().Height();
+    const auto newWidthU16 = gsl::narrow_cast<uint16_t>(newWidth);
 
-            oldX = state.sourceColumnEnd;
-            newX = state.columnEnd;
-        } while (oldX < oldRowLimit);
+    const ReflowParams params{
+        .oldCursorPos = oldCursorPos,
+        .oldHeight = oldHeight,
+        .newWidth = newWidth,
+        .newHeight = newHeight,
+        .mutableViewportTop = positionInfo ? positionInfo->mutableViewportTop : til::CoordTypeMax,
+        .visibleViewportTop = positionInfo ? positionInfo->visibleViewportTop : til::CoordTypeMax,
+        .initialAttributes = newBuffer._initialAttributes,
+    };
 
-        // If the row had an explicit newline we also need to newline. :)
-        if (!oldRow.WasWrapForced())
-        {
-            newX = 0;
-            newY++;
-        }
+    // Copy oldBuffer into newBuffer until oldBuffer has been fully consumed.
+    std::optional<ReflowResult> result;
+    if (allowParallel && oldHeight >= reflowParallelMinRows)
+    {
+        result = reflowParallel(oldBuffer, newBuffer, params);
+    }
+    if (!result)
+    {
+        result = reflowSerial(oldBuffer, newBuffer, params);
     }
 
-    // The for loop right after this if condition will copy entire rows of attributes at a time.
-    // This assumes of course that the "write cursor" (newX, newY) is at the start of a row.
-    // If we didn't check for this, we may otherwise copy attributes from a later row into a previous one.
-    if (newX != 0)
+    auto oldY = result->oldY;
+    auto newY = result->newY;
+    auto newCursorPos = result->newCursorPos;
+    if (result->newMutableViewportTop)
+    {
+        positionInfo->mutableViewportTop = *result->newMutableViewportTop;
+    }
+    if (result->newVisibleViewportTop)
     {
-        newX = 0;
-        newY++;
+        positionInfo->visibleViewportTop = *result->newVisibleViewportTop;
     }
 
     // Finish copying buffer attributes to remaining rows below the last
@@ -3211,6 +4672,7 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
 
     newBuffer.CopyProperties(oldBuffer);
     newBuffer.CopyHyperlinkMaps(oldBuffer);
+    newBuffer._rebuildMarks();
 
     assert(newCursorPos.x >= 0 && newCursorPos.x < newWidth);
     assert(newCursorPos.y >= 0 && newCursorPos.y < newHeight);
@@ -3225,6 +4687,7 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
 void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 {
     _hyperlinkMap[id] = uri;
+    _startHyperlinkTracking();
 }
 
 // Method Description:
@@ -3246,6 +4709,8 @@ std::wstring TextBuffer::GetHyperlinkUriFromId(uint16_t id) const
 // - The internal hyperlink ID
 uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 {
+    _startHyperlinkTracking();
+
     uint16_t numericId = 0;
     if (id.empty())
     {
@@ -3263,6 +4728,7 @@ uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
         if (result.second)
         {
             // the custom id did not already exist
+            _hyperlinkIdToCustomIdMap.insert_or_assign(_currentHyperlinkId, std::move(newId));
             ++_currentHyperlinkId;
         }
         numericId = (*(result.first)).second;
@@ -3283,13 +4749,10 @@ uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 {
     _hyperlinkMap.erase(id);
-    for (const auto& customIdPair : _hyperlinkCustomIdMap)
+    if (const auto it = _hyperlinkIdToCustomIdMap.find(id); it != _hyperlinkIdToCustomIdMap.end())
     {
-        if (customIdPair.second == id)
-        {
-            _hyperlinkCustomIdMap.erase(customIdPair.first);
-            break;
-        }
+        _hyperlinkCustomIdMap.erase(it->second);
+        _hyperlinkIdToCustomIdMap.erase(it);
     }
 }
 
@@ -3302,12 +4765,9 @@ void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 // - The custom ID if there was one, empty string otherwise
 std::wstring TextBuffer::GetCustomIdFromId(uint16_t id) const
 {
-    for (auto customIdPair : _hyperlinkCustomIdMap)
+    if (const auto it = _hyperlinkIdToCustomIdMap.find(id); it != _hyperlinkIdToCustomIdMap.end())
     {
-        if (customIdPair.second == id)
-        {
-            return customIdPair.first;
-        }
+        return it->second;
     }
     return {};
 }
@@ -3321,9 +4781,178 @@ void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
 {
     _hyperlinkMap = other._hyperlinkMap;
     _hyperlinkCustomIdMap = other._hyperlinkCustomIdMap;
+    _hyperlinkIdToCustomIdMap = other._hyperlinkIdToCustomIdMap;
     _currentHyperlinkId = other._currentHyperlinkId;
+    // Our rows were written without knowing about these hyperlinks, so they need to be counted from scratch.
+    if (other._hyperlinkTracking)
+    {
+        _startHyperlinkTracking();
+    }
+}
+
+// Called whenever a hyperlink ID is handed out. Until then no ROW can refer to one, which
+// allows GetMutableRowByOffset() to skip tracking hyperlinks for buffers that don't have any.
+void TextBuffer::_startHyperlinkTracking() noexcept
+{
+    if (!_hyperlinkTracking)
+    {
+        _hyperlinkTracking = true;
+        _hyperlinkRefsStale = true;
+    }
 }
 
+// Implements the UREGEX_LITERAL flavor of SearchText() one line at a time.
+// Case-sensitive needles, as well as case-insensitive ASCII needles on ASCII-only lines, are matched without ICU,
+// using std::wstring_view::find() which is vectorized. Everything else falls back to ICU for just that line,
+// because its full case folding may produce different results than a simple case-insensitive comparison.
+class LiteralSearcher
+{
+public:
+    LiteralSearcher(const TextBuffer& buffer, const std::wstring_view& needle, SearchFlag flags) :
+        _buffer{ buffer },
+        _needle{ needle },
+        _caseInsensitive{ WI_IsFlagSet(flags, SearchFlag::CaseInsensitive) },
+        _asciiNeedle{ _isAscii(needle) }
+    {
+        if (_caseInsensitive && _asciiNeedle)
+        {
+            _foldedNeedle.reserve(needle.size());
+            for (const auto ch : needle)
+            {
+                _foldedNeedle.push_back(til::tolower_ascii(ch));
+            }
+        }
+    }
+
+    // Appends all matches in the line consisting of the rows [rowBeg,rowEnd) to `results`.
+    // Returns false if ICU failed to compile the needle.
+    bool Search(til::CoordType rowBeg, til::CoordType rowEnd, std::vector<til::point_span>& results)
+    {
+        _text.clear();
+        _rowOffsets.clear();
+
+        for (auto y = rowBeg; y < rowEnd; ++y)
+        {
+            _rowOffsets.push_back(_text.size());
+            _text.append(_buffer.GetRowByOffset(y).GetText());
+        }
+
+        _rowOffsets.push_back(_text.size());
+        _rowBeg = rowBeg;
+        _lastRowWrapped = _buffer.GetRowByOffset(rowEnd - 1).WasWrapForced();
+
+        std::wstring_view haystack{ _text };
+        std::wstring_view needle{ _needle };
+
+        if (_caseInsensitive)
+        {
+            if (!_asciiNeedle || !_isAscii(haystack))
+            {
+                return _searchICU(rowBeg, rowEnd, results);
+            }
+
+            _folded.resize(_text.size());
+            std::transform(_text.begin(), _text.end(), _folded.begin(), [](wchar_t ch) { return til::tolower_ascii(ch); });
+            haystack = _folded;
+            needle = _foldedNeedle;
+        }
+
+        for (auto pos = haystack.find(needle); pos != std::wstring_view::npos; pos = haystack.find(needle, pos + needle.size()))
+        {
+            results.emplace_back(_rangeFromMatch(pos, pos + needle.size()));
+        }
+
+        return true;
+    }
+
+private:
+    static bool _isAscii(const std::wstring_view& text) noexcept
+    {
+        return std::all_of(text.begin(), text.end(), [](wchar_t ch) { return ch < 0x80; });
+    }
+
+    bool _searchICU(til::CoordType rowBeg, til::CoordType rowEnd, std::vector<til::point_span>& results)
+    {
+        UErrorCode status = U_ZERO_ERROR;
+
+        if (!_re)
+        {
+            _re = ICU::CreateRegex(_needle, UREGEX_LITERAL | UREGEX_CASE_INSENSITIVE, &status);
+            if (status > U_ZERO_ERROR)
+            {
+                return false;
+            }
+        }
+
+        auto text = ICU::UTextFromTextBuffer(_buffer, rowBeg, rowEnd);
+        uregex_setUText(_re.get(), &text, &status);
+
+        if (uregex_find(_re.get(), -1, &status))
+        {
+            do
+            {
+                results.emplace_back(ICU::BufferRangeFromMatch(&text, _re.get()));
+            } while (uregex_findNext(_re.get(), &status));
+        }
+
+        return true;
+    }
+
+    // Converts a [beg,end) offset pair into _text into buffer coordinates
+    // in exactly the same way as ICU::BufferRangeFromMatch() does.
+    til::point_span _rangeFromMatch(size_t beg, size_t end) const
+    {
+        til::point_span ret;
+        ret.start = _pointFromOffset(beg);
+
+        // If the match ends right at the end of a line that's cut off by the end of the search
+        // range (= its last row is wrapped), there's no row to put the end coordinate on.
+        if (end == _text.size() && _lastRowWrapped)
+        {
+            ret.end = ret.start;
+        }
+        else
+        {
+            ret.end = _pointFromOffset(end);
+        }
+
+        return ret;
+    }
+
+    til::point _pointFromOffset(size_t offset) const
+    {
+        // _rowOffsets contains 1 more item than there are rows: The past-the-end offset.
+        const auto rows = _rowOffsets.size() - 1;
+        const auto it = std::upper_bound(_rowOffsets.begin(), _rowOffsets.begin() + rows, offset) - 1;
+        const auto rowOffset = *it;
+        const auto rowLength = *(it + 1) - rowOffset;
+        const auto y = _rowBeg + gsl::narrow_cast<til::CoordType>(it - _rowOffsets.begin());
+
+        auto off = offset - rowOffset;
+        // Don't leave the offset on a trailing surrogate pair. See utextAccess().
+        if (off > 0 && off < rowLength && U16_IS_TRAIL(til::at(_text, rowOffset + off)))
+        {
+            off--;
+        }
+
+        return { _buffer.GetRowByOffset(y).GetLeadingColumnAtCharOffset(gsl::narrow_cast<ptrdiff_t>(off)), y };
+    }
+
+    const TextBuffer& _buffer;
+    std::wstring_view _needle;
+    std::wstring _foldedNeedle;
+    bool _caseInsensitive = false;
+    bool _asciiNeedle = false;
+    ICU::unique_uregex _re;
+
+    // The text of the current line, the offsets at which each row starts in it and its case-folded copy.
+    std::wstring _text;
+    std::vector<size_t> _rowOffsets;
+    std::wstring _folded;
+    til::CoordType _rowBeg = 0;
+    bool _lastRowWrapped = false;
+};
+
 // Searches through the entire (committed) text buffer for `needle` and returns the coordinates in absolute coordinates.
 // The end coordinates of the returned ranges are considered inclusive.
 std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::wstring_view& needle, SearchFlag flags) const
@@ -3346,6 +4975,31 @@ std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::ws
         return results;
     }
 
+    // A literal needle can only match within a line of text, because lines are separated by a
+    // newline in the text we give to ICU. This allows us to search them one by one without ICU.
+    if (WI_IsFlagClear(flags, SearchFlag::RegularExpression) && needle.find(L'\n') == std::wstring_view::npos)
+    {
+        LiteralSearcher searcher{ *this, needle, flags };
+
+        for (auto y = rowBeg; y < rowEnd;)
+        {
+            auto end = y + 1;
+            while (end < rowEnd && GetRowByOffset(end - 1).WasWrapForced())
+            {
+                ++end;
+            }
+
+            if (!searcher.Search(y, end, results))
+            {
+                return std::nullopt;
+            }
+
+            y = end;
+        }
+
+        return results;
+    }
+
     auto text = ICU::UTextFromTextBuffer(*this, rowBeg, rowEnd);
 
     uint32_t icuFlags{ 0 };
@@ -3380,21 +5034,111 @@ std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::ws
     return results;
 }
 
+// Same as SearchText(needle, flags), but reuses the results stored in `index` for all lines that didn't change since
+// the last call with the same `index`. Only literal searches can be indexed, because regular expressions may match
+// across lines. In that case the index will be reset and the entire buffer searched.
+std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::wstring_view& needle, SearchFlag flags, SearchIndex& index) const
+{
+    if (WI_IsFlagSet(flags, SearchFlag::RegularExpression) || needle.find(L'\n') != std::wstring_view::npos)
+    {
+        index = {};
+        return SearchText(needle, flags);
+    }
+
+    const auto size = GetSize().Dimensions();
+    if (index.needle != needle || index.flags != flags || index.size != size)
+    {
+        index.needle = needle;
+        index.flags = flags;
+        index.size = size;
+        index.revisions.assign(_height, 0);
+        index.lines.assign(_height, {});
+    }
+
+    std::vector<til::point_span> results;
+
+    // All whitespace strings would match the not-yet-written parts of the TextBuffer which would be weird.
+    if (allWhitespace(needle))
+    {
+        return results;
+    }
+
+    // The index is stored by the row index in the underlying circular buffer. See _getRow().
+    const auto physicalRow = [&](til::CoordType y) noexcept {
+        return gsl::narrow_cast<size_t>((_firstRow + y) % _height);
+    };
+
+    const auto rowEnd = _estimateOffsetOfLastCommittedRow() + 1;
+    LiteralSearcher searcher{ *this, needle, flags };
+
+    for (til::CoordType y = 0; y < rowEnd;)
+    {
+        auto end = y + 1;
+        while (end < rowEnd && GetRowByOffset(end - 1).WasWrapForced())
+        {
+            ++end;
+        }
+
+        auto& line = til::at(index.lines, physicalRow(y));
+        auto valid = line.height == end - y;
+        for (auto i = y; valid && i < end; ++i)
+        {
+            valid = til::at(index.revisions, physicalRow(i)) == GetRowByOffset(i).GetRevision();
+        }
+
+        if (!valid)
+        {
+            line.matches.clear();
+
+            if (!searcher.Search(y, end, line.matches))
+            {
+                index = {};
+                return std::nullopt;
+            }
+
+            for (auto& m : line.matches)
+            {
+                m.start.y -= y;
+                m.end.y -= y;
+            }
+
+            for (auto i = y; i < end; ++i)
+            {
+                til::at(index.revisions, physicalRow(i)) = GetRowByOffset(i).GetRevision();
+            }
+
+            // Rows that continue a line can't be the start of one.
+            for (auto i = y + 1; i < end; ++i)
+            {
+                auto& continuation = til::at(index.lines, physicalRow(i));
+                continuation.height = 0;
+                continuation.matches.clear();
+            }
+
+            line.height = end - y;
+        }
+
+        for (const auto& m : line.matches)
+        {
+            results.push_back({ { m.start.x, m.start.y + y }, { m.end.x, m.end.y + y } });
+        }
+
+        y = end;
+    }
+
+    return results;
+}
+
 // Collect up all the rows that were marked, and the data marked on that row.
 // This is what should be used for hot paths, like updating the scrollbar.
 std::vector<ScrollMark> TextBuffer::GetMarkRows() const
 {
     std::vector<ScrollMark> marks;
-    const auto bottom = _estimateOffsetOfLastCommittedRow();
-    for (auto y = 0; y <= bottom; y++)
+    for (auto y = _findMarkAbove(_estimateOffsetOfLastCommittedRow()); y >= 0; y = _findMarkAbove(y - 1))
     {
-        const auto& row = GetRowByOffset(y);
-        const auto& data{ row.GetScrollbarData() };
-        if (data.has_value())
-        {
-            marks.emplace_back(y, *data);
-        }
+        marks.emplace_back(y, *_scrollbarDataAt(y));
     }
+    std::reverse(marks.begin(), marks.end());
     return marks;
 }
 
@@ -3416,15 +5160,9 @@ std::vector<MarkExtents> TextBuffer::GetMarkExtents(size_t limit) const
     std::vector<MarkExtents> marks{};
     const auto bottom = _estimateOffsetOfLastCommittedRow();
     auto lastPromptY = bottom;
-    for (auto promptY = bottom; promptY >= 0; promptY--)
+    for (auto promptY = _findMarkAbove(bottom); promptY >= 0; promptY = _findMarkAbove(promptY - 1))
     {
-        const auto& currRow = GetRowByOffset(promptY);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (!rowPromptData.has_value())
-        {
-            // This row didn't start a prompt, don't even look here.
-            continue;
-        }
+        const auto rowPromptData = _scrollbarDataAt(promptY);
 
         // Future thought! In #11000 & #14792, we considered the possibility of
         // scrolling to only an error mark, or something like that. Perhaps in
@@ -3466,6 +5204,7 @@ void TextBuffer::ClearMarksInRange(
     auto top = std::clamp(std::min(start.y, end.y), 0, _height - 1);
     auto bottom = std::clamp(std::max(start.y, end.y), 0, _estimateOffsetOfLastCommittedRow());
 
+    _removeMarks(top, bottom + 1);
     for (auto y = top; y <= bottom; y++)
     {
         auto& row = GetMutableRowByOffset(y);
@@ -3482,6 +5221,111 @@ void TextBuffer::ClearAllMarks()
     ClearMarksInRange({ 0, 0 }, { _width - 1, _height - 1 });
 }
 
+// Returns the ScrollbarData of the given row, without committing or expanding the ROW.
+// It's returned by value, because another reader may expand the chunk it's stored in right after.
+std::optional<ScrollbarData> TextBuffer::_scrollbarDataAt(const til::CoordType y) const
+{
+    const auto offset = _rowOffset(y);
+    if (_isCompactRow(offset))
+    {
+        const std::lock_guard guard{ _materializeLock };
+        if (_isCompactRow(offset))
+        {
+            return _compactRowAt(offset).promptData;
+        }
+    }
+    const auto row = _buffer.get() + _bufferRowStride * offset;
+    if (row >= _commitWatermark.load(std::memory_order_acquire))
+    {
+        return std::nullopt;
+    }
+    return reinterpret_cast<const ROW*>(row)->GetScrollbarData();
+}
+
+// Returns the closest row at or above `y` that has ScrollbarData, or -1 if there's none.
+til::CoordType TextBuffer::_findMarkAbove(til::CoordType y) const
+{
+    y = std::min<til::CoordType>(y, _height - 1);
+    while (y >= 0 && !_markPositions.empty())
+    {
+        // The rows [0,y] correspond to the positions [_firstRow,position], or, if they wrap
+        // around the end of the circular buffer, to [_firstRow,_height) and [0,position].
+        const auto position = _rowPosition(y);
+        const auto it = std::upper_bound(_markPositions.begin(), _markPositions.end(), position);
+        auto found = it != _markPositions.begin() ? *(it - 1) : _markPositions.back();
+        const auto wraps = position < _firstRow;
+        if (wraps ? (it == _markPositions.begin() && found < _firstRow) : (it == _markPositions.begin() || found < _firstRow))
+        {
+            break;
+        }
+
+        y = (found - _firstRow + _height) % _height;
+        if (_scrollbarDataAt(y).has_value())
+        {
+            return y;
+        }
+        // The ROW got reset since it was marked. Keep looking further up.
+        --y;
+    }
+    return -1;
+}
+
+void TextBuffer::_addMark(const til::CoordType y)
+{
+    const auto position = _rowPosition(y);
+    const auto it = std::lower_bound(_markPositions.begin(), _markPositions.end(), position);
+    if (it == _markPositions.end() || *it != position)
+    {
+        _markPositions.insert(it, position);
+    }
+}
+
+// Removes the rows [beg,end) from _markPositions.
+void TextBuffer::_removeMarks(const til::CoordType beg, const til::CoordType end)
+{
+    if (_markPositions.empty() || beg >= end)
+    {
+        return;
+    }
+    if (end - beg >= _height)
+    {
+        _markPositions.clear();
+        return;
+    }
+
+    const auto erase = [&](const til::CoordType lo, const til::CoordType hi) {
+        const auto first = std::lower_bound(_markPositions.begin(), _markPositions.end(), lo);
+        const auto last = std::lower_bound(first, _markPositions.end(), hi);
+        _markPositions.erase(first, last);
+    };
+    const auto lo = _rowPosition(beg);
+    const auto hi = lo + (end - beg);
+    if (hi <= _height)
+    {
+        erase(lo, hi);
+    }
+    else
+    {
+        erase(lo, _height);
+        erase(0, hi - _height);
+    }
+}
+
+// Recreates _markPositions from the contents of the buffer, after the ROWs got rearranged wholesale.
+void TextBuffer::_rebuildMarks()
+{
+    _markPositions.clear();
+    const auto bottom = _estimateOffsetOfLastCommittedRow();
+    for (til::CoordType y = 0; y <= bottom; ++y)
+    {
+        if (_scrollbarDataAt(y).has_value())
+        {
+            _markPositions.emplace_back(_rowPosition(y));
+        }
+    }
+    std::sort(_markPositions.begin(), _markPositions.end());
+}
+
 // Collect up the extent of the prompt and possibly command and output for the
 // mark that starts on this row.
 MarkExtents TextBuffer::_scrollMarkExtentForRow(const til::CoordType rowOffset,
@@ -3643,23 +5487,16 @@ std::wstring TextBuffer::_commandForRow(const til::CoordType rowOffset,
 
 std::wstring TextBuffer::CurrentCommand() const
 {
-    auto promptY = GetCursor().GetPosition().y;
-    for (; promptY >= 0; promptY--)
+    const auto promptY = _findMarkAbove(GetCursor().GetPosition().y);
+    if (promptY < 0)
     {
-        const auto& currRow = GetRowByOffset(promptY);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (!rowPromptData.has_value())
-        {
-            // This row didn't start a prompt, don't even look here.
-            continue;
-        }
-
-        // This row did start a prompt! Find the prompt that starts here.
-        // Presumably, no rows below us will have prompts, so pass in the last
-        // row with text as the bottom
-        return _commandForRow(promptY, _estimateOffsetOfLastCommittedRow(), true);
+        return L"";
     }
-    return L"";
+
+    // This row did start a prompt! Find the prompt that starts here.
+    // Presumably, no rows below us will have prompts, so pass in the last
+    // row with text as the bottom
+    return _commandForRow(promptY, _estimateOffsetOfLastCommittedRow(), true);
 }
 
 std::vector<std::wstring> TextBuffer::Commands() const
@@ -3667,16 +5504,8 @@ std::vector<std::wstring> TextBuffer::Commands() const
     std::vector<std::wstring> commands{};
     const auto bottom = _estimateOffsetOfLastCommittedRow();
     auto lastPromptY = bottom;
-    for (auto promptY = bottom; promptY >= 0; promptY--)
+    for (auto promptY = _findMarkAbove(bottom); promptY >= 0; promptY = _findMarkAbove(promptY - 1))
     {
-        const auto& currRow = GetRowByOffset(promptY);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (!rowPromptData.has_value())
-        {
-            // This row didn't start a prompt, don't even look here.
-            continue;
-        }
-
         // This row did start a prompt! Find the prompt that starts here.
         // Presumably, no rows below us will have prompts, so pass in the last
         // row with text as the bottom
@@ -3696,6 +5525,7 @@ void TextBuffer::StartPrompt()
     const auto currentRowOffset = GetCursor().GetPosition().y;
     auto& currentRow = GetMutableRowByOffset(currentRowOffset);
     currentRow.StartPrompt();
+    _addMark(currentRowOffset);
 
     _currentAttributes.SetMarkAttributes(MarkKind::Prompt);
 }
@@ -3740,8 +5570,10 @@ bool TextBuffer::_createPromptMarkIfNeeded()
     //   --> add a new mark to this row, set all the attrs in this row
     //   to be Prompt, and set the current attrs to Output.
 
-    auto& row = GetMutableRowByOffset(GetCursor().GetPosition().y);
+    const auto y = GetCursor().GetPosition().y;
+    auto& row = GetMutableRowByOffset(y);
     row.StartPrompt();
+    _addMark(y);
     return true;
 }
 
@@ -3764,15 +5596,9 @@ void TextBuffer::EndCurrentCommand(std::optional<unsigned int> error)
 {
     _currentAttributes.SetMarkAttributes(MarkKind::None);
 
-    for (auto y = GetCursor().GetPosition().y; y >= 0; y--)
+    if (const auto y = _findMarkAbove(GetCursor().GetPosition().y); y >= 0)
     {
-        auto& currRow = GetMutableRowByOffset(y);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (rowPromptData.has_value())
-        {
-            currRow.EndOutput(error);
-            return;
-        }
+        GetMutableRowByOffset(y).EndOutput(error);
     }
 }
 
@@ -3780,6 +5606,7 @@ void TextBuffer::SetScrollbarData(ScrollbarData mark, til::CoordType y)
 {
     auto& row = GetMutableRowByOffset(y);
     row.SetScrollbarData(mark);
+    _addMark(y);
 }
 void TextBuffer::ManuallyMarkRowAsPrompt(til::CoordType y)
 {
@@ -54,6 +54,9 @@ filling in the last row, and updating the screen.
 #include "TextAttribute.hpp"
 #include "../types/inc/Viewport.hpp"
 
+#include <til/ticket_lock.h>
+#include <til/virtual_memory.h>
+
 #include "../buffer/out/textBufferCellIterator.hpp"
 #include "../buffer/out/textBufferTextIterator.hpp"
 
@@ -134,6 +137,22 @@ public:
 
     const Microsoft::Console::Types::Viewport GetSize() const noexcept;
 
+    // Describes how much memory the ROWs of this buffer occupy. Rows that are still "hot" are stored in the
+    // regular row memory, whereas rows that scrolled far enough above the cursor are stored in the compact tier.
+    struct MemoryStatistics
+    {
+        size_t hotRows = 0;
+        size_t hotBytes = 0;
+        size_t compactRows = 0;
+        size_t compactBytes = 0;
+        // The amount of row memory the OS reports as committed (or resident outside of Windows).
+        size_t committedBytes = 0;
+    };
+
+    void SetCompactDistance(til::CoordType distance) noexcept;
+    void SetCommitReadAhead(size_t rows) noexcept;
+    MemoryStatistics GetMemoryStatistics() const noexcept;
+
     void ScrollRows(const til::CoordType firstRow, const til::CoordType size, const til::CoordType delta);
     void CopyRow(const til::CoordType srcRow, const til::CoordType dstRow, TextBuffer& dstBuffer) const;
 
@@ -290,7 +309,11 @@ public:
                        const bool isIntenseBold,
                        std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept;
 
+    // Writes the buffer as UTF-16 VT text, which is what sessions were persisted as before snapshots.
+    // It's kept as the reference that the snapshot round-trip is tested against.
     void SerializeToPath(const wchar_t* destination) const;
+    void SerializeSnapshotToPath(const wchar_t* destination) const;
+    static std::unique_ptr<TextBuffer> DeserializeSnapshot(std::span<const std::byte> snapshot);
 
     struct PositionInformation
     {
@@ -298,10 +321,31 @@ public:
         til::CoordType visibleViewportTop{ 0 };
     };
 
-    static void Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport = nullptr, PositionInformation* positionInfo = nullptr);
+    static void Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport = nullptr, PositionInformation* positionInfo = nullptr, bool allowParallel = true);
+
+    // Retains the results of SearchText() for each line of text, so that repeated searches for the same
+    // needle only need to look at lines whose rows changed since the last search (see ROW::GetRevision).
+    struct SearchIndex
+    {
+        struct Line
+        {
+            // The number of rows the line consisted of. 0 if no line started at this row.
+            til::CoordType height = 0;
+            // The coordinates are relative to the first row of the line.
+            std::vector<til::point_span> matches;
+        };
+
+        std::wstring needle;
+        SearchFlag flags{};
+        til::size size;
+        // Both are indexed by the row index in the underlying circular buffer, so that they remain valid while scrolling.
+        std::vector<uint64_t> revisions;
+        std::vector<Line> lines;
+    };
 
     std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags) const;
     std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags, til::CoordType rowBeg, til::CoordType rowEnd) const;
+    std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags, SearchIndex& index) const;
 
     // Mark handling
     std::vector<ScrollMark> GetMarkRows() const;
@@ -318,13 +362,31 @@ public:
     void ManuallyMarkRowAsPrompt(til::CoordType y);
 
 private:
+    struct CompactAttributeRun;
+    struct CompactChunk;
+
     void _reserve(til::size screenBufferSize, const TextAttribute& defaultAttributes);
     void _commit(const std::byte* row);
     void _decommit() noexcept;
+    void _decommitFrom(size_t offset);
+    void _resetRowMap(til::CoordType count);
     void _construct(const std::byte* until) noexcept;
     void _destroy() const noexcept;
+    void _constructRow(std::byte* row) const noexcept;
+    bool _isCompactRow(size_t offset) const noexcept;
+    void _compactChunk(size_t chunk);
+    void _expandChunk(size_t chunk);
+    void _internCompactAttributes(CompactRow& row, CompactChunk& chunk);
+    void _releaseCompactAttributes(std::span<const CompactAttributeRun> runs) noexcept;
+    void _clearCompactAttributes() noexcept;
+    void _compactScrollback() noexcept;
     ROW& _getRowByOffsetDirect(size_t offset);
     ROW& _getRow(til::CoordType y) const;
+    size_t _rowOffset(til::CoordType y) const noexcept;
+    til::CoordType _rowPosition(til::CoordType y) const noexcept;
+    const CompactRow& _compactRowAt(size_t offset) const;
+    til::CoordType _rowIndexOfOffset(size_t offset) const noexcept;
+    void _rotateRows(til::CoordType beg, til::CoordType end, til::CoordType shift);
     til::CoordType _estimateOffsetOfLastCommittedRow() const noexcept;
 
     void _SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept;
@@ -337,10 +399,21 @@ private:
     til::point _GetWordEndForAccessibility(const til::point target, const std::wstring_view wordDelimiters, const til::point limit) const;
     til::point _GetWordEndForSelection(const til::point target, const std::wstring_view wordDelimiters) const;
     void _PruneHyperlinks();
+    void _startHyperlinkTracking() noexcept;
+    void _trackHyperlinkRow(size_t offset);
+    void _reconcileHyperlinkRefs();
+    std::vector<uint16_t> _hyperlinksOfRow(size_t offset) const;
+    void _addHyperlinkRefs(size_t offset, std::vector<uint16_t>&& ids);
+    bool _releaseHyperlinkRef(uint16_t id) noexcept;
 
     std::wstring _commandForRow(const til::CoordType rowOffset, const til::CoordType bottomInclusive, const bool clipAtCursor = false) const;
     MarkExtents _scrollMarkExtentForRow(const til::CoordType rowOffset, const til::CoordType bottomInclusive) const;
     bool _createPromptMarkIfNeeded();
+    std::optional<ScrollbarData> _scrollbarDataAt(til::CoordType y) const;
+    til::CoordType _findMarkAbove(til::CoordType y) const;
+    void _addMark(til::CoordType y);
+    void _removeMarks(til::CoordType beg, til::CoordType end);
+    void _rebuildMarks();
 
     std::tuple<til::CoordType, til::CoordType, bool> _RowCopyHelper(const CopyRequest& req, const til::CoordType iRow, const ROW& row) const;
 
@@ -352,8 +425,21 @@ private:
 
     std::unordered_map<uint16_t, std::wstring> _hyperlinkMap;
     std::unordered_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
+    std::unordered_map<uint16_t, std::wstring> _hyperlinkIdToCustomIdMap;
     uint16_t _currentHyperlinkId = 1;
 
+    // Hyperlink IDs are reference counted by the number of ROWs that use them, so that IncrementCircularBuffer()
+    // can release the IDs of the row it recycles without searching the rest of the buffer for them.
+    // _hyperlinkRowRefs holds the IDs that were counted for each ROW offset, and _hyperlinkDirtyRows the offsets
+    // that GetMutableRowByOffset() handed out since then, which are recounted before releasing anything.
+    // If _hyperlinkRefsStale is set, the counts are rebuilt from scratch instead. See _reconcileHyperlinkRefs().
+    std::unordered_map<uint16_t, uint32_t> _hyperlinkRefCounts;
+    std::unordered_map<size_t, std::vector<uint16_t>> _hyperlinkRowRefs;
+    std::vector<size_t> _hyperlinkDirtyRows;
+    // No tracking happens until the first hyperlink ID is handed out.
+    bool _hyperlinkTracking = false;
+    bool _hyperlinkRefsStale = false;
+
     // This block describes the state of the underlying virtual memory buffer that holds all ROWs, text and attributes.
     // Initially memory is only allocated with MEM_RESERVE to reduce the private working set of conhost.
     // ROWs are laid out like this in memory:
@@ -367,7 +453,7 @@ private:
     // Padding may exist for alignment purposes.
     //
     // The base (start) address of the memory arena.
-    wil::unique_virtualalloc_ptr<std::byte> _buffer;
+    til::virtual_memory _buffer;
     // The past-the-end pointer of the memory arena.
     std::byte* _bufferEnd = nullptr;
     // The range between _buffer (inclusive) and _commitWatermark (exclusive) is the range of
@@ -385,7 +471,10 @@ private:
     // _commitWatermark will always be a multiple of _bufferRowStride away from _buffer.
     // In other words, _commitWatermark itself will either point exactly onto the next ROW
     // that should be committed or be equal to _bufferEnd when all ROWs are committed.
-    std::byte* _commitWatermark = nullptr;
+    //
+    // It's atomic, because readers holding the terminal lock in shared mode may commit ROWs concurrently.
+    // It's only advanced once the ROWs below it are constructed. See _materializeLock.
+    std::atomic<std::byte*> _commitWatermark{ nullptr };
     // This will MEM_COMMIT 128 rows more than we need, to avoid us from having to call VirtualAlloc too often.
     // This equates to roughly the following commit chunk sizes at these column counts:
     // *  80 columns (the usual minimum) =  60KB chunks,  4.1MB buffer at 9001 rows
@@ -393,7 +482,8 @@ private:
     // * 400 columns (the usual maximum) = 220KB chunks, 15.5MB buffer at 9001 rows
     // There's probably a better metric than this. (This comment was written when ROW had both,
     // a _chars array containing text and a _charOffsets array contain column-to-text indices.)
-    static constexpr size_t _commitReadAheadRowCount = 128;
+    // Can be changed with SetCommitReadAhead(), for instance to trade a few more VirtualAlloc calls for less memory.
+    size_t _commitReadAheadRowCount = 128;
     // Before TextBuffer was made to use virtual memory it initialized the entire memory arena with the initial
     // attributes right away. To ensure it continues to work the way it used to, this stores these initial attributes.
     TextAttribute _initialAttributes;
@@ -411,9 +501,67 @@ private:
     // The height of the buffer in rows, excluding the scratchpad row.
     uint16_t _height = 0;
 
+    // ROWs that are further than _compactDistance rows above the cursor are moved out of the row memory
+    // above into a compact tier in chunks of _compactChunkRowCount ROWs. The pages that a compacted chunk
+    // occupied get MEM_DECOMMIT'd and its ROWs are only reconstructed once they're accessed again.
+    // See _compactChunk() and _expandChunk().
+    struct CompactAttributeRun
+    {
+        uint16_t id;
+        uint16_t length;
+    };
+    struct CompactChunk
+    {
+        // Only reset once the chunk's ROWs are reconstructed. Read via std::atomic_ref, see _isCompactRow().
+        bool compact = false;
+        std::vector<CompactRow> rows;
+        std::vector<uint16_t> pool;
+        // The interned attribute runs of the rows, as indices into _compactAttributes. See _internCompactAttributes().
+        std::vector<CompactAttributeRun> attrRuns;
+    };
+    struct TextAttributeHasher
+    {
+        size_t operator()(const TextAttribute& attr) const noexcept;
+    };
+    // 64 ROWs span 8 or more pages for any buffer that's at least 80 columns wide,
+    // only 2 of which are shared with the neighboring chunks and can't be decommitted.
+    static constexpr size_t _compactChunkRowCount = 64;
+    // Indexed by the chunk index. Allocated on first use.
+    std::vector<CompactChunk> _compactChunks;
+    // The number of chunks that are compact. If 0, _getRowByOffsetDirect() can skip looking at _compactChunks.
+    std::atomic<size_t> _compactChunkCount{ 0 };
+    // IncrementCircularBuffer() visits one chunk after another with this index, to compact
+    // chunks again that got expanded while reading the scrollback. See _compactScrollback().
+    size_t _compactSweep = 0;
+    // <= 0 disables the compact tier.
+    til::CoordType _compactDistance = 1024;
+    // The distinct attributes of the compact tier. A run of an 18 byte TextAttribute and its length
+    // shrinks to 4 bytes this way, which adds up for colorful output. Cleared once no chunk is compact.
+    std::vector<TextAttribute> _compactAttributes;
+    std::unordered_map<TextAttribute, uint16_t, TextAttributeHasher> _compactAttributeIds;
+    // The number of CompactAttributeRuns that refer to each ID. The IDs of attributes that aren't referenced anymore
+    // are reused, so that the table only holds what's in the compact tier right now, instead of every attribute that
+    // was ever in it. _compactAttributeFreeIds has the capacity for every ID, so that releasing them can't throw.
+    std::vector<uint32_t> _compactAttributeRefCounts;
+    std::vector<uint16_t> _compactAttributeFreeIds;
+    // Const accessors construct ROWs lazily (see _getRowByOffsetDirect()) and the terminal
+    // lets any number of readers do that at once. This serializes _commit() and _expandChunk(),
+    // as well as peeks into compact chunks, which may be expanded by another reader in the meantime.
+    mutable til::ticket_lock _materializeLock;
+
     TextAttribute _currentAttributes;
     til::CoordType _firstRow = 0; // indexes top row (not necessarily 0)
+    // ScrollRows() moves rows within a scroll region by permuting which ROW a position in the circular buffer
+    // refers to, instead of copying them. _rowMap maps from the position `(_firstRow + y) % _height` to the
+    // ROW offset (minus the scratchpad row) and _rowMapInverse is its inverse. Both are empty (= identity)
+    // until the first partial scroll. The permutation only ever affects rows that are already committed.
+    std::vector<uint16_t> _rowMap;
+    std::vector<uint16_t> _rowMapInverse;
     uint64_t _lastMutationId = 0;
+    // The positions `(_firstRow + y) % _height` of the rows with ScrollbarData, in ascending order. This lets the
+    // shell integration queries find prompts in log time without visiting every row. Since ROW::Reset() can remove
+    // ScrollbarData behind our back, the entries are only candidates and get checked. See _findMarkAbove().
+    std::vector<til::CoordType> _markPositions;
 
     Cursor _cursor;
     bool _isActiveBuffer = false;
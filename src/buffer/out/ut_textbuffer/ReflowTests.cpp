@@ -805,6 +805,119 @@ class ReflowTests
             _compareTextBufferAgainstTestBuffer(*textBuffer, testBuffer);
         }
     }
+
+    TEST_METHOD(TestReflowLargeBuffer)
+    {
+        // Buffers with this many rows are reflowed concurrently. Each logical line spans 1 to 4 rows,
+        // so that shrinking the width pushes the oldest lines out of the buffer.
+        const til::size size{ 80, 10000 };
+        auto buffer = std::make_unique<TextBuffer>(size, TextAttribute{ 0x7 }, 0, false, &renderer);
+
+        const auto makeLine = [](int i) {
+            auto line = std::to_wstring(i);
+            line.append(i % 13 * 10 + 10, static_cast<wchar_t>(L'a' + i % 26));
+            return line;
+        };
+
+        til::CoordType y = 0;
+        for (auto i = 0; i < 5000; ++i)
+        {
+            const auto line = makeLine(i);
+            for (size_t beg = 0; beg < line.size(); beg += size.width)
+            {
+                auto& row = buffer->GetMutableRowByOffset(y++);
+                RowWriteState state{ .text = std::wstring_view{ line }.substr(beg, size.width) };
+                row.ReplaceText(state);
+                row.SetWrapForced(beg + size.width < line.size());
+            }
+        }
+        buffer->GetCursor().SetPosition({ 0, y });
+
+        const auto narrow = _textBufferByReflowingTextBuffer(*buffer, { 37, size.height });
+        VERIFY_ARE_EQUAL(til::point(0, size.height - 1), narrow->GetCursor().GetPosition());
+
+        const auto wide = _textBufferByReflowingTextBuffer(*narrow, size);
+        const auto cursor = wide->GetCursor().GetPosition();
+        VERIFY_ARE_EQUAL(0, cursor.x);
+
+        // The oldest lines got truncated, but the most recent ones must be unchanged.
+        for (til::CoordType dy = 1; dy <= 5000; ++dy)
+        {
+            const auto& expected = buffer->GetRowByOffset(y - dy);
+            const auto& actual = wide->GetRowByOffset(cursor.y - dy);
+            VERIFY_ARE_EQUAL(String(std::wstring{ expected.GetText() }.c_str()), String(std::wstring{ actual.GetText() }.c_str()));
+            VERIFY_ARE_EQUAL(expected.WasWrapForced(), actual.WasWrapForced());
+        }
+    }
+
+    TEST_METHOD(TestReflowParallelMatchesSerial)
+    {
+        // Logical lines of varying length with wide glyphs and colors, so that the chunks reflowParallel()
+        // splits the buffer into don't line up with the new rows. The cursor and the viewports sit in
+        // the middle of the buffer, so that their new positions depend on more than the last chunk.
+        const til::size size{ 80, 6000 };
+        auto buffer = std::make_unique<TextBuffer>(size, TextAttribute{ 0x7 }, 0, false, &renderer);
+
+        til::CoordType y = 0;
+        for (auto i = 0; y < size.height - 1; ++i)
+        {
+            auto line = std::to_wstring(i);
+            line.append(i % 17 * 13, static_cast<wchar_t>(L'a' + i % 26));
+            if (i % 3 == 0)
+            {
+                line.append(i % 7 + 1, L'\x732B');
+            }
+
+            RowWriteState state{ .text = line };
+            while (y < size.height - 1)
+            {
+                auto& row = buffer->GetMutableRowByOffset(y++);
+                state.columnBegin = 0;
+                row.ReplaceText(state);
+                row.ReplaceAttributes(0, state.columnEnd, TextAttribute{ gsl::narrow_cast<WORD>(i % 15 + 1) });
+                row.SetWrapForced(!state.text.empty());
+                if (state.text.empty())
+                {
+                    break;
+                }
+            }
+        }
+        buffer->GetCursor().SetPosition({ 5, 4321 });
+
+        static constexpr til::size newSizes[]{
+            { 37, 6000 },
+            { 123, 6000 },
+            { 50, 5000 },
+            { 29, 3000 },
+        };
+        for (const auto newSize : newSizes)
+        {
+            Log::Comment(NoThrowString().Format(L"Resizing to %dx%d", newSize.width, newSize.height));
+
+            const auto reflow = [&](const bool allowParallel) {
+                auto newBuffer = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, false, &renderer);
+                TextBuffer::PositionInformation positionInfo{ .mutableViewportTop = 4300, .visibleViewportTop = 1234 };
+                TextBuffer::Reflow(*buffer, *newBuffer, nullptr, &positionInfo, allowParallel);
+                return std::pair{ std::move(newBuffer), positionInfo };
+            };
+            const auto [serial, serialPositions] = reflow(false);
+            const auto [parallel, parallelPositions] = reflow(true);
+
+            VERIFY_ARE_EQUAL(serial->GetCursor().GetPosition(), parallel->GetCursor().GetPosition());
+            VERIFY_ARE_EQUAL(serialPositions.mutableViewportTop, parallelPositions.mutableViewportTop);
+            VERIFY_ARE_EQUAL(serialPositions.visibleViewportTop, parallelPositions.visibleViewportTop);
+
+            for (til::CoordType newY = 0; newY < newSize.height; ++newY)
+            {
+                const auto& expected = serial->GetRowByOffset(newY);
+                const auto& actual = parallel->GetRowByOffset(newY);
+                if (expected.GetText() != actual.GetText() || expected.WasWrapForced() != actual.WasWrapForced() || expected.Attributes() != actual.Attributes())
+                {
+                    VERIFY_FAIL(NoThrowString().Format(L"Row %d differs: \"%s\" vs. \"%s\"", newY, std::wstring{ expected.GetText() }.c_str(), std::wstring{ actual.GetText() }.c_str()));
+                }
+            }
+        }
+    }
 };
 
 DummyRenderer ReflowTests::renderer{};
@@ -25,6 +25,7 @@ class TextAttributeTests
     TEST_METHOD(TestReverseDefaultColors);
     TEST_METHOD(TestRoundtripDefaultColors);
     TEST_METHOD(TestIntenseAsBright);
+    TEST_METHOD(TestDistinguishableColors);
 
     RenderSettings _renderSettings;
     const COLORREF _defaultFg = RGB(1, 2, 3);
@@ -325,3 +326,33 @@ void TextAttributeTests::TestIntenseAsBright()
     // Restore the default IntenseIsBright mode.
     _renderSettings.SetRenderMode(RenderSettings::Mode::IntenseIsBright, true);
 }
+
+void TextAttributeTests::TestDistinguishableColors()
+{
+    if constexpr (!Feature_AdjustIndistinguishableText::IsEnabled())
+    {
+        Log::Result(WEX::Logging::TestResults::Skipped);
+        return;
+    }
+
+    RenderSettings renderSettings;
+    renderSettings.SetRenderMode(RenderSettings::Mode::AlwaysDistinguishableColors, true);
+    renderSettings.SetColorTableEntry(TextColor::DARK_BLACK, RGB(0, 0, 0));
+    renderSettings.SetColorTableEntry(TextColor::DARK_RED, RGB(1, 1, 1));
+
+    TextAttribute attr{};
+    attr.SetIndexedForeground(TextColor::DARK_RED);
+    attr.SetIndexedBackground(TextColor::DARK_BLACK);
+
+    Log::Comment(L"A foreground that's indistinguishable from the background gets nudged, whether it's cached or not");
+    const auto expected = ColorFix::GetPerceivableColor(RGB(1, 1, 1), RGB(0, 0, 0), 0.5f * 0.5f);
+    VERIFY_ARE_NOT_EQUAL(RGB(1, 1, 1), expected);
+    VERIFY_ARE_EQUAL(std::make_pair(expected, RGB(0, 0, 0)), renderSettings.GetAttributeColors(attr));
+    VERIFY_ARE_EQUAL(std::make_pair(expected, RGB(0, 0, 0)), renderSettings.GetAttributeColors(attr));
+
+    Log::Comment(L"Changing the color table must not return stale results");
+    renderSettings.SetColorTableEntry(TextColor::DARK_RED, RGB(255, 0, 0));
+    VERIFY_ARE_EQUAL(std::make_pair(RGB(255, 0, 0), RGB(0, 0, 0)), renderSettings.GetAttributeColors(attr));
+    renderSettings.SetColorTableEntry(TextColor::DARK_RED, RGB(1, 1, 1));
+    VERIFY_ARE_EQUAL(std::make_pair(expected, RGB(0, 0, 0)), renderSettings.GetAttributeColors(attr));
+}
@@ -61,4 +61,56 @@ class UTextAdapterTests
         actual = buffer.SearchText(L"ネコ", SearchFlag::None);
         VERIFY_ARE_EQUAL(expected, actual);
     }
+
+    TEST_METHOD(IncrementalSearch)
+    {
+        DummyRenderer renderer;
+        TextBuffer buffer{ til::size{ 10, 6 }, TextAttribute{}, 0, false, &renderer };
+
+        const auto write = [&](til::CoordType y, const std::wstring_view& text) {
+            RowWriteState state{ .text = text };
+            buffer.Replace(y, TextAttribute{}, state);
+        };
+
+        write(0, L"abc ABC");
+        write(1, L"xxxxxxxxab");
+        write(2, L"c abc ネコ");
+        write(3, L"Straße 𝒶𝒷");
+        write(4, L"xxxxxxxxネ");
+        write(5, L"コ ABCabc");
+        buffer.SetWrapForced(1, true);
+        buffer.SetWrapForced(4, true);
+
+        TextBuffer::SearchIndex index;
+        const auto verify = [&](const wchar_t* needle, SearchFlag flags) {
+            // The literal search paths are checked against a whole-buffer ICU search, quoting the needle as a regex.
+            const auto expected = buffer.SearchText(std::wstring{ L"\\Q" } + needle + L"\\E", flags | SearchFlag::RegularExpression).value();
+            const auto literal = buffer.SearchText(needle, flags).value();
+            const auto incremental = buffer.SearchText(needle, flags, index).value();
+            VERIFY_ARE_EQUAL(expected, literal);
+            VERIFY_ARE_EQUAL(expected, incremental);
+        };
+
+        for (const auto flags : { SearchFlag::None, SearchFlag::CaseInsensitive })
+        {
+            for (const auto needle : { L"abc", L"ab", L"ss", L"ß", L"ネコ", L"𝒷", L"cA" })
+            {
+                verify(needle, flags);
+
+                // Modifying a row must be reflected in the results, without affecting the other rows.
+                write(2, L"c  abc");
+                verify(needle, flags);
+
+                // ...as should changing how rows are joined into lines...
+                buffer.SetWrapForced(1, false);
+                verify(needle, flags);
+                buffer.SetWrapForced(1, true);
+
+                // ...or scrolling the buffer.
+                buffer.IncrementCircularBuffer();
+                write(3, L"abcabc");
+                verify(needle, flags);
+            }
+        }
+    }
 };
@@ -4,6 +4,8 @@
 #include "pch.h"
 #include "ConptyConnection.h"
 
+#include <bit>
+
 #include <conpty-static.h>
 #include <winmeta.h>
 
@@ -661,22 +663,40 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             _LastConPtyClientDisconnected();
         });
 
+        // This thread only reads from the pipe. The chunks it reads are parsed on a separate thread
+        // (see _ProcessOutputThread()), so that a slow TerminalOutput.raise() doesn't stall our ReadFile()
+        // calls and thus the client application. Once the queue is full, we stop reading and the pipe
+        // applies backpressure like it used to.
+        auto [producer, consumer] = til::spsc::channel<std::string>(_outputQueueCapacity);
+        std::thread processThread{ [this, consumer = std::move(consumer)]() noexcept {
+            _ProcessOutputThread(consumer);
+        } };
+        LOG_IF_FAILED(SetThreadDescription(processThread.native_handle(), L"ConptyConnection Process Thread"));
+
+        // This runs before `cleanup`, so that the process exit message comes after all of the output.
+        const auto joinProcessThread = wil::scope_exit([&]() noexcept {
+            // Dropping the producer tells the process thread to exit once it drained the queue.
+            {
+                const auto dropped = std::move(producer);
+            }
+            processThread.join();
+        });
+
         const wil::unique_event overlappedEvent{ CreateEventExW(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS) };
         OVERLAPPED overlapped{ .hEvent = overlappedEvent.get() };
         bool overlappedPending = false;
         char buffer[128 * 1024];
         DWORD read = 0;
 
-        til::u8state u8State;
-        std::wstring wstr;
+        std::string chunk;
 
-        // If we use overlapped IO We want to queue ReadFile() calls before processing the
-        // string, because TerminalOutput.raise() may take a while (relatively speaking).
-        // That's why the loop looks a little weird as it starts a read, processes the
-        // previous string, and finally converts the previous read to the next string.
+        // If we use overlapped IO We want to queue ReadFile() calls before queueing the
+        // previous chunk, because the queue may be full and block us until it has room.
+        // That's why the loop looks a little weird as it starts a read, queues the
+        // previous chunk, and finally copies the previous read into the next chunk.
         for (;;)
         {
-            // When we have a `wstr` that's ready for processing we must do so without blocking.
+            // When we have a `chunk` that's ready for processing we must do so without blocking.
             // Otherwise, whatever the user typed will be delayed until the next IO operation.
             // With overlapped IO that's not a problem because the ReadFile() calls won't block.
             if (!ReadFile(_pipe.get(), &buffer[0], sizeof(buffer), &read, &overlapped))
@@ -688,10 +708,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 overlappedPending = true;
             }
 
-            // wstr can be empty in two situations:
-            // * The previous call to til::u8u16 failed.
-            // * We're using overlapped IO, and it's the first iteration.
-            if (!wstr.empty())
+            // chunk is only empty if we're using overlapped IO, and it's the first iteration.
+            if (!chunk.empty())
             {
                 if (!_receivedFirstByte)
                 {
@@ -709,14 +727,15 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                     _receivedFirstByte = true;
                 }
 
-                try
+                // This only fails if the process thread is gone, which it is when we're closing.
+                if (!producer.emplace(std::move(chunk)))
                 {
-                    TerminalOutput.raise(wstr);
+                    break;
                 }
-                CATCH_LOG();
+                chunk = {};
             }
 
-            // Here's the counterpart to the start of the loop. We processed whatever was in `wstr`,
+            // Here's the counterpart to the start of the loop. We queued whatever was in `chunk`,
             // so blocking synchronously on the pipe is now possible.
             // If we used overlapped IO, we need to wait for the ReadFile() to complete.
             // If we didn't, we can now safely block on our ReadFile() call.
@@ -751,13 +770,89 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
                 TraceLoggingKeyword(TIL_KEYWORD_TRACE));
 
-            // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
-            FAILED_LOG(til::u8u16({ &buffer[0], gsl::narrow_cast<size_t>(read) }, wstr, u8State));
+            chunk.assign(&buffer[0], read);
         }
 
         return 0;
     }
 
+    // Parses the chunks that _OutputThread() read from the pipe by raising TerminalOutput with them.
+    // Everything that piled up in the queue while the previous TerminalOutput.raise() was running is
+    // coalesced into a single call, which amortizes the cost of acquiring the terminal lock and of the
+    // per-call overhead of the VT parser. It exits once _OutputThread() dropped the producer and the queue is empty.
+    void ConptyConnection::_ProcessOutputThread(const til::spsc::consumer<std::string>& consumer) noexcept
+    try
+    {
+        // Histograms over the number of chunks that were queued up each time we took them out of the
+        // queue (= the queue depth) and over the size of the chunks (by powers of 2, up to the buffer size
+        // of _OutputThread()). They're emitted as a trace event once the connection closes.
+        std::array<uint32_t, 8> queueDepthHistogram{};
+        std::array<uint32_t, 18> chunkSizeHistogram{};
+        const auto bucket = [](size_t value, size_t bucketCount) noexcept {
+            return std::min<size_t>(bucketCount - 1, std::bit_width(value | 1) - 1);
+        };
+
+        std::array<std::string, _outputCoalesceLimit> chunks;
+        std::string batch;
+        std::wstring wstr;
+        til::u8state u8State;
+
+        for (;;)
+        {
+            // Blocks until at least 1 chunk is available and then takes all that are there (up to the array size).
+            const auto count = consumer.pop_n(til::spsc::block_initially, chunks.begin(), chunks.size()).first;
+            if (count == 0)
+            {
+                break;
+            }
+
+            til::at(queueDepthHistogram, bucket(count, queueDepthHistogram.size()))++;
+
+            batch.clear();
+            for (auto& chunk : std::span{ chunks }.first(count))
+            {
+                til::at(chunkSizeHistogram, bucket(chunk.size(), chunkSizeHistogram.size()))++;
+                batch.append(chunk);
+                chunk = {};
+            }
+
+            if (_isStateAtOrBeyond(ConnectionState::Closing))
+            {
+                break;
+            }
+
+            TraceLoggingWrite(
+                g_hTerminalConnectionProvider,
+                "ProcessOutput",
+                TraceLoggingUInt32(gsl::narrow_cast<uint32_t>(count), "chunks"),
+                TraceLoggingUInt32(gsl::narrow_cast<uint32_t>(batch.size()), "bytes"),
+                TraceLoggingGuid(_sessionId, "session"),
+                TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+
+            // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
+            FAILED_LOG(til::u8u16(batch, wstr, u8State));
+            if (!wstr.empty())
+            {
+                try
+                {
+                    TerminalOutput.raise(wstr);
+                }
+                CATCH_LOG();
+            }
+        }
+
+        TraceLoggingWrite(
+            g_hTerminalConnectionProvider,
+            "OutputPipelineStatistics",
+            TraceLoggingUInt32FixedArray(queueDepthHistogram.data(), gsl::narrow_cast<UINT16>(queueDepthHistogram.size()), "queueDepthLog2Histogram"),
+            TraceLoggingUInt32FixedArray(chunkSizeHistogram.data(), gsl::narrow_cast<UINT16>(chunkSizeHistogram.size()), "chunkSizeLog2Histogram"),
+            TraceLoggingGuid(_sessionId, "session"),
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+            TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+    }
+    CATCH_LOG()
+
     static winrt::event<NewConnectionHandler> _newConnectionHandlers;
 
     winrt::event_token ConptyConnection::NewConnection(const NewConnectionHandler& handler) { return _newConnectionHandlers.add(handler); };
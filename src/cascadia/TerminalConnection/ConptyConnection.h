@@ -8,6 +8,7 @@
 #include "ITerminalHandoff.h"
 
 #include <til/env.h>
+#include <til/spsc.h>
 #include <til/ticket_lock.h>
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
@@ -102,7 +103,13 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         } _startupInfo{};
 
+        // The number of chunks _OutputThread() may read ahead of _ProcessOutputThread(), and the number
+        // of chunks the latter coalesces into a single TerminalOutput.raise() call at most.
+        static constexpr uint32_t _outputQueueCapacity = 64;
+        static constexpr size_t _outputCoalesceLimit = 16;
+
         DWORD _OutputThread();
+        void _ProcessOutputThread(const til::spsc::consumer<std::string>& consumer) noexcept;
     };
 }
 
@@ -361,7 +361,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             // Then, using the font, get the number of characters that can fit.
             // Resize our terminal connection to match that size, and initialize the terminal with that size.
             const auto viewInPixels = Viewport::FromDimensions({ 0, 0 }, windowSize);
-            LOG_IF_FAILED(_renderEngine->SetWindowSize({ viewInPixels.Width(), viewInPixels.Height() }));
+            {
+                const auto engineLock = _renderer->LockEngines();
+                LOG_IF_FAILED(_renderEngine->SetWindowSize({ viewInPixels.Width(), viewInPixels.Height() }));
+            }
 
             const auto vp = _renderEngine->GetViewportInCharacters(viewInPixels);
             const auto width = vp.Width();
@@ -389,18 +392,24 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 _renderEngineSwapChainChanged(handle);
             });
 
-            _renderEngine->SetRetroTerminalEffect(_settings->RetroTerminalEffect());
-            _renderEngine->SetPixelShaderPath(_settings->PixelShaderPath());
-            _renderEngine->SetPixelShaderImagePath(_settings->PixelShaderImagePath());
-            _renderEngine->SetGraphicsAPI(parseGraphicsAPI(_settings->GraphicsAPI()));
-            _renderEngine->SetDisablePartialInvalidation(_settings->DisablePartialInvalidation());
-            _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
+            {
+                const auto engineLock = _renderer->LockEngines();
+                _renderEngine->SetRetroTerminalEffect(_settings->RetroTerminalEffect());
+                _renderEngine->SetPixelShaderPath(_settings->PixelShaderPath());
+                _renderEngine->SetPixelShaderImagePath(_settings->PixelShaderImagePath());
+                _renderEngine->SetGraphicsAPI(parseGraphicsAPI(_settings->GraphicsAPI()));
+                _renderEngine->SetDisablePartialInvalidation(_settings->DisablePartialInvalidation());
+                _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
+            }
 
             _updateAntiAliasingMode();
 
-            // GH#5098: Inform the engine of the opacity of the default text background.
-            // GH#11315: Always do this, even if they don't have acrylic on.
-            _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            {
+                // GH#5098: Inform the engine of the opacity of the default text background.
+                // GH#11315: Always do this, even if they don't have acrylic on.
+                const auto engineLock = _renderer->LockEngines();
+                _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            }
 
             _initializedTerminal.store(true, std::memory_order_relaxed);
         } // scope for TerminalLock
@@ -460,7 +469,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
         else
         {
+            _renderer->NotifyInput();
             _sendInputToConnection(wstr);
+            // We can't observe when the application reads the input on the other end of the connection.
+            // The closest we get is the moment it was handed to the connection.
+            _renderer->NotifyInputConsumed();
         }
     }
 
@@ -494,7 +507,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         TerminalInput::OutputType out;
         {
-            const auto lock = _terminal->LockForReading();
+            const auto lock = _terminal->LockForWriting();
             out = _terminal->SendCharEvent(ch, scanCode, modifiers);
         }
         if (out)
@@ -671,7 +684,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         TerminalInput::OutputType out;
         {
-            const auto lock = _terminal->LockForReading();
+            const auto lock = _terminal->LockForWriting();
             out = _terminal->SendMouseEvent(viewportPos, uiButton, states, wheelDelta, state);
         }
         if (out)
@@ -739,7 +752,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         if (_renderEngine)
         {
             const auto lock = _terminal->LockForWriting();
-            _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            {
+                const auto engineLock = _renderer->LockEngines();
+                _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            }
             _renderer->NotifyPaintFrame();
         }
 
@@ -756,13 +772,16 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // specify a custom pixel shader, manually enable the legacy retro
         // effect first. This will ensure that a toggle off->on will still work,
         // even if they currently have retro effect off.
-        if (path.empty())
-        {
-            _renderEngine->SetRetroTerminalEffect(!_renderEngine->GetRetroTerminalEffect());
-        }
-        else
         {
-            _renderEngine->SetPixelShaderPath(_renderEngine->GetPixelShaderPath().empty() ? std::wstring_view{ path } : std::wstring_view{});
+            const auto engineLock = _renderer->LockEngines();
+            if (path.empty())
+            {
+                _renderEngine->SetRetroTerminalEffect(!_renderEngine->GetRetroTerminalEffect());
+            }
+            else
+            {
+                _renderEngine->SetPixelShaderPath(_renderEngine->GetPixelShaderPath().empty() ? std::wstring_view{ path } : std::wstring_view{});
+            }
         }
         // Always redraw after toggling effects. This way even if the control
         // does not have focus it will update immediately.
@@ -880,11 +899,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             return;
         }
 
-        _renderEngine->SetGraphicsAPI(parseGraphicsAPI(_settings->GraphicsAPI()));
-        _renderEngine->SetDisablePartialInvalidation(_settings->DisablePartialInvalidation());
-        _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
-        // Inform the renderer of our opacity
-        _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+        {
+            const auto engineLock = _renderer->LockEngines();
+            _renderEngine->SetGraphicsAPI(parseGraphicsAPI(_settings->GraphicsAPI()));
+            _renderEngine->SetDisablePartialInvalidation(_settings->DisablePartialInvalidation());
+            _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
+            // Inform the renderer of our opacity
+            _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+        }
 
         // Trigger a redraw to repaint the window background and tab colors.
         _renderer->TriggerRedrawAll(true, true);
@@ -911,9 +933,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         if (_renderEngine)
         {
             // Update AtlasEngine settings under the lock
-            _renderEngine->SetRetroTerminalEffect(newAppearance->RetroTerminalEffect());
-            _renderEngine->SetPixelShaderPath(newAppearance->PixelShaderPath());
-            _renderEngine->SetPixelShaderImagePath(newAppearance->PixelShaderImagePath());
+            {
+                const auto engineLock = _renderer->LockEngines();
+                _renderEngine->SetRetroTerminalEffect(newAppearance->RetroTerminalEffect());
+                _renderEngine->SetPixelShaderPath(newAppearance->PixelShaderPath());
+                _renderEngine->SetPixelShaderImagePath(newAppearance->PixelShaderImagePath());
+            }
 
             // Incase EnableUnfocusedAcrylic is disabled and Focused Acrylic is set to true,
             // the terminal should ignore the unfocused opacity from settings.
@@ -931,7 +956,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             // Update the renderer as well. It might need to fall back from
             // cleartype -> grayscale if the BG is transparent / acrylic.
-            _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            {
+                const auto engineLock = _renderer->LockEngines();
+                _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            }
             _renderer->NotifyPaintFrame();
 
             auto eventArgs = winrt::make_self<TransparencyChangedEventArgs>(Opacity());
@@ -973,6 +1001,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             break;
         }
 
+        const auto engineLock = _renderer->LockEngines();
         _renderEngine->SetAntialiasingMode(mode);
     }
 
@@ -1013,6 +1042,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             // TODO: MSFT:20895307 If the font doesn't exist, this doesn't
             //      actually fail. We need a way to gracefully fallback.
+            const auto engineLock = _renderer->LockEngines();
             LOG_IF_FAILED(_renderEngine->UpdateDpi(newDpi));
             LOG_IF_FAILED(_renderEngine->UpdateFont(_desiredFont, _actualFont, featureMap, axesMap));
         }
@@ -1109,7 +1139,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _terminal->ClearSelection();
 
         // Tell the dx engine that our window is now the new size.
-        THROW_IF_FAILED(_renderEngine->SetWindowSize({ cx, cy }));
+        {
+            const auto engineLock = _renderer->LockEngines();
+            THROW_IF_FAILED(_renderEngine->SetWindowSize({ cx, cy }));
+        }
 
         // Invalidate everything
         _renderer->TriggerRedrawAll();
@@ -1843,6 +1876,24 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             message = fmt::format(FMT_COMPILE(L"\x1b[100;37m  [{} {} {}]\x1b[K\x1b[m\r\n"), msg, date, time);
         }
 
+        // Files written by PersistToPath() contain a snapshot of the buffer, which can be restored straight from a
+        // mapped view. Files written by older versions contain UTF-16 text with VT sequences, which is parsed below.
+        if (LARGE_INTEGER fileSize; GetFileSizeEx(file.get(), &fileSize) && fileSize.QuadPart > 0)
+        {
+            const wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+            const wil::unique_mapview_ptr<std::byte> view{ mapping ? static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) : nullptr };
+            if (view)
+            {
+                const std::span<const std::byte> snapshot{ view.get(), gsl::narrow_cast<size_t>(fileSize.QuadPart) };
+                const auto lock = _terminal->LockForWriting();
+                if (_terminal->RestoreMainBuffer(snapshot))
+                {
+                    _terminal->Write(message);
+                    return;
+                }
+            }
+        }
+
         wchar_t buffer[32 * 1024];
         DWORD read = 0;
 
@@ -2182,6 +2233,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 _terminal->Write(hstr);
             }
 
+            // After writing, so that the render thread knows that the next frame contains this text.
+            _renderer->NotifyOutput(hstr.size() * sizeof(wchar_t));
+
             if (!_pendingResponses.empty())
             {
                 _sendInputToConnection(_pendingResponses);
@@ -2523,7 +2577,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         TerminalInput::OutputType out;
         {
-            const auto lock = _terminal->LockForReading();
+            const auto lock = _terminal->LockForWriting();
             out = _terminal->FocusChanged(focused);
         }
         if (out && !out->empty())
@@ -2585,7 +2639,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
     void ControlCore::AddMark(const Control::ScrollMark& mark)
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         ::ScrollbarData m{};
 
         if (mark.Color.HasValue)
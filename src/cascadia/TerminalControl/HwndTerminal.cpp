@@ -350,7 +350,10 @@ HRESULT HwndTerminal::Refresh(const til::size windowSize, _Out_ til::size* dimen
 
     _terminal->ClearSelection();
 
-    RETURN_IF_FAILED(_renderEngine->SetWindowSize(windowSize));
+    {
+        const auto engineLock = _renderer->LockEngines();
+        RETURN_IF_FAILED(_renderEngine->SetWindowSize(windowSize));
+    }
 
     // Invalidate everything
     _renderer->TriggerRedrawAll();
@@ -754,7 +757,7 @@ try
 
     TerminalInput::OutputType out;
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         out = _terminal->SendMouseEvent(cursorPosition / fontSize, uMsg, getControlKeyState(), wheelDelta, state);
     }
     if (out)
@@ -790,7 +793,7 @@ try
 
     TerminalInput::OutputType out;
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         out = _terminal->SendKeyEvent(vkey, scanCode, modifiers, keyDown);
     }
     if (out)
@@ -925,6 +925,18 @@ void Terminal::_assertLocked() const noexcept
 #endif
 }
 
+// Anything that modifies the terminal requires the lock in exclusive mode,
+// since any number of readers may hold it in shared mode at the same time.
+void Terminal::_assertLockedExclusive() const noexcept
+{
+#ifndef NDEBUG
+    if (!_suppressLockChecks && !_readWriteLock.is_locked_exclusive())
+    {
+        __debugbreak();
+    }
+#endif
+}
+
 void Terminal::_assertUnlocked() const noexcept
 {
 #ifndef NDEBUG
@@ -936,15 +948,16 @@ void Terminal::_assertUnlocked() const noexcept
 }
 
 // Method Description:
-// - Acquire a read lock on the terminal.
+// - Acquire a read lock on the terminal. Any number of readers may hold it at once,
+//   so whatever is done under it mustn't modify the terminal, not even lazily.
 // Return Value:
 // - a shared_lock which can be used to unlock the terminal. The shared_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::recursive_ticket_lock> Terminal::LockForReading() const noexcept
+[[nodiscard]] std::shared_lock<til::recursive_shared_ticket_lock> Terminal::LockForReading() const noexcept
 {
-#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_ticket_lock>()' which may throw exceptions (f.6).
+#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_shared_ticket_lock>()' which may throw exceptions (f.6).
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
-    return std::unique_lock{ const_cast<til::recursive_ticket_lock&>(_readWriteLock) };
+    return std::shared_lock{ const_cast<til::recursive_shared_ticket_lock&>(_readWriteLock) };
 }
 
 // Method Description:
@@ -952,17 +965,17 @@ void Terminal::_assertUnlocked() const noexcept
 // Return Value:
 // - a unique_lock which can be used to unlock the terminal. The unique_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::recursive_ticket_lock> Terminal::LockForWriting() noexcept
+[[nodiscard]] std::unique_lock<til::recursive_shared_ticket_lock> Terminal::LockForWriting() noexcept
 {
-#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_ticket_lock>()' which may throw exceptions (f.6).
+#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_shared_ticket_lock>()' which may throw exceptions (f.6).
     return std::unique_lock{ _readWriteLock };
 }
 
 // Method Description:
 // - Get a reference to the terminal's read/write lock.
 // Return Value:
-// - a ticket_lock which can be used to manually lock or unlock the terminal.
-til::recursive_ticket_lock_suspension Terminal::SuspendLock() noexcept
+// - a suspension which reacquires the lock in the same mode when it's destructed.
+til::recursive_shared_ticket_lock_suspension Terminal::SuspendLock() noexcept
 {
     return _readWriteLock.suspend();
 }
@@ -1186,7 +1199,7 @@ void Terminal::SetCursorOn(const bool isOn) noexcept
 void Terminal::UpdatePatternsUnderLock()
 {
     _InvalidatePatternTree();
-    _patternIntervalTree = _getPatterns(_VisibleStartIndex(), _VisibleEndIndex());
+    _patternIntervalTree = _getPatternsCached(_VisibleStartIndex(), _VisibleEndIndex());
     _InvalidatePatternTree();
 }
 
@@ -1196,7 +1209,7 @@ void Terminal::UpdatePatternsUnderLock()
 //   visible region is changing
 void Terminal::_clearPatternTree()
 {
-    _assertLocked();
+    _assertLockedExclusive();
     if (!_patternIntervalTree.empty())
     {
         _InvalidatePatternTree();
@@ -1257,7 +1270,7 @@ void Microsoft::Terminal::Core::Terminal::SetClearQuickFixCallback(std::function
 // - Stores the search highlighted regions in the terminal
 void Terminal::SetSearchHighlights(const std::vector<til::point_span>& highlights) noexcept
 {
-    _assertLocked();
+    _assertLockedExclusive();
     _searchHighlights = highlights;
 }
 
@@ -1266,7 +1279,7 @@ void Terminal::SetSearchHighlights(const std::vector<til::point_span>& highlight
 // - If the region isn't empty, it will be brought into view
 void Terminal::SetSearchHighlightFocused(const size_t focusedIdx) noexcept
 {
-    _assertLocked();
+    _assertLockedExclusive();
     _searchHighlightFocused = focusedIdx;
 }
 
@@ -1434,20 +1447,16 @@ private:
 
 static URegularExpressionInterner uregexInterner;
 
-PointTree Terminal::_getPatterns(til::CoordType beg, til::CoordType end) const
+// Appends the matches of all patterns in the rows [beg,end) to `intervals`.
+// PointTree uses half-open ranges and the coordinates are made relative to the row `origin`.
+static void matchPatterns(const TextBuffer& buffer, til::CoordType beg, til::CoordType end, til::CoordType origin, PointTree::interval_vector& intervals)
 {
     static constexpr std::array<std::wstring_view, 1> patterns{
         LR"(\b(?:https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])",
     };
 
-    if (!_detectURLs)
-    {
-        return {};
-    }
-
-    auto text = ICU::UTextFromTextBuffer(_activeBuffer(), beg, end + 1);
+    auto text = ICU::UTextFromTextBuffer(buffer, beg, end);
     UErrorCode status = U_ZERO_ERROR;
-    PointTree::interval_vector intervals;
 
     for (size_t i = 0; i < patterns.size(); ++i)
     {
@@ -1459,13 +1468,93 @@ PointTree Terminal::_getPatterns(til::CoordType beg, til::CoordType end) const
             do
             {
                 auto range = ICU::BufferRangeFromMatch(&text, re.get());
-                // PointTree uses half-open ranges and viewport-relative coordinates.
-                range.start.y -= beg;
-                range.end.y -= beg;
+                range.start.y -= origin;
+                range.end.y -= origin;
                 intervals.push_back(PointTree::interval(range.start, range.end, 0));
             } while (uregex_findNext(re.get(), &status));
         }
     }
+}
+
+PointTree Terminal::_getPatterns(til::CoordType beg, til::CoordType end) const
+{
+    if (!_detectURLs)
+    {
+        return {};
+    }
+
+    PointTree::interval_vector intervals;
+    matchPatterns(_activeBuffer(), beg, end + 1, beg, intervals);
+    return PointTree{ std::move(intervals) };
+}
+
+// Same as _getPatterns(), but reuses the matches in _patternCache for all lines whose rows didn't change since
+// the last call. None of the patterns can match a newline, so it's sufficient to match each line on its own.
+// Since row revisions are unique across TextBuffers, switching to the alt buffer invalidates the cache as well.
+PointTree Terminal::_getPatternsCached(til::CoordType beg, til::CoordType end)
+{
+    if (!_detectURLs)
+    {
+        return {};
+    }
+
+    const auto& buffer = _activeBuffer();
+    const auto size = buffer.GetSize().Dimensions();
+    if (_patternCache.size != size)
+    {
+        _patternCache.size = size;
+        _patternCache.revisions.assign(size.height, 0);
+        _patternCache.lines.assign(size.height, {});
+    }
+
+    // The cache is stored by the row index in the underlying circular buffer. See TextBuffer::_getRow().
+    const auto firstRow = buffer.GetFirstRowIndex();
+    const auto physicalRow = [&](til::CoordType y) noexcept {
+        return gsl::narrow_cast<size_t>((firstRow + y) % size.height);
+    };
+
+    PointTree::interval_vector intervals;
+    const auto rowEnd = end + 1;
+
+    // The first visible row is treated as the start of a line, even if it continues one from above,
+    // just like _getPatterns() does. The cached matches are still valid, because a line is only
+    // reused if it starts at the same row, has the same height and none of its rows changed.
+    for (auto y = beg; y < rowEnd;)
+    {
+        auto lineEnd = y + 1;
+        while (lineEnd < rowEnd && buffer.GetRowByOffset(lineEnd - 1).WasWrapForced())
+        {
+            ++lineEnd;
+        }
+
+        auto& line = til::at(_patternCache.lines, physicalRow(y));
+        auto valid = line.height == lineEnd - y;
+        for (auto i = y; valid && i < lineEnd; ++i)
+        {
+            valid = til::at(_patternCache.revisions, physicalRow(i)) == buffer.GetRowByOffset(i).GetRevision();
+        }
+
+        if (!valid)
+        {
+            line.intervals.clear();
+            matchPatterns(buffer, y, lineEnd, y, line.intervals);
+            line.height = lineEnd - y;
+
+            for (auto i = y; i < lineEnd; ++i)
+            {
+                til::at(_patternCache.revisions, physicalRow(i)) = buffer.GetRowByOffset(i).GetRevision();
+            }
+        }
+
+        for (const auto& interval : line.intervals)
+        {
+            const til::point start{ interval.start.x, interval.start.y + y - beg };
+            const til::point stop{ interval.stop.x, interval.stop.y + y - beg };
+            intervals.push_back(PointTree::interval(start, stop, interval.value));
+        }
+
+        y = lineEnd;
+    }
 
     return PointTree{ std::move(intervals) };
 }
@@ -1566,7 +1655,70 @@ std::wstring Terminal::CurrentCommand() const
 
 void Terminal::SerializeMainBuffer(const wchar_t* destination) const
 {
-    _mainBuffer->SerializeToPath(destination);
+    _mainBuffer->SerializeSnapshotToPath(destination);
+}
+
+// Appends the contents of a snapshot written by SerializeMainBuffer() to the main buffer, as if the rows had been
+// written by the application. Like restoring the older VT based format, this is meant to be used on a fresh terminal,
+// because the hyperlink maps are taken over from the snapshot. Returns false if the snapshot couldn't be read.
+bool Terminal::RestoreMainBuffer(const std::span<const std::byte> snapshot)
+{
+    auto source = TextBuffer::DeserializeSnapshot(snapshot);
+    if (!source)
+    {
+        return false;
+    }
+
+    auto& buffer = *_mainBuffer;
+    const auto bufferSize = buffer.GetSize().Dimensions();
+
+    if (source->GetSize().Width() != bufferSize.width)
+    {
+        auto reflowed = std::make_unique<TextBuffer>(bufferSize, TextAttribute{}, 0, false, nullptr);
+        TextBuffer::Reflow(*source, *reflowed);
+        source = std::move(reflowed);
+    }
+
+    buffer.CopyHyperlinkMaps(*source);
+
+    // The source cursor is on the line after the last row. The rows are copied along with their wrap flags and marks,
+    // and the cursor is moved past each of them like a line feed would, but without going through the VT parser:
+    // Once it reaches the end of the buffer, the buffer is cycled and the rows at the top scroll out.
+    auto& cursor = buffer.GetCursor();
+    const auto rowCount = source->GetCursor().GetPosition().y;
+    auto rotation = 0;
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        const auto dstY = cursor.GetPosition().y;
+        source->CopyRow(y, dstY, buffer);
+
+        if (dstY < bufferSize.height - 1)
+        {
+            cursor.SetPosition({ 0, dstY + 1 });
+        }
+        else
+        {
+            buffer.IncrementCircularBuffer();
+            cursor.SetPosition({ 0, dstY });
+            rotation++;
+        }
+    }
+
+    if (rotation)
+    {
+        NotifyBufferRotation(rotation);
+    }
+
+    // Pan the viewport down to the cursor, if it moved past the bottom.
+    const auto viewport = _GetMutableViewport();
+    const auto cursorY = cursor.GetPosition().y;
+    if (cursorY > viewport.BottomInclusive())
+    {
+        SetViewportPosition({ viewport.Left(), cursorY - viewport.Height() + 1 });
+    }
+
+    buffer.TriggerRedrawAll();
+    return true;
 }
 
 void Terminal::ColorSelection(const TextAttribute& attr, winrt::Microsoft::Terminal::Core::MatchMode matchMode)
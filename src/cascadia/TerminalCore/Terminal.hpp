@@ -104,10 +104,11 @@ public:
     void Write(std::wstring_view stringView);
 
     void _assertLocked() const noexcept;
+    void _assertLockedExclusive() const noexcept;
     void _assertUnlocked() const noexcept;
-    [[nodiscard]] std::unique_lock<til::recursive_ticket_lock> LockForReading() const noexcept;
-    [[nodiscard]] std::unique_lock<til::recursive_ticket_lock> LockForWriting() noexcept;
-    til::recursive_ticket_lock_suspension SuspendLock() noexcept;
+    [[nodiscard]] std::shared_lock<til::recursive_shared_ticket_lock> LockForReading() const noexcept;
+    [[nodiscard]] std::unique_lock<til::recursive_shared_ticket_lock> LockForWriting() noexcept;
+    til::recursive_shared_ticket_lock_suspension SuspendLock() noexcept;
 
     til::CoordType GetBufferHeight() const noexcept;
 
@@ -126,6 +127,7 @@ public:
     std::wstring CurrentCommand() const;
 
     void SerializeMainBuffer(const wchar_t* destination) const;
+    bool RestoreMainBuffer(std::span<const std::byte> snapshot);
 
 #pragma region ITerminalApi
     // These methods are defined in TerminalApi.cpp
@@ -339,7 +341,13 @@ private:
     //
     // But we can abuse the fact that the surrounding members rarely change and are huge
     // (std::function is like 64 bytes) to create some natural padding without wasting space.
-    til::recursive_ticket_lock _readWriteLock;
+    //
+    // LockForReading() acquires it in shared mode, everything else (including LockConsole()) exclusively.
+    // The renderer needs the latter, because painting uses the scratchpad row and caches the selection,
+    // and UIA shares IRenderData::LockConsole() with it.
+    // Anything that's reachable through a shared lock must be safe to call concurrently. Most notably
+    // that's TextBuffer's lazy ROW construction, which is serialized by TextBuffer itself.
+    til::recursive_shared_ticket_lock _readWriteLock;
 
     std::function<void(const int, const int, const int)> _pfnScrollPositionChanged;
     std::function<void()> _pfnTaskbarProgressChanged;
@@ -435,6 +443,24 @@ private:
     //      Either way, we should make this behavior controlled by a setting.
 
     interval_tree::IntervalTree<til::point, size_t> _patternIntervalTree;
+    // Retains the pattern matches of each line of text between calls to UpdatePatternsUnderLock(),
+    // so that only lines whose rows changed (see ROW::GetRevision) need to be matched again.
+    struct PatternCache
+    {
+        struct Line
+        {
+            // The number of rows the line consisted of. 0 if no line started at this row.
+            til::CoordType height = 0;
+            // The coordinates are relative to the first row of the line.
+            std::vector<interval_tree::Interval<til::point, size_t>> intervals;
+        };
+
+        til::size size;
+        // Both are indexed by the row index in the underlying circular buffer, so that they remain valid while scrolling.
+        std::vector<uint64_t> revisions;
+        std::vector<Line> lines;
+    };
+    PatternCache _patternCache;
     void _clearPatternTree();
     void _InvalidatePatternTree();
     void _InvalidateFromCoords(const til::point start, const til::point end);
@@ -472,6 +498,7 @@ private:
     TextBuffer& _activeBuffer() const noexcept;
     void _updateUrlDetection();
     interval_tree::IntervalTree<til::point, size_t> _getPatterns(til::CoordType beg, til::CoordType end) const;
+    interval_tree::IntervalTree<til::point, size_t> _getPatternsCached(til::CoordType beg, til::CoordType end);
 
 #pragma region TextSelection
     // These methods are defined in TerminalSelection.cpp
@@ -61,7 +61,7 @@ CATCH_LOG()
 
 void Terminal::SetSystemMode(const Mode mode, const bool enabled) noexcept
 {
-    _assertLocked();
+    _assertLockedExclusive();
     _systemMode.set(mode, enabled);
 }
 
@@ -83,7 +83,7 @@ void Terminal::WarningBell()
 
 void Terminal::SetWindowTitle(const std::wstring_view title)
 {
-    _assertLocked();
+    _assertLockedExclusive();
     if (!_suppressApplicationTitle)
     {
         _title.emplace(title.empty() ? _startingTitle : title);
@@ -100,7 +100,7 @@ CursorType Terminal::GetUserDefaultCursorStyle() const noexcept
 bool Terminal::ResizeWindow(const til::CoordType width, const til::CoordType height)
 {
     // TODO: This will be needed to support various resizing sequences. See also GH#1860.
-    _assertLocked();
+    _assertLockedExclusive();
 
     if (width <= 0 || height <= 0 || width > SHRT_MAX || height > SHRT_MAX)
     {
@@ -155,7 +155,7 @@ void Terminal::CopyToClipboard(wil::zwstring_view content)
 // - <none>
 void Terminal::SetTaskbarProgress(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::TaskbarState state, const size_t progress)
 {
-    _assertLocked();
+    _assertLockedExclusive();
 
     _taskbarState = static_cast<size_t>(state);
 
@@ -200,7 +200,7 @@ void Terminal::SetTaskbarProgress(const ::Microsoft::Console::VirtualTerminal::D
 
 void Terminal::SetWorkingDirectory(std::wstring_view uri)
 {
-    _assertLocked();
+    _assertLockedExclusive();
 
     static bool logged = false;
     if (!logged)
@@ -225,7 +225,7 @@ void Terminal::PlayMidiNote(const int noteNumber, const int velocity, const std:
 
 void Terminal::UseAlternateScreenBuffer(const TextAttribute& attrs)
 {
-    _assertLocked();
+    _assertLockedExclusive();
 
     // the new alt buffer is exactly the size of the viewport.
     _altBufferSize = _mutableViewport.Dimensions();
@@ -188,7 +188,7 @@ void Terminal::MultiClickSelection(const til::point viewportPos, SelectionExpans
 // - position: the (x,y) coordinate on the visible viewport
 void Terminal::SetSelectionAnchor(const til::point viewportPos)
 {
-    _assertLocked();
+    _assertLockedExclusive();
 
     auto selection{ _selection.write() };
     wil::hide_name _selection;
@@ -847,7 +847,7 @@ void Terminal::_MoveByBuffer(SelectionDirection direction, til::point& pos) noex
 #pragma warning(disable : 26440) // changing this to noexcept would require a change to ConHost's selection model
 void Terminal::ClearSelection()
 {
-    _assertLocked();
+    _assertLockedExclusive();
     _selection.write()->active = false;
     _selectionMode = SelectionInteractionMode::None;
     _selectionIsTargetingUrl = false;
@@ -0,0 +1,314 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderer.hpp"
+#include "../renderer/inc/RenderEngineBase.hpp"
+
+using namespace winrt::Microsoft::Terminal::Core;
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace ::Microsoft::Console::Types;
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace std::string_view_literals;
+
+namespace
+{
+    // Accumulates the invalidations into a dirty area like the real engines do,
+    // so that the Renderer copies (and thus paints) exactly the invalidated rows.
+    class MockRowRenderEngine final : public RenderEngineBase
+    {
+    public:
+        // The viewport-relative rows that were invalidated since the last Reset(), as a comma-separated list.
+        std::wstring InvalidatedRows() const
+        {
+            auto rows = _invalidatedRows;
+            std::sort(rows.begin(), rows.end());
+            rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+            std::wstring str;
+            for (const auto y : rows)
+            {
+                if (!str.empty())
+                {
+                    str.push_back(L',');
+                }
+                str.append(std::to_wstring(y));
+            }
+            return str;
+        }
+
+        void Reset()
+        {
+            _invalidatedRows.clear();
+        }
+
+        HRESULT StartPaint() noexcept { return S_OK; }
+        HRESULT EndPaint() noexcept
+        {
+            _dirty.clear();
+            return S_OK;
+        }
+        HRESULT Present() noexcept { return S_OK; }
+        HRESULT ScrollFrame() noexcept { return S_OK; }
+        HRESULT Invalidate(const til::rect* psrRegion) noexcept
+        {
+            _invalidate(*psrRegion);
+            return S_OK;
+        }
+        HRESULT InvalidateCursor(const til::rect* /*psrRegion*/) noexcept { return S_OK; }
+        HRESULT InvalidateSystem(const til::rect* /*prcDirtyClient*/) noexcept { return S_OK; }
+        HRESULT InvalidateScroll(const til::point* pcoordDelta) noexcept
+        {
+            // Like the real engines, we keep what we presented and only need to paint the rows that scrolled into view.
+            const auto dy = pcoordDelta->y;
+            if (dy < 0)
+            {
+                _invalidate({ 0, _size.height + dy, _size.width, _size.height });
+            }
+            else if (dy > 0)
+            {
+                _invalidate({ 0, 0, _size.width, dy });
+            }
+            return S_OK;
+        }
+        HRESULT InvalidateAll() noexcept
+        {
+            _invalidate({ til::point{}, _size });
+            return S_OK;
+        }
+        HRESULT InvalidateCircling(_Out_ bool* /*pForcePaint*/) noexcept { return S_OK; }
+        HRESULT PaintBackground() noexcept { return S_OK; }
+        HRESULT PaintBufferLine(std::span<const Cluster> /*clusters*/, til::point /*coord*/, bool /*fTrimLeft*/, bool /*lineWrapped*/) noexcept { return S_OK; }
+        HRESULT PaintBufferGridLines(GridLineSet /*lines*/, COLORREF /*gridlineColor*/, COLORREF /*underlineColor*/, size_t /*cchLine*/, til::point /*coordTarget*/) noexcept { return S_OK; }
+        HRESULT PaintSelection(const til::rect& /*rect*/) noexcept { return S_OK; }
+        HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept { return S_OK; }
+        HRESULT UpdateDrawingBrushes(const TextAttribute& /*textAttributes*/, const RenderSettings& /*renderSettings*/, gsl::not_null<IRenderData*> /*pData*/, bool /*usingSoftFont*/, bool /*isSettingDefaultBrushes*/) noexcept { return S_OK; }
+        HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/) noexcept { return S_OK; }
+        HRESULT UpdateDpi(int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT UpdateViewport(const til::inclusive_rect& srNewViewport) noexcept
+        {
+            // A differently sized viewport invalidates everything, just like it does in the real engines.
+            const til::size size{ srNewViewport.right - srNewViewport.left + 1, srNewViewport.bottom - srNewViewport.top + 1 };
+            if (size != _size)
+            {
+                _size = size;
+                InvalidateAll();
+            }
+            return S_OK;
+        }
+        HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/, int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT GetDirtyArea(std::span<const til::rect>& area) noexcept
+        {
+            area = _dirty;
+            return S_OK;
+        }
+        HRESULT GetFontSize(_Out_ til::size* /*pFontSize*/) noexcept { return S_OK; }
+        HRESULT IsGlyphWideByFont(std::wstring_view /*glyph*/, _Out_ bool* /*pResult*/) noexcept { return S_OK; }
+
+    protected:
+        HRESULT _DoUpdateTitle(const std::wstring_view /*newTitle*/) noexcept { return S_OK; }
+
+    private:
+        void _invalidate(const til::rect& rect) noexcept
+        try
+        {
+            _dirty.emplace_back(rect);
+            for (auto y = rect.top; y < rect.bottom; ++y)
+            {
+                _invalidatedRows.emplace_back(y);
+            }
+        }
+        CATCH_LOG()
+
+        til::size _size;
+        std::vector<til::rect> _dirty;
+        std::vector<til::CoordType> _invalidatedRows;
+    };
+}
+
+namespace TerminalCoreUnitTests
+{
+    class RenderInvalidationTest;
+};
+using namespace TerminalCoreUnitTests;
+
+// The Renderer drops the rows of Region invalidations whose ROW::ContentHash() matches the one
+// they had when they were last presented. These tests ensure that it doesn't drop too much.
+class TerminalCoreUnitTests::RenderInvalidationTest final
+{
+    static const til::CoordType TerminalViewWidth = 80;
+    static const til::CoordType TerminalViewHeight = 32;
+    static const til::CoordType TerminalHistoryLength = 100;
+
+    TEST_CLASS(RenderInvalidationTest);
+
+    TEST_METHOD(TestIdenticalRewriteIsSkipped);
+    TEST_METHOD(TestChangedRowsArePainted);
+    TEST_METHOD(TestHashesFollowScroll);
+    TEST_METHOD(TestHashesFollowResize);
+
+    TEST_METHOD_SETUP(MethodSetup)
+    {
+        _term = std::make_unique<::Microsoft::Terminal::Core::Terminal>(Terminal::TestDummyMarker{});
+        _renderEngine = std::make_unique<MockRowRenderEngine>();
+        _renderer = std::make_unique<DummyRenderer>(_term.get());
+        _renderer->AddRenderEngine(_renderEngine.get());
+        _term->Create({ TerminalViewWidth, TerminalViewHeight }, TerminalHistoryLength, *_renderer);
+
+        // The first frame tells the engine about the viewport, which
+        // invalidates everything and presents the initial row hashes.
+        _paintFrame();
+        return true;
+    }
+
+    TEST_METHOD_CLEANUP(MethodCleanup)
+    {
+        _renderer = nullptr;
+        _term = nullptr;
+        return true;
+    }
+
+private:
+    Renderer::FrameRowStats _paintFrame()
+    {
+        VERIFY_SUCCEEDED(_renderer->PaintFrame());
+        return _renderer->GetLastFrameRowStats();
+    }
+
+    // Invalidates the given viewport-relative rows like an application rewriting them would.
+    void _redrawRows(const til::CoordType top, const til::CoordType height)
+    {
+        const auto view = _term->GetViewport();
+        _renderer->TriggerRedraw(Viewport::FromDimensions({ 0, view.Top() + top }, { view.Width(), height }));
+    }
+
+    std::unique_ptr<Terminal> _term;
+    std::unique_ptr<MockRowRenderEngine> _renderEngine;
+    std::unique_ptr<DummyRenderer> _renderer;
+};
+
+void RenderInvalidationTest::TestIdenticalRewriteIsSkipped()
+{
+    _term->Write(L"foo\r\nbar\r\nbaz");
+    auto stats = _paintFrame();
+    VERIFY_ARE_EQUAL(3u, stats.painted);
+
+    Log::Comment(L"Rewriting the same text mustn't invalidate anything.");
+    _renderEngine->Reset();
+    _term->Write(L"\x1b[Hfoo\r\nbar\r\nbaz");
+    stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L""sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(0u, stats.painted);
+    VERIFY_IS_GREATER_THAN_OR_EQUAL(stats.skipped, 3u);
+
+    Log::Comment(L"Rewriting a single row of otherwise unchanged rows must only paint that row.");
+    _renderEngine->Reset();
+    _term->Write(L"\x1b[2;1Hbaz");
+    _redrawRows(0, 3);
+    stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L"1"sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(1u, stats.painted);
+    VERIFY_IS_GREATER_THAN_OR_EQUAL(stats.skipped, 2u);
+}
+
+void RenderInvalidationTest::TestChangedRowsArePainted()
+{
+    _term->Write(L"foo\r\nbar\r\nbaz");
+    _paintFrame();
+
+    Log::Comment(L"The same text with a different attribute run must be painted.");
+    _renderEngine->Reset();
+    _term->Write(L"\x1b[H\x1b[1mfoo\x1b[m");
+    auto stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L"0"sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(1u, stats.painted);
+
+    Log::Comment(L"The same text with a different line rendition must be painted.");
+    _renderEngine->Reset();
+    _term->Write(L"\x1b[2;1H\x1b#6");
+    stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L"1"sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(1u, stats.painted);
+
+    Log::Comment(L"The same text with a new image revision must be painted.");
+    auto& row = _term->GetTextBuffer().GetMutableRowByOffset(_term->GetViewport().Top() + 2);
+    const auto slice = row.SetImageSlice(std::make_unique<ImageSlice>(til::size{ 10, 20 }));
+    slice->MutablePixels(0, 1);
+    _redrawRows(2, 1);
+    _paintFrame();
+
+    _renderEngine->Reset();
+    const auto revision = slice->Revision();
+    slice->MutablePixels(0, 1);
+    VERIFY_ARE_NOT_EQUAL(revision, slice->Revision());
+    _redrawRows(0, 3);
+    stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L"2"sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(1u, stats.painted);
+}
+
+void RenderInvalidationTest::TestHashesFollowScroll()
+{
+    // Every row gets distinct contents, so that any misalignment
+    // between the rows and their presented hashes gets them painted.
+    for (auto i = 0; i < TerminalViewHeight; ++i)
+    {
+        _term->Write(fmt::format(FMT_COMPILE(L"{}row {}"), i ? L"\r\n" : L"", i));
+    }
+    _paintFrame();
+
+    Log::Comment(L"Scroll the viewport down by one row.");
+    const auto top = _term->GetViewport().Top();
+    _renderEngine->Reset();
+    _term->Write(L"\r\nnew row");
+    _renderer->TriggerScroll();
+    _paintFrame();
+    VERIFY_ARE_EQUAL(top + 1, _term->GetViewport().Top());
+    VERIFY_ARE_EQUAL(std::to_wstring(TerminalViewHeight - 1), _renderEngine->InvalidatedRows());
+
+    Log::Comment(L"After the scroll, the presented hashes must still match the rows they belong to.");
+    _renderEngine->Reset();
+    _redrawRows(0, TerminalViewHeight);
+    auto stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L""sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(0u, stats.painted);
+    VERIFY_ARE_EQUAL(gsl::narrow_cast<size_t>(TerminalViewHeight), stats.skipped);
+}
+
+void RenderInvalidationTest::TestHashesFollowResize()
+{
+    for (auto i = 0; i < TerminalViewHeight; ++i)
+    {
+        _term->Write(fmt::format(FMT_COMPILE(L"{}row {}"), i ? L"\r\n" : L"", i));
+    }
+    _paintFrame();
+
+    Log::Comment(L"A smaller viewport gets repainted entirely.");
+    constexpr til::CoordType height = TerminalViewHeight / 2;
+    _renderEngine->Reset();
+    VERIFY_SUCCEEDED(_term->UserResize({ TerminalViewWidth, height }));
+    auto stats = _paintFrame();
+    VERIFY_ARE_EQUAL(gsl::narrow_cast<size_t>(height), stats.painted);
+
+    Log::Comment(L"Afterwards the presented hashes must match the rows of the new viewport.");
+    _renderEngine->Reset();
+    _redrawRows(0, height);
+    stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L""sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(0u, stats.painted);
+    VERIFY_ARE_EQUAL(gsl::narrow_cast<size_t>(height), stats.skipped);
+
+    Log::Comment(L"...and changes to them must still be painted.");
+    _renderEngine->Reset();
+    _term->Write(L"\x1b[1;1Hchanged");
+    stats = _paintFrame();
+    VERIFY_ARE_EQUAL(L"0"sv, _renderEngine->InvalidatedRows());
+    VERIFY_ARE_EQUAL(1u, stats.painted);
+}
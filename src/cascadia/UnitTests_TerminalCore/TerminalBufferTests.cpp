@@ -52,6 +52,11 @@ class TerminalCoreUnitTests::TerminalBufferTests final
     TEST_METHOD(TestGetReverseTab);
 
     TEST_METHOD(TestURLPatternDetection);
+    TEST_METHOD(TestURLPatternDetectionAfterChanges);
+
+    TEST_METHOD(TestRestoreMainBufferMatchesLegacyFormat);
+    TEST_METHOD(TestRestoreMainBufferScrollsAndKeepsMarks);
+    TEST_METHOD(TestRestoreMainBufferRejectsLegacyFormat);
 
     TEST_METHOD_SETUP(MethodSetup)
     {
@@ -70,8 +75,17 @@ class TerminalCoreUnitTests::TerminalBufferTests final
     }
 
 private:
+    // A Terminal other than `term`, for tests that restore a buffer into a fresh one.
+    struct OtherTerminal
+    {
+        std::unique_ptr<Terminal> term;
+        std::unique_ptr<DummyRenderer> renderer;
+    };
+
     void _SetTabStops(std::list<til::CoordType> columns, bool replace);
     std::list<til::CoordType> _GetTabStops();
+    static OtherTerminal _CreateTerminal(til::CoordType width, til::CoordType historyLength);
+    static std::vector<std::byte> _SerializeToBytes(const std::function<void(const wchar_t*)>& serialize);
 
     std::unique_ptr<DummyRenderer> emptyRenderer;
     std::unique_ptr<Terminal> term;
@@ -634,3 +648,195 @@ void TerminalBufferTests::TestURLPatternDetection()
     result = term->GetHyperlinkAtBufferPosition(til::point{ urlEndX + 1, 0 });
     VERIFY_IS_TRUE(result.empty(), L"URL is not detected after the actual URL.");
 }
+
+void TerminalBufferTests::TestURLPatternDetectionAfterChanges()
+{
+    using namespace std::string_view_literals;
+
+    constexpr auto UrlStr = L"https://www.contoso.com"sv;
+    constexpr auto WrappedUrlStr = L"https://www.contoso.com/wrapped"sv;
+
+    auto originalDetectURLs = term->_detectURLs;
+    auto restoreDetectUrls = wil::scope_exit([&]() {
+        term->_detectURLs = originalDetectURLs;
+    });
+    term->_detectURLs = true;
+
+    auto& termSm = *term->_stateMachine;
+    termSm.ProcessString(UrlStr);
+    term->UpdatePatternsUnderLock();
+    VERIFY_ARE_EQUAL(UrlStr, term->GetHyperlinkAtBufferPosition(til::point{ 10, 0 }));
+
+    Log::Comment(L"Overwriting the scheme must remove the URL, even though the other rows didn't change.");
+    termSm.ProcessString(L"\x1b[Hxxxxxxxx"sv);
+    term->UpdatePatternsUnderLock();
+    VERIFY_IS_TRUE(term->GetHyperlinkAtBufferPosition(til::point{ 10, 0 }).empty());
+
+    Log::Comment(L"A URL that wraps into the next row must be detected on both rows.");
+    termSm.ProcessString(fmt::format(FMT_COMPILE(L"\x1b[2;{}H{}"), TerminalViewWidth - 10, WrappedUrlStr));
+    term->UpdatePatternsUnderLock();
+    VERIFY_ARE_EQUAL(WrappedUrlStr, term->GetHyperlinkAtBufferPosition(til::point{ TerminalViewWidth - 5, 1 }));
+    VERIFY_ARE_EQUAL(WrappedUrlStr, term->GetHyperlinkAtBufferPosition(til::point{ 5, 2 }));
+
+    Log::Comment(L"Changing only the wrapped row must rescan the row it wraps from as well.");
+    termSm.ProcessString(L"\x1b[3;1H\x1b[2K"sv);
+    term->UpdatePatternsUnderLock();
+    VERIFY_ARE_EQUAL(L"https://ww"sv, term->GetHyperlinkAtBufferPosition(til::point{ TerminalViewWidth - 5, 1 }));
+}
+
+TerminalBufferTests::OtherTerminal TerminalBufferTests::_CreateTerminal(const til::CoordType width, const til::CoordType historyLength)
+{
+    OtherTerminal other;
+    other.term = std::make_unique<Terminal>(Terminal::TestDummyMarker{});
+    other.renderer = std::make_unique<DummyRenderer>(other.term.get());
+    other.term->Create({ width, TerminalViewHeight }, historyLength, *other.renderer);
+    return other;
+}
+
+// Calls `serialize` with the path of a temporary file and returns what it wrote into it.
+std::vector<std::byte> TerminalBufferTests::_SerializeToBytes(const std::function<void(const wchar_t*)>& serialize)
+{
+    wchar_t tempPath[MAX_PATH];
+    wchar_t path[MAX_PATH];
+    VERIFY_ARE_NOT_EQUAL(0u, GetTempPathW(MAX_PATH, &tempPath[0]));
+    VERIFY_ARE_NOT_EQUAL(0u, GetTempFileNameW(&tempPath[0], L"tb", 0, &path[0]));
+    const auto cleanup = wil::scope_exit([&]() { DeleteFileW(&path[0]); });
+
+    serialize(&path[0]);
+
+    const wil::unique_handle file{ CreateFileW(&path[0], GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    VERIFY_IS_TRUE(file.is_valid());
+    LARGE_INTEGER fileSize;
+    VERIFY_WIN32_BOOL_SUCCEEDED(GetFileSizeEx(file.get(), &fileSize));
+    std::vector<std::byte> bytes(gsl::narrow<size_t>(fileSize.QuadPart));
+    DWORD read = 0;
+    VERIFY_WIN32_BOOL_SUCCEEDED(ReadFile(file.get(), bytes.data(), gsl::narrow<DWORD>(bytes.size()), &read, nullptr));
+    VERIFY_ARE_EQUAL(bytes.size(), size_t{ read });
+    return bytes;
+}
+
+// Restoring a snapshot must produce the same buffer as replaying the VT text that SerializeToPath() writes, which is
+// what sessions used to be persisted as. This includes restoring into a narrower terminal, which reflows the snapshot.
+void TerminalBufferTests::TestRestoreMainBufferMatchesLegacyFormat()
+{
+    auto& termSm = *term->_stateMachine;
+    for (auto i = 0; i < 60; ++i)
+    {
+        // Colored text, a wide glyph, a surrogate pair and every 5th line long enough to wrap.
+        const auto tail = i % 5 ? std::wstring{} : std::wstring(TerminalViewWidth + 7, static_cast<wchar_t>(L'a' + i % 26));
+        termSm.ProcessString(fmt::format(FMT_COMPILE(L"\x1b[3{};4{}mline {}\x1b[m \x732B \xD83D\xDD25 {}\r\n"), i % 8, (i + 3) % 8, i, tail));
+    }
+
+    const auto legacy = _SerializeToBytes([&](const wchar_t* path) { term->_mainBuffer->SerializeToPath(path); });
+    const auto snapshot = _SerializeToBytes([&](const wchar_t* path) { term->SerializeMainBuffer(path); });
+
+    // Skip the BOM, just like ControlCore::RestoreFromPath() does.
+    VERIFY_IS_GREATER_THAN_OR_EQUAL(legacy.size(), sizeof(wchar_t));
+    const std::wstring_view legacyText{ reinterpret_cast<const wchar_t*>(legacy.data()) + 1, legacy.size() / sizeof(wchar_t) - 1 };
+
+    for (const auto width : { TerminalViewWidth, TerminalViewWidth / 2 + 3 })
+    {
+        Log::Comment(NoThrowString().Format(L"Restoring into a terminal %d columns wide", width));
+
+        auto expected = _CreateTerminal(width, TerminalHistoryLength);
+        expected.term->_stateMachine->ProcessString(legacyText);
+
+        auto actual = _CreateTerminal(width, TerminalHistoryLength);
+        VERIFY_IS_TRUE(actual.term->RestoreMainBuffer(snapshot));
+
+        const auto& expectedBuffer = *expected.term->_mainBuffer;
+        const auto& actualBuffer = *actual.term->_mainBuffer;
+        const auto cursor = expectedBuffer.GetCursor().GetPosition();
+        VERIFY_ARE_EQUAL(cursor, actualBuffer.GetCursor().GetPosition());
+        VERIFY_ARE_EQUAL(expected.term->GetViewport(), actual.term->GetViewport());
+
+        for (til::CoordType y = 0; y <= cursor.y; ++y)
+        {
+            const auto& expectedRow = expectedBuffer.GetRowByOffset(y);
+            const auto& actualRow = actualBuffer.GetRowByOffset(y);
+            VERIFY_ARE_EQUAL(String(std::wstring{ expectedRow.GetText() }.c_str()), String(std::wstring{ actualRow.GetText() }.c_str()));
+            VERIFY_ARE_EQUAL(expectedRow.WasWrapForced(), actualRow.WasWrapForced());
+
+            // The VT text doesn't describe the attributes of the whitespace past the end of the text.
+            const auto right = expectedRow.MeasureRight();
+            VERIFY_ARE_EQUAL(right, actualRow.MeasureRight());
+            for (til::CoordType x = 0; x < right; ++x)
+            {
+                VERIFY_ARE_EQUAL(expectedRow.GetAttrByColumn(x), actualRow.GetAttrByColumn(x));
+            }
+        }
+    }
+}
+
+// Restoring more rows than the buffer holds must cycle it, keep the cursor and the viewport
+// at its bottom and restore the marks and wrap flags of the rows that remain.
+void TerminalBufferTests::TestRestoreMainBufferScrollsAndKeepsMarks()
+{
+    auto& termTb = *term->_mainBuffer;
+    auto& termSm = *term->_stateMachine;
+    for (auto i = 0; i < 200; ++i)
+    {
+        termSm.ProcessString(fmt::format(FMT_COMPILE(L"line {}\r\n"), i));
+    }
+
+    static constexpr til::CoordType markedRows[]{ 10, 100, 120, 125 };
+    for (const auto y : markedRows)
+    {
+        termTb.SetScrollbarData(ScrollbarData{ MarkCategory::Prompt }, y);
+    }
+    termTb.GetMutableRowByOffset(110).SetWrapForced(true);
+
+    const auto snapshot = _SerializeToBytes([&](const wchar_t* path) { term->SerializeMainBuffer(path); });
+    const auto rowCount = termTb.GetLastNonSpaceCharacter(nullptr).y + 1;
+
+    // A smaller history than the source terminal has, so that the restored rows don't fit.
+    static constexpr til::CoordType historyLength = 20;
+    auto restored = _CreateTerminal(TerminalViewWidth, historyLength);
+    VERIFY_IS_TRUE(restored.term->RestoreMainBuffer(snapshot));
+
+    const auto& buffer = *restored.term->_mainBuffer;
+    const auto bufferHeight = TerminalViewHeight + historyLength;
+    const auto cursor = buffer.GetCursor().GetPosition();
+    VERIFY_ARE_EQUAL(til::point(0, bufferHeight - 1), cursor);
+    VERIFY_ARE_EQUAL(bufferHeight - 1, restored.term->GetViewport().BottomInclusive());
+
+    // Row y of the restored buffer holds row y + offset of the snapshot.
+    const auto offset = rowCount - cursor.y;
+    VERIFY_IS_GREATER_THAN(offset, 0);
+    for (til::CoordType y = 0; y < cursor.y; ++y)
+    {
+        const auto& expected = termTb.GetRowByOffset(y + offset);
+        const auto& actual = buffer.GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(String(std::wstring{ expected.GetText() }.c_str()), String(std::wstring{ actual.GetText() }.c_str()));
+        VERIFY_ARE_EQUAL(expected.WasWrapForced(), actual.WasWrapForced());
+        VERIFY_ARE_EQUAL(expected.GetScrollbarData().has_value(), actual.GetScrollbarData().has_value());
+    }
+
+    std::vector<til::CoordType> expectedMarks;
+    for (const auto y : markedRows)
+    {
+        if (y >= offset)
+        {
+            expectedMarks.emplace_back(y - offset);
+        }
+    }
+    const auto marks = buffer.GetMarkRows();
+    VERIFY_ARE_EQUAL(expectedMarks.size(), marks.size());
+    for (size_t i = 0; i < std::min(expectedMarks.size(), marks.size()); ++i)
+    {
+        VERIFY_ARE_EQUAL(til::at(expectedMarks, i), til::at(marks, i).row);
+    }
+}
+
+// Sessions persisted by older versions contain VT text. RestoreMainBuffer() must reject them without touching
+// the buffer, so that ControlCore::RestoreFromPath() can fall back to replaying them through the VT parser.
+void TerminalBufferTests::TestRestoreMainBufferRejectsLegacyFormat()
+{
+    term->_stateMachine->ProcessString(L"\x1b[31mHello\x1b[m World\r\n");
+    const auto legacy = _SerializeToBytes([&](const wchar_t* path) { term->_mainBuffer->SerializeToPath(path); });
+
+    auto restored = _CreateTerminal(TerminalViewWidth, TerminalHistoryLength);
+    VERIFY_IS_FALSE(restored.term->RestoreMainBuffer(legacy));
+    VERIFY_ARE_EQUAL(til::point(0, 0), restored.term->_mainBuffer->GetCursor().GetPosition());
+    VERIFY_IS_FALSE(restored.term->_mainBuffer->GetRowByOffset(0).ContainsText());
+}
@@ -439,6 +439,11 @@ try
         WriteCharsVT(screenInfo, str);
     }
 
+    if (const auto renderer = ServiceLocator::LocateGlobals().pRender)
+    {
+        renderer->NotifyOutput(*pcbBuffer);
+    }
+
     return STATUS_SUCCESS;
 }
 NT_CATCH_RETURN()
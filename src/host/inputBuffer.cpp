@@ -455,6 +455,12 @@ try
     if (!Peek)
     {
         _storage.erase(_storage.begin(), it);
+
+        // Whatever the application writes from now on is presumably its reaction to this input.
+        if (const auto renderer = ServiceLocator::LocateGlobals().pRender; renderer && !OutEvents.empty())
+        {
+            renderer->NotifyInputConsumed();
+        }
     }
 
     Cache(Unicode, OutEvents, AmountToRead);
@@ -912,6 +912,7 @@ void COOKED_READ_DATA::_redisplay()
     til::point cursorPositionFinal;
     til::point pagerPromptEnd;
     std::vector<Line> lines;
+    size_t reuse = 0;
 
     // FYI: This loop does not loop. It exists because goto is considered evil
     // and if MSVC says that then that must be true.
@@ -919,14 +920,40 @@ void COOKED_READ_DATA::_redisplay()
     {
         cursorPositionFinal = { originInViewport.x, 0 };
 
+        // The rows in front of the one containing the first change (or the cursor) are still laid out
+        // the same way as before, as long as the width and starting column didn't change either.
+        // We lay out the row containing the change again, as well as the one before it if the change
+        // is right at the start of a row, since the change may extend the grapheme cluster at its end.
+        LayoutRow start{ 0, originInViewport.x };
+        reuse = 0;
+        if (_layoutWidth == size.width && _layoutColumnBegin == originInViewport.x)
+        {
+            const auto limit = std::min(_bufferDirtyBeg, _bufferCursor);
+            const auto it = std::lower_bound(_layoutRows.begin(), _layoutRows.end(), limit, [](const LayoutRow& row, size_t offset) {
+                return row.offset < offset;
+            });
+            if (it != _layoutRows.begin())
+            {
+                reuse = gsl::narrow_cast<size_t>(it - _layoutRows.begin()) - 1;
+                start = til::at(_layoutRows, reuse);
+            }
+        }
+        _layoutRows.resize(reuse);
+        _layoutRows.emplace_back(start);
+        _layoutWidth = size.width;
+        _layoutColumnBegin = originInViewport.x;
+
+        // Reused rows are full and unchanged. We only lay out their text if they need to be drawn (see layoutReusedLine).
+        lines.resize(reuse, Line{ {}, 0, size.width, size.width });
+
         // Construct the first line manually so that it starts at the correct horizontal position.
-        LayoutResult res{ .column = cursorPositionFinal.x };
-        lines.emplace_back(std::wstring{}, 0, cursorPositionFinal.x, cursorPositionFinal.x);
+        LayoutResult res{ .column = start.column };
+        lines.emplace_back(std::wstring{}, 0, start.column, start.column);
 
         // Split the buffer into 3 segments, so that we can find the row/column coordinates of
         // the cursor within the buffer, as well as the start of the dirty parts of the buffer.
         const size_t offsets[]{
-            0,
+            start.offset,
             std::min(_bufferDirtyBeg, _bufferCursor),
             std::max(_bufferDirtyBeg, _bufferCursor),
             npos,
@@ -948,6 +975,7 @@ void COOKED_READ_DATA::_redisplay()
                 if (res.column >= size.width)
                 {
                     lines.emplace_back();
+                    _layoutRows.emplace_back(offsets[i] + beg, 0);
                 }
 
                 auto& line = lines.back();
@@ -1110,6 +1138,24 @@ void COOKED_READ_DATA::_redisplay()
     // dirtyBegPosition however could be outside of it.
     cursorPositionFinal.y += originInViewportFinal.y - pagerContentTop;
 
+    // Lays out the text of a reused line, so that it can be drawn.
+    const auto layoutReusedLine = [&](const til::CoordType i) {
+        const auto index = gsl::narrow_cast<size_t>(i);
+        if (index >= reuse)
+        {
+            return;
+        }
+
+        auto& line = lines.at(index);
+        const auto& row = til::at(_layoutRows, index);
+        const auto end = til::at(_layoutRows, index + 1).offset;
+        line.text.clear();
+        const auto res = _layoutLine(line.text, _slice(0, end), row.offset, row.column, size.width);
+        line.dirtyBegOffset = line.text.size();
+        line.dirtyBegColumn = res.column;
+        line.columns = res.column;
+    };
+
     std::wstring output;
 
     if (_clearPending)
@@ -1173,6 +1219,7 @@ void COOKED_READ_DATA::_redisplay()
         // Mark each row that has been uncovered by the scroll as dirty.
         for (auto i = beg; i < end; i++)
         {
+            layoutReusedLine(i + pagerContentTop);
             auto& line = lines.at(i + pagerContentTop);
             line.dirtyBegOffset = 0;
             line.dirtyBegColumn = 0;
@@ -1260,6 +1307,12 @@ void COOKED_READ_DATA::_redisplay()
     _appendCUP(output, cursorPositionFinal);
     WriteCharsVT(_screenInfo, output);
 
+    // This is the echo of the input we read, just like the output of applications that echo their input themselves.
+    if (const auto renderer = ServiceLocator::LocateGlobals().pRender)
+    {
+        renderer->NotifyOutput(output.size() * sizeof(wchar_t));
+    }
+
     _originInViewport = originInViewportFinal;
     _pagerPromptEnd = pagerPromptEnd;
     _pagerContentTop = pagerContentTop;
@@ -112,6 +112,14 @@ private:
         til::CoordType column = 0;
     };
 
+    struct LayoutRow
+    {
+        // The offset into _buffer at which the row starts.
+        size_t offset = 0;
+        // The column at which the row starts. Only the first row may start at a column other than 0.
+        til::CoordType column = 0;
+    };
+
     struct Line
     {
         std::wstring text;
@@ -167,6 +175,13 @@ private:
     bool _redrawPending = false;
     bool _clearPending = false;
 
+    // The rows of the last layout of _buffer, for the given width and starting column.
+    // This allows _redisplay() to only lay out the rows starting at the first change,
+    // which would otherwise make pasting large amounts of text quadratic.
+    std::vector<LayoutRow> _layoutRows;
+    til::CoordType _layoutWidth = 0;
+    til::CoordType _layoutColumnBegin = 0;
+
     std::optional<til::point> _originInViewport;
     // This value is in the pager coordinate space. (0,0) is the first character of the
     // first line, independent on where the prompt actually appears on the screen.
@@ -853,6 +853,7 @@ PWSTR TranslateConsoleTitle(_In_ PCWSTR pwszConsoleTitle, const BOOL fUnexpand,
             g.pRender = new Renderer(gci.GetRenderSettings(), &gci.renderData, nullptr, 0, std::move(renderThread));
 
             THROW_IF_FAILED(localPointerToThread->Initialize(g.pRender));
+            g.pRender->SetFrameTimingCallback(Tracing::s_TraceRenderFrame);
 
             // Set up the renderer to be used to calculate the width of a glyph,
             //      should we be unable to figure out its width another way.
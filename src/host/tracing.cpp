@@ -5,6 +5,7 @@
 #include "tracing.hpp"
 #include "../types/UiaTextRangeBase.hpp"
 #include "../types/ScreenInfoUiaProviderBase.h"
+#include "../renderer/base/thread.hpp"
 
 TRACELOGGING_DEFINE_PROVIDER(g_hConhostV2EventTraceProvider,
                              "Microsoft.Windows.Console.Host",
@@ -28,7 +29,8 @@ enum TraceKeywords
     UIA = 0x800,
     CookedRead = 0x1000,
     ConsoleAttachDetach = 0x2000,
-    All = 0x1FFF
+    Render = 0x4000,
+    All = 0x7FFF
 };
 DEFINE_ENUM_FLAG_OPERATORS(TraceKeywords);
 
@@ -211,6 +213,24 @@ void Tracing::s_TraceConsoleAttachDetach(_In_ ConsoleProcessHandle* const pConso
     }
 }
 
+void Tracing::s_TraceRenderFrame(const Microsoft::Console::Render::FrameTiming& timing)
+{
+    if (TraceLoggingProviderEnabled(g_hConhostV2EventTraceProvider, 0, TraceKeywords::Render))
+    {
+        TraceLoggingWrite(
+            g_hConhostV2EventTraceProvider,
+            "RenderFrame",
+            TraceLoggingInt64(timing.paced.count(), "PacedUs"),
+            TraceLoggingInt64(timing.paint.count(), "PaintUs"),
+            TraceLoggingInt64(timing.inputLatency.count(), "InputLatencyUs"),
+            TraceLoggingUInt64(timing.ingestedBytes, "IngestedBytes"),
+            TraceLoggingUInt64(timing.paintedRows, "PaintedRows"),
+            TraceLoggingUInt64(timing.skippedRows, "SkippedRows"),
+            TraceLoggingKeyword(TIL_KEYWORD_TRACE),
+            TraceLoggingKeyword(TraceKeywords::Render));
+    }
+}
+
 void __stdcall Tracing::TraceFailure(const wil::FailureInfo& failure) noexcept
 {
     TraceLoggingWrite(
@@ -19,6 +19,11 @@ Author(s):
 
 #include "../types/inc/Viewport.hpp"
 
+namespace Microsoft::Console::Render
+{
+    struct FrameTiming;
+}
+
 #define TraceLoggingConsoleCoord(value, name)        \
     TraceLoggingPackedData(&value, sizeof(COORD)),   \
         TraceLoggingPackedStruct(2, name),           \
@@ -54,6 +59,7 @@ public:
 
     static void s_TraceCookedRead(_In_ ConsoleProcessHandle* const pConsoleProcessHandle, const std::wstring_view& text);
     static void s_TraceConsoleAttachDetach(_In_ ConsoleProcessHandle* const pConsoleProcessHandle, _In_ bool bIsAttach);
+    static void s_TraceRenderFrame(const Microsoft::Console::Render::FrameTiming& timing);
 
     static void __stdcall TraceFailure(const wil::FailureInfo& failure) noexcept;
 
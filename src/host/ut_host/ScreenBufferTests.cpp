@@ -263,6 +263,9 @@ class ScreenBufferTests
 
     TEST_METHOD(EraseColorMode);
 
+    TEST_METHOD(SixelBandRendering);
+    TEST_METHOD(SixelCopiesSharePixels);
+
     TEST_METHOD(SimpleMarkCommand);
     TEST_METHOD(SimpleWrappedCommand);
     TEST_METHOD(SimplePromptRegions);
@@ -8308,6 +8311,85 @@ void ScreenBufferTests::EraseColorMode()
     VERIFY_ARE_EQUAL(L" ", cellData->Chars());
 }
 
+void ScreenBufferTests::SixelBandRendering()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    auto& stateMachine = si.GetStateMachine();
+    auto& textBuffer = si.GetTextBuffer();
+    WI_SetFlag(si.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+    const auto top = si.GetViewport().Top();
+    textBuffer.GetCursor().SetPosition({ 0, top });
+
+    // With a 2:1 aspect ratio, each band covers 12 device pixels. The first
+    // band is filled with red for 20 columns and then overprinted with blue
+    // in the bottom sixel row of the first 10 columns. The second band only
+    // has the top sixel row set, in red, for 12 columns.
+    Log::Comment(L"Output a transparent sixel image with two bands");
+    stateMachine.ProcessString(L"\033P0;1q\"2;1#1;2;100;0;0#2;2;0;0;100#1!20~$#2!10_-#1!12@\033\\");
+
+    const auto slice = textBuffer.GetRowByOffset(top).GetImageSlice();
+    VERIFY_IS_NOT_NULL(slice);
+    const auto pixelAt = [&](const til::CoordType x, const til::CoordType y) {
+        const auto& pixel = til::at(slice->Pixels(), y * slice->PixelWidth() + x);
+        return pixel.rgbReserved ? RGB(pixel.rgbRed, pixel.rgbGreen, pixel.rgbBlue) : INVALID_COLOR;
+    };
+    const auto red = RGB(255, 0, 0);
+    const auto blue = RGB(0, 0, 255);
+
+    Log::Comment(L"The first band is red, apart from the overprinted blue");
+    VERIFY_ARE_EQUAL(red, pixelAt(0, 0));
+    VERIFY_ARE_EQUAL(red, pixelAt(19, 9));
+    VERIFY_ARE_EQUAL(blue, pixelAt(0, 10));
+    VERIFY_ARE_EQUAL(blue, pixelAt(9, 11));
+    VERIFY_ARE_EQUAL(red, pixelAt(10, 10));
+    VERIFY_ARE_EQUAL(red, pixelAt(19, 11));
+
+    Log::Comment(L"The top sixel row of the second band is repeated for the aspect ratio");
+    VERIFY_ARE_EQUAL(red, pixelAt(0, 12));
+    VERIFY_ARE_EQUAL(red, pixelAt(11, 13));
+    VERIFY_ARE_EQUAL(INVALID_COLOR, pixelAt(12, 12));
+    VERIFY_ARE_EQUAL(INVALID_COLOR, pixelAt(0, 14));
+    VERIFY_ARE_EQUAL(INVALID_COLOR, pixelAt(11, 19));
+}
+
+void ScreenBufferTests::SixelCopiesSharePixels()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    auto& stateMachine = si.GetStateMachine();
+    auto& textBuffer = si.GetTextBuffer();
+    WI_SetFlag(si.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+    const auto top = si.GetViewport().Top();
+    textBuffer.GetCursor().SetPosition({ 0, top });
+
+    Log::Comment(L"Output a red sixel image in the first row");
+    stateMachine.ProcessString(L"\033Pq#1;2;100;0;0#1!20~\033\\");
+
+    Log::Comment(L"Copy the first row to the third row with DECCRA");
+    stateMachine.ProcessString(L"\033[1;1;1;999;1;3;1;1$v");
+
+    const auto srcSlice = textBuffer.GetRowByOffset(top).GetImageSlice();
+    const auto dstSlice = textBuffer.GetRowByOffset(top + 2).GetImageSlice();
+    VERIFY_IS_NOT_NULL(srcSlice);
+    VERIFY_IS_NOT_NULL(dstSlice);
+
+    Log::Comment(L"The copy should share the pixels of the source");
+    VERIFY_ARE_EQUAL(srcSlice->Revision(), dstSlice->Revision());
+    VERIFY_ARE_EQUAL(srcSlice->Pixels().data(), dstSlice->Pixels().data());
+
+    Log::Comment(L"Erasing the copy should leave the source untouched");
+    const auto srcRevision = srcSlice->Revision();
+    stateMachine.ProcessString(L"\033[3;1H\033[X");
+    VERIFY_ARE_EQUAL(srcRevision, srcSlice->Revision());
+    const auto& srcPixel = til::at(srcSlice->Pixels(), 0);
+    VERIFY_ARE_EQUAL(RGB(255, 0, 0), RGB(srcPixel.rgbRed, srcPixel.rgbGreen, srcPixel.rgbBlue));
+    const auto erasedSlice = textBuffer.GetRowByOffset(top + 2).GetImageSlice();
+    VERIFY_IS_TRUE(!erasedSlice || erasedSlice->Pixels().data() != srcSlice->Pixels().data());
+}
+
 #define FTCS_A L"\x1b]133;A\x1b\\"
 #define FTCS_B L"\x1b]133;B\x1b\\"
 #define FTCS_C L"\x1b]133;C\x1b\\"
@@ -131,6 +131,11 @@ class TextBufferTests
 
     TEST_METHOD(ResizeTraditionalRotationPreservesHighUnicode);
     TEST_METHOD(ScrollBufferRotationPreservesHighUnicode);
+    TEST_METHOD(ScrollRowsWithinRegion);
+    TEST_METHOD(CompactScrollbackRoundTrip);
+    TEST_METHOD(CompactAttributesAreBounded);
+    TEST_METHOD(ClearScrollbackReleasesMemory);
+    TEST_METHOD(SnapshotRoundTrip);
 
     TEST_METHOD(ResizeTraditionalHighUnicodeRowRemoval);
     TEST_METHOD(ResizeTraditionalHighUnicodeColumnRemoval);
@@ -151,6 +156,8 @@ class TextBufferTests
 
     TEST_METHOD(HyperlinkTrim);
     TEST_METHOD(NoHyperlinkTrim);
+    TEST_METHOD(HyperlinkTrimAfterOverwrite);
+    TEST_METHOD(MarkRowsFollowRows);
 
     TEST_METHOD(ReflowPromptRegions);
 };
@@ -1704,6 +1711,351 @@ void TextBufferTests::ScrollBufferRotationPreservesHighUnicode()
     VERIFY_ARE_EQUAL(String(fire), String(shouldBeFireText.data(), gsl::narrow<int>(shouldBeFireText.size())));
 }
 
+// This tests that rows which scroll far enough above the cursor are moved into the compact tier
+// and that they're restored with their text, attributes and metadata intact once accessed again.
+void TextBufferTests::CompactScrollbackRoundTrip()
+{
+    const til::size bufferSize{ 80, 300 };
+    auto buffer = std::make_unique<TextBuffer>(bufferSize, TextAttribute{ 0x7f }, 12, false, &_renderer);
+    buffer->SetCompactDistance(10);
+    buffer->GetCursor().SetPosition({ 0, bufferSize.height - 1 });
+
+    // Each line mixes ASCII, a run long enough to be run-length encoded, a wide glyph and a surrogate pair.
+    const auto makeLine = [](int i) {
+        return fmt::format(L"line {} {} \x732B \xD83D\xDD25", i, std::wstring(i % 20 + 4, L'-'));
+    };
+
+    // Fill the buffer twice, so that the rows wrap around the circular buffer once.
+    const auto lineCount = bufferSize.height * 2;
+    for (auto i = 0; i < lineCount; ++i)
+    {
+        const auto line = makeLine(i);
+        auto& row = buffer->GetMutableRowByOffset(bufferSize.height - 1);
+        RowWriteState state{ .text = line };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(0, 4, TextAttribute{ gsl::narrow_cast<WORD>(i % 16) });
+        row.SetWrapForced(i % 2 != 0);
+        buffer->IncrementCircularBuffer();
+    }
+
+    const auto compacted = buffer->GetMemoryStatistics();
+    VERIFY_IS_GREATER_THAN(compacted.compactRows, 0u);
+    VERIFY_IS_LESS_THAN(compacted.compactBytes / compacted.compactRows, compacted.hotBytes / compacted.hotRows);
+
+    // The last row is the one that IncrementCircularBuffer() recycled last. Every row above it holds line i.
+    for (auto y = 0; y < bufferSize.height - 1; ++y)
+    {
+        const auto i = lineCount - bufferSize.height + 1 + y;
+        const auto expected = makeLine(i);
+        const auto& row = buffer->GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(std::wstring{ row.GetText() }.substr(0, expected.size()).c_str()));
+        VERIFY_ARE_EQUAL(TextAttribute{ gsl::narrow_cast<WORD>(i % 16) }, row.GetAttrByColumn(0));
+        VERIFY_ARE_EQUAL(TextAttribute{ 0x7f }, row.GetAttrByColumn(4));
+        VERIFY_ARE_EQUAL(i % 2 != 0, row.WasWrapForced());
+    }
+
+    // Reading every row expanded every chunk...
+    const auto expanded = buffer->GetMemoryStatistics();
+    VERIFY_ARE_EQUAL(0u, expanded.compactRows);
+    VERIFY_IS_GREATER_THAN(expanded.committedBytes, compacted.committedBytes);
+
+    // ...but IncrementCircularBuffer() compacts them again, one chunk of 64 rows per call.
+    // By the time it visited all of them, the memory must have been recovered. At most one chunk may have
+    // become ineligible in the meantime, because the circular buffer's wrap-around point moved into it.
+    for (auto i = 0; i < bufferSize.height / 64 + 1; ++i)
+    {
+        buffer->IncrementCircularBuffer();
+    }
+
+    const auto recompacted = buffer->GetMemoryStatistics();
+    VERIFY_IS_GREATER_THAN_OR_EQUAL(recompacted.compactRows + 64, compacted.compactRows);
+    VERIFY_IS_LESS_THAN(recompacted.committedBytes, expanded.committedBytes);
+}
+
+// The compact tier interns the attributes of its rows. The table may only hold the attributes of the rows that are
+// compact right now, or output that never repeats a color (like a 24-bit gradient) would grow it indefinitely.
+void TextBufferTests::CompactAttributesAreBounded()
+{
+    const til::size bufferSize{ 80, 300 };
+    auto buffer = std::make_unique<TextBuffer>(bufferSize, TextAttribute{ 0x7f }, 12, false, &_renderer);
+    buffer->SetCompactDistance(10);
+    buffer->GetCursor().SetPosition({ 0, bufferSize.height - 1 });
+
+    // Every line has 3 colors that no other line uses.
+    const auto makeAttr = [](int i, int run) {
+        return TextAttribute{ gsl::narrow_cast<COLORREF>(i * 3 + run), gsl::narrow_cast<COLORREF>(0x808080) };
+    };
+    const auto writeLines = [&](int beg, int end) {
+        for (auto i = beg; i < end; ++i)
+        {
+            auto& row = buffer->GetMutableRowByOffset(bufferSize.height - 1);
+            RowWriteState state{ .text = L"red green blue" };
+            row.ReplaceText(state);
+            row.ReplaceAttributes(0, 4, makeAttr(i, 0));
+            row.ReplaceAttributes(4, 10, makeAttr(i, 1));
+            row.ReplaceAttributes(10, 14, makeAttr(i, 2));
+            buffer->IncrementCircularBuffer();
+        }
+    };
+
+    // Fill the buffer a few times, until the compact tier is as large as it gets...
+    const auto warmup = bufferSize.height * 3;
+    writeLines(0, warmup);
+    const auto before = buffer->GetMemoryStatistics();
+    VERIFY_IS_GREATER_THAN(before.compactRows, 0u);
+
+    // ...after which it must not grow anymore, no matter how many new attributes scroll through it.
+    const auto lineCount = bufferSize.height * 30;
+    writeLines(warmup, lineCount);
+    const auto after = buffer->GetMemoryStatistics();
+    Log::Comment(NoThrowString().Format(L"%zu compact rows use %zu bytes, %zu bytes after %d more lines", before.compactRows, before.compactBytes, after.compactBytes, lineCount - warmup));
+    VERIFY_IS_LESS_THAN_OR_EQUAL(after.compactRows, before.compactRows + 64);
+    VERIFY_IS_LESS_THAN_OR_EQUAL(after.compactBytes, before.compactBytes * 3 / 2);
+
+    // The reused IDs must resolve to the attributes of the rows that now own them.
+    for (auto y = 0; y < bufferSize.height - 1; ++y)
+    {
+        const auto i = lineCount - bufferSize.height + 1 + y;
+        const auto& row = buffer->GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(makeAttr(i, 0), row.GetAttrByColumn(0));
+        VERIFY_ARE_EQUAL(makeAttr(i, 1), row.GetAttrByColumn(4));
+        VERIFY_ARE_EQUAL(makeAttr(i, 2), row.GetAttrByColumn(10));
+    }
+}
+
+// ClearScrollback() should return the memory of the rows it clears to the OS. The rows it keeps must survive, even if
+// the circular buffer wrapped around, ScrollRows() left them out of order and parts of the scrollback are compact.
+void TextBufferTests::ClearScrollbackReleasesMemory()
+{
+    const til::size bufferSize{ 120, 2000 };
+    const auto viewportHeight = 30;
+    auto buffer = std::make_unique<TextBuffer>(bufferSize, TextAttribute{ 0x7f }, 12, false, &_renderer);
+    buffer->SetCompactDistance(100);
+    buffer->GetCursor().SetPosition({ 0, bufferSize.height - 1 });
+
+    for (auto i = 0; i < bufferSize.height * 3 / 2; ++i)
+    {
+        const auto line = fmt::format(L"line {}", i);
+        auto& row = buffer->GetMutableRowByOffset(bufferSize.height - 1);
+        RowWriteState state{ .text = line };
+        row.ReplaceText(state);
+        buffer->IncrementCircularBuffer();
+    }
+
+    // Like a linefeed at the bottom of a scroll region within the viewport.
+    const auto viewportTop = bufferSize.height - viewportHeight;
+    buffer->ScrollRows(viewportTop + 5, viewportHeight - 10, -1);
+
+    // One mark outside of the scrolled region and one inside of it, whose ROW is out of order.
+    static constexpr til::CoordType markedRows[]{ 2, 10 };
+    for (const auto y : markedRows)
+    {
+        buffer->SetScrollbarData(ScrollbarData{ MarkCategory::Prompt }, viewportTop + y);
+    }
+
+    std::vector<std::wstring> expected;
+    for (auto y = viewportTop; y < bufferSize.height; ++y)
+    {
+        expected.emplace_back(buffer->GetRowByOffset(y).GetText());
+    }
+
+    const auto before = buffer->GetMemoryStatistics();
+    VERIFY_IS_GREATER_THAN(before.compactRows, 0u);
+
+    buffer->ClearScrollback(viewportTop, viewportHeight);
+
+    const auto after = buffer->GetMemoryStatistics();
+    VERIFY_ARE_EQUAL(0u, after.compactRows);
+    VERIFY_IS_LESS_THAN(after.committedBytes, before.committedBytes / 4);
+
+    for (auto y = 0; y < viewportHeight; ++y)
+    {
+        VERIFY_ARE_EQUAL(String(expected[y].c_str()), String(std::wstring{ buffer->GetRowByOffset(y).GetText() }.c_str()));
+    }
+
+    // The marks move along with the contents of their rows.
+    const auto marks = buffer->GetMarkRows();
+    VERIFY_ARE_EQUAL(std::size(markedRows), marks.size());
+    for (size_t i = 0; i < std::min(std::size(markedRows), marks.size()); ++i)
+    {
+        VERIFY_ARE_EQUAL(til::at(markedRows, i), til::at(marks, i).row);
+        VERIFY_IS_TRUE(buffer->GetRowByOffset(til::at(markedRows, i)).GetScrollbarData().has_value());
+    }
+
+    // The cleared rows are constructed again on demand and are blank.
+    VERIFY_IS_FALSE(buffer->GetRowByOffset(viewportHeight).ContainsText());
+    VERIFY_IS_FALSE(buffer->GetRowByOffset(bufferSize.height - 1).ContainsText());
+}
+
+// ScrollRows() rotates overlapping ranges of rows instead of copying them. This tests that the result is still
+// the same as copying every row, including the rows that got scrolled out, across the circular buffer's wrap-around.
+// Attributes and marks must be copied just like the text.
+void TextBufferTests::ScrollRowsWithinRegion()
+{
+    const til::size bufferSize{ 20, 12 };
+    auto buffer = std::make_unique<TextBuffer>(bufferSize, TextAttribute{ 0x7f }, 12, false, &_renderer);
+
+    struct Line
+    {
+        std::wstring text;
+        TextAttribute attr;
+        bool marked = false;
+    };
+    std::vector<Line> expected;
+    for (auto y = 0; y < bufferSize.height; ++y)
+    {
+        expected.push_back({ fmt::format(L"row {}", y), TextAttribute{ gsl::narrow_cast<WORD>(y) }, y % 3 == 0 });
+    }
+
+    // Offset the circular buffer so that the rotations wrap around its end.
+    for (auto i = 0; i < 7; ++i)
+    {
+        buffer->IncrementCircularBuffer();
+    }
+    for (auto y = 0; y < bufferSize.height; ++y)
+    {
+        auto& row = buffer->GetMutableRowByOffset(y);
+        RowWriteState state{ .text = expected[y].text };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(0, 3, expected[y].attr);
+        if (expected[y].marked)
+        {
+            buffer->SetScrollbarData(ScrollbarData{ MarkCategory::Prompt }, y);
+        }
+    }
+
+    struct Scroll
+    {
+        til::CoordType firstRow;
+        til::CoordType size;
+        til::CoordType delta;
+    };
+    static constexpr Scroll scrolls[]{
+        { 3, 8, -1 }, // Like a linefeed at the bottom of a scroll region.
+        { 2, 8, 1 }, // Like a reverse index at its top.
+        { 4, 6, -3 },
+        { 0, 9, 3 },
+        { 5, 7, -5 },
+        { 0, 3, 6 }, // Source and destination don't overlap.
+    };
+
+    for (const auto& scroll : scrolls)
+    {
+        buffer->ScrollRows(scroll.firstRow, scroll.size, scroll.delta);
+
+        // The reference implementation: Copy one row after the other, in the order that doesn't overwrite the source.
+        const auto source = expected;
+        for (auto y = scroll.firstRow; y < scroll.firstRow + scroll.size; ++y)
+        {
+            expected[y + scroll.delta] = source[y];
+        }
+
+        std::vector<til::CoordType> expectedMarks;
+        for (auto y = 0; y < bufferSize.height; ++y)
+        {
+            const auto& row = buffer->GetRowByOffset(y);
+            const auto text = std::wstring{ row.GetText() };
+            VERIFY_ARE_EQUAL(String(expected[y].text.c_str()), String(text.substr(0, text.find_last_not_of(L' ') + 1).c_str()));
+            VERIFY_ARE_EQUAL(expected[y].attr, row.GetAttrByColumn(0));
+            VERIFY_ARE_EQUAL(TextAttribute{ 0x7f }, row.GetAttrByColumn(3));
+            VERIFY_ARE_EQUAL(expected[y].marked, row.GetScrollbarData().has_value());
+            if (expected[y].marked)
+            {
+                expectedMarks.emplace_back(y);
+            }
+        }
+
+        const auto marks = buffer->GetMarkRows();
+        VERIFY_ARE_EQUAL(expectedMarks.size(), marks.size());
+        for (size_t i = 0; i < std::min(expectedMarks.size(), marks.size()); ++i)
+        {
+            VERIFY_ARE_EQUAL(til::at(expectedMarks, i), til::at(marks, i).row);
+        }
+    }
+}
+
+void TextBufferTests::SnapshotRoundTrip()
+{
+    const til::size bufferSize{ 80, 20 };
+    auto buffer = std::make_unique<TextBuffer>(bufferSize, TextAttribute{ 0x7f }, 12, false, &_renderer);
+
+    const auto uri = L"https://example.com";
+    const auto id = buffer->GetHyperlinkId(uri, L"custom");
+    buffer->AddHyperlinkToMap(uri, id);
+    auto linkAttr = TextAttribute{ 0x1e };
+    linkAttr.SetHyperlinkId(id);
+
+    // Each line mixes ASCII, a run long enough to be run-length encoded, a wide glyph and a surrogate pair.
+    const auto makeLine = [](int i) {
+        return fmt::format(L"line {} {} \x732B \xD83D\xDD25", i, std::wstring(i + 4, L'-'));
+    };
+
+    const auto lineCount = 10;
+    for (auto i = 0; i < lineCount; ++i)
+    {
+        const auto line = makeLine(i);
+        auto& row = buffer->GetMutableRowByOffset(i);
+        RowWriteState state{ .text = line };
+        row.ReplaceText(state);
+        row.ReplaceAttributes(0, 4, i % 3 ? TextAttribute{ gsl::narrow_cast<WORD>(i) } : linkAttr);
+        row.SetWrapForced(i % 2 != 0);
+        row.SetLineRendition(i == 5 ? LineRendition::DoubleWidth : LineRendition::SingleWidth);
+    }
+    buffer->SetScrollbarData(ScrollbarData{ .category = MarkCategory::Prompt, .color = til::color{ 0x11, 0x22, 0x33 }, .exitCode = 1u }, 3);
+
+    wchar_t tempPath[MAX_PATH];
+    wchar_t path[MAX_PATH];
+    VERIFY_ARE_NOT_EQUAL(0u, GetTempPathW(MAX_PATH, &tempPath[0]));
+    VERIFY_ARE_NOT_EQUAL(0u, GetTempFileNameW(&tempPath[0], L"tb", 0, &path[0]));
+    const auto cleanup = wil::scope_exit([&]() { DeleteFileW(&path[0]); });
+
+    buffer->SerializeSnapshotToPath(&path[0]);
+
+    std::vector<std::byte> snapshot;
+    {
+        const wil::unique_handle file{ CreateFileW(&path[0], GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        VERIFY_IS_TRUE(file.is_valid());
+        LARGE_INTEGER fileSize;
+        VERIFY_WIN32_BOOL_SUCCEEDED(GetFileSizeEx(file.get(), &fileSize));
+        snapshot.resize(gsl::narrow<size_t>(fileSize.QuadPart));
+        DWORD read = 0;
+        VERIFY_WIN32_BOOL_SUCCEEDED(ReadFile(file.get(), snapshot.data(), gsl::narrow<DWORD>(snapshot.size()), &read, nullptr));
+        VERIFY_ARE_EQUAL(snapshot.size(), size_t{ read });
+    }
+
+    const auto restored = TextBuffer::DeserializeSnapshot(snapshot);
+    VERIFY_IS_NOT_NULL(restored.get());
+    VERIFY_ARE_EQUAL(bufferSize.width, restored->GetSize().Width());
+    VERIFY_ARE_EQUAL(til::point(0, lineCount), restored->GetCursor().GetPosition());
+    VERIFY_ARE_EQUAL(String(uri), String(restored->GetHyperlinkUriFromId(id).c_str()));
+    VERIFY_ARE_EQUAL(id, restored->GetHyperlinkId(uri, L"custom"));
+
+    for (auto i = 0; i < lineCount; ++i)
+    {
+        const auto& expected = buffer->GetRowByOffset(i);
+        const auto& actual = restored->GetRowByOffset(i);
+        VERIFY_ARE_EQUAL(String(std::wstring{ expected.GetText() }.c_str()), String(std::wstring{ actual.GetText() }.c_str()));
+        VERIFY_IS_TRUE(expected.Attributes() == actual.Attributes());
+        VERIFY_ARE_EQUAL(expected.WasWrapForced(), actual.WasWrapForced());
+        VERIFY_IS_TRUE(expected.GetLineRendition() == actual.GetLineRendition());
+        VERIFY_ARE_EQUAL(expected.GetScrollbarData().has_value(), actual.GetScrollbarData().has_value());
+        for (auto x = 0; x < bufferSize.width; ++x)
+        {
+            VERIFY_IS_TRUE(expected.DbcsAttrAt(x) == actual.DbcsAttrAt(x));
+        }
+    }
+
+    const auto& scrollbarData = restored->GetRowByOffset(3).GetScrollbarData();
+    VERIFY_IS_TRUE(scrollbarData->category == MarkCategory::Prompt);
+    VERIFY_ARE_EQUAL(til::color(0x11, 0x22, 0x33), scrollbarData->color.value());
+    VERIFY_ARE_EQUAL(1u, scrollbarData->exitCode.value());
+
+    // Truncated or corrupted snapshots must be rejected instead of producing a broken buffer.
+    VERIFY_IS_NULL(TextBuffer::DeserializeSnapshot(std::span{ snapshot }.first(snapshot.size() - 4)).get());
+    snapshot[0] = std::byte{ 0 };
+    VERIFY_IS_NULL(TextBuffer::DeserializeSnapshot(snapshot).get());
+}
+
 // This tests that rows removed from the buffer while resizing traditionally will also drop the high unicode
 // characters from the Unicode Storage buffer
 void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
@@ -2777,6 +3129,108 @@ void TextBufferTests::NoHyperlinkTrim()
     VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalCustomId], id);
 }
 
+// This tests that the hyperlink reference counts follow rows that get overwritten
+// or copied in between increments of the circular buffer
+void TextBufferTests::HyperlinkTrimAfterOverwrite()
+{
+    // Set up a text buffer for us
+    const til::size bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, false, &_renderer);
+
+    static constexpr std::wstring_view url{ L"test.url" };
+    static constexpr std::wstring_view otherUrl{ L"other.url" };
+    static constexpr std::wstring_view customId{ L"CustomId" };
+
+    // Set the same hyperlink id in the first two rows and in row 5
+    const auto id = _buffer->GetHyperlinkId(url, customId);
+    _buffer->AddHyperlinkToMap(url, id);
+    TextAttribute newAttr{ 0x7f };
+    newAttr.SetHyperlinkId(id);
+    _buffer->GetMutableRowByOffset(0).SetAttrToEnd(70, newAttr);
+    _buffer->GetMutableRowByOffset(1).SetAttrToEnd(70, newAttr);
+    _buffer->GetMutableRowByOffset(5).SetAttrToEnd(70, newAttr);
+
+    // Set a different hyperlink id in row 1, and copy row 1 to row 8
+    const auto otherId = _buffer->GetHyperlinkId(otherUrl, {});
+    _buffer->AddHyperlinkToMap(otherUrl, otherId);
+    newAttr.SetHyperlinkId(otherId);
+    _buffer->GetMutableRowByOffset(1).SetAttrToEnd(75, newAttr);
+    _buffer->CopyRow(1, 8, *_buffer);
+
+    // The first increment releases row 0, but rows 1 and 5 still refer to the first id
+    _buffer->IncrementCircularBuffer();
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
+
+    // Overwrite the hyperlinks in what used to be row 5 and the copy in row 8
+    _buffer->GetMutableRowByOffset(4).SetAttrToEnd(0, attr);
+    _buffer->GetMutableRowByOffset(7).SetAttrToEnd(0, attr);
+
+    // Now the old row 1 is the only one referring to either id, so both are deleted when it's released
+    _buffer->IncrementCircularBuffer();
+
+    const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
+    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap.find(id), _buffer->_hyperlinkMap.end());
+    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap.find(finalCustomId), _buffer->_hyperlinkCustomIdMap.end());
+    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap.find(otherId), _buffer->_hyperlinkMap.end());
+    VERIFY_IS_TRUE(_buffer->GetCustomIdFromId(id).empty());
+}
+
+// This tests that the mark index stays in sync with the ScrollbarData of the rows
+// as they get scrolled, rotated within a region, recycled and reset
+void TextBufferTests::MarkRowsFollowRows()
+{
+    const til::size bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, false, &_renderer);
+
+    const auto verifyMarks = [&](const std::vector<til::CoordType>& expected) {
+        const auto marks = _buffer->GetMarkRows();
+        VERIFY_ARE_EQUAL(expected.size(), marks.size());
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            VERIFY_ARE_EQUAL(til::at(expected, i), til::at(marks, i).row);
+        }
+
+        // The index must agree with what's actually stored in the rows.
+        size_t scanned = 0;
+        for (til::CoordType y = 0; y < bufferSize.height; y++)
+        {
+            if (_buffer->GetRowByOffset(y).GetScrollbarData().has_value())
+            {
+                VERIFY_IS_LESS_THAN(scanned, marks.size());
+                VERIFY_ARE_EQUAL(y, til::at(marks, scanned).row);
+                scanned++;
+            }
+        }
+        VERIFY_ARE_EQUAL(marks.size(), scanned);
+    };
+
+    Log::Comment(L"Mark rows 1, 4 and 7");
+    for (const auto y : { 1, 4, 7 })
+    {
+        _buffer->SetScrollbarData(ScrollbarData{ MarkCategory::Prompt }, y);
+    }
+    verifyMarks({ 1, 4, 7 });
+
+    Log::Comment(L"Scroll rows 5 to 8 up by one, which rotates the rows 4 to 8");
+    Log::Comment(L"Row 4 scrolls out and row 8 keeps its contents, neither of which is marked");
+    _buffer->ScrollRows(5, 4, -1);
+    verifyMarks({ 1, 6 });
+
+    Log::Comment(L"Recycle the first two rows of the circular buffer");
+    _buffer->IncrementCircularBuffer();
+    _buffer->IncrementCircularBuffer();
+    verifyMarks({ 4, 6 });
+
+    Log::Comment(L"Resetting a row removes its mark");
+    _buffer->GetMutableRowByOffset(4).Reset(attr);
+    verifyMarks({ 6 });
+    VERIFY_ARE_EQUAL(1u, _buffer->GetMarkExtents().size());
+}
+
 #define FTCS_A L"\x1b]133;A\x1b\\"
 #define FTCS_B L"\x1b]133;B\x1b\\"
 #define FTCS_C L"\x1b]133;C\x1b\\"
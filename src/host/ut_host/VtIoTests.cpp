@@ -259,6 +259,12 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected = "a\t\r\n\r\nb";
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
+
+        // The terminal needs to see the synchronized output mode to present the update as a whole.
+        THROW_IF_FAILED(routines.WriteConsoleWImpl(*screenInfo, L"\x1b[?2026hc\x1b[?2026l", written, waiter));
+        expected = "\x1b[?2026hc\x1b[?2026l";
+        actual = readOutput();
+        VERIFY_ARE_EQUAL(expected, actual);
     }
 
     TEST_METHOD(WriteConsoleOutputW)
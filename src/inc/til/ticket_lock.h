@@ -153,4 +153,280 @@ namespace til
     };
 
     using recursive_ticket_lock_suspension = recursive_ticket_lock::recursive_ticket_lock_suspension;
+
+    // shared_ticket_lock is the reader/writer variant of ticket_lock and just as fair:
+    // Readers and writers are served strictly in the order they arrived in. Consecutive readers
+    // are served simultaneously, writers wait for everyone before them and everyone after a writer waits for it.
+    // A steady stream of readers can thus neither starve a writer, nor can a flood of writers starve the readers.
+    //
+    // Both atomics count readers in their lower and writers in their upper 32 bits. A writer draws the
+    // entire 64-bit value of _requests as its ticket and is served once _completions has caught up with it.
+    // Readers only need to wait for the writers before them and so only compare the upper halves.
+    //
+    // After 2^32 readers the lower half carries into the upper one. That's fine, because it happens
+    // in both atomics at the same point of the sequence. The readers that arrive right after it
+    // merely wait for the ones right before it to finish, as if a writer had been between them.
+    //
+    // The same caveats as for ticket_lock apply and on top of that: Acquiring it in shared mode
+    // recursively deadlocks if a writer arrived in between. Use recursive_shared_ticket_lock for that.
+    struct shared_ticket_lock
+    {
+        void lock() noexcept
+        {
+            const auto ticket = _requests.fetch_add(writer_one, std::memory_order_relaxed);
+
+            for (;;)
+            {
+                const auto current = _completions.load(std::memory_order_acquire);
+                if (current == ticket)
+                {
+                    break;
+                }
+
+                til::atomic_wait(_completions, current);
+            }
+        }
+
+        void unlock() noexcept
+        {
+            _completions.fetch_add(writer_one, std::memory_order_release);
+            til::atomic_notify_all(_completions);
+        }
+
+        void lock_shared() noexcept
+        {
+            const auto ticket = _requests.fetch_add(1, std::memory_order_relaxed);
+
+            for (;;)
+            {
+                const auto current = _completions.load(std::memory_order_acquire);
+                if ((current ^ ticket) < writer_one)
+                {
+                    break;
+                }
+
+                til::atomic_wait(_completions, current);
+            }
+        }
+
+        void unlock_shared() noexcept
+        {
+            _completions.fetch_add(1, std::memory_order_release);
+            til::atomic_notify_all(_completions);
+        }
+
+    private:
+        static constexpr uint64_t writer_one = uint64_t{ 1 } << 32;
+
+        // Unlike ticket_lock this one is meant to be used by more than 2 threads. Readers only ever
+        // write to _completions when they're done, however, so there's little to gain by splitting them up.
+        std::atomic<uint64_t> _requests{ 0 };
+        std::atomic<uint64_t> _completions{ 0 };
+    };
+
+    // Like recursive_ticket_lock, but with a shared mode on top. Both modes can be acquired recursively.
+    // The exclusive owner may acquire it in shared mode, which counts as another exclusive recursion.
+    // Upgrading a shared hold to an exclusive one however isn't possible and deadlocks.
+    struct recursive_shared_ticket_lock
+    {
+        struct recursive_shared_ticket_lock_suspension
+        {
+            constexpr recursive_shared_ticket_lock_suspension(recursive_shared_ticket_lock& lock, uint32_t owner, uint32_t recursion, uint32_t shared) noexcept :
+                _lock{ lock },
+                _owner{ owner },
+                _recursion{ recursion },
+                _shared{ shared }
+            {
+            }
+
+            // When this class is destroyed it restores the recursive_shared_ticket_lock state.
+            // This of course only works if the lock wasn't moved to another thread or something.
+            recursive_shared_ticket_lock_suspension(const recursive_shared_ticket_lock_suspension&) = delete;
+            recursive_shared_ticket_lock_suspension& operator=(const recursive_shared_ticket_lock_suspension&) = delete;
+            recursive_shared_ticket_lock_suspension(recursive_shared_ticket_lock_suspension&&) = delete;
+            recursive_shared_ticket_lock_suspension& operator=(recursive_shared_ticket_lock_suspension&&) = delete;
+
+            ~recursive_shared_ticket_lock_suspension()
+            {
+                if (_owner)
+                {
+                    // If someone reacquired the lock on the current thread, we shouldn't lock it again.
+                    if (_lock._owner.load(std::memory_order_relaxed) != _owner)
+                    {
+                        _lock._lock.lock();
+                        _lock._owner.store(_owner, std::memory_order_relaxed);
+                    }
+                    // ...but we should restore the original recursion count.
+                    _lock._recursion += _recursion;
+                }
+
+                // lock_shared() only draws a ticket for the first of these and counts the rest.
+                for (auto i = _shared; i != 0; --i)
+                {
+                    _lock.lock_shared();
+                }
+            }
+
+        private:
+            friend struct recursive_shared_ticket_lock;
+
+            recursive_shared_ticket_lock& _lock;
+            uint32_t _owner = 0;
+            uint32_t _recursion = 0;
+            uint32_t _shared = 0;
+        };
+
+        void lock() noexcept
+        {
+            const auto id = GetCurrentThreadId();
+
+            if (_owner.load(std::memory_order_relaxed) != id)
+            {
+                // This would wait for our own shared hold to be released.
+                assert(!_shared_hold(false));
+                _lock.lock();
+                _owner.store(id, std::memory_order_relaxed);
+            }
+
+            _recursion++;
+        }
+
+        void unlock() noexcept
+        {
+            if (--_recursion == 0)
+            {
+                _owner.store(0, std::memory_order_relaxed);
+                _lock.unlock();
+            }
+        }
+
+        void lock_shared() noexcept
+        {
+            if (_owner.load(std::memory_order_relaxed) == GetCurrentThreadId())
+            {
+                _recursion++;
+                return;
+            }
+
+            // Drawing another ticket while already holding one would deadlock behind a waiting writer.
+            const auto hold = _shared_hold(true);
+            if (hold->depth++ == 0)
+            {
+                _lock.lock_shared();
+            }
+        }
+
+        void unlock_shared() noexcept
+        {
+            if (_owner.load(std::memory_order_relaxed) == GetCurrentThreadId())
+            {
+                unlock();
+                return;
+            }
+
+            // Unbalanced calls are ignored, as the thread doesn't hold a ticket we could return.
+            const auto hold = _shared_hold(false);
+            if (!hold || --hold->depth != 0)
+            {
+                return;
+            }
+            hold->lock = nullptr;
+            _lock.unlock_shared();
+        }
+
+        // Releases the lock, no matter whether the current thread holds it in exclusive or shared mode.
+        [[nodiscard]] recursive_shared_ticket_lock_suspension suspend() noexcept
+        {
+            const auto id = GetCurrentThreadId();
+            uint32_t owner = 0;
+            uint32_t recursion = 0;
+            uint32_t shared = 0;
+
+            if (_owner.load(std::memory_order_relaxed) == id)
+            {
+                owner = id;
+                recursion = _recursion;
+                _owner.store(0, std::memory_order_relaxed);
+                _recursion = 0;
+                _lock.unlock();
+            }
+            else if (const auto hold = _shared_hold(false))
+            {
+                shared = hold->depth;
+                *hold = {};
+                _lock.unlock_shared();
+            }
+
+            return { *this, owner, recursion, shared };
+        }
+
+        // Returns true if the current thread holds the lock in either mode.
+        bool is_locked() const noexcept
+        {
+            return is_locked_exclusive() || _shared_hold(false);
+        }
+
+        bool is_locked_exclusive() const noexcept
+        {
+            const auto id = GetCurrentThreadId();
+            return _owner.load(std::memory_order_relaxed) == id;
+        }
+
+        uint32_t recursion_depth() const noexcept
+        {
+            if (is_locked_exclusive())
+            {
+                return _recursion;
+            }
+            const auto hold = _shared_hold(false);
+            return hold ? hold->depth : 0;
+        }
+
+    private:
+        struct shared_hold
+        {
+            const recursive_shared_ticket_lock* lock = nullptr;
+            uint32_t depth = 0;
+        };
+
+        // Any number of threads may hold the lock in shared mode, so the recursion depth can't be stored
+        // in the lock itself. Instead, each thread tracks the locks it holds in shared mode.
+        // Threads rarely hold more than a few, so a linear search is fine.
+        shared_hold* _shared_hold(bool create) const noexcept
+        {
+            static thread_local std::vector<shared_hold> holds;
+            shared_hold* vacant = nullptr;
+
+            for (auto& hold : holds)
+            {
+                if (hold.lock == this)
+                {
+                    return &hold;
+                }
+                if (!hold.lock && !vacant)
+                {
+                    vacant = &hold;
+                }
+            }
+
+            if (!create)
+            {
+                return nullptr;
+            }
+            if (!vacant)
+            {
+                // The table only grows until it fits the most locks this thread ever held at once.
+                // If this throws, we're out of memory, which terminates the process due to noexcept.
+                vacant = &holds.emplace_back();
+            }
+            vacant->lock = this;
+            return vacant;
+        }
+
+        shared_ticket_lock _lock;
+        std::atomic<uint32_t> _owner = 0;
+        uint32_t _recursion = 0;
+    };
+
+    using recursive_shared_ticket_lock_suspension = recursive_shared_ticket_lock::recursive_shared_ticket_lock_suspension;
 }
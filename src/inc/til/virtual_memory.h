@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+namespace til // Terminal Implementation Library. Also: "Today I Learned"
+{
+    // A range of reserved address space, whose pages can be committed and decommitted on demand.
+    // The size of the reservation is rounded up to whole pages.
+    // Reserving is free, committed pages count towards the working set and decommitted pages are
+    // returned to the OS. Freshly committed pages are always zeroed, even if they were committed before.
+    //
+    // This is VirtualAlloc/VirtualFree on Windows and mmap/mprotect/madvise everywhere else.
+    class virtual_memory
+    {
+    public:
+        // Reservations at least this large ask the OS to back them with huge pages, where that can be
+        // done transparently (Linux' THP). Windows' MEM_LARGE_PAGES doesn't qualify: It requires
+        // SeLockMemoryPrivilege and committing the entire allocation upfront, which defeats the purpose.
+        static constexpr size_t huge_page_threshold = 64 * 1024 * 1024;
+
+        static size_t page_size() noexcept
+        {
+#ifdef _WIN32
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        constexpr virtual_memory() noexcept = default;
+
+        explicit virtual_memory(size_t size)
+        {
+            size = (size + page_size() - 1) & ~(page_size() - 1);
+#ifdef _WIN32
+            _data = static_cast<std::byte*>(THROW_LAST_ERROR_IF_NULL(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE)));
+#else
+            const auto data = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (data == MAP_FAILED)
+            {
+                throw std::bad_alloc{};
+            }
+            _data = static_cast<std::byte*>(data);
+#ifdef MADV_HUGEPAGE
+            if (size >= huge_page_threshold)
+            {
+                madvise(data, size, MADV_HUGEPAGE);
+            }
+#endif
+#endif
+            _size = size;
+        }
+
+        virtual_memory(const virtual_memory&) = delete;
+        virtual_memory& operator=(const virtual_memory&) = delete;
+
+        virtual_memory(virtual_memory&& other) noexcept :
+            _data{ std::exchange(other._data, nullptr) },
+            _size{ std::exchange(other._size, 0) }
+        {
+        }
+
+        virtual_memory& operator=(virtual_memory&& other) noexcept
+        {
+            if (this != &other)
+            {
+                _release();
+                _data = std::exchange(other._data, nullptr);
+                _size = std::exchange(other._size, 0);
+            }
+            return *this;
+        }
+
+        ~virtual_memory()
+        {
+            _release();
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return _data != nullptr;
+        }
+
+        std::byte* get() const noexcept
+        {
+            return _data;
+        }
+
+        size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        // Commits all pages that overlap with [ptr,ptr+size). Pages that are already committed keep their contents.
+        void commit(void* ptr, const size_t size) const
+        {
+#ifdef _WIN32
+            THROW_LAST_ERROR_IF_NULL(VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE));
+#else
+            const auto [beg, end] = _outer(ptr, size);
+            if (mprotect(beg, end - beg, PROT_READ | PROT_WRITE) != 0)
+            {
+                throw std::bad_alloc{};
+            }
+#endif
+        }
+
+        // Decommits all pages that lie entirely within [ptr,ptr+size). Pages that are only partially covered
+        // are left alone, because their remainder may still be in use by something else.
+        void decommit(void* ptr, const size_t size) const noexcept
+        {
+            const auto [beg, end] = _inner(ptr, size);
+            if (beg >= end)
+            {
+                return;
+            }
+#ifdef _WIN32
+            VirtualFree(beg, end - beg, MEM_DECOMMIT);
+#else
+            madvise(beg, end - beg, MADV_DONTNEED);
+            mprotect(beg, end - beg, PROT_NONE);
+#endif
+        }
+
+        // Returns the number of bytes in [ptr,ptr+size) that are committed (Windows) or resident (elsewhere).
+        // This is meant for diagnostics and tests and isn't particularly fast.
+        size_t committed(const void* ptr, const size_t size) const noexcept
+        {
+            const auto [beg, end] = _outer(ptr, size);
+            size_t total = 0;
+#ifdef _WIN32
+            MEMORY_BASIC_INFORMATION info;
+            for (auto it = beg; it < end && VirtualQuery(it, &info, sizeof(info)); it = static_cast<std::byte*>(info.BaseAddress) + info.RegionSize)
+            {
+                if (info.State == MEM_COMMIT)
+                {
+                    const auto regionEnd = static_cast<std::byte*>(info.BaseAddress) + info.RegionSize;
+                    total += std::min(regionEnd, end) - std::max(static_cast<std::byte*>(info.BaseAddress), beg);
+                }
+            }
+#else
+            const auto pageSize = page_size();
+            unsigned char residency[256];
+            for (auto it = beg; it < end;)
+            {
+                const auto bytes = std::min<size_t>(end - it, std::size(residency) * pageSize);
+                if (mincore(it, bytes, &residency[0]) != 0)
+                {
+                    break;
+                }
+                for (size_t i = 0; i < bytes / pageSize; ++i)
+                {
+                    total += (residency[i] & 1) * pageSize;
+                }
+                it += bytes;
+            }
+#endif
+            return total;
+        }
+
+    private:
+        // Rounds [ptr,ptr+size) outwards to whole pages.
+        static std::pair<std::byte*, std::byte*> _outer(const void* ptr, const size_t size) noexcept
+        {
+            const auto mask = page_size() - 1;
+            const auto beg = reinterpret_cast<uintptr_t>(ptr) & ~mask;
+            const auto end = (reinterpret_cast<uintptr_t>(ptr) + size + mask) & ~mask;
+            return { reinterpret_cast<std::byte*>(beg), reinterpret_cast<std::byte*>(end) };
+        }
+
+        // Rounds [ptr,ptr+size) inwards to whole pages.
+        static std::pair<std::byte*, std::byte*> _inner(const void* ptr, const size_t size) noexcept
+        {
+            const auto mask = page_size() - 1;
+            const auto beg = (reinterpret_cast<uintptr_t>(ptr) + mask) & ~mask;
+            const auto end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~mask;
+            return { reinterpret_cast<std::byte*>(beg), reinterpret_cast<std::byte*>(end) };
+        }
+
+        void _release() noexcept
+        {
+            if (_data)
+            {
+#ifdef _WIN32
+                VirtualFree(_data, 0, MEM_RELEASE);
+#else
+                munmap(_data, _size);
+#endif
+            }
+        }
+
+        std::byte* _data = nullptr;
+        size_t _size = 0;
+    };
+}
+
+#pragma warning(pop)
@@ -122,6 +122,12 @@ void HandleKeyEvent(const HWND hWnd,
     auto& g = ServiceLocator::LocateGlobals();
     auto& gci = g.getConsoleInformation();
 
+    // Don't let the render thread postpone the echo of this key press because of heavy output.
+    if (g.pRender)
+    {
+        g.pRender->NotifyInput();
+    }
+
     // BOGUS for WM_CHAR/WM_DEADCHAR, in which LOWORD(wParam) is a character
     auto VirtualKeyCode = LOWORD(wParam);
     WORD VirtualScanCode = LOBYTE(HIWORD(lParam));
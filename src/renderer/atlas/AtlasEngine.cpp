@@ -550,8 +550,8 @@ try
     auto& b = row->bitmap;
 
     // If this row's ImageSlice has changed we need to update our snapshot.
-    // Theoretically another _p.rows[y]->bitmap may have this particular revision already,
-    // but that can only happen if we're scrolling _and_ the entire viewport was invalidated.
+    // The revision identifies the slice's pixel tile, which may be shared by other rows
+    // (e.g. after a rectangular copy), so another _p.rows[y]->bitmap may have it already.
     if (b.revision != revision)
     {
         const auto srcHeight = std::max(0, srcCellSize.height);
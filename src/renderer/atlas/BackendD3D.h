@@ -7,6 +7,7 @@
 #include <til/flat_set.h>
 
 #include "Backend.h"
+#include "../../types/inc/ColorFix.hpp"
 
 namespace Microsoft::Console::Render::Atlas
 {
@@ -328,6 +329,8 @@ namespace Microsoft::Console::Render::Atlas
         til::small_vector<CursorRect, 6> _cursorRects;
         // The bounding rect of _cursorRects in pixels.
         til::rect _cursorPosition;
+        // Nudges the cursor and the text underneath it to be perceivable, on every frame.
+        ColorFix::PerceivableColorCache _perceivableColorCache;
 
         f32 _curlyLineHalfHeight = 0.0f;
         FontDecorationPosition _curlyUnderline;
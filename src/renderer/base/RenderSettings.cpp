@@ -5,7 +5,6 @@
 
 #include "../inc/RenderSettings.hpp"
 #include "../base/renderer.hpp"
-#include "../../types/inc/ColorFix.hpp"
 #include "../../types/inc/colorTable.hpp"
 
 using namespace Microsoft::Console::Render;
@@ -30,6 +29,37 @@ RenderSettings::RenderSettings() noexcept
     SaveDefaultSettings();
 }
 
+// Routine Description:
+// - Copies the color table, color aliases and render modes of another instance.
+// - The renderer uses this to paint from a snapshot without holding the console lock.
+//   The blink usage isn't copied, since it's assessed anew by every frame,
+//   and neither is the perceivable color cache, which each instance owns on its own.
+// Arguments:
+// - other - The settings to copy from.
+void RenderSettings::CopyFrom(const RenderSettings& other) noexcept
+{
+    _renderMode = other._renderMode;
+    _colorTable = other._colorTable;
+    _colorAliasIndices = other._colorAliasIndices;
+    _defaultColorTable = other._defaultColorTable;
+    _defaultColorAliasIndices = other._defaultColorAliasIndices;
+    _blinkCycle = other._blinkCycle;
+    _blinkIsInUse.store(false, std::memory_order_relaxed);
+    _blinkShouldBeFaint = other._blinkShouldBeFaint;
+}
+
+// Routine Description:
+// - Caches the results of adjusting indistinguishable colors from now on.
+//   The cache isn't thread-safe, so this is only meant for the renderer's snapshot
+//   of the settings, which is only ever used by the render thread.
+void RenderSettings::EnablePerceivableColorCache()
+{
+    if (!_perceivableColorCache)
+    {
+        _perceivableColorCache = std::make_unique<ColorFix::PerceivableColorCache>();
+    }
+}
+
 // Routine Description:
 // - Saves the current color table and color aliases as the default values, so
 //   we can later restore them when a hard reset (RIS) is requested.
@@ -168,7 +198,10 @@ size_t RenderSettings::GetColorAliasIndex(const ColorAlias alias) const noexcept
 // - The color values of the attribute's foreground and background.
 std::pair<COLORREF, COLORREF> RenderSettings::GetAttributeColors(const TextAttribute& attr) const noexcept
 {
-    _blinkIsInUse = _blinkIsInUse || attr.IsBlinking();
+    if (attr.IsBlinking())
+    {
+        MarkBlinkInUse();
+    }
 
     const auto fgTextColor = attr.GetForeground();
     const auto bgTextColor = attr.GetBackground();
@@ -206,7 +239,7 @@ std::pair<COLORREF, COLORREF> RenderSettings::GetAttributeColors(const TextAttri
             fg != bg &&
             (_renderMode.test(Mode::AlwaysDistinguishableColors) || (fgTextColor.IsDefaultOrLegacy() && bgTextColor.IsDefaultOrLegacy())))
         {
-            fg = ColorFix::GetPerceivableColor(fg, bg, 0.5f * 0.5f);
+            fg = _getPerceivableColor(fg, bg);
         }
     }
 
@@ -270,7 +303,7 @@ COLORREF RenderSettings::GetAttributeUnderlineColor(const TextAttribute& attr) c
             (_renderMode.test(Mode::AlwaysDistinguishableColors) ||
              (_renderMode.test(Mode::IndexedDistinguishableColors) && ulTextColor.IsDefaultOrLegacy() && attr.GetBackground().IsDefaultOrLegacy())))
         {
-            ul = ColorFix::GetPerceivableColor(ul, bg, 0.5f * 0.5f);
+            ul = _getPerceivableColor(ul, bg);
         }
     }
 
@@ -296,11 +329,11 @@ try
         _blinkShouldBeFaint = _blinkCycle >= 2;
         // Every two cycles (when the state changes), we need to trigger a
         // redraw, but only if there are actually blink attributes in use.
-        if (_blinkIsInUse && _blinkCycle % 2 == 0)
+        if (IsBlinkInUse() && _blinkCycle % 2 == 0)
         {
             // We reset the _blinkIsInUse flag before redrawing, so we can
             // get a fresh assessment of the current blink attribute usage.
-            _blinkIsInUse = false;
+            _blinkIsInUse.store(false, std::memory_order_relaxed);
             if (renderer)
             {
                 renderer->TriggerRedrawAll();
@@ -309,3 +342,28 @@ try
     }
 }
 CATCH_LOG()
+
+// Routine Description:
+// - Returns whether any blinking attribute was rendered since the last time
+//   the blink rendition was toggled.
+bool RenderSettings::IsBlinkInUse() const noexcept
+{
+    return _blinkIsInUse.load(std::memory_order_relaxed);
+}
+
+// Routine Description:
+// - Records that a blinking attribute was rendered, so that the next
+//   ToggleBlinkRendition() call triggers a redraw.
+void RenderSettings::MarkBlinkInUse() const noexcept
+{
+    _blinkIsInUse.store(true, std::memory_order_relaxed);
+}
+
+// Routine Description:
+// - Nudges `color` to be more perceivable on `reference`, using the cache if this instance has one.
+COLORREF RenderSettings::_getPerceivableColor(const COLORREF color, const COLORREF reference) const noexcept
+{
+    static constexpr auto minSquaredDistance = 0.5f * 0.5f;
+    return _perceivableColorCache ? _perceivableColorCache->GetPerceivableColor(color, reference, minSquaredDistance) :
+                                    ColorFix::GetPerceivableColor(color, reference, minSquaredDistance);
+}
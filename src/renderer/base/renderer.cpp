@@ -37,6 +37,8 @@ Renderer::Renderer(const RenderSettings& renderSettings,
     _pData(pData),
     _pThread{ std::move(thread) }
 {
+    // Only the render thread paints from this copy, which makes it safe to cache in.
+    _frame.renderSettings.EnablePerceivableColorCache();
     for (size_t i = 0; i < cEngines; i++)
     {
         AddRenderEngine(rgpEngines[i]);
@@ -61,6 +63,18 @@ IRenderData* Renderer::GetRenderData() const noexcept
     return _pData;
 }
 
+// Routine Description:
+// - Returns how many rows the last frame painted and how many invalidated rows it skipped.
+// - Must be called by the thread that calls PaintFrame(), or while holding the console lock.
+// Arguments:
+// - <none>
+// Return Value:
+// - The row counts of the last frame.
+Renderer::FrameRowStats Renderer::GetLastFrameRowStats() const noexcept
+{
+    return _lastFrameRowStats;
+}
+
 // Routine Description:
 // - Walks through the console data structures to compose a new frame based on the data that has changed since last call and outputs it to the connected rendering engine.
 // Arguments:
@@ -110,32 +124,90 @@ IRenderData* Renderer::GetRenderData() const noexcept
     return S_OK;
 }
 
+// Painting a frame happens in two phases:
+// * While holding the console lock, we hand all queued invalidations to the engines, call StartPaint()
+//   and copy the dirty rows, as well as anything else we need from IRenderData, into _frame.
+// * Without the console lock, we then paint the frame from that snapshot and present it.
+// This ensures that the VT parser only has to wait for us while we copy a handful of rows.
 [[nodiscard]] HRESULT Renderer::_PaintFrame() noexcept
+try
 {
+    // The engines which returned S_OK from StartPaint() and are thus waiting for an EndPaint().
+    til::small_vector<IRenderEngine*, 2> painting;
+    auto endPaint = wil::scope_exit([&]() {
+        for (const auto pEngine : painting)
+        {
+            _EndPaintForEngine(pEngine);
+        }
+    });
+
+    _pData->LockConsole();
+    auto unlock = wil::scope_exit([&]() {
+        _pData->UnlockConsole();
+    });
+
+    // The render thread waited for synchronized output to end before we acquired the console lock,
+    // but the application may have started another update since then. Since the mode only changes while
+    // the console lock is held, this check is reliable. The invalidations remain queued for the next frame,
+    // which RenderThread::_WaitForSynchronizedOutput() holds back until the update is complete or
+    // the invalidations are overdue (see IsSynchronizedOutputActive()).
+    if (IsSynchronizedOutputActive())
     {
-        _pData->LockConsole();
-        auto unlock = wil::scope_exit([&]() {
-            _pData->UnlockConsole();
-        });
+        _pThread->NotifyPaint();
+        return S_FALSE;
+    }
 
-        // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
-        _CheckViewportAndScroll();
+    const auto engineLock = _engineLock.lock_exclusive();
 
-        _invalidateCurrentCursor(); // Invalidate the previous cursor position.
-        _invalidateOldComposition();
+    // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
+    _CheckViewportAndScroll();
 
-        _updateCursorInfo();
-        _compositionCache.reset();
+    _invalidateCurrentCursor(); // Invalidate the previous cursor position.
+    _invalidateOldComposition();
 
-        _invalidateCurrentCursor(); // Invalidate the new cursor position.
-        _prepareNewComposition();
+    _updateCursorInfo();
+    _compositionCache.reset();
 
-        FOREACH_ENGINE(pEngine)
+    _invalidateCurrentCursor(); // Invalidate the new cursor position.
+    _prepareNewComposition();
+
+    _flushInvalidations();
+
+    FOREACH_ENGINE(pEngine)
+    {
+        // Try to start painting a frame
+        const auto hr = pEngine->StartPaint();
+        RETURN_IF_FAILED(hr);
+
+        // Skip engines with nothing to paint.
+        // The renderer itself tracks if there's something to do with the title, the
+        //      engine won't know that.
+        if (hr == S_OK)
         {
-            RETURN_IF_FAILED(_PaintFrameForEngine(pEngine));
+            painting.emplace_back(pEngine);
         }
     }
 
+    _snapshotFrame(painting);
+
+    // From here on everything we need is in _frame.
+    unlock.reset();
+
+    for (const auto pEngine : painting)
+    {
+        RETURN_IF_FAILED(_PaintFrameForEngine(pEngine));
+    }
+
+    // The snapshot recorded whether we painted any blinking text. ToggleBlinkRendition()
+    // needs to know that to decide whether it has to trigger a redraw.
+    if (_frame.renderSettings.IsBlinkInUse())
+    {
+        _renderSettings.MarkBlinkInUse();
+    }
+
+    // Force scope exit end paint to finish up collecting information and possibly painting
+    endPaint.reset();
+
     FOREACH_ENGINE(pEngine)
     {
         RETURN_IF_FAILED(pEngine->Present());
@@ -143,36 +215,15 @@ IRenderData* Renderer::GetRenderData() const noexcept
 
     return S_OK;
 }
+CATCH_RETURN()
 
+// Paints the current _frame with the given engine.
+// The engine must have successfully returned S_OK from StartPaint().
 [[nodiscard]] HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine) noexcept
 try
 {
     FAIL_FAST_IF_NULL(pEngine); // This is a programming error. Fail fast.
 
-    // Try to start painting a frame
-    const auto hr = pEngine->StartPaint();
-    RETURN_IF_FAILED(hr);
-
-    // Return early if there's nothing to paint.
-    // The renderer itself tracks if there's something to do with the title, the
-    //      engine won't know that.
-    if (S_FALSE == hr)
-    {
-        return S_OK;
-    }
-
-    auto endPaint = wil::scope_exit([&]() {
-        LOG_IF_FAILED(pEngine->EndPaint());
-
-        // If the engine tells us it really wants to redraw immediately,
-        // tell the thread so it doesn't go to sleep and ticks again
-        // at the next opportunity.
-        if (pEngine->RequiresContinuousRedraw())
-        {
-            NotifyPaintFrame();
-        }
-    });
-
     // A. Prep Colors
     RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, {}, false, true));
 
@@ -197,14 +248,449 @@ try
     // 6. Paint window title
     RETURN_IF_FAILED(_PaintTitle(pEngine));
 
-    // Force scope exit end paint to finish up collecting information and possibly painting
-    endPaint.reset();
-
-    // As we leave the scope, EndPaint will be called (declared above)
     return S_OK;
 }
 CATCH_RETURN()
 
+void Renderer::_EndPaintForEngine(_In_ IRenderEngine* const pEngine) noexcept
+{
+    LOG_IF_FAILED(pEngine->EndPaint());
+
+    // If the engine tells us it really wants to redraw immediately,
+    // tell the thread so it doesn't go to sleep and ticks again
+    // at the next opportunity.
+    if (pEngine->RequiresContinuousRedraw())
+    {
+        NotifyPaintFrame();
+    }
+}
+
+// Routine Description:
+// - Hands an invalidation to the engines. If we have a render thread, this only queues
+//   it up and the render thread will forward it at the start of the next frame.
+//   That way, engines are never invalidated concurrently while they're painting.
+// - Consecutive invalidations of the same kind are merged, as all engines
+//   accumulate them into a single dirty region anyway.
+// Arguments:
+// - invalidation - The invalidation to forward.
+// Return Value:
+// - <none>
+void Renderer::_queueInvalidation(DeferredInvalidation&& invalidation)
+{
+    {
+        const auto lock = _invalidationLock.lock_exclusive();
+
+        if (!_deferredInvalidations.empty())
+        {
+            auto& last = _deferredInvalidations.back();
+            if (last.kind == invalidation.kind)
+            {
+                switch (invalidation.kind)
+                {
+                case DeferredInvalidation::Kind::Region:
+                case DeferredInvalidation::Kind::Cursor:
+                case DeferredInvalidation::Kind::System:
+                    last.rect |= invalidation.rect;
+                    return;
+                case DeferredInvalidation::Kind::Scroll:
+                    last.delta += invalidation.delta;
+                    return;
+                case DeferredInvalidation::Kind::All:
+                    return;
+                case DeferredInvalidation::Kind::Title:
+                    last.text = std::move(invalidation.text);
+                    return;
+                case DeferredInvalidation::Kind::NewText:
+                    last.text.append(invalidation.text);
+                    return;
+                default:
+                    break;
+                }
+            }
+        }
+
+        if (_deferredInvalidations.empty())
+        {
+            _deferredInvalidationsSince.store(RenderThread::clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        }
+        _deferredInvalidations.emplace_back(std::move(invalidation));
+    }
+
+    // If we're running in the unittests, we might not have a render thread.
+    // There's nobody to flush the queue for us then.
+    if (!_pThread)
+    {
+        _flushInvalidations();
+    }
+}
+
+// Routine Description:
+// - Forwards all invalidations queued by _queueInvalidation() to the engines.
+// - Must be called while holding the console lock, but not during painting.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_flushInvalidations()
+{
+    {
+        const auto lock = _invalidationLock.lock_exclusive();
+        std::swap(_deferredInvalidations, _flushedInvalidations);
+        _deferredInvalidationsSince.store(0, std::memory_order_relaxed);
+    }
+
+    const auto clear = wil::scope_exit([&]() {
+        _flushedInvalidations.clear();
+    });
+
+    // Region invalidations are relative to the viewport at the time they were queued. Those that follow the
+    // last scroll, viewport change or InvalidateAll() thus refer to the same rows that _presentedRowHashes
+    // describes and we can drop the rows whose contents are the same as the ones we presented last.
+    auto filterBeg = _flushedInvalidations.size();
+    if (_viewport == _pData->GetViewport())
+    {
+        filterBeg = 0;
+        for (size_t idx = 0; idx < _flushedInvalidations.size(); ++idx)
+        {
+            switch (_flushedInvalidations[idx].kind)
+            {
+            case DeferredInvalidation::Kind::Scroll:
+            case DeferredInvalidation::Kind::Viewport:
+            case DeferredInvalidation::Kind::All:
+                filterBeg = idx + 1;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    for (size_t idx = 0; idx < _flushedInvalidations.size(); ++idx)
+    {
+        const auto& i = _flushedInvalidations[idx];
+        const auto filter = i.kind == DeferredInvalidation::Kind::Region && idx >= filterBeg;
+
+        switch (i.kind)
+        {
+        case DeferredInvalidation::Kind::Region:
+            if (filter)
+            {
+                _collectChangedRows(i.rect);
+            }
+            break;
+        case DeferredInvalidation::Kind::Scroll:
+            _scrollPresentedRowHashes(i.delta);
+            break;
+        case DeferredInvalidation::Kind::Viewport:
+            _resizePresentedRowHashes(i.viewport);
+            break;
+        case DeferredInvalidation::Kind::All:
+            std::fill(_presentedRowHashes.begin(), _presentedRowHashes.end(), 0);
+            break;
+        default:
+            break;
+        }
+
+        FOREACH_ENGINE(pEngine)
+        {
+            switch (i.kind)
+            {
+            case DeferredInvalidation::Kind::Region:
+                if (!filter)
+                {
+                    LOG_IF_FAILED(pEngine->Invalidate(&i.rect));
+                    break;
+                }
+                for (const auto& rect : _changedRowRects)
+                {
+                    LOG_IF_FAILED(pEngine->Invalidate(&rect));
+                }
+                break;
+            case DeferredInvalidation::Kind::Cursor:
+                LOG_IF_FAILED(pEngine->InvalidateCursor(&i.rect));
+                break;
+            case DeferredInvalidation::Kind::System:
+                LOG_IF_FAILED(pEngine->InvalidateSystem(&i.rect));
+                break;
+            case DeferredInvalidation::Kind::Scroll:
+                LOG_IF_FAILED(pEngine->InvalidateScroll(&i.delta));
+                break;
+            case DeferredInvalidation::Kind::Viewport:
+                LOG_IF_FAILED(pEngine->UpdateViewport(i.viewport));
+                break;
+            case DeferredInvalidation::Kind::All:
+                LOG_IF_FAILED(pEngine->InvalidateAll());
+                break;
+            case DeferredInvalidation::Kind::Selection:
+                LOG_IF_FAILED(pEngine->InvalidateSelection(i.rects));
+                break;
+            case DeferredInvalidation::Kind::Highlight:
+                LOG_IF_FAILED(pEngine->InvalidateHighlight(i.spans, _pData->GetTextBuffer()));
+                break;
+            case DeferredInvalidation::Kind::Title:
+                LOG_IF_FAILED(pEngine->InvalidateTitle(i.text));
+                break;
+            case DeferredInvalidation::Kind::NewText:
+                LOG_IF_FAILED(pEngine->NotifyNewText(i.text));
+                break;
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - Forgets the presented row hashes if the given viewport differs in anything but its vertical position.
+//   Vertical movement is accounted for by the Scroll invalidation that accompanies it.
+// Arguments:
+// - viewport - The new viewport.
+// Return Value:
+// - <none>
+void Renderer::_resizePresentedRowHashes(const til::inclusive_rect& viewport)
+{
+    const auto& old = _presentedRowHashesViewport;
+    if (viewport.left != old.left || viewport.right != old.right || viewport.bottom - viewport.top != old.bottom - old.top)
+    {
+        _presentedRowHashes.assign(gsl::narrow_cast<size_t>(std::max(0, viewport.bottom - viewport.top + 1)), 0);
+    }
+    _presentedRowHashesViewport = viewport;
+}
+
+// Routine Description:
+// - Moves the presented row hashes along with the contents of the engines.
+// Arguments:
+// - delta - The distance the contents were scrolled by.
+// Return Value:
+// - <none>
+void Renderer::_scrollPresentedRowHashes(const til::point delta) noexcept
+{
+    auto& hashes = _presentedRowHashes;
+    const auto height = gsl::narrow_cast<til::CoordType>(hashes.size());
+
+    if (delta.x != 0 || delta.y <= -height || delta.y >= height)
+    {
+        std::fill(hashes.begin(), hashes.end(), 0);
+    }
+    else if (delta.y > 0)
+    {
+        std::shift_right(hashes.begin(), hashes.end(), delta.y);
+        std::fill_n(hashes.begin(), delta.y, 0);
+    }
+    else if (delta.y < 0)
+    {
+        std::shift_left(hashes.begin(), hashes.end(), -delta.y);
+        std::fill(hashes.end() + delta.y, hashes.end(), 0);
+    }
+}
+
+// Routine Description:
+// - Splits the given Region invalidation into the rectangles of its rows that changed
+//   since they were last presented and stores them in _changedRowRects.
+// Arguments:
+// - rect - The viewport-relative invalidation.
+// Return Value:
+// - <none>
+void Renderer::_collectChangedRows(const til::rect& rect)
+{
+    _changedRowRects.clear();
+
+    const auto& buffer = _pData->GetTextBuffer();
+    const auto top = _viewport.Top();
+    const auto height = gsl::narrow_cast<til::CoordType>(_presentedRowHashes.size());
+    // The composition isn't part of the buffer contents and needs to be redrawn regardless.
+    const auto compositionRow = _compositionCache ? _compositionCache->absoluteOrigin.y - top : -1;
+    auto runTop = rect.top;
+
+    for (auto y = std::max(0, rect.top); y < std::min(height, rect.bottom); ++y)
+    {
+        const auto presented = til::at(_presentedRowHashes, y);
+        if (presented == 0 || y == compositionRow || presented != buffer.GetRowByOffset(top + y).ContentHash())
+        {
+            continue;
+        }
+
+        if (runTop < y)
+        {
+            _changedRowRects.push_back({ rect.left, runTop, rect.right, y });
+        }
+        runTop = y + 1;
+        ++_skippedRows;
+    }
+
+    if (runTop < rect.bottom)
+    {
+        _changedRowRects.push_back({ rect.left, runTop, rect.right, rect.bottom });
+    }
+}
+
+// Routine Description:
+// - Copies everything that painting the current frame requires out of IRenderData into _frame.
+// - Only rows that are dirty in any of the given engines are copied out of the text buffer.
+// Arguments:
+// - engines - The engines that are about to paint a frame.
+// Return Value:
+// - <none>
+void Renderer::_snapshotFrame(const std::span<IRenderEngine* const> engines)
+{
+    const auto& buffer = _pData->GetTextBuffer();
+    const auto view = _pData->GetViewport();
+    const til::size size{ buffer.GetSize().Width(), view.Height() };
+    const auto height = gsl::narrow_cast<size_t>(size.height);
+
+    if (!_frame.buffer || _frame.buffer->GetSize().Dimensions() != size)
+    {
+        _frame.buffer = std::make_unique<TextBuffer>(size, TextAttribute{}, 0, false, nullptr);
+    }
+
+    _frame.viewport = view;
+    _frame.patterns.resize(height);
+    _frame.copiedRows.assign(height, false);
+
+    if (_presentedRowHashes.size() != height)
+    {
+        _presentedRowHashes.assign(height, 0);
+    }
+
+    for (const auto pEngine : engines)
+    {
+        std::span<const til::rect> dirtyAreas;
+        LOG_IF_FAILED(pEngine->GetDirtyArea(dirtyAreas));
+
+        for (const auto& dirtyRect : dirtyAreas)
+        {
+            const auto beg = std::max(0, dirtyRect.top);
+            const auto end = std::min(size.height, dirtyRect.bottom);
+            for (auto row = beg; row < end; ++row)
+            {
+                _snapshotRow(row);
+            }
+        }
+    }
+
+    _frame.cursorOptions = _currentCursorOptions;
+    _frame.selectionRects = _lastSelectionRectsByViewport;
+
+    const auto searchHighlights = _pData->GetSearchHighlights();
+    const auto searchHighlightFocused = _pData->GetSearchHighlightFocused();
+    const auto selectionSpans = _pData->GetSelectionSpans();
+    _frame.searchHighlights.assign(searchHighlights.begin(), searchHighlights.end());
+    _frame.searchHighlightFocused.reset();
+    if (searchHighlightFocused)
+    {
+        _frame.searchHighlightFocused = *searchHighlightFocused;
+    }
+    _frame.selectionSpans.assign(selectionSpans.begin(), selectionSpans.end());
+
+    _frame.title = _pData->GetConsoleTitle();
+    _frame.hyperlinkHoveredId = _hyperlinkHoveredId;
+    _frame.hoveredInterval = _hoveredInterval;
+    _frame.gridLineDrawingAllowed = _pData->IsGridLineDrawingAllowed();
+    _frame.renderSettings.CopyFrom(_renderSettings);
+
+    _lastFrameRowStats = {
+        .painted = gsl::narrow_cast<size_t>(std::count(_frame.copiedRows.begin(), _frame.copiedRows.end(), true)),
+        .skipped = _skippedRows,
+    };
+    _skippedRows = 0;
+}
+
+// Routine Description:
+// - Copies the given viewport row into _frame, including its pattern IDs and the active composition.
+// Arguments:
+// - row - The viewport-relative row to copy.
+// Return Value:
+// - <none>
+void Renderer::_snapshotRow(const til::CoordType row)
+{
+    const auto y = gsl::narrow_cast<size_t>(row);
+    if (_frame.copiedRows[y])
+    {
+        return;
+    }
+    _frame.copiedRows[y] = true;
+
+    const auto& buffer = _pData->GetTextBuffer();
+    auto& snapshot = *_frame.buffer;
+    const auto absoluteRow = _frame.viewport.Top() + row;
+    buffer.CopyRow(absoluteRow, row, snapshot);
+    til::at(_presentedRowHashes, y) = buffer.GetRowByOffset(absoluteRow).ContentHash();
+
+    // Draw the active composition into the copy. Since _prepareNewComposition() ensured
+    // that the composition row is dirty, we'll always get here when there's one.
+    if (_compositionCache && _compositionCache->absoluteOrigin.y == absoluteRow)
+    {
+        til::at(_presentedRowHashes, y) = 0;
+        auto& r = snapshot.GetMutableRowByOffset(row);
+        const auto& activeComposition = _pData->GetActiveComposition();
+
+        std::wstring_view text{ activeComposition.text };
+        RowWriteState state{
+            .columnLimit = r.GetReadableColumnCount(),
+            .columnEnd = _compositionCache->absoluteOrigin.x,
+        };
+
+        size_t off = 0;
+        for (const auto& range : activeComposition.attributes)
+        {
+            const auto len = range.len;
+            auto attr = range.attr;
+
+            // Use the color at the cursor if TSF didn't specify any explicit color.
+            if (attr.GetBackground().IsDefault())
+            {
+                attr.SetBackground(_compositionCache->baseAttribute.GetBackground());
+            }
+            if (attr.GetForeground().IsDefault())
+            {
+                attr.SetForeground(_compositionCache->baseAttribute.GetForeground());
+            }
+
+            state.text = text.substr(off, len);
+            state.columnBegin = state.columnEnd;
+            r.ReplaceText(state);
+            r.ReplaceAttributes(state.columnBegin, state.columnEnd, attr);
+            off += len;
+        }
+    }
+
+    // GetPatternId() is fairly expensive, but luckily patterns are
+    // rare and span many columns, which allows us to store them as runs.
+    auto& runs = _frame.patterns[y];
+    runs.clear();
+
+    const auto width = snapshot.GetSize().Width();
+    for (til::CoordType x = 0; x < width; ++x)
+    {
+        auto ids = _pData->GetPatternId({ x, row });
+        if (!runs.empty() && runs.back().ids == ids)
+        {
+            runs.back().end = x + 1;
+        }
+        else
+        {
+            runs.push_back({ x + 1, std::move(ids) });
+        }
+    }
+}
+
+// Returns the pattern IDs at the given viewport-relative position, as captured by _snapshotRow().
+const std::vector<size_t>& Renderer::_snapshotPatternIdAt(const til::point location) const noexcept
+{
+    static const std::vector<size_t> none;
+
+    if (location.y >= 0 && gsl::narrow_cast<size_t>(location.y) < _frame.patterns.size())
+    {
+        for (const auto& run : til::at(_frame.patterns, location.y))
+        {
+            if (location.x < run.end)
+            {
+                return run.ids;
+            }
+        }
+    }
+
+    return none;
+}
+
 void Renderer::NotifyPaintFrame() noexcept
 {
     // If we're running in the unittests, we might not have a render thread.
@@ -215,6 +701,98 @@ void Renderer::NotifyPaintFrame() noexcept
     }
 }
 
+// Routine Description:
+// - Tells the render thread that the user interacted with us, so that it
+//   doesn't postpone the next frame even if there's a lot of output.
+void Renderer::NotifyInput() noexcept
+{
+    if (_pThread)
+    {
+        _pThread->NotifyInput();
+    }
+}
+
+// Routine Description:
+// - Tells the render thread that the application read input, so that it
+//   knows that the following output is presumably the echo of that input.
+void Renderer::NotifyInputConsumed() noexcept
+{
+    if (_pThread)
+    {
+        _pThread->NotifyInputConsumed();
+    }
+}
+
+// Routine Description:
+// - Tells the render thread how much text was written, which it uses to pace its frames.
+// Arguments:
+// - bytes - The size of the written text in bytes of UTF-16.
+void Renderer::NotifyOutput(const size_t bytes) noexcept
+{
+    if (_pThread)
+    {
+        _pThread->NotifyOutput(bytes);
+    }
+}
+
+// Routine Description:
+// - Sets the frame rate the render thread limits itself to while a lot of output is being written.
+// Arguments:
+// - framesPerSecond - The maximum frame rate, or 0 to paint as fast as possible.
+void Renderer::SetMaximumFrameRate(const uint32_t framesPerSecond) noexcept
+{
+    if (_pThread)
+    {
+        _pThread->SetMaximumFrameRate(framesPerSecond);
+    }
+}
+
+// Routine Description:
+// - Enables or disables synchronized output (DECSET 2026). While it's enabled, frames are
+//   held back until the application finished its update or a timeout elapsed.
+// Arguments:
+// - enabled - true to hold back frames, false to paint the update.
+void Renderer::SetSynchronizedOutput(const bool enabled) noexcept
+{
+    if (_pThread)
+    {
+        _pThread->SetSynchronizedOutput(enabled);
+    }
+}
+
+// Routine Description:
+// - Returns whether frames are currently held back because of synchronized output.
+// - Invalidations are never held back for longer than RenderThread::s_synchronizedOutputTimeout, even if the
+//   application finished its update and started the next one in the meantime, which resets the mode's own timeout.
+bool Renderer::IsSynchronizedOutputActive() const noexcept
+{
+    if (!_pThread || !_pThread->IsSynchronizedOutputActive())
+    {
+        return false;
+    }
+
+    const auto since = _deferredInvalidationsSince.load(std::memory_order_relaxed);
+    return since == 0 || RenderThread::clock::now() < RenderThread::clock::time_point{ RenderThread::clock::duration{ since } } + RenderThread::s_synchronizedOutputTimeout;
+}
+
+// Routine Description:
+// - Returns the RenderThread::clock::time_point at which the oldest invalidation
+//   that hasn't been painted yet was queued, or 0 if there is none.
+RenderThread::clock::rep Renderer::GetDeferredInvalidationsSince() const noexcept
+{
+    return _deferredInvalidationsSince.load(std::memory_order_relaxed);
+}
+
+// Routine Description:
+// - Sets a callback that receives the timings of each frame. It's called on the render thread.
+void Renderer::SetFrameTimingCallback(std::function<void(const FrameTiming&)> pfn)
+{
+    if (_pThread)
+    {
+        _pThread->SetFrameTimingCallback(std::move(pfn));
+    }
+}
+
 // Routine Description:
 // - Called when the system has requested we redraw a portion of the console.
 // Arguments:
@@ -223,10 +801,7 @@ void Renderer::NotifyPaintFrame() noexcept
 // - <none>
 void Renderer::TriggerSystemRedraw(const til::rect* const prcDirtyClient)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateSystem(prcDirtyClient));
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::System, .rect = *prcDirtyClient });
 
     NotifyPaintFrame();
 }
@@ -257,10 +832,7 @@ void Renderer::TriggerRedraw(const Viewport& region)
     if (view.TrimToViewport(&srUpdateRegion))
     {
         view.ConvertToOrigin(&srUpdateRegion);
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
-        }
+        _queueInvalidation({ .kind = DeferredInvalidation::Kind::Region, .rect = srUpdateRegion });
 
         NotifyPaintFrame();
     }
@@ -287,10 +859,7 @@ void Renderer::TriggerRedraw(const til::point* const pcoord)
 // - <none>
 void Renderer::TriggerRedrawAll(const bool backgroundChanged, const bool frameChanged)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateAll());
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::All });
 
     NotifyPaintFrame();
 
@@ -352,13 +921,10 @@ try
             }
         }
 
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->InvalidateSelection(_lastSelectionRectsByViewport));
-            LOG_IF_FAILED(pEngine->InvalidateSelection(newSelectionViewportRects));
-        }
+        _queueInvalidation({ .kind = DeferredInvalidation::Kind::Selection, .rects = _lastSelectionRectsByViewport });
+        _queueInvalidation({ .kind = DeferredInvalidation::Kind::Selection, .rects = newSelectionViewportRects });
 
-        std::exchange(_lastSelectionRectsByViewport, newSelectionViewportRects);
+        _lastSelectionRectsByViewport = std::move(newSelectionViewportRects);
 
         NotifyPaintFrame();
     }
@@ -379,13 +945,8 @@ try
         return;
     }
 
-    const auto& buffer = _pData->GetTextBuffer();
-
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateHighlight(oldHighlights, buffer));
-        LOG_IF_FAILED(pEngine->InvalidateHighlight(newHighlights, buffer));
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::Highlight, .spans = oldHighlights });
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::Highlight, .spans = { newHighlights.begin(), newHighlights.end() } });
 
     NotifyPaintFrame();
 }
@@ -414,11 +975,8 @@ bool Renderer::_CheckViewportAndScroll()
     coordDelta.x = srOldViewport.left - srNewViewport.left;
     coordDelta.y = srOldViewport.top - srNewViewport.top;
 
-    FOREACH_ENGINE(engine)
-    {
-        LOG_IF_FAILED(engine->UpdateViewport(srNewViewport));
-        LOG_IF_FAILED(engine->InvalidateScroll(&coordDelta));
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::Viewport, .viewport = srNewViewport });
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::Scroll, .delta = coordDelta });
 
     _ScrollPreviousSelection(coordDelta);
 
@@ -469,10 +1027,7 @@ void Renderer::TriggerScroll()
 // - <none>
 void Renderer::TriggerScroll(const til::point* const pcoordDelta)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateScroll(pcoordDelta));
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::Scroll, .delta = *pcoordDelta });
 
     _ScrollPreviousSelection(*pcoordDelta);
 
@@ -488,20 +1043,13 @@ void Renderer::TriggerScroll(const til::point* const pcoordDelta)
 // - <none>
 void Renderer::TriggerTitleChange()
 {
-    const auto newTitle = _pData->GetConsoleTitle();
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateTitle(newTitle));
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::Title, .text = std::wstring{ _pData->GetConsoleTitle() } });
     NotifyPaintFrame();
 }
 
 void Renderer::TriggerNewTextNotification(const std::wstring_view newText)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->NotifyNewText(newText));
-    }
+    _queueInvalidation({ .kind = DeferredInvalidation::Kind::NewText, .text = std::wstring{ newText } });
 }
 
 // Routine Description:
@@ -512,8 +1060,7 @@ void Renderer::TriggerNewTextNotification(const std::wstring_view newText)
 // - the HRESULT of the underlying engine's UpdateTitle call.
 HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
 {
-    const auto newTitle = _pData->GetConsoleTitle();
-    return pEngine->UpdateTitle(newTitle);
+    return pEngine->UpdateTitle(_frame.title);
 }
 
 // Routine Description:
@@ -526,6 +1073,8 @@ HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
 // - <none>
 void Renderer::TriggerFontChange(const int iDpi, const FontInfoDesired& FontInfoDesired, _Out_ FontInfo& FontInfo)
 {
+    const auto engineLock = _engineLock.lock_exclusive();
+
     FOREACH_ENGINE(pEngine)
     {
         LOG_IF_FAILED(pEngine->UpdateDpi(iDpi));
@@ -552,9 +1101,13 @@ void Renderer::UpdateSoftFont(const std::span<const uint16_t> bitPattern, const
     const auto softFontCharCount = cellSize.height ? bitPattern.size() / cellSize.height : 0;
     _lastSoftFontChar = _firstSoftFontChar + softFontCharCount - 1;
 
-    FOREACH_ENGINE(pEngine)
     {
-        LOG_IF_FAILED(pEngine->UpdateSoftFont(bitPattern, cellSize, centeringHint));
+        const auto engineLock = _engineLock.lock_exclusive();
+
+        FOREACH_ENGINE(pEngine)
+        {
+            LOG_IF_FAILED(pEngine->UpdateSoftFont(bitPattern, cellSize, centeringHint));
+        }
     }
     TriggerRedrawAll();
 }
@@ -582,6 +1135,8 @@ bool Renderer::s_IsSoftFontChar(const std::wstring_view& v, const size_t firstSo
     //      renderer. We won't know which is which, so iterate over them.
     //      Only return the result of the successful one if it's not S_FALSE (which is the VT renderer)
     // TODO: 14560740 - The Window might be able to get at this info in a more sane manner
+    const auto engineLock = _engineLock.lock_exclusive();
+
     FOREACH_ENGINE(pEngine)
     {
         const auto hr = LOG_IF_FAILED(pEngine->GetProposedFont(FontInfoDesired, FontInfo, iDpi));
@@ -613,6 +1168,8 @@ bool Renderer::IsGlyphWideByFont(const std::wstring_view glyph)
     //      renderer. We won't know which is which, so iterate over them.
     //      Only return the result of the successful one if it's not S_FALSE (which is the VT renderer)
     // TODO: 14560740 - The Window might be able to get at this info in a more sane manner
+    const auto engineLock = _engineLock.lock_exclusive();
+
     FOREACH_ENGINE(pEngine)
     {
         const auto hr = LOG_IF_FAILED(pEngine->IsGlyphWideByFont(glyph, &fIsFullWidth));
@@ -681,10 +1238,9 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
 {
     // This is the subsection of the entire screen buffer that is currently being presented.
     // It can move left/right or top/bottom depending on how the viewport is scrolled
-    // relative to the entire buffer.
-    const auto view = _pData->GetViewport();
-    const auto compositionRow = _compositionCache ? _compositionCache->absoluteOrigin.y : -1;
-    const auto& activeComposition = _pData->GetActiveComposition();
+    // relative to the entire buffer. Since _frame only holds the rows inside the viewport,
+    // we're working with a copy of it that's been moved to the top of the snapshot.
+    const auto view = Viewport::FromDimensions({ _frame.viewport.Left(), 0 }, _frame.viewport.Dimensions());
 
     // This is effectively the number of cells on the visible screen that need to be redrawn.
     // The origin is always 0, 0 because it represents the screen itself, not the underlying buffer.
@@ -696,6 +1252,9 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
         LOG_IF_FAILED(pEngine->ResetLineTransform());
     });
 
+    // The snapshot of the rows in the viewport. _snapshotFrame() copied all rows that are dirty.
+    const auto& buffer = *_frame.buffer;
+
     for (const auto& dirtyRect : dirtyAreas)
     {
         if (!dirtyRect)
@@ -705,7 +1264,7 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
 
         auto dirty = Viewport::FromExclusive(dirtyRect);
 
-        // Shift the origin of the dirty region to match the underlying buffer so we can
+        // Shift the origin of the dirty region to match the snapshot so we can
         // compare the two regions directly for intersection.
         dirty = Viewport::Offset(dirty, view.Origin());
 
@@ -714,8 +1273,6 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
         // we need to walk through line-by-line and repaint onto the screen.
         const auto redraw = Viewport::Intersect(dirty, view);
 
-        // Retrieve the text buffer so we can read information out of it.
-        auto& buffer = _pData->GetTextBuffer();
         // Now walk through each row of text that we need to redraw.
         for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
         {
@@ -724,63 +1281,14 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
             const auto screenLine = til::inclusive_rect{ redraw.Left(), row, redraw.RightInclusive(), row };
             const auto& r = buffer.GetRowByOffset(row);
 
-            // Draw the active composition.
-            // We have to use some tricks here with const_cast, because the code after it relies on TextBufferCellIterator,
-            // which isn't compatible with the scratchpad row. This forces us to back up and modify the actual row `r`.
-            ROW* rowBackup = nullptr;
-            if (row == compositionRow)
-            {
-                auto& scratch = buffer.GetScratchpadRow();
-                scratch.CopyFrom(r);
-                rowBackup = &scratch;
-
-                std::wstring_view text{ activeComposition.text };
-                RowWriteState state{
-                    .columnLimit = r.GetReadableColumnCount(),
-                    .columnEnd = _compositionCache->absoluteOrigin.x,
-                };
-
-                size_t off = 0;
-                for (const auto& range : activeComposition.attributes)
-                {
-                    const auto len = range.len;
-                    auto attr = range.attr;
-
-                    // Use the color at the cursor if TSF didn't specify any explicit color.
-                    if (attr.GetBackground().IsDefault())
-                    {
-                        attr.SetBackground(_compositionCache->baseAttribute.GetBackground());
-                    }
-                    if (attr.GetForeground().IsDefault())
-                    {
-                        attr.SetForeground(_compositionCache->baseAttribute.GetForeground());
-                    }
-
-                    state.text = text.substr(off, len);
-                    state.columnBegin = state.columnEnd;
-                    const_cast<ROW&>(r).ReplaceText(state);
-                    const_cast<ROW&>(r).ReplaceAttributes(state.columnBegin, state.columnEnd, attr);
-                    off += len;
-                }
-            }
-            const auto restore = wil::scope_exit([&] {
-                if (rowBackup)
-                {
-                    const_cast<ROW&>(r).CopyFrom(*rowBackup);
-                }
-            });
-
             // Convert the screen coordinates of the line to an equivalent
             // range of buffer cells, taking line rendition into account.
-            const auto lineRendition = buffer.GetLineRendition(row);
+            const auto lineRendition = r.GetLineRendition();
             const auto bufferLine = Viewport::FromInclusive(ScreenToBufferLine(screenLine, lineRendition));
 
-            // Find where on the screen we should place this line information. This requires us to re-map
-            // the buffer-based origin of the line back onto the screen-based origin of the line.
-            // For example, the screen might say we need to paint line 1 because it is dirty but the viewport
-            // is actually looking at line 26 relative to the buffer. This means that we need line 27 out
-            // of the backing buffer to fill in line 1 of the screen.
-            const auto screenPosition = bufferLine.Origin() - til::point{ 0, view.Top() };
+            // Since the snapshot starts at the top of the viewport, its rows already
+            // correspond to the rows on the screen. Only the X axis may be scrolled.
+            const auto screenPosition = bufferLine.Origin();
 
             // Retrieve the cell information iterator limited to just this line we want to redraw.
             auto it = buffer.GetCellDataAt(bufferLine.Origin(), bufferLine);
@@ -789,8 +1297,7 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
             // 1. this row wrapped
             // 2. We're painting the last col of the row.
             // In that case, set lineWrapped=true for the _PaintBufferOutputHelper call.
-            const auto lineWrapped = (buffer.GetRowByOffset(bufferLine.Origin().y).WasWrapForced()) &&
-                                     (bufferLine.RightExclusive() == buffer.GetSize().Width());
+            const auto lineWrapped = r.WasWrapForced() && bufferLine.RightExclusive() == buffer.GetSize().Width();
 
             // Prepare the appropriate line transform for the current row and viewport offset.
             LOG_IF_FAILED(pEngine->PrepareLineTransform(lineRendition, screenPosition.y, view.Left()));
@@ -799,7 +1306,7 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
             _PaintBufferOutputHelper(pEngine, it, screenPosition, lineWrapped);
 
             // Paint any image content on top of the text.
-            const auto imageSlice = buffer.GetRowByOffset(row).GetImageSlice();
+            const auto imageSlice = r.GetImageSlice();
             if (imageSlice) [[unlikely]]
             {
                 LOG_IF_FAILED(pEngine->PaintImageSlice(*imageSlice, screenPosition.y, view.Left()));
@@ -819,7 +1326,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
                                         const til::point target,
                                         const bool lineWrapped)
 {
-    auto globalInvert{ _renderSettings.GetRenderMode(RenderSettings::Mode::ScreenReversed) };
+    auto globalInvert{ _frame.renderSettings.GetRenderMode(RenderSettings::Mode::ScreenReversed) };
 
     // If we have valid data, let's figure out how to draw it.
     if (it)
@@ -833,7 +1340,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
         // Retrieve the first color.
         auto color = it->TextAttr();
         // Retrieve the first pattern id
-        auto patternIds = _pData->GetPatternId(target);
+        auto patternIds = _snapshotPatternIdAt(target);
         // Determine whether we're using a soft font.
         auto usingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
 
@@ -881,7 +1388,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             do
             {
                 til::point thisPoint{ screenPoint.x + cols, screenPoint.y };
-                const auto thisPointPatterns = _pData->GetPatternId(thisPoint);
+                const auto& thisPointPatterns = _snapshotPatternIdAt(thisPoint);
                 const auto thisUsingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
                 const auto changedPatternOrFont = patternIds != thisPointPatterns || usingSoftFont != thisUsingSoftFont;
                 if (color != it->TextAttr() || changedPatternOrFont)
@@ -931,7 +1438,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
 
             // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
             // We're only allowed to draw the grid lines under certain circumstances.
-            if (_pData->IsGridLineDrawingAllowed())
+            if (_frame.gridLineDrawingAllowed)
             {
                 // See GH: 803
                 // If we found a wide character while we looped above, it's possible we skipped over the right half
@@ -1064,8 +1571,8 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
     if (lines.any())
     {
         // Get the current foreground and underline colors to render the lines.
-        const auto fg = _renderSettings.GetAttributeColors(textAttribute).first;
-        const auto underlineColor = _renderSettings.GetAttributeUnderlineColor(textAttribute);
+        const auto fg = _frame.renderSettings.GetAttributeColors(textAttribute).first;
+        const auto underlineColor = _frame.renderSettings.GetAttributeUnderlineColor(textAttribute);
         // Draw the lines
         LOG_IF_FAILED(pEngine->PaintBufferGridLines(lines, fg, underlineColor, cchLine, coordTarget));
     }
@@ -1073,14 +1580,14 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
 
 bool Renderer::_isHoveredHyperlink(const TextAttribute& textAttribute) const noexcept
 {
-    return _hyperlinkHoveredId && _hyperlinkHoveredId == textAttribute.GetHyperlinkId();
+    return _frame.hyperlinkHoveredId && _frame.hyperlinkHoveredId == textAttribute.GetHyperlinkId();
 }
 
 bool Renderer::_isInHoveredInterval(const til::point coordTarget) const noexcept
 {
-    return _hoveredInterval &&
-           _hoveredInterval->start <= coordTarget && coordTarget <= _hoveredInterval->stop &&
-           _pData->GetPatternId(coordTarget).size() > 0;
+    return _frame.hoveredInterval &&
+           _frame.hoveredInterval->start <= coordTarget && coordTarget <= _frame.hoveredInterval->stop &&
+           !_snapshotPatternIdAt(coordTarget).empty();
 }
 
 // Routine Description:
@@ -1140,7 +1647,7 @@ void Renderer::_updateCursorInfo()
     _currentCursorOptions.inViewport = xInRange && yInRange;
 }
 
-void Renderer::_invalidateCurrentCursor() const
+void Renderer::_invalidateCurrentCursor()
 {
     if (!_currentCursorOptions.inViewport || !_currentCursorOptions.isOn)
     {
@@ -1160,17 +1667,14 @@ void Renderer::_invalidateCurrentCursor() const
 
     if (view.TrimToViewport(&rect))
     {
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->InvalidateCursor(&rect));
-        }
+        _queueInvalidation({ .kind = DeferredInvalidation::Kind::Cursor, .rect = rect });
     }
 }
 
 // If we had previously drawn a composition at the previous cursor position
 // we need to invalidate the entire line because who knows what changed.
 // (It's possible to figure that out, but not worth the effort right now.)
-void Renderer::_invalidateOldComposition() const
+void Renderer::_invalidateOldComposition()
 {
     if (!_compositionCache || !_currentCursorOptions.inViewport)
     {
@@ -1184,10 +1688,7 @@ void Renderer::_invalidateOldComposition() const
     til::rect rect{ 0, coord.y, til::CoordTypeMax, coord.y + 1 };
     if (view.TrimToViewport(&rect))
     {
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->Invalidate(&rect));
-        }
+        _queueInvalidation({ .kind = DeferredInvalidation::Kind::Region, .rect = rect });
     }
 }
 
@@ -1208,10 +1709,7 @@ void Renderer::_prepareNewComposition()
     {
         viewport.ConvertToOrigin(&line);
 
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->Invalidate(&line));
-        }
+        _queueInvalidation({ .kind = DeferredInvalidation::Kind::Region, .rect = line });
 
         auto& buffer = _pData->GetTextBuffer();
         auto& scratch = buffer.GetScratchpadRow();
@@ -1252,9 +1750,9 @@ void Renderer::_prepareNewComposition()
 // - <none>
 void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
 {
-    if (_currentCursorOptions.inViewport && _currentCursorOptions.isVisible)
+    if (_frame.cursorOptions.inViewport && _frame.cursorOptions.isVisible)
     {
-        LOG_IF_FAILED(pEngine->PaintCursor(_currentCursorOptions));
+        LOG_IF_FAILED(pEngine->PaintCursor(_frame.cursorOptions));
     }
 }
 
@@ -1272,10 +1770,10 @@ void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
 [[nodiscard]] HRESULT Renderer::_PrepareRenderInfo(_In_ IRenderEngine* const pEngine)
 {
     RenderFrameInfo info;
-    info.searchHighlights = _pData->GetSearchHighlights();
-    info.searchHighlightFocused = _pData->GetSearchHighlightFocused();
-    info.selectionSpans = _pData->GetSelectionSpans();
-    info.selectionBackground = _renderSettings.GetColorTableEntry(TextColor::SELECTION_BACKGROUND);
+    info.searchHighlights = _frame.searchHighlights;
+    info.searchHighlightFocused = _frame.searchHighlightFocused ? &*_frame.searchHighlightFocused : nullptr;
+    info.selectionSpans = _frame.selectionSpans;
+    info.selectionBackground = _frame.renderSettings.GetColorTableEntry(TextColor::SELECTION_BACKGROUND);
     return pEngine->PrepareRenderInfo(std::move(info));
 }
 
@@ -1294,7 +1792,7 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 
         for (auto&& dirtyRect : dirtyAreas)
         {
-            for (const auto& rect : _lastSelectionRectsByViewport)
+            for (const auto& rect : _frame.selectionRects)
             {
                 if (const auto rectCopy{ rect & dirtyRect })
                 {
@@ -1325,7 +1823,7 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 {
     // The last color needs to be each engine's responsibility. If it's local to this function,
     //      then on the next engine we might not update the color.
-    return pEngine->UpdateDrawingBrushes(textAttributes, _renderSettings, _pData, usingSoftFont, isSettingDefaultBrushes);
+    return pEngine->UpdateDrawingBrushes(textAttributes, _frame.renderSettings, _pData, usingSoftFont, isSettingDefaultBrushes);
 }
 
 // Routine Description:
@@ -1445,9 +1943,21 @@ void Renderer::ResetErrorStateAndResume()
     EnablePainting();
 }
 
+// Method Description:
+// - Blocks the render thread from painting until the returned guard is destroyed.
+// - Engines are painted without holding the console lock, so this needs to be held
+//   whenever an engine's settings are changed from outside the renderer.
+// - Like the render thread, callers may hold the console lock while acquiring this, but not vice versa.
+wil::rwlock_release_exclusive_scope_exit Renderer::LockEngines() noexcept
+{
+    return _engineLock.lock_exclusive();
+}
+
 void Renderer::UpdateHyperlinkHoveredId(uint16_t id) noexcept
 {
     _hyperlinkHoveredId = id;
+
+    const auto engineLock = _engineLock.lock_exclusive();
     FOREACH_ENGINE(pEngine)
     {
         pEngine->UpdateHyperlinkHoveredId(id);
@@ -28,6 +28,14 @@ namespace Microsoft::Console::Render
     class Renderer
     {
     public:
+        // How many viewport rows the last frame copied out of the text buffer to paint them, and how many
+        // rows were invalidated since the frame before it, but skipped because their contents didn't change.
+        struct FrameRowStats
+        {
+            size_t painted = 0;
+            size_t skipped = 0;
+        };
+
         Renderer(const RenderSettings& renderSettings,
                  IRenderData* pData,
                  _In_reads_(cEngines) IRenderEngine** const pEngine,
@@ -37,10 +45,19 @@ namespace Microsoft::Console::Render
         ~Renderer();
 
         IRenderData* GetRenderData() const noexcept;
+        FrameRowStats GetLastFrameRowStats() const noexcept;
 
         [[nodiscard]] HRESULT PaintFrame();
 
         void NotifyPaintFrame() noexcept;
+        void NotifyInput() noexcept;
+        void NotifyInputConsumed() noexcept;
+        void NotifyOutput(size_t bytes) noexcept;
+        void SetMaximumFrameRate(uint32_t framesPerSecond) noexcept;
+        void SetSynchronizedOutput(bool enabled) noexcept;
+        bool IsSynchronizedOutputActive() const noexcept;
+        RenderThread::clock::rep GetDeferredInvalidationsSince() const noexcept;
+        void SetFrameTimingCallback(std::function<void(const FrameTiming&)> pfn);
         void TriggerSystemRedraw(const til::rect* const prcDirtyClient);
         void TriggerRedraw(const Microsoft::Console::Types::Viewport& region);
         void TriggerRedraw(const til::point* const pcoord);
@@ -76,6 +93,7 @@ namespace Microsoft::Console::Render
 
         void AddRenderEngine(_In_ IRenderEngine* const pEngine);
         void RemoveRenderEngine(_In_ IRenderEngine* const pEngine);
+        [[nodiscard]] wil::rwlock_release_exclusive_scope_exit LockEngines() noexcept;
 
         void SetBackgroundColorChangedCallback(std::function<void()> pfn);
         void SetFrameColorChangedCallback(std::function<void()> pfn);
@@ -94,11 +112,80 @@ namespace Microsoft::Console::Render
             TextAttribute baseAttribute;
         };
 
+        // The engines must not be invalidated while they're painting, but we paint without holding the
+        // console lock. Invalidations are thus queued up here and only handed to the engines by the
+        // render thread right before it calls StartPaint(). See _queueInvalidation().
+        struct DeferredInvalidation
+        {
+            enum class Kind : uint8_t
+            {
+                Region,
+                Cursor,
+                System,
+                Scroll,
+                Viewport,
+                All,
+                Selection,
+                Highlight,
+                Title,
+                NewText,
+            };
+
+            Kind kind;
+            til::rect rect;
+            til::point delta;
+            til::inclusive_rect viewport;
+            std::vector<til::rect> rects;
+            std::vector<til::point_span> spans;
+            std::wstring text;
+        };
+
+        // Columns [previous run's end, end) of a row share the same pattern IDs.
+        struct PatternRun
+        {
+            til::CoordType end;
+            std::vector<size_t> ids;
+        };
+
+        // A copy of everything that painting a frame needs from IRenderData.
+        // It gets filled by _snapshotFrame() while holding the console lock and is then
+        // painted without it, so that the VT parser doesn't have to wait for us.
+        struct FrameSnapshot
+        {
+            // Row 0 of this buffer corresponds to viewport.Top() in the real one.
+            // Only the rows that are dirty in the current frame are up to date.
+            std::unique_ptr<TextBuffer> buffer;
+            Microsoft::Console::Types::Viewport viewport;
+            // The pattern IDs of each viewport row (see IRenderData::GetPatternId).
+            std::vector<std::vector<PatternRun>> patterns;
+            std::vector<bool> copiedRows;
+            CursorOptions cursorOptions;
+            std::vector<til::rect> selectionRects;
+            std::vector<til::point_span> searchHighlights;
+            std::optional<til::point_span> searchHighlightFocused;
+            std::vector<til::point_span> selectionSpans;
+            std::wstring title;
+            uint16_t hyperlinkHoveredId = 0;
+            std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> hoveredInterval;
+            bool gridLineDrawingAllowed = false;
+            // The color table and render modes at the time of the snapshot.
+            RenderSettings renderSettings;
+        };
+
         static GridLineSet s_GetGridlines(const TextAttribute& textAttribute) noexcept;
         static bool s_IsSoftFontChar(const std::wstring_view& v, const size_t firstSoftFontChar, const size_t lastSoftFontChar);
 
         [[nodiscard]] HRESULT _PaintFrame() noexcept;
         [[nodiscard]] HRESULT _PaintFrameForEngine(_In_ IRenderEngine* const pEngine) noexcept;
+        void _EndPaintForEngine(_In_ IRenderEngine* const pEngine) noexcept;
+        void _queueInvalidation(DeferredInvalidation&& invalidation);
+        void _flushInvalidations();
+        void _resizePresentedRowHashes(const til::inclusive_rect& viewport);
+        void _scrollPresentedRowHashes(til::point delta) noexcept;
+        void _collectChangedRows(const til::rect& rect);
+        void _snapshotFrame(std::span<IRenderEngine* const> engines);
+        void _snapshotRow(til::CoordType row);
+        const std::vector<size_t>& _snapshotPatternIdAt(til::point location) const noexcept;
         bool _CheckViewportAndScroll();
         [[nodiscard]] HRESULT _PaintBackground(_In_ IRenderEngine* const pEngine);
         void _PaintBufferOutput(_In_ IRenderEngine* const pEngine);
@@ -113,8 +200,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT _PaintTitle(IRenderEngine* const pEngine);
         bool _isInHoveredInterval(til::point coordTarget) const noexcept;
         void _updateCursorInfo();
-        void _invalidateCurrentCursor() const;
-        void _invalidateOldComposition() const;
+        void _invalidateCurrentCursor();
+        void _invalidateOldComposition();
         void _prepareNewComposition();
         [[nodiscard]] HRESULT _PrepareRenderInfo(_In_ IRenderEngine* const pEngine);
 
@@ -122,6 +209,23 @@ namespace Microsoft::Console::Render
         std::array<IRenderEngine*, 2> _engines{};
         IRenderData* _pData = nullptr; // Non-ownership pointer
         std::unique_ptr<RenderThread> _pThread;
+        wil::srwlock _invalidationLock;
+        std::vector<DeferredInvalidation> _deferredInvalidations;
+        std::vector<DeferredInvalidation> _flushedInvalidations;
+        // The RenderThread::clock::time_point at which the oldest of the _deferredInvalidations was queued, or 0 if there are none.
+        // Synchronized output doesn't hold back frames for longer than s_synchronizedOutputTimeout past this point.
+        std::atomic<RenderThread::clock::rep> _deferredInvalidationsSince{ 0 };
+        // Protects the engines against concurrent use while a frame is painted. It may be acquired
+        // while holding the console lock, but the console lock must never be acquired while holding it.
+        wil::srwlock _engineLock;
+        FrameSnapshot _frame;
+        // The ROW::ContentHash() of each viewport row as it was last copied into _frame and thus presented,
+        // or 0 if unknown. Region invalidations of rows whose hash didn't change are dropped.
+        std::vector<size_t> _presentedRowHashes;
+        til::inclusive_rect _presentedRowHashesViewport;
+        std::vector<til::rect> _changedRowRects;
+        size_t _skippedRows = 0;
+        FrameRowStats _lastFrameRowStats;
         static constexpr size_t _firstSoftFontChar = 0xEF20;
         size_t _lastSoftFontChar = 0;
         uint16_t _hyperlinkHoveredId = 0;
@@ -14,6 +14,8 @@ RenderThread::RenderThread() :
     _pRenderer(nullptr),
     _hThread(nullptr),
     _hEvent(nullptr),
+    _hInputEvent(nullptr),
+    _hSynchronizedOutputEvent(nullptr),
     _hPaintCompletedEvent(nullptr),
     _fKeepRunning(true),
     _hPaintEnabledEvent(nullptr),
@@ -40,6 +42,18 @@ RenderThread::~RenderThread()
         _hEvent = nullptr;
     }
 
+    if (_hInputEvent)
+    {
+        CloseHandle(_hInputEvent);
+        _hInputEvent = nullptr;
+    }
+
+    if (_hSynchronizedOutputEvent)
+    {
+        CloseHandle(_hSynchronizedOutputEvent);
+        _hSynchronizedOutputEvent = nullptr;
+    }
+
     if (_hPaintEnabledEvent)
     {
         CloseHandle(_hPaintEnabledEvent);
@@ -86,6 +100,40 @@ RenderThread::~RenderThread()
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        auto hInputEvent = CreateEventW(nullptr,
+                                        FALSE, // auto reset event
+                                        FALSE, // initially unsignaled
+                                        nullptr);
+
+        if (hInputEvent == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hInputEvent = hInputEvent;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        auto hSynchronizedOutputEvent = CreateEventW(nullptr,
+                                                     FALSE, // auto reset event
+                                                     FALSE, // initially unsignaled
+                                                     nullptr);
+
+        if (hSynchronizedOutputEvent == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hSynchronizedOutputEvent = hSynchronizedOutputEvent;
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         auto hPaintEnabledEvent = CreateEventW(nullptr,
@@ -213,14 +261,99 @@ DWORD WINAPI RenderThread::_ThreadProc()
             ResetEvent(_hEvent);
         }
 
+        _WaitForSynchronizedOutput();
+
+        FrameTiming timing;
+        timing.paced = _PaceFrame();
+
+        // The echo of an input event usually arrives a few frames after the input itself, because the application needs to
+        // process it first. Until it was painted, _inputTime is left untouched, so that _PaceFrame() doesn't postpone it.
+        // The output is written into the buffer before NotifyOutput() is called, so if _inputEchoed is set
+        // at this point, the echo is guaranteed to be part of this frame.
+        const auto echoed = _inputEchoed.exchange(false, std::memory_order_acq_rel);
+        const auto inputTime = _inputTime.load(std::memory_order_acquire);
+        timing.ingestedBytes = _ingestedBytes.exchange(0, std::memory_order_relaxed);
+        _lastPaint = clock::now();
+
         ResetEvent(_hPaintCompletedEvent);
         LOG_IF_FAILED(_pRenderer->PaintFrame());
         SetEvent(_hPaintCompletedEvent);
+
+        const auto now = clock::now();
+        if (inputTime != 0)
+        {
+            const auto latency = now - clock::time_point{ clock::duration{ inputTime } };
+            if (echoed || latency >= s_inputEchoTimeout)
+            {
+                // NotifyInput() doesn't overwrite a pending _inputTime, so this only fails if
+                // it got reset in the meantime, which only this thread does.
+                auto expected = inputTime;
+                _inputTime.compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+                if (echoed)
+                {
+                    timing.inputLatency = std::chrono::duration_cast<std::chrono::microseconds>(latency);
+                }
+            }
+        }
+
+        if (_pfnFrameTiming)
+        {
+            const auto rowStats = _pRenderer->GetLastFrameRowStats();
+            timing.paint = std::chrono::duration_cast<std::chrono::microseconds>(now - _lastPaint);
+            timing.paintedRows = rowStats.painted;
+            timing.skippedRows = rowStats.skipped;
+            _pfnFrameTiming(timing);
+        }
     }
 
     return S_OK;
 }
 
+// Method Description:
+// - Postpones the next frame while a lot of output is being written, so that we don't
+//   take the console lock away from the VT parser more often than the maximum frame rate.
+// - Input events end the wait immediately, because typing should feel responsive.
+// Arguments:
+// - <none>
+// Return Value:
+// - How long the frame was postponed.
+std::chrono::microseconds RenderThread::_PaceFrame() noexcept
+{
+    const std::chrono::microseconds interval{ _minFrameIntervalUs.load(std::memory_order_relaxed) };
+    if (interval.count() <= 0)
+    {
+        return {};
+    }
+
+    // Reset the event before checking _inputTime, so that an input event
+    // that arrives after the check is guaranteed to wake us up.
+    ResetEvent(_hInputEvent);
+    if (_inputTime.load(std::memory_order_acquire) != 0)
+    {
+        return {};
+    }
+
+    const auto beg = clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(beg - _lastPaint);
+    if (elapsed >= interval)
+    {
+        return {};
+    }
+
+    const auto bytes = _ingestedBytes.load(std::memory_order_relaxed);
+    if (bytes * 1'000'000 < s_floodBytesPerSecond * gsl::narrow_cast<size_t>(std::max<int64_t>(1, elapsed.count())))
+    {
+        return {};
+    }
+
+    // _hEvent is signaled by the destructor, in which case we shouldn't delay the final frame.
+    const HANDLE events[]{ _hInputEvent, _hEvent };
+    const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(interval - elapsed);
+    WaitForMultipleObjects(2, &events[0], FALSE, gsl::narrow_cast<DWORD>(timeout.count()));
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - beg);
+}
+
 void RenderThread::NotifyPaint() noexcept
 {
     if (_fWaiting.load(std::memory_order_acquire))
@@ -233,6 +366,137 @@ void RenderThread::NotifyPaint() noexcept
     }
 }
 
+// Method Description:
+// - Holds back the next frame while the application is in the middle of a synchronized update
+//   (DECSET 2026), so that it isn't presented half-drawn. Gives up after s_synchronizedOutputTimeout,
+//   measured from the start of the update or from when the oldest held-back invalidation was queued,
+//   whichever is earlier. The latter ensures that applications which start a new update right after
+//   finishing the previous one can't hold back frames indefinitely.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RenderThread::_WaitForSynchronizedOutput() noexcept
+{
+    for (;;)
+    {
+        const auto deadline = _synchronizedOutputDeadline.load(std::memory_order_acquire);
+        if (deadline == 0)
+        {
+            return;
+        }
+
+        auto end = clock::time_point{ clock::duration{ deadline } };
+        if (const auto since = _pRenderer->GetDeferredInvalidationsSince(); since != 0)
+        {
+            end = std::min(end, clock::time_point{ clock::duration{ since } } + s_synchronizedOutputTimeout);
+        }
+
+        const auto remaining = end - clock::now();
+        if (remaining <= clock::duration::zero())
+        {
+            return;
+        }
+
+        // _hEvent is signaled by the destructor, in which case we shouldn't delay the final frame.
+        const HANDLE events[]{ _hSynchronizedOutputEvent, _hEvent };
+        const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(remaining);
+        if (WaitForMultipleObjects(2, &events[0], FALSE, gsl::narrow_cast<DWORD>(timeout.count())) == WAIT_OBJECT_0 + 1)
+        {
+            return;
+        }
+    }
+}
+
+// Method Description:
+// - Called for keyboard and other user input, so that the frames up to its echo aren't
+//   postponed by _PaceFrame() and its latency can be reported to the frame timing callback.
+void RenderThread::NotifyInput() noexcept
+{
+    clock::rep expected = 0;
+    if (_inputTime.compare_exchange_strong(expected, clock::now().time_since_epoch().count(), std::memory_order_acq_rel))
+    {
+        // Output that was written while the previous input's echo got painted doesn't count.
+        _inputConsumed.store(false, std::memory_order_release);
+        _inputEchoed.store(false, std::memory_order_release);
+    }
+    SetEvent(_hInputEvent);
+}
+
+// Method Description:
+// - Called when the application read input from the input buffer. Output that follows is
+//   considered to be the echo of the pending input (see NotifyOutput() and _ThreadProc()).
+void RenderThread::NotifyInputConsumed() noexcept
+{
+    if (_inputTime.load(std::memory_order_acquire) != 0)
+    {
+        _inputConsumed.store(true, std::memory_order_release);
+    }
+}
+
+// Method Description:
+// - Called with the amount of text the application wrote, after it was written into the buffer.
+//   This is what _PaceFrame() uses to decide whether to limit the frame rate.
+//   Output that follows the consumption of an input event is considered to be its echo (see _ThreadProc()).
+//   Other output, like a flood that was already underway, doesn't end the input bypass.
+// Arguments:
+// - bytes: The size of the written text in bytes of UTF-16.
+void RenderThread::NotifyOutput(const size_t bytes) noexcept
+{
+    _ingestedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (_inputConsumed.load(std::memory_order_acquire) && _inputTime.load(std::memory_order_acquire) != 0)
+    {
+        _inputEchoed.store(true, std::memory_order_release);
+    }
+}
+
+// Method Description:
+// - Sets the frame rate that frames are limited to while a lot of output is being written.
+// Arguments:
+// - framesPerSecond: The maximum frame rate, or 0 to paint as fast as possible.
+void RenderThread::SetMaximumFrameRate(const uint32_t framesPerSecond) noexcept
+{
+    _minFrameIntervalUs.store(framesPerSecond ? 1'000'000 / framesPerSecond : 0, std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Enables or disables synchronized output (DECSET 2026). See _WaitForSynchronizedOutput().
+// Arguments:
+// - enabled: true if the application started an update, false if it finished it.
+void RenderThread::SetSynchronizedOutput(const bool enabled) noexcept
+{
+    if (enabled)
+    {
+        // Setting the mode again while it's already set doesn't extend the deadline,
+        // or an application could hold back frames forever by repeating DECSET 2026.
+        clock::rep expected = 0;
+        _synchronizedOutputDeadline.compare_exchange_strong(expected, (clock::now() + s_synchronizedOutputTimeout).time_since_epoch().count(), std::memory_order_acq_rel);
+    }
+    else
+    {
+        _synchronizedOutputDeadline.store(0, std::memory_order_release);
+        SetEvent(_hSynchronizedOutputEvent);
+    }
+}
+
+// Method Description:
+// - Returns whether an application is in the middle of a synchronized update that hasn't timed out yet.
+// - _WaitForSynchronizedOutput() checks this without holding the console lock, so the renderer checks again
+//   while holding it, because the application may have started another update in the meantime.
+bool RenderThread::IsSynchronizedOutputActive() const noexcept
+{
+    const auto deadline = _synchronizedOutputDeadline.load(std::memory_order_acquire);
+    return deadline != 0 && clock::now() < clock::time_point{ clock::duration{ deadline } };
+}
+
+// Method Description:
+// - Sets a callback that receives the timings of each frame on the render thread.
+// - Must be called before painting is enabled.
+void RenderThread::SetFrameTimingCallback(std::function<void(const FrameTiming&)> pfn)
+{
+    _pfnFrameTiming = std::move(pfn);
+}
+
 void RenderThread::EnablePainting() noexcept
 {
     SetEvent(_hPaintEnabledEvent);
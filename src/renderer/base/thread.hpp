@@ -14,29 +14,68 @@ Author(s):
 
 #pragma once
 
+#include <chrono>
+
 namespace Microsoft::Console::Render
 {
     class Renderer;
 
+    // Timings of a single frame, as reported to the callback given to RenderThread::SetFrameTimingCallback().
+    struct FrameTiming
+    {
+        // How long the frame was postponed to let more output accumulate.
+        std::chrono::microseconds paced{};
+        // How long PaintFrame() took.
+        std::chrono::microseconds paint{};
+        // The time from the oldest input event until the first frame that contains output written after it, or 0 if there was none.
+        std::chrono::microseconds inputLatency{};
+        // The amount of text that was written since the previous frame, in bytes of UTF-16.
+        size_t ingestedBytes = 0;
+        // How many rows the frame painted and how many invalidated rows it skipped, because they didn't change.
+        size_t paintedRows = 0;
+        size_t skippedRows = 0;
+    };
+
     class RenderThread
     {
     public:
+        using clock = std::chrono::steady_clock;
+
+        // Synchronized output can't hold back frames for longer than this, in case the application never ends its update.
+        static constexpr std::chrono::milliseconds s_synchronizedOutputTimeout{ 150 };
+
         RenderThread();
         ~RenderThread();
 
         [[nodiscard]] HRESULT Initialize(Renderer* const pRendererParent) noexcept;
 
         void NotifyPaint() noexcept;
+        void NotifyInput() noexcept;
+        void NotifyInputConsumed() noexcept;
+        void NotifyOutput(size_t bytes) noexcept;
+        void SetMaximumFrameRate(uint32_t framesPerSecond) noexcept;
+        void SetSynchronizedOutput(bool enabled) noexcept;
+        bool IsSynchronizedOutputActive() const noexcept;
+        void SetFrameTimingCallback(std::function<void(const FrameTiming&)> pfn);
         void EnablePainting() noexcept;
         void DisablePainting() noexcept;
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) noexcept;
 
     private:
+        // While more than this much text is written per second, frames are limited to the maximum frame rate.
+        static constexpr size_t s_floodBytesPerSecond = 1024 * 1024;
+        // Input that didn't produce any output within this time is assumed to not have an echo.
+        static constexpr std::chrono::milliseconds s_inputEchoTimeout{ 500 };
+
         static DWORD WINAPI s_ThreadProc(_In_ LPVOID lpParameter);
         DWORD WINAPI _ThreadProc();
+        std::chrono::microseconds _PaceFrame() noexcept;
+        void _WaitForSynchronizedOutput() noexcept;
 
         HANDLE _hThread;
         HANDLE _hEvent;
+        HANDLE _hInputEvent;
+        HANDLE _hSynchronizedOutputEvent;
 
         HANDLE _hPaintEnabledEvent;
         HANDLE _hPaintCompletedEvent;
@@ -46,5 +85,19 @@ namespace Microsoft::Console::Render
         bool _fKeepRunning;
         std::atomic<bool> _fNextFrameRequested;
         std::atomic<bool> _fWaiting;
+
+        // The clock::time_point of the oldest input event whose echo wasn't painted yet, or 0 if there is none.
+        std::atomic<clock::rep> _inputTime{ 0 };
+        // Set once the application read the input at _inputTime. Only output after that can be its echo,
+        // since output that the application wrote before it even saw the input can't be a reaction to it.
+        std::atomic<bool> _inputConsumed{ false };
+        // Set once output was written after the input at _inputTime was consumed, which is presumably its echo.
+        std::atomic<bool> _inputEchoed{ false };
+        std::atomic<size_t> _ingestedBytes{ 0 };
+        std::atomic<int64_t> _minFrameIntervalUs{ 1'000'000 / 60 };
+        // The clock::time_point at which synchronized output times out, or 0 if it's disabled.
+        std::atomic<clock::rep> _synchronizedOutputDeadline{ 0 };
+        clock::time_point _lastPaint;
+        std::function<void(const FrameTiming&)> _pfnFrameTiming;
     };
 }
@@ -12,6 +12,7 @@ Abstract:
 #pragma once
 
 #include "../../buffer/out/TextAttribute.hpp"
+#include "../../types/inc/ColorFix.hpp"
 
 namespace Microsoft::Console::Render
 {
@@ -29,6 +30,8 @@ namespace Microsoft::Console::Render
         };
 
         RenderSettings() noexcept;
+        void CopyFrom(const RenderSettings& other) noexcept;
+        void EnablePerceivableColorCache();
         void SaveDefaultSettings() noexcept;
         void RestoreDefaultSettings() noexcept;
         void SetRenderMode(const Mode mode, const bool enabled) noexcept;
@@ -45,15 +48,21 @@ namespace Microsoft::Console::Render
         std::pair<COLORREF, COLORREF> GetAttributeColorsWithAlpha(const TextAttribute& attr) const noexcept;
         COLORREF GetAttributeUnderlineColor(const TextAttribute& attr) const noexcept;
         void ToggleBlinkRendition(class Renderer* renderer) noexcept;
+        bool IsBlinkInUse() const noexcept;
+        void MarkBlinkInUse() const noexcept;
 
     private:
+        COLORREF _getPerceivableColor(COLORREF color, COLORREF reference) const noexcept;
+
         til::enumset<Mode> _renderMode{ Mode::BlinkAllowed, Mode::IntenseIsBright };
         std::array<COLORREF, TextColor::TABLE_SIZE> _colorTable;
         std::array<size_t, static_cast<size_t>(ColorAlias::ENUM_COUNT)> _colorAliasIndices;
         std::array<COLORREF, TextColor::TABLE_SIZE> _defaultColorTable;
         std::array<size_t, static_cast<size_t>(ColorAlias::ENUM_COUNT)> _defaultColorAliasIndices;
+        // Only the renderer's own copy has a cache, since the live settings are read by multiple threads.
+        std::unique_ptr<ColorFix::PerceivableColorCache> _perceivableColorCache;
         size_t _blinkCycle = 0;
-        mutable bool _blinkIsInUse = false;
+        mutable std::atomic<bool> _blinkIsInUse{ false };
         bool _blinkShouldBeFaint = false;
     };
 }
@@ -175,23 +175,26 @@ bool FontBuffer::SetStartChar(const VTParameter startChar,
     return true;
 }
 
-void FontBuffer::AddSixelData(const wchar_t ch)
+void FontBuffer::AddSixelData(const std::wstring_view string)
 {
-    if (!_charsetIdInitialized)
-    {
-        _buildCharsetId(ch);
-    }
-    else if (ch >= L'?' && ch <= L'~')
-    {
-        _addSixelValue(ch - L'?');
-    }
-    else if (ch == L'/')
-    {
-        _endOfSixelLine();
-    }
-    else if (ch == L';')
+    for (const auto ch : string)
     {
-        _endOfCharacter();
+        if (!_charsetIdInitialized)
+        {
+            _buildCharsetId(ch);
+        }
+        else if (ch >= L'?' && ch <= L'~')
+        {
+            _addSixelValue(ch - L'?');
+        }
+        else if (ch == L'/')
+        {
+            _endOfSixelLine();
+        }
+        else if (ch == L';')
+        {
+            _endOfCharacter();
+        }
     }
 }
 
@@ -113,7 +113,19 @@ bool MacroBuffer::InitParser(const size_t macroId, const DispatchTypes::MacroDel
     return false;
 }
 
-bool MacroBuffer::ParseDefinition(const wchar_t ch)
+bool MacroBuffer::ParseDefinition(const std::wstring_view string)
+{
+    for (const auto ch : string)
+    {
+        if (!_parseDefinitionChar(ch))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MacroBuffer::_parseDefinitionChar(const wchar_t ch)
 {
     // Once we receive an ESC, that marks the end of the definition, but if
     // an unterminated repeat is still pending, we should apply that now.
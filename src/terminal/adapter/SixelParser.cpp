@@ -80,7 +80,7 @@ void SixelParser::SetDisplayMode(const bool enabled) noexcept
     }
 }
 
-std::function<bool(wchar_t)> SixelParser::DefineImage(const VTInt macroParameter, const DispatchTypes::SixelBackground backgroundSelect, const VTParameter backgroundColor)
+std::function<bool(const std::wstring_view)> SixelParser::DefineImage(const VTInt macroParameter, const DispatchTypes::SixelBackground backgroundSelect, const VTParameter backgroundColor)
 {
     if (_initTextBufferBoundaries())
     {
@@ -89,8 +89,8 @@ std::function<bool(wchar_t)> SixelParser::DefineImage(const VTInt macroParameter
         _initImageBuffer();
         _state = States::Normal;
         _parameters.clear();
-        return [&](const auto ch) {
-            _parseCommandChar(ch);
+        return [&](const std::wstring_view string) {
+            _parseCommandString(string);
             return true;
         };
     }
@@ -100,6 +100,18 @@ std::function<bool(wchar_t)> SixelParser::DefineImage(const VTInt macroParameter
     }
 }
 
+void SixelParser::_parseCommandString(const std::wstring_view string)
+{
+    // The state machine hands us the data in runs, so it can only tell us
+    // whether the last character of a run is the last one in the packet.
+    const auto lastCharacterOfPacket = _stateMachine.IsProcessingLastCharacter();
+    for (size_t i = 0; i < string.size(); i++)
+    {
+        _processingLastCharacter = lastCharacterOfPacket && i + 1 == string.size();
+        _parseCommandChar(til::at(string, i));
+    }
+}
+
 void SixelParser::_parseCommandChar(const wchar_t ch)
 {
     // Characters in the range `?` to `~` encode a sixel value, which is a group
@@ -352,6 +364,9 @@ void SixelParser::_updateRasterAttributes(const VTParameters& rasterAttributes)
     const auto xAspect = rasterAttributes.at(1).value_or(0);
     if (xAspect > 0)
     {
+        // Any pending sixels need to be committed with the old aspect ratio.
+        _commitImageBand();
+
         // The documentation suggests the aspect ratio is rounded to the nearest
         // integer, but on the original VT340 hardware it was rounded up.
         _pixelAspectRatio = std::clamp(static_cast<int>(std::ceil(yAspect * 1.0 / xAspect)), 1, _maxPixelAspectRatio);
@@ -538,7 +553,7 @@ void SixelParser::_defineColor(const size_t colorNumber, const COLORREF color)
         // If some image content has already been defined at this point, and
         // we're processing the last character in the packet, this is likely an
         // attempt to animate the palette, so we should flush the image.
-        if (_imageWidth > 0 && _stateMachine.IsProcessingLastCharacter())
+        if (_imageWidth > 0 && _processingLastCharacter)
         {
             _maybeFlushImageBuffer();
         }
@@ -620,12 +635,18 @@ void SixelParser::_updateTextColors()
 
 void SixelParser::_initImageBuffer()
 {
+    static constexpr auto transparentPixel = IndexedPixel{ .transparent = true };
+    static constexpr auto transparentColumn = BandColumn{ transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel };
     _imageBuffer.clear();
+    _imageBufferOffset = 0;
     _imageOriginCell = _textCursor;
     _imageCursor = {};
     _imageWidth = 0;
     _imageMaxWidth = _availablePixelWidth;
     _imageLineCount = 0;
+    _imageBand.resize(_imageMaxWidth);
+    std::ranges::fill(_imageBand, transparentColumn);
+    _imageBandWidth = 0;
     _resizeImageBuffer(_sixelHeight);
 
     _lastFlushLine = 0;
@@ -642,8 +663,8 @@ void SixelParser::_initImageBuffer()
 
 void SixelParser::_resizeImageBuffer(const til::CoordType requiredHeight)
 {
-    const auto requiredSize = (_imageCursor.y + requiredHeight) * _imageMaxWidth;
-    if (static_cast<size_t>(requiredSize) > _imageBuffer.size())
+    const auto requiredSize = _imageBufferOffset + static_cast<size_t>((_imageCursor.y + requiredHeight) * _imageMaxWidth);
+    if (requiredSize > _imageBuffer.size())
     {
         static constexpr auto transparentPixel = IndexedPixel{ .transparent = true };
         _imageBuffer.resize(requiredSize, transparentPixel);
@@ -665,7 +686,7 @@ void SixelParser::_fillImageBackground()
         // none were given, up to the page boundaries). The actual image output
         // isn't limited by the background dimensions though.
         static constexpr auto backgroundPixel = IndexedPixel{};
-        const auto backgroundOffset = _imageCursor.y * _imageMaxWidth;
+        const auto backgroundOffset = _imageBufferOffset + _imageCursor.y * _imageMaxWidth;
         auto dst = std::next(_imageBuffer.begin(), backgroundOffset);
         for (auto i = 0; i < backgroundHeight; i++)
         {
@@ -677,7 +698,11 @@ void SixelParser::_fillImageBackground()
     }
 }
 
-void SixelParser::_writeToImageBuffer(int sixelValue, int repeatCount)
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+void SixelParser::_writeToImageBuffer(const int sixelValue, int repeatCount)
 {
     // On terminals that support the raster attributes command (which sets the
     // background size), the background is only drawn when the first sixel value
@@ -685,41 +710,154 @@ void SixelParser::_writeToImageBuffer(int sixelValue, int repeatCount)
     _fillImageBackground();
 
     // Then we need to render the 6 vertical pixels that are represented by the
-    // bits in the sixel value. Although note that each of these sixel pixels
-    // may cover more than one device pixel, depending on the aspect ratio.
-    const auto targetOffset = _imageCursor.y * _imageMaxWidth + _imageCursor.x;
-    auto imageBufferPtr = std::next(_imageBuffer.data(), targetOffset);
+    // bits in the sixel value. These are written to the band buffer, where the
+    // pixels of a column are contiguous, so each bit of the sixel value simply
+    // selects one of the first 6 lanes of the column. The aspect ratio is only
+    // applied once the band is committed to the image buffer.
     repeatCount = std::min(repeatCount, _imageMaxWidth - _imageCursor.x);
-    for (auto i = 0; i < 6; i++)
+    auto column = _imageBand.data() + _imageCursor.x;
+    const auto columnEnd = column + std::max(repeatCount, 0);
+
+#if defined(TIL_SSE_INTRINSICS)
+    static_assert(sizeof(BandColumn) == sizeof(__m128i));
+    const auto bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    const auto mask = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(gsl::narrow_cast<short>(sixelValue)), bits), bits);
+    const auto pixels = _mm_and_si128(mask, _mm_set1_epi16(std::bit_cast<short>(_foregroundPixel)));
+    for (; column < columnEnd; ++column)
     {
-        if (sixelValue & 1)
+        const auto ptr = reinterpret_cast<__m128i*>(column->data());
+        _mm_storeu_si128(ptr, _mm_or_si128(_mm_andnot_si128(mask, _mm_loadu_si128(ptr)), pixels));
+    }
+#else
+    for (; column < columnEnd; ++column)
+    {
+        for (auto i = 0; i < 6; i++)
         {
-            auto repeatAspectRatio = _pixelAspectRatio;
-            do
+            if (sixelValue & (1 << i))
             {
-                std::fill_n(imageBufferPtr, repeatCount, _foregroundPixel);
-                std::advance(imageBufferPtr, _imageMaxWidth);
-            } while (--repeatAspectRatio > 0);
+                til::at(*column, i) = _foregroundPixel;
+            }
         }
-        else
+    }
+#endif
+
+    _imageCursor.x += repeatCount;
+    _imageBandWidth = std::max(_imageBandWidth, _imageCursor.x);
+}
+
+void SixelParser::_commitImageBand()
+{
+    if (_imageBandWidth <= 0)
+    {
+        return;
+    }
+
+    // The band could have been written after the image buffer was cleared by
+    // an erase, so we need to be certain that there's space for it.
+    _resizeImageBuffer(_sixelHeight);
+
+    // We need to transpose the columns of the band into the rows of the image
+    // buffer, repeating each row to match the pixel aspect ratio. Only opaque
+    // pixels are copied, since anything else would erase the background.
+    static constexpr auto transparentPixel = IndexedPixel{ .transparent = true };
+    static constexpr auto transparentColumn = BandColumn{ transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel, transparentPixel };
+    const auto bandWidth = _imageBandWidth;
+    const auto src = _imageBand.data();
+    auto dst = _imageBuffer.data() + _imageBufferOffset + _imageCursor.y * _imageMaxWidth;
+    auto x = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+    // This processes 8 columns at a time with an 8x8 transpose of 16-bit lanes.
+    // Only the first 6 rows of the result are needed.
+    for (; x + 8 <= bandWidth; x += 8)
+    {
+        const auto c = reinterpret_cast<const __m128i*>(src + x);
+        const auto a0 = _mm_unpacklo_epi16(_mm_loadu_si128(c + 0), _mm_loadu_si128(c + 1));
+        const auto a1 = _mm_unpackhi_epi16(_mm_loadu_si128(c + 0), _mm_loadu_si128(c + 1));
+        const auto a2 = _mm_unpacklo_epi16(_mm_loadu_si128(c + 2), _mm_loadu_si128(c + 3));
+        const auto a3 = _mm_unpackhi_epi16(_mm_loadu_si128(c + 2), _mm_loadu_si128(c + 3));
+        const auto a4 = _mm_unpacklo_epi16(_mm_loadu_si128(c + 4), _mm_loadu_si128(c + 5));
+        const auto a5 = _mm_unpackhi_epi16(_mm_loadu_si128(c + 4), _mm_loadu_si128(c + 5));
+        const auto a6 = _mm_unpacklo_epi16(_mm_loadu_si128(c + 6), _mm_loadu_si128(c + 7));
+        const auto a7 = _mm_unpackhi_epi16(_mm_loadu_si128(c + 6), _mm_loadu_si128(c + 7));
+        const auto b0 = _mm_unpacklo_epi32(a0, a2);
+        const auto b1 = _mm_unpackhi_epi32(a0, a2);
+        const auto b2 = _mm_unpacklo_epi32(a1, a3);
+        const auto b4 = _mm_unpacklo_epi32(a4, a6);
+        const auto b5 = _mm_unpackhi_epi32(a4, a6);
+        const auto b6 = _mm_unpacklo_epi32(a5, a7);
+        const std::array<__m128i, 6> rows{
+            _mm_unpacklo_epi64(b0, b4),
+            _mm_unpackhi_epi64(b0, b4),
+            _mm_unpacklo_epi64(b1, b5),
+            _mm_unpackhi_epi64(b1, b5),
+            _mm_unpacklo_epi64(b2, b6),
+            _mm_unpackhi_epi64(b2, b6),
+        };
+
+        auto rowPtr = dst + x;
+        for (const auto& row : rows)
         {
-            std::advance(imageBufferPtr, _imageMaxWidth * _pixelAspectRatio);
+            // The low byte of each pixel is the transparent flag.
+            const auto opaque = _mm_cmpeq_epi16(_mm_and_si128(row, _mm_set1_epi16(0xff)), _mm_setzero_si128());
+            const auto pixels = _mm_and_si128(opaque, row);
+            for (auto i = 0; i < _pixelAspectRatio; i++)
+            {
+                const auto ptr = reinterpret_cast<__m128i*>(rowPtr);
+                _mm_storeu_si128(ptr, _mm_or_si128(_mm_andnot_si128(opaque, _mm_loadu_si128(ptr)), pixels));
+                rowPtr += _imageMaxWidth;
+            }
         }
-        sixelValue >>= 1;
     }
-    _imageCursor.x += repeatCount;
+#endif
+
+    for (auto i = 0; i < 6; i++)
+    {
+        for (auto repeatAspectRatio = 0; repeatAspectRatio < _pixelAspectRatio; repeatAspectRatio++)
+        {
+            const auto row = dst + (i * _pixelAspectRatio + repeatAspectRatio) * _imageMaxWidth;
+            for (auto column = x; column < bandWidth; column++)
+            {
+                const auto& pixel = til::at(src[column], i);
+                if (!pixel.transparent)
+                {
+                    row[column] = pixel;
+                }
+            }
+        }
+    }
+
+    std::fill_n(_imageBand.begin(), bandWidth, transparentColumn);
+    _imageBandWidth = 0;
 }
 
-void SixelParser::_eraseImageBufferRows(const int rowCount, const til::CoordType rowOffset) noexcept
+#pragma warning(pop)
+
+void SixelParser::_eraseImageBufferRows(const int rowCount, const til::CoordType rowOffset)
 {
     const auto pixelCount = rowCount * _cellSize.height;
-    const auto bufferOffset = rowOffset * _cellSize.height * _imageMaxWidth;
-    const auto bufferOffsetEnd = bufferOffset + pixelCount * _imageMaxWidth;
-    if (static_cast<size_t>(bufferOffsetEnd) >= _imageBuffer.size()) [[unlikely]]
+    const auto bufferOffset = _imageBufferOffset + static_cast<size_t>(rowOffset * _cellSize.height * _imageMaxWidth);
+    const auto bufferOffsetEnd = bufferOffset + static_cast<size_t>(pixelCount * _imageMaxWidth);
+    if (bufferOffsetEnd >= _imageBuffer.size()) [[unlikely]]
     {
         _imageBuffer.clear();
+        _imageBufferOffset = 0;
         _imageCursor.y = 0;
     }
+    else if (rowOffset == 0)
+    {
+        // Erasing from the top is the common case when an image scrolls off
+        // the page, so we just skip over those rows. Once they make up half
+        // the buffer, we reclaim the space, which amortizes the cost of the
+        // move across all the rows that were erased.
+        _imageBufferOffset = bufferOffsetEnd;
+        if (_imageBufferOffset * 2 >= _imageBuffer.size())
+        {
+            _imageBuffer.erase(_imageBuffer.begin(), _imageBuffer.begin() + _imageBufferOffset);
+            _imageBufferOffset = 0;
+        }
+        _imageCursor.y -= pixelCount;
+    }
     else
     {
         _imageBuffer.erase(_imageBuffer.begin() + bufferOffset, _imageBuffer.begin() + bufferOffsetEnd);
@@ -729,6 +867,10 @@ void SixelParser::_eraseImageBufferRows(const int rowCount, const til::CoordType
 
 void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
 {
+    // Any sixels still pending in the band need to be in the image buffer
+    // before we can output it, or move the cursor to another band.
+    _commitImageBand();
+
     // Regardless of whether we flush the image or not, we always calculate how
     // much we need to scroll in advance. This algorithm is a bit odd. If there
     // isn't enough space for the current segment, it'll scroll until it can fit
@@ -761,7 +903,7 @@ void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
     const auto currentTime = steady_clock::now();
     const auto timeSinceLastFlush = duration_cast<milliseconds>(currentTime - _lastFlushTime);
     const auto linesSinceLastFlush = _imageLineCount - _lastFlushLine;
-    if (endOfSequence || timeSinceLastFlush > 500ms || (linesSinceLastFlush <= 1 && _stateMachine.IsProcessingLastCharacter()))
+    if (endOfSequence || timeSinceLastFlush > 500ms || (linesSinceLastFlush <= 1 && _processingLastCharacter))
     {
         _lastFlushTime = currentTime;
         _lastFlushLine = _imageLineCount;
@@ -782,7 +924,7 @@ void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
             const auto columnBegin = _imageOriginCell.x;
             const auto columnEnd = _imageOriginCell.x + (_imageWidth + _cellSize.width - 1) / _cellSize.width;
             auto rowOffset = _imageOriginCell.y;
-            auto srcIterator = _imageBuffer.begin();
+            auto srcIterator = std::next(_imageBuffer.begin(), _imageBufferOffset);
             while (srcIterator < _imageBuffer.end() && rowOffset < page.Bottom())
             {
                 if (rowOffset >= 0)
@@ -34,7 +34,7 @@ namespace Microsoft::Console::VirtualTerminal
         SixelParser(AdaptDispatch& dispatcher, const StateMachine& stateMachine, const VTInt conformanceLevel = DefaultConformance) noexcept;
         void SoftReset();
         void SetDisplayMode(const bool enabled) noexcept;
-        std::function<bool(wchar_t)> DefineImage(const VTInt macroParameter, const DispatchTypes::SixelBackground backgroundSelect, const VTParameter backgroundColor);
+        std::function<bool(const std::wstring_view)> DefineImage(const VTInt macroParameter, const DispatchTypes::SixelBackground backgroundSelect, const VTParameter backgroundColor);
 
     private:
         // NB: If we want to support more than 256 colors, we'll also need to
@@ -51,7 +51,9 @@ namespace Microsoft::Console::VirtualTerminal
         AdaptDispatch& _dispatcher;
         const StateMachine& _stateMachine;
         const VTInt _conformanceLevel;
+        bool _processingLastCharacter = false;
 
+        void _parseCommandString(const std::wstring_view string);
         void _parseCommandChar(const wchar_t ch);
         void _parseParameterChar(const wchar_t ch);
         int _applyPendingCommand();
@@ -110,10 +112,23 @@ namespace Microsoft::Console::VirtualTerminal
         void _resizeImageBuffer(const til::CoordType requiredHeight);
         void _fillImageBackground();
         void _writeToImageBuffer(const int sixelValue, const int repeatCount);
-        void _eraseImageBufferRows(const int rowCount, const til::CoordType startRow = 0) noexcept;
+        void _commitImageBand();
+        void _eraseImageBufferRows(const int rowCount, const til::CoordType startRow = 0);
         void _maybeFlushImageBuffer(const bool endOfSequence = false);
 
+        // Sixels are first written to a band buffer which holds the 6 pixels
+        // of each column next to each other (padded to 8), so a sixel can be
+        // applied with a single masked store. The band is transposed into the
+        // image buffer, scaled by the aspect ratio, once we move off the band.
+        using BandColumn = std::array<IndexedPixel, 8>;
+        std::vector<BandColumn> _imageBand;
+        til::CoordType _imageBandWidth = 0;
+
+        // Rows that are erased from the top of the image buffer are skipped by
+        // advancing _imageBufferOffset, and only reclaimed once they make up
+        // half the buffer. This keeps the cost of scrolling an image constant.
         std::vector<IndexedPixel> _imageBuffer;
+        size_t _imageBufferOffset = 0;
         til::point _imageOriginCell;
         til::point _imageCursor;
         til::CoordType _imageWidth = 0;
@@ -37,6 +37,24 @@ static constexpr std::array<XtermResourceColorTableEntry, 10> XtermResourceColor
     /* 19 */ { -1, -1 },
 } };
 
+// The StringHandler contract delivers DCS data in runs of characters, but the
+// short reports parsed below are simpler to handle one character at a time.
+// This adapts such a parser, stopping at the first character it rejects.
+template<typename T>
+static ITermDispatch::StringHandler perCharacterStringHandler(T&& parser)
+{
+    return [parser = std::forward<T>(parser)](const std::wstring_view string) mutable {
+        for (const auto ch : string)
+        {
+            if (!parser(ch))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+}
+
 AdaptDispatch::AdaptDispatch(ITerminalApi& api, Renderer* renderer, RenderSettings& renderSettings, TerminalInput& terminalInput) noexcept :
     _api{ api },
     _renderer{ renderer },
@@ -1763,6 +1781,23 @@ void AdaptDispatch::_SetColumnMode(const bool enable)
     }
 }
 
+// Routine Description:
+// - Set the synchronized output mode. While it's enabled, the application is in the
+//     middle of an update and the renderer holds back its frames, so that the update
+//     is presented as a whole instead of as a series of partially drawn screens.
+// Arguments:
+// - enable - true to hold back frames, false to present the update.
+// Return Value:
+// - <none>
+void AdaptDispatch::_SetSynchronizedOutputMode(const bool enable)
+{
+    _modes.set(Mode::SynchronizedOutput, enable);
+    if (_renderer)
+    {
+        _renderer->SetSynchronizedOutput(enable);
+    }
+}
+
 // Routine Description:
 // - Set the alternate screen buffer mode. In virtual terminals, there exists
 //     both a "main" screen buffer and an alternate. This mode is used to switch
@@ -1914,6 +1949,9 @@ void AdaptDispatch::_ModeParamsHelper(const DispatchTypes::ModeParams param, con
     case DispatchTypes::ModeParams::XTERM_BracketedPasteMode:
         _api.SetSystemMode(ITerminalApi::Mode::BracketedPaste, enable);
         break;
+    case DispatchTypes::ModeParams::SO_SynchronizedOutput:
+        _SetSynchronizedOutputMode(enable);
+        break;
     case DispatchTypes::ModeParams::GCM_GraphemeClusterMode:
         break;
     case DispatchTypes::ModeParams::W32IM_Win32InputMode:
@@ -2052,6 +2090,9 @@ void AdaptDispatch::RequestMode(const DispatchTypes::ModeParams param)
     case DispatchTypes::ModeParams::XTERM_BracketedPasteMode:
         state = mapTemp(_api.GetSystemMode(ITerminalApi::Mode::BracketedPaste));
         break;
+    case DispatchTypes::ModeParams::SO_SynchronizedOutput:
+        state = mapTemp(_modes.test(Mode::SynchronizedOutput));
+        break;
     case DispatchTypes::ModeParams::GCM_GraphemeClusterMode:
         state = mapPerm(CodepointWidthDetector::Singleton().GetMode() == TextMeasurementMode::Graphemes);
         break;
@@ -3057,6 +3098,9 @@ void AdaptDispatch::HardReset()
     // Reset bracketed paste mode
     _api.SetSystemMode(ITerminalApi::Mode::BracketedPaste, false);
 
+    // Don't leave the renderer waiting for the end of a synchronized update.
+    _SetSynchronizedOutputMode(false);
+
     // Restore cursor blinking mode.
     _pages.ActivePage().Cursor().SetBlinkingAllowed(true);
 
@@ -3814,14 +3858,14 @@ ITermDispatch::StringHandler AdaptDispatch::DownloadDRCS(const VTInt fontNumber,
         return nullptr;
     }
 
-    return [=](const auto ch) {
+    return [=](const std::wstring_view string) {
         // We pass the data string straight through to the font buffer class
         // until we receive an ESC, indicating the end of the string. At that
         // point we can finalize the buffer, and if valid, update the renderer
         // with the constructed bit pattern.
-        if (ch != AsciiChars::ESC)
+        if (string.front() != AsciiChars::ESC)
         {
-            _fontBuffer->AddSixelData(ch);
+            _fontBuffer->AddSixelData(string);
         }
         else if (_fontBuffer->FinalizeSixelData())
         {
@@ -3867,7 +3911,7 @@ void AdaptDispatch::RequestUserPreferenceCharset()
 // - a function to parse the character set ID
 ITermDispatch::StringHandler AdaptDispatch::AssignUserPreferenceCharset(const DispatchTypes::CharsetSize charsetSize)
 {
-    return [this, charsetSize, idBuilder = VTIDBuilder{}](const auto ch) mutable {
+    return perCharacterStringHandler([this, charsetSize, idBuilder = VTIDBuilder{}](const auto ch) mutable {
         if (ch >= L'\x20' && ch <= L'\x2f')
         {
             idBuilder.AddIntermediate(ch);
@@ -3887,7 +3931,7 @@ ITermDispatch::StringHandler AdaptDispatch::AssignUserPreferenceCharset(const Di
             return false;
         }
         return true;
-    };
+    });
 }
 
 // Method Description:
@@ -3910,8 +3954,8 @@ ITermDispatch::StringHandler AdaptDispatch::DefineMacro(const VTInt macroId,
 
     if (_macroBuffer->InitParser(macroId, deleteControl, encoding))
     {
-        return [&](const auto ch) {
-            return _macroBuffer->ParseDefinition(ch);
+        return [&](const std::wstring_view string) {
+            return _macroBuffer->ParseDefinition(string);
         };
     }
 
@@ -4031,7 +4075,7 @@ void AdaptDispatch::_ReportColorTable(const DispatchTypes::ColorModel colorModel
 // - a function to parse the report data.
 ITermDispatch::StringHandler AdaptDispatch::_RestoreColorTable()
 {
-    return [this, parameter = VTInt{}, parameters = std::vector<VTParameter>{}](const auto ch) mutable {
+    return perCharacterStringHandler([this, parameter = VTInt{}, parameters = std::vector<VTParameter>{}](const auto ch) mutable {
         if (ch >= L'0' && ch <= L'9')
         {
             parameter *= 10;
@@ -4070,7 +4114,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreColorTable()
             parameter = 0;
         }
         return (ch != AsciiChars::ESC);
-    };
+    });
 }
 
 // Method Description:
@@ -4089,7 +4133,7 @@ ITermDispatch::StringHandler AdaptDispatch::RequestSetting()
     // this is the opposite of what is documented in most DEC manuals, which
     // say that 0 is for a valid response, and 1 is for an error. The correct
     // interpretation is documented in the DEC STD 070 reference.
-    return [this, parameter = VTInt{}, idBuilder = VTIDBuilder{}](const auto ch) mutable {
+    return perCharacterStringHandler([this, parameter = VTInt{}, idBuilder = VTIDBuilder{}](const auto ch) mutable {
         const auto isFinal = ch >= L'\x40' && ch <= L'\x7e';
         if (isFinal)
         {
@@ -4144,7 +4188,7 @@ ITermDispatch::StringHandler AdaptDispatch::RequestSetting()
             }
             return true;
         }
-    };
+    });
 }
 
 // Method Description:
@@ -4491,7 +4535,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreCursorInformation()
         VTParameter row{};
         VTParameter column{};
     };
-    return [&, state = State{}](const auto ch) mutable {
+    return perCharacterStringHandler([&, state = State{}](const auto ch) mutable {
         if (numeric.test(state.field))
         {
             if (ch >= '0' && ch <= '9')
@@ -4611,7 +4655,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreCursorInformation()
             }
         }
         return (ch != AsciiChars::ESC);
-    };
+    });
 }
 
 // Method Description:
@@ -4663,7 +4707,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreTabStops()
     _ClearAllTabStops();
     _InitTabStopsForWidth(width);
 
-    return [this, width, column = size_t{}](const auto ch) mutable {
+    return perCharacterStringHandler([this, width, column = size_t{}](const auto ch) mutable {
         if (ch >= L'0' && ch <= L'9')
         {
             column *= 10;
@@ -4687,7 +4731,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreTabStops()
             return false;
         }
         return (ch != AsciiChars::ESC);
-    };
+    });
 }
 
 void AdaptDispatch::_ReturnCsiResponse(const std::wstring_view response) const
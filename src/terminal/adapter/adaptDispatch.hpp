@@ -198,7 +198,8 @@ namespace Microsoft::Console::VirtualTerminal
             SixelDisplay,
             EraseColor,
             RectangularChangeExtent,
-            PageCursorCoupling
+            PageCursorCoupling,
+            SynchronizedOutput
         };
         enum class ScrollDirection
         {
@@ -270,6 +271,7 @@ namespace Microsoft::Console::VirtualTerminal
 
         void _SetColumnMode(const bool enable);
         void _SetAlternateScreenBufferMode(const bool enable);
+        void _SetSynchronizedOutputMode(const bool enable);
         void _ModeParamsHelper(const DispatchTypes::ModeParams param, const bool enable);
 
         void _ClearSingleTabStop();
@@ -1844,11 +1844,11 @@ public:
     {
         const auto requestSetting = [=](const std::wstring_view settingId = {}) {
             const auto stringHandler = _pDispatch->RequestSetting();
-            for (auto ch : settingId)
+            if (!settingId.empty())
             {
-                stringHandler(ch);
+                stringHandler(settingId);
             }
-            stringHandler(L'\033'); // String terminator
+            stringHandler(L"\033"); // String terminator
         };
 
         Log::Comment(L"Requesting DECSTBM margins (5 to 10).");
@@ -2106,7 +2106,7 @@ public:
         // and DECRQM would not then be applicable.
 
         BEGIN_TEST_METHOD_PROPERTIES()
-            TEST_METHOD_PROPERTY(L"Data:modeNumber", L"{1, 3, 5, 6, 7, 8, 12, 25, 40, 66, 67, 69, 117, 1000, 1002, 1003, 1004, 1005, 1006, 1007, 1049, 2004, 9001}")
+            TEST_METHOD_PROPERTY(L"Data:modeNumber", L"{1, 3, 5, 6, 7, 8, 12, 25, 40, 66, 67, 69, 117, 1000, 1002, 1003, 1004, 1005, 1006, 1007, 1049, 2004, 2026, 9001}")
         END_TEST_METHOD_PROPERTIES()
 
         VTInt modeNumber;
@@ -2137,6 +2137,67 @@ public:
         _testGetSet->ValidateInputEvent(expectedResponse);
     }
 
+    TEST_METHOD(SynchronizedOutputTests)
+    {
+        // The mode is tracked by the RenderThread, which DummyRenderer doesn't have.
+        // One that was never initialized doesn't paint, but it does track the mode.
+        Microsoft::Console::Render::RenderSettings renderSettings;
+        Microsoft::Console::Render::Renderer renderer{ renderSettings, nullptr, nullptr, 0, std::make_unique<Microsoft::Console::Render::RenderThread>() };
+        auto adapter = std::make_unique<AdaptDispatch>(*_testGetSet, &renderer, renderSettings, _terminalInput);
+        StateMachine stateMachine{ std::make_unique<OutputStateMachineEngine>(std::move(adapter)) };
+
+        Log::Comment(L"DECSET 2026 holds back frames");
+        stateMachine.ProcessString(L"\x1b[?2026h");
+        VERIFY_IS_TRUE(renderer.IsSynchronizedOutputActive());
+
+        Log::Comment(L"DECRST 2026 releases them");
+        stateMachine.ProcessString(L"\x1b[?2026l");
+        VERIFY_IS_FALSE(renderer.IsSynchronizedOutputActive());
+
+        Log::Comment(L"RIS releases them as well");
+        stateMachine.ProcessString(L"\x1b[?2026h");
+        VERIFY_IS_TRUE(renderer.IsSynchronizedOutputActive());
+        stateMachine.ProcessString(L"\x1b" L"c");
+        VERIFY_IS_FALSE(renderer.IsSynchronizedOutputActive());
+    }
+
+    TEST_METHOD(SynchronizedOutputTimeoutTests)
+    {
+        using RenderThread = Microsoft::Console::Render::RenderThread;
+        // Generous, because the test machine may be busy. It's still shorter than 2 timeouts.
+        static constexpr auto limit = (RenderThread::s_synchronizedOutputTimeout * 3 / 2).count();
+
+        Microsoft::Console::Render::RenderSettings renderSettings;
+        Microsoft::Console::Render::Renderer renderer{ renderSettings, nullptr, nullptr, 0, std::make_unique<RenderThread>() };
+        auto adapter = std::make_unique<AdaptDispatch>(*_testGetSet, &renderer, renderSettings, _terminalInput);
+        StateMachine stateMachine{ std::make_unique<OutputStateMachineEngine>(std::move(adapter)) };
+
+        // Calls `update` until frames aren't held back anymore and returns how many milliseconds that took.
+        const auto measure = [&](const wchar_t* update) {
+            const auto beg = RenderThread::clock::now();
+            auto end = beg;
+            while (renderer.IsSynchronizedOutputActive() && end - beg < RenderThread::s_synchronizedOutputTimeout * 4)
+            {
+                stateMachine.ProcessString(update);
+                Sleep(1);
+                end = RenderThread::clock::now();
+            }
+            return std::chrono::duration_cast<std::chrono::milliseconds>(end - beg).count();
+        };
+
+        Log::Comment(L"Repeating DECSET 2026 doesn't extend the timeout");
+        stateMachine.ProcessString(L"\x1b[?2026h");
+        VERIFY_IS_TRUE(renderer.IsSynchronizedOutputActive());
+        VERIFY_IS_LESS_THAN(measure(L"\x1b[?2026h"), limit);
+        stateMachine.ProcessString(L"\x1b[?2026l");
+
+        Log::Comment(L"Updates without a gap in between don't hold back an invalidation past the timeout");
+        renderer.TriggerRedrawAll();
+        stateMachine.ProcessString(L"\x1b[?2026h");
+        VERIFY_IS_TRUE(renderer.IsSynchronizedOutputActive());
+        VERIFY_IS_LESS_THAN(measure(L"\x1b[?2026l\x1b[?2026h"), limit);
+    }
+
     TEST_METHOD(RequestPermanentModeTests)
     {
         BEGIN_TEST_METHOD_PROPERTIES()
@@ -3309,11 +3370,8 @@ public:
                 return false;
             }
 
-            fontBuffer.AddSixelData(L'B'); // Charset identifier
-            for (auto ch : data)
-            {
-                fontBuffer.AddSixelData(ch);
-            }
+            fontBuffer.AddSixelData(L"B"); // Charset identifier
+            fontBuffer.AddSixelData(data);
             if (!fontBuffer.FinalizeSixelData())
             {
                 return false;
@@ -3557,11 +3615,11 @@ public:
     {
         const auto assignCharset = [=](const auto charsetSize, const std::wstring_view charsetId = {}) {
             const auto stringHandler = _pDispatch->AssignUserPreferenceCharset(charsetSize);
-            for (auto ch : charsetId)
+            if (!charsetId.empty())
             {
-                stringHandler(ch);
+                stringHandler(charsetId);
             }
-            stringHandler(L'\033'); // String terminator
+            stringHandler(L"\033"); // String terminator
         };
         auto& termOutput = _pDispatch->_termOutput;
         termOutput.SoftReset();
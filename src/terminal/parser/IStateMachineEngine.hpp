@@ -20,7 +20,11 @@ namespace Microsoft::Console::VirtualTerminal
     class IStateMachineEngine
     {
     public:
-        using StringHandler = std::function<bool(const wchar_t)>;
+        // Receives the data of a DCS string in runs of one or more characters.
+        // The end of the string is signaled with a separate call containing
+        // just an ESC. Returning false indicates that the remainder of the
+        // string should be ignored.
+        using StringHandler = std::function<bool(const std::wstring_view)>;
 
         virtual ~IStateMachineEngine() = 0;
         IStateMachineEngine(const IStateMachineEngine&) = default;
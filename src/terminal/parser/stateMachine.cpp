@@ -374,6 +374,53 @@ static constexpr bool _isApcIndicator(const wchar_t wch) noexcept
 
 #pragma warning(pop)
 
+// The character classes that the CSI fast path in ProcessString cares about.
+// Anything that isn't part of a plain "CSI [marker] Pn;...;Pn [intermediates] final"
+// sequence is classified as Other and makes us fall back to the regular state machine.
+enum class CsiCharClass : uint8_t
+{
+    Other,
+    Digit,
+    Delimiter,
+    PrivateMarker,
+    Intermediate,
+    Final,
+};
+
+static constexpr auto s_csiCharClasses = []() {
+    std::array<CsiCharClass, 128> classes{};
+    for (wchar_t wch = 0; wch < 128; ++wch)
+    {
+        auto& c = til::at(classes, wch);
+        if (_isNumericParamValue(wch))
+        {
+            c = CsiCharClass::Digit;
+        }
+        else if (_isParameterDelimiter(wch))
+        {
+            c = CsiCharClass::Delimiter;
+        }
+        else if (_isCsiPrivateMarker(wch))
+        {
+            c = CsiCharClass::PrivateMarker;
+        }
+        else if (_isIntermediate(wch))
+        {
+            c = CsiCharClass::Intermediate;
+        }
+        else if (wch >= L'@' && wch <= L'~') // 0x40 - 0x7E
+        {
+            c = CsiCharClass::Final;
+        }
+    }
+    return classes;
+}();
+
+static constexpr CsiCharClass _csiCharClass(const wchar_t wch) noexcept
+{
+    return wch < 128 ? til::at(s_csiCharClasses, wch) : CsiCharClass::Other;
+}
+
 // Routine Description:
 // - Triggers the Execute action to indicate that the listener should immediately respond to a C0 control character.
 // Arguments:
@@ -655,7 +702,7 @@ void StateMachine::_ActionInterrupt()
     if (_state == VTStates::DcsPassThrough)
     {
         // The ESC signals the end of the data string.
-        _dcsStringHandler(AsciiChars::ESC);
+        _dcsStringHandler(L"\x1b");
         _dcsStringHandler = nullptr;
     }
 }
@@ -686,6 +733,20 @@ void StateMachine::_ActionOscPut(const wchar_t wch)
     _oscString.push_back(wch);
 }
 
+// Routine Description:
+// - Same as _ActionOscPut, but for a run of characters that are all valid
+//   parts of an OSC string, as found by Utils::FindActionableOscCharacter.
+// Arguments:
+// - string - Characters to collect.
+// Return Value:
+// - <none>
+void StateMachine::_ActionOscPutString(const std::wstring_view string)
+{
+    _trace.TraceOnAction(L"OscPut");
+
+    _oscString.append(string);
+}
+
 // Routine Description:
 // - Triggers the OscDispatch action to indicate that the listener should handle a control sequence.
 //   These sequences perform various API-type commands that can include many parameters.
@@ -1804,7 +1865,7 @@ void StateMachine::_EventDcsPassThrough(const wchar_t wch)
     _trace.TraceOnEvent(L"DcsPassThrough");
     if (_isC0Code(wch) || _isDcsPassThroughValid(wch))
     {
-        if (!_dcsStringHandler(wch))
+        if (!_dcsStringHandler({ &wch, 1 }))
         {
             _EnterDcsIgnore();
         }
@@ -1815,6 +1876,23 @@ void StateMachine::_EventDcsPassThrough(const wchar_t wch)
     }
 }
 
+// Routine Description:
+// - Same as _EventDcsPassThrough, but for a run of characters that are all
+//   valid pass through data, as found by Utils::FindActionableDcsCharacter.
+//   The whole run is handed to the string handler in a single call.
+// Arguments:
+// - string - Characters that triggered the event
+// Return Value:
+// - <none>
+void StateMachine::_EventDcsPassThroughString(const std::wstring_view string)
+{
+    _trace.TraceOnEvent(L"DcsPassThrough");
+    if (!_dcsStringHandler(string))
+    {
+        _EnterDcsIgnore();
+    }
+}
+
 // Routine Description:
 // - Handle SOS/PM/APC string.
 //   In this state the entire string is ignored.
@@ -2018,6 +2096,46 @@ void StateMachine::ProcessString(const std::wstring_view string)
 
         do
         {
+            // Most of the sequences we receive are complete CSI sequences with nothing but
+            // numeric parameters. Those can be parsed straight out of the string.
+            if (_state == VTStates::Ground)
+            {
+                if (const auto size = _ProcessCompleteCsi(string, i, true))
+                {
+                    i += size;
+                    continue;
+                }
+            }
+
+            // The data of DCS and OSC strings doesn't affect the parser state
+            // until we reach a control character, so we can consume it in bulk.
+            if (_state == VTStates::DcsPassThrough || _state == VTStates::OscString)
+            {
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).)
+                const auto beg = string.data() + i;
+                const auto len = string.size() - i;
+                const auto it = _state == VTStates::DcsPassThrough ?
+                                    Microsoft::Console::Utils::FindActionableDcsCharacter(beg, len) :
+                                    Microsoft::Console::Utils::FindActionableOscCharacter(beg, len);
+                const auto runSize = gsl::narrow_cast<size_t>(it - beg);
+
+                if (runSize)
+                {
+                    _runSize += runSize;
+                    i += runSize;
+                    _processingLastCharacter = i >= string.size();
+                    if (_state == VTStates::DcsPassThrough)
+                    {
+                        _EventDcsPassThroughString({ beg, runSize });
+                    }
+                    else
+                    {
+                        _ActionOscPutString({ beg, runSize });
+                    }
+                    continue;
+                }
+            }
+
             _runSize++;
             _processingLastCharacter = i + 1 >= string.size();
             // If we're processing characters individually, send it to the state machine.
@@ -2029,69 +2147,351 @@ void StateMachine::ProcessString(const std::wstring_view string)
     // If we're at the end of the string and have remaining un-printed characters,
     if (_state != VTStates::Ground)
     {
-        const auto run = _CurrentRun();
-        auto cacheUnusedRun = true;
-
-        // One of the "weird things" in VT input is the case of something like
-        // <kbd>alt+[</kbd>. In VT, that's encoded as `\x1b[`. However, that's
-        // also the start of a CSI, and could be the start of a longer sequence,
-        // there's no way to know for sure. For an <kbd>alt+[</kbd> keypress,
-        // the parser originally would just sit in the `CsiEntry` state after
-        // processing it, which would pollute the following keypress (e.g.
-        // <kbd>alt+[</kbd>, <kbd>A</kbd> would be processed like `\x1b[A`,
-        // which is _wrong_).
-        //
-        // At the same time, input may be broken up arbitrarily, depending on the pipe's
-        // buffer size, our read-buffer size, the sender's write-buffer size, and more.
-        // In fact, with the current WSL, input is broken up in 16 byte chunks (Why? :(),
-        // which breaks up many of our longer sequences, like our Win32InputMode ones.
-        //
-        // As a heuristic, this code specifically checks for a trailing Esc or Alt+key.
-        // If we encountered a win32-input-mode sequence before, we know that our \x1b[?9001h
-        // request to enable them was successful. While a client may still send \x1b{some char}
-        // intentionally, it's far more likely now that we're looking at a broken up sequence.
-        // The most common win32-input-mode is ConPTY itself after all, and we never emit
-        // \x1b{some char} once it's enabled.
-        if (_isEngineForInput)
+        _ProcessIncompleteSequence();
+    }
+}
+
+// Routine Description:
+// - The fast path for ProcessString: If the string contains a complete and plain
+//   CSI sequence at the given offset, it gets parsed and dispatched in one go,
+//   without walking through the CsiEntry/CsiParam/CsiIntermediate states one
+//   character at a time. The result is identical to what those states produce.
+// - Anything else, like sub-parameters, C0 controls embedded in the sequence, or
+//   sequences that are split across writes, is left to the regular state machine.
+// Arguments:
+// - string - Characters to operate upon
+// - offset - Position of the potential CSI introducer within the string
+// - atEndOfInput - False if the caller has more input after the end of the string
+// Return Value:
+// - The length of the dispatched sequence, or 0 if nothing was dispatched.
+size_t StateMachine::_ProcessCompleteCsi(const std::wstring_view string, const size_t offset, const bool atEndOfInput)
+{
+    const auto seq = string.substr(offset);
+    const auto len = seq.size();
+    size_t paramsBeg = 0;
+
+    if (!_parserMode.test(Mode::Ansi))
+    {
+        return 0;
+    }
+    if (len >= 2 && _isEscape(til::at(seq, 0)) && _isCsiIndicator(til::at(seq, 1)))
+    {
+        paramsBeg = 2;
+    }
+    else if (len >= 1 && til::at(seq, 0) == L'\x9b' && _parserMode.test(Mode::AcceptC1))
+    {
+        paramsBeg = 1;
+    }
+    else
+    {
+        return 0;
+    }
+
+    // Validate the entire sequence before touching any state.
+    auto pos = paramsBeg;
+    const auto hasMarker = pos < len && _csiCharClass(til::at(seq, pos)) == CsiCharClass::PrivateMarker;
+    if (hasMarker)
+    {
+        ++pos;
+    }
+    const auto digitsBeg = pos;
+    for (; pos < len; ++pos)
+    {
+        const auto c = _csiCharClass(til::at(seq, pos));
+        if (c != CsiCharClass::Digit && c != CsiCharClass::Delimiter)
         {
-            const auto win32 = _engine->EncounteredWin32InputModeSequence();
-            if (!win32 && run.size() <= 2 && run.front() == L'\x1b')
+            break;
+        }
+    }
+    const auto digitsEnd = pos;
+    while (pos < len && _csiCharClass(til::at(seq, pos)) == CsiCharClass::Intermediate)
+    {
+        ++pos;
+    }
+    if (pos >= len || _csiCharClass(til::at(seq, pos)) != CsiCharClass::Final)
+    {
+        return 0;
+    }
+
+    const auto size = pos + 1;
+    for (size_t j = 0; j < size; ++j)
+    {
+        _trace.AddSequenceTrace(til::at(seq, j));
+    }
+
+    _EnterCsiEntry();
+
+    if (hasMarker)
+    {
+        _ActionCollect(til::at(seq, paramsBeg));
+    }
+
+    if (digitsBeg != digitsEnd)
+    {
+        // This mirrors _ActionParam. There are no sub-parameters on this path,
+        // so every parameter gets an empty sub-parameter range.
+        VTInt value = 0;
+        auto hasValue = false;
+        _parameters.push_back({});
+        _subParameterRanges.push_back({ 0, 0 });
+
+        for (auto j = digitsBeg; j < digitsEnd; ++j)
+        {
+            const auto wch = til::at(seq, j);
+            if (_isParameterDelimiter(wch))
             {
-                _EnterGround();
-                if (run.size() == 1)
+                if (hasValue)
                 {
-                    _ActionExecute(L'\x1b');
+                    _parameters.back() = value;
                 }
-                else
+                // Once we've reached the parameter limit, additional parameters are ignored.
+                if (_parameters.size() >= MAX_PARAMETER_COUNT)
                 {
-                    _EnterEscape();
-                    _ActionEscDispatch(run.back());
+                    _parameterLimitOverflowed = true;
+                    hasValue = false;
+                    break;
                 }
-                _EnterGround();
-                // No need to cache the run, since we've dealt with it now.
-                cacheUnusedRun = false;
+                _parameters.push_back({});
+                _subParameterRanges.push_back({ 0, 0 });
+                value = 0;
+                hasValue = false;
+            }
+            else
+            {
+                _AccumulateTo(wch, value);
+                hasValue = true;
             }
         }
-        else if (_state == VTStates::SosPmApcString || _state == VTStates::DcsPassThrough || _state == VTStates::DcsIgnore)
+
+        if (hasValue)
         {
-            // There is no need to cache the run if we've reached one of the
-            // string processing states in the output engine, since that data
-            // will be dealt with as soon as it is received.
-            cacheUnusedRun = false;
+            _parameters.back() = value;
         }
+    }
 
-        // If the run hasn't been dealt with in one of the cases above, we cache
-        // the partial sequence in case we have to flush the whole thing later.
-        if (cacheUnusedRun)
+    for (auto j = digitsEnd; j < pos; ++j)
+    {
+        _ActionCollect(til::at(seq, j));
+    }
+
+    _runSize += size;
+    _processingLastCharacter = atEndOfInput && offset + size >= string.size();
+    _ActionCsiDispatch(til::at(seq, pos));
+    _EnterGround();
+    _ExecuteCsiCompleteCallback();
+    return size;
+}
+
+// Routine Description:
+// - Same as ProcessString(std::wstring_view), but for UTF-8 input.
+// - Printable runs are only converted to UTF-16 right before they're handed to the
+//   engine, while everything else is converted one character at a time.
+//   Code points that are split up across calls are carried over in _u8State.
+// - The offsets returned by GetInjections() are byte offsets into the given string.
+// Arguments:
+// - string - Characters to operate upon
+// Return Value:
+// - <none>
+void StateMachine::ProcessString(const std::string_view string)
+{
+    size_t i = 0;
+    _u8Sequence.clear();
+    _currentString = _u8Sequence;
+    _runOffset = 0;
+    _runSize = 0;
+    _injections.clear();
+
+    while (i < string.size())
+    {
+        // A code point that was split up across calls may be a C1 control character,
+        // which is why we only look for printable runs if there's none pending.
+        if (_state == VTStates::Ground && !_u8State.have)
         {
-            if (!_cachedSequence)
+            // Pointer arithmetic is perfectly fine for our hot path.
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).)
+            const auto beg = string.data() + i;
+            const auto len = string.size() - i;
+            const auto it = Microsoft::Console::Utils::FindActionableControlCharacter(beg, len);
+            const auto runSize = gsl::narrow_cast<size_t>(it - beg);
+
+            if (runSize)
+            {
+                i += runSize;
+                LOG_IF_FAILED(til::u8u16({ beg, runSize }, _u8Buffer, _u8State));
+
+                // A code point can only be legitimately incomplete at the end of the string.
+                // Anywhere else it's invalid UTF-8, which we need to replace just like MultiByteToWideChar does.
+                if (_u8State.have && i < string.size())
+                {
+                    _u8State.reset();
+                    _u8Buffer.push_back(L'\uFFFD');
+                }
+
+                if (!_u8Buffer.empty())
+                {
+                    _ActionPrintString(_u8Buffer);
+                }
+                continue;
+            }
+        }
+
+        // Complete CSI sequences are pure ASCII, so we can widen them as a whole
+        // and hand them to the same fast path that ProcessString(std::wstring_view) uses.
+        if (_state == VTStates::Ground && !_u8State.have && til::at(string, i) == '\x1b' && i + 1 < string.size() && til::at(string, i + 1) == '[')
+        {
+            auto end = i + 2;
+            while (end < string.size() && til::at(string, end) >= 0x20 && til::at(string, end) <= 0x3f)
             {
-                _cachedSequence.emplace(std::wstring{});
+                ++end;
             }
 
-            auto& cachedSequence = *_cachedSequence;
-            cachedSequence.append(run);
+            if (end < string.size() && til::at(string, end) >= 0x40 && til::at(string, end) <= 0x7e)
+            {
+                ++end;
+                _u8Sequence.assign(string.begin() + i, string.begin() + end);
+                _currentString = _u8Sequence;
+                _runOffset = 0;
+                _runSize = 0;
+
+                const auto injections = _injections.size();
+                if (_ProcessCompleteCsi(_u8Sequence, 0, end >= string.size()))
+                {
+                    i = end;
+                    for (auto k = injections; k < _injections.size(); ++k)
+                    {
+                        til::at(_injections, k).offset = i;
+                    }
+                    continue;
+                }
+            }
+        }
+
+        // Otherwise, we process a single code point. We figure out its length based on its lead byte
+        // and let til::u8u16 handle the rest, including invalid and incomplete sequences.
+        const auto lead = static_cast<uint8_t>(til::at(string, i));
+        size_t size = 1;
+        if (_u8State.have)
+        {
+            size = _u8State.want;
+        }
+        else if (lead >= 0xf0)
+        {
+            size = 4;
         }
+        else if (lead >= 0xe0)
+        {
+            size = 3;
+        }
+        else if (lead >= 0xc0)
+        {
+            size = 2;
+        }
+        size = std::min(size, string.size() - i);
+
+        LOG_IF_FAILED(til::u8u16(string.substr(i, size), _u8Buffer, _u8State));
+        i += size;
+
+        for (size_t j = 0; j < _u8Buffer.size(); ++j)
+        {
+            // Just like in ProcessString(std::wstring_view), a run starts anew in the ground state.
+            if (_state == VTStates::Ground)
+            {
+                _u8Sequence.clear();
+            }
+
+            _u8Sequence.push_back(til::at(_u8Buffer, j));
+            _currentString = _u8Sequence;
+            _runSize = _u8Sequence.size();
+            _processingLastCharacter = i >= string.size() && j + 1 >= _u8Buffer.size();
+
+            const auto injections = _injections.size();
+            ProcessCharacter(til::at(_u8Buffer, j));
+            // InjectSequence() recorded offsets into _u8Sequence, but they're supposed to be offsets into `string`.
+            for (auto k = injections; k < _injections.size(); ++k)
+            {
+                til::at(_injections, k).offset = i;
+            }
+        }
+    }
+
+    // _u8Sequence may be empty if all we got was the start of a code point.
+    if (_state != VTStates::Ground && !_u8Sequence.empty())
+    {
+        _ProcessIncompleteSequence();
+    }
+}
+
+// Routine Description:
+// - Called by ProcessString() when the string ended in the middle of a sequence.
+//   The sequence will either be dealt with right away or cached until we receive the rest.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::_ProcessIncompleteSequence()
+{
+    const auto run = _CurrentRun();
+    auto cacheUnusedRun = true;
+
+    // One of the "weird things" in VT input is the case of something like
+    // <kbd>alt+[</kbd>. In VT, that's encoded as `\x1b[`. However, that's
+    // also the start of a CSI, and could be the start of a longer sequence,
+    // there's no way to know for sure. For an <kbd>alt+[</kbd> keypress,
+    // the parser originally would just sit in the `CsiEntry` state after
+    // processing it, which would pollute the following keypress (e.g.
+    // <kbd>alt+[</kbd>, <kbd>A</kbd> would be processed like `\x1b[A`,
+    // which is _wrong_).
+    //
+    // At the same time, input may be broken up arbitrarily, depending on the pipe's
+    // buffer size, our read-buffer size, the sender's write-buffer size, and more.
+    // In fact, with the current WSL, input is broken up in 16 byte chunks (Why? :(),
+    // which breaks up many of our longer sequences, like our Win32InputMode ones.
+    //
+    // As a heuristic, this code specifically checks for a trailing Esc or Alt+key.
+    // If we encountered a win32-input-mode sequence before, we know that our \x1b[?9001h
+    // request to enable them was successful. While a client may still send \x1b{some char}
+    // intentionally, it's far more likely now that we're looking at a broken up sequence.
+    // The most common win32-input-mode is ConPTY itself after all, and we never emit
+    // \x1b{some char} once it's enabled.
+    if (_isEngineForInput)
+    {
+        const auto win32 = _engine->EncounteredWin32InputModeSequence();
+        if (!win32 && run.size() <= 2 && run.front() == L'\x1b')
+        {
+            _EnterGround();
+            if (run.size() == 1)
+            {
+                _ActionExecute(L'\x1b');
+            }
+            else
+            {
+                _EnterEscape();
+                _ActionEscDispatch(run.back());
+            }
+            _EnterGround();
+            // No need to cache the run, since we've dealt with it now.
+            cacheUnusedRun = false;
+        }
+    }
+    else if (_state == VTStates::SosPmApcString || _state == VTStates::DcsPassThrough || _state == VTStates::DcsIgnore)
+    {
+        // There is no need to cache the run if we've reached one of the
+        // string processing states in the output engine, since that data
+        // will be dealt with as soon as it is received.
+        cacheUnusedRun = false;
+    }
+
+    // If the run hasn't been dealt with in one of the cases above, we cache
+    // the partial sequence in case we have to flush the whole thing later.
+    if (cacheUnusedRun)
+    {
+        if (!_cachedSequence)
+        {
+            _cachedSequence.emplace(std::wstring{});
+        }
+
+        auto& cachedSequence = *_cachedSequence;
+        cachedSequence.append(run);
     }
 }
 
@@ -81,6 +81,7 @@ namespace Microsoft::Console::VirtualTerminal
 
         void ProcessCharacter(const wchar_t wch);
         void ProcessString(const std::wstring_view string);
+        void ProcessString(const std::string_view string);
         bool IsProcessingLastCharacter() const noexcept;
 
         void InjectSequence(InjectionType type);
@@ -106,6 +107,7 @@ namespace Microsoft::Console::VirtualTerminal
         void _ActionCsiDispatch(const wchar_t wch);
         void _ActionOscParam(const wchar_t wch) noexcept;
         void _ActionOscPut(const wchar_t wch);
+        void _ActionOscPutString(const std::wstring_view string);
         void _ActionOscDispatch();
         void _ActionSs3Dispatch(const wchar_t wch);
         void _ActionDcsDispatch(const wchar_t wch);
@@ -114,6 +116,8 @@ namespace Microsoft::Console::VirtualTerminal
         void _ActionIgnore() noexcept;
         void _ActionInterrupt();
 
+        void _ProcessIncompleteSequence();
+
         void _EnterGround() noexcept;
         void _EnterEscape() noexcept;
         void _EnterEscapeIntermediate() noexcept;
@@ -154,8 +158,10 @@ namespace Microsoft::Console::VirtualTerminal
         void _EventDcsIntermediate(const wchar_t wch);
         void _EventDcsParam(const wchar_t wch);
         void _EventDcsPassThrough(const wchar_t wch);
+        void _EventDcsPassThroughString(const std::wstring_view string);
         void _EventSosPmApcString(const wchar_t wch) noexcept;
 
+        size_t _ProcessCompleteCsi(const std::wstring_view string, const size_t offset, const bool atEndOfInput);
         void _AccumulateTo(const wchar_t wch, VTInt& value) noexcept;
 
         template<typename TLambda>
@@ -200,6 +206,13 @@ namespace Microsoft::Console::VirtualTerminal
         size_t _runOffset;
         size_t _runSize;
 
+        // State for ProcessString(std::string_view): Code points that are split up across
+        // calls, the UTF-16 version of the current printable run or character, as well
+        // as that of the current sequence (which _currentString then refers to).
+        til::u8state _u8State;
+        std::wstring _u8Buffer;
+        std::wstring _u8Sequence;
+
         // Construct current run.
         //
         // Note: We intentionally use this method to create the run lazily for better performance.
@@ -38,6 +38,8 @@ public:
         dcsId = 0;
         dcsParams.clear();
         dcsDataString.clear();
+        dcsDataRuns = 0;
+        oscString.clear();
     }
 
     bool EncounteredWin32InputModeSequence() const noexcept override
@@ -52,7 +54,11 @@ public:
     };
 
     bool ActionExecuteFromEscape(const wchar_t /* wch */) override { return true; };
-    bool ActionPrint(const wchar_t /* wch */) override { return true; };
+    bool ActionPrint(const wchar_t wch) override
+    {
+        printed += wch;
+        return true;
+    };
     bool ActionPrintString(const std::wstring_view string) override
     {
         printed += string;
@@ -69,8 +75,9 @@ public:
 
     bool ActionVt52EscDispatch(const VTID /*id*/, const VTParameters /*parameters*/) override { return true; };
 
-    bool ActionOscDispatch(const size_t /* parameter */, const std::wstring_view /* string */) override
+    bool ActionOscDispatch(const size_t /* parameter */, const std::wstring_view string) override
     {
+        oscString = string;
         if (pfnFlushToTerminal)
         {
             pfnFlushToTerminal();
@@ -109,7 +116,8 @@ public:
             dcsParams.push_back(parameters.at(i).value_or(0));
         }
         dcsDataString.clear();
-        return [=](const auto ch) { dcsDataString += ch; return true; };
+        dcsDataRuns = 0;
+        return [=](const auto string) { dcsDataString += string; dcsDataRuns++; return true; };
     }
 
     // These will only be populated if ActionCsiDispatch is called.
@@ -132,6 +140,10 @@ public:
     uint64_t dcsId = 0;
     std::vector<size_t> dcsParams;
     std::wstring dcsDataString;
+    size_t dcsDataRuns = 0;
+
+    // This will only be populated if ActionOscDispatch is called.
+    std::wstring oscString;
 };
 
 class Microsoft::Console::VirtualTerminal::StateMachineTest
@@ -154,8 +166,11 @@ class Microsoft::Console::VirtualTerminal::StateMachineTest
     TEST_METHOD(RunStorageBeforeEscape);
     TEST_METHOD(BulkTextPrint);
     TEST_METHOD(PassThroughUnhandledSplitAcrossWrites);
+    TEST_METHOD(Utf8SplitAcrossWrites);
+    TEST_METHOD(CompleteCsiMatchesSplitCsi);
 
     TEST_METHOD(DcsDataStringsReceivedByHandler);
+    TEST_METHOD(StringDataReceivedInRuns);
 
     TEST_METHOD(VtParameterSubspanTest);
 };
@@ -276,6 +291,82 @@ void StateMachineTest::PassThroughUnhandledSplitAcrossWrites()
     VERIFY_ARE_EQUAL(L"", engine.printed);
 }
 
+void StateMachineTest::Utf8SplitAcrossWrites()
+{
+    // Printable text with 1-4 byte long code points, followed by a CSI sequence,
+    // a C1 CSI sequence and a DCS sequence with a non-ASCII data string.
+    static constexpr std::string_view input{ "a\xc3\xa4\xe3\x83\x8d\xe3\x82\xb3\xf0\x9f\x90\xb1\r\n\x1b[12;34m\xc2\x9b"
+                                             "5m\x1bP1|\xc3\xa4\x1b\\end" };
+
+    // Splitting the input at any point, including in the middle of a code point, must not affect the result.
+    for (size_t split = 0; split <= input.size(); ++split)
+    {
+        auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+        // this dance is required because StateMachine presumes to take ownership of its engine.
+        auto& engine{ *enginePtr.get() };
+        StateMachine machine{ std::move(enginePtr) };
+        machine.SetParserMode(StateMachine::Mode::AcceptC1, true);
+
+        machine.ProcessString(input.substr(0, split));
+        machine.ProcessString(input.substr(split));
+
+        VERIFY_ARE_EQUAL(L"a\u00e4\u30cd\u30b3\U0001F431end", engine.printed);
+        VERIFY_ARE_EQUAL(L"\r\n", engine.executed);
+        VERIFY_ARE_EQUAL(std::vector<size_t>({ 12, 34, 5 }), engine.csiParams);
+        VERIFY_ARE_EQUAL(VTID("|"), engine.dcsId);
+        VERIFY_ARE_EQUAL(L"\u00e4\033", engine.dcsDataString);
+    }
+}
+
+void StateMachineTest::CompleteCsiMatchesSplitCsi()
+{
+    // Complete sequences take a shortcut through the parser. They must produce
+    // the same result as when they're fed in one character at a time.
+    static constexpr std::wstring_view sequences[]{
+        L"\x1b[m",
+        L"\x1b[1;2H",
+        L"\x1b[;;5m",
+        L"\x1b[?25h",
+        L"\x1b[>0;1c",
+        L"\x1b[2 q",
+        L"\x1b[99999C",
+        L"\x1b[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17;18;19;20;21;22;23;24;25;26;27;28;29;30;31;32;33;34;35m",
+        L"\x1b[38:2::1:2:3m",
+        L"\x1b[1?m",
+        L"\x1b[1\b;2H",
+        L"\x1b[1 1m",
+        L"\x9b"
+        L"4m",
+    };
+
+    for (const auto sequence : sequences)
+    {
+        Log::Comment(NoThrowString().Format(L"Sequence: %s", std::wstring{ sequence }.substr(1).c_str()));
+
+        auto wholeEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+        // this dance is required because StateMachine presumes to take ownership of its engine.
+        const auto& wholeEngine{ *wholeEnginePtr.get() };
+        StateMachine wholeMachine{ std::move(wholeEnginePtr) };
+        wholeMachine.SetParserMode(StateMachine::Mode::AcceptC1, true);
+
+        auto splitEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+        const auto& splitEngine{ *splitEnginePtr.get() };
+        StateMachine splitMachine{ std::move(splitEnginePtr) };
+        splitMachine.SetParserMode(StateMachine::Mode::AcceptC1, true);
+
+        wholeMachine.ProcessString(sequence);
+        for (const auto ch : sequence)
+        {
+            splitMachine.ProcessString({ &ch, 1 });
+        }
+
+        VERIFY_ARE_EQUAL(splitEngine.csiId, wholeEngine.csiId);
+        VERIFY_ARE_EQUAL(splitEngine.csiParams, wholeEngine.csiParams);
+        VERIFY_ARE_EQUAL(splitEngine.executed, wholeEngine.executed);
+        VERIFY_ARE_EQUAL(splitEngine.printed, wholeEngine.printed);
+    }
+}
+
 void StateMachineTest::DcsDataStringsReceivedByHandler()
 {
     BEGIN_TEST_METHOD_PROPERTIES()
@@ -339,6 +430,39 @@ void StateMachineTest::DcsDataStringsReceivedByHandler()
     VERIFY_ARE_EQUAL(expectedExecuted, engine.executed);
 }
 
+void StateMachineTest::StringDataReceivedInRuns()
+{
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    Log::Comment(L"DCS data is passed to the handler a run at a time");
+    machine.ProcessString(L"\033Pq#0;2;0;0;0!10~-\r\n\x7f~~\033\\");
+    VERIFY_ARE_EQUAL(VTID("q"), engine.dcsId);
+    // DEL is dropped, which splits the data into two runs, plus one for the ESC.
+    VERIFY_ARE_EQUAL(L"#0;2;0;0;0!10~-\r\n~~\033", engine.dcsDataString);
+    VERIFY_ARE_EQUAL(3u, engine.dcsDataRuns);
+
+    Log::Comment(L"DCS data split across writes is passed through as it arrives");
+    engine.ResetTestState();
+    machine.ProcessString(L"\033Pqabc");
+    machine.ProcessString(L"def\033\\");
+    VERIFY_ARE_EQUAL(L"abcdef\033", engine.dcsDataString);
+    VERIFY_ARE_EQUAL(3u, engine.dcsDataRuns);
+
+    Log::Comment(L"OSC strings are collected in bulk, ignoring invalid controls");
+    engine.ResetTestState();
+    machine.ProcessString(L"\033]2;a long \x01window\x1f title\u00e4\a");
+    VERIFY_ARE_EQUAL(L"a long window title\u00e4", engine.oscString);
+
+    Log::Comment(L"OSC strings are terminated by ST within a run");
+    engine.ResetTestState();
+    machine.ProcessString(L"\033]2;title\033\\printed");
+    VERIFY_ARE_EQUAL(L"title", engine.oscString);
+    VERIFY_ARE_EQUAL(L"printed", engine.printed);
+}
+
 void StateMachineTest::VtParameterSubspanTest()
 {
     const auto parameterList = std::vector<VTParameter>{ 12, 34, 56, 78 };
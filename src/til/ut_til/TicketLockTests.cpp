@@ -0,0 +1,261 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/ticket_lock.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+namespace
+{
+    struct ContentionResult
+    {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        bool torn = false;
+    };
+
+    // Runs `readerCount` threads that acquire the lock via ReadLock in a loop, while the
+    // calling thread floods it with exclusive acquisitions, like the VT parser does during heavy output.
+    template<typename Lock, template<typename> typename ReadLock>
+    ContentionResult measureContention(const size_t readerCount, const std::chrono::milliseconds duration)
+    {
+        Lock lock;
+        std::atomic<bool> stop{ false };
+        std::atomic<uint64_t> reads{ 0 };
+        std::atomic<bool> torn{ false };
+        // The writer keeps these two in sync. Readers that see them differ weren't excluded from the writer.
+        uint64_t first = 0;
+        uint64_t second = 0;
+        uint64_t writes = 0;
+
+        std::vector<std::thread> readers;
+        readers.reserve(readerCount);
+        for (size_t i = 0; i < readerCount; ++i)
+        {
+            readers.emplace_back([&]() {
+                uint64_t count = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    const ReadLock<Lock> guard{ lock };
+                    if (first != second)
+                    {
+                        torn.store(true, std::memory_order_relaxed);
+                    }
+                    ++count;
+                }
+                reads.fetch_add(count, std::memory_order_relaxed);
+            });
+        }
+
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            const std::unique_lock guard{ lock };
+            ++first;
+            ++second;
+            ++writes;
+        }
+
+        stop.store(true, std::memory_order_relaxed);
+        for (auto& t : readers)
+        {
+            t.join();
+        }
+
+        return { reads.load(), writes, torn.load() };
+    }
+
+    template<typename Lock, template<typename> typename ReadLock>
+    void benchmarkContention(const wchar_t* name)
+    {
+        static constexpr std::chrono::milliseconds duration{ 100 };
+        static constexpr size_t readerCounts[]{ 1, 4, 16 };
+
+        for (const auto readerCount : readerCounts)
+        {
+            const auto result = measureContention<Lock, ReadLock>(readerCount, duration);
+            Log::Comment(NoThrowString().Format(
+                L"%s, %zu readers: %llu reads/s, %llu writes/s",
+                name,
+                readerCount,
+                result.reads * 1000 / duration.count(),
+                result.writes * 1000 / duration.count()));
+
+            VERIFY_IS_FALSE(result.torn);
+            // Being fair, neither the readers nor the writer may starve.
+            VERIFY_ARE_NOT_EQUAL(uint64_t{ 0 }, result.reads);
+            VERIFY_ARE_NOT_EQUAL(uint64_t{ 0 }, result.writes);
+        }
+    }
+}
+
+class TicketLockTests
+{
+    BEGIN_TEST_CLASS(TicketLockTests)
+        TEST_CLASS_PROPERTY(L"TestTimeout", L"0:0:30") // 30s timeout
+    END_TEST_CLASS()
+
+    TEST_METHOD(SharedReadersOverlap)
+    {
+        til::shared_ticket_lock lock;
+
+        lock.lock_shared();
+        // This would deadlock if readers excluded each other.
+        std::thread{ [&]() {
+            lock.lock_shared();
+            lock.unlock_shared();
+        } }.join();
+        lock.unlock_shared();
+
+        // ...and this if the shared acquisitions above weren't balanced.
+        lock.lock();
+        lock.unlock();
+    }
+
+    TEST_METHOD(WriterExcludesReaders)
+    {
+        til::shared_ticket_lock lock;
+        std::atomic<bool> acquired{ false };
+
+        lock.lock_shared();
+        std::thread writer{ [&]() {
+            lock.lock();
+            acquired.store(true);
+            lock.unlock();
+        } };
+
+        Sleep(50);
+        VERIFY_IS_FALSE(acquired.load());
+
+        lock.unlock_shared();
+        writer.join();
+        VERIFY_IS_TRUE(acquired.load());
+    }
+
+    TEST_METHOD(RecursiveShared)
+    {
+        til::recursive_shared_ticket_lock lock;
+
+        lock.lock_shared();
+        lock.lock_shared();
+        VERIFY_IS_TRUE(lock.is_locked());
+        VERIFY_IS_FALSE(lock.is_locked_exclusive());
+        VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+
+        // Other threads don't inherit the hold, but may acquire it in shared mode as well.
+        std::thread{ [&]() {
+            VERIFY_IS_FALSE(lock.is_locked());
+            lock.lock_shared();
+            VERIFY_ARE_EQUAL(1u, lock.recursion_depth());
+            lock.unlock_shared();
+        } }.join();
+
+        lock.unlock_shared();
+        VERIFY_ARE_EQUAL(1u, lock.recursion_depth());
+        lock.unlock_shared();
+        VERIFY_IS_FALSE(lock.is_locked());
+
+        // Exclusive owners may read, which counts as recursion.
+        lock.lock();
+        lock.lock_shared();
+        VERIFY_IS_TRUE(lock.is_locked_exclusive());
+        VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+        lock.unlock_shared();
+        lock.unlock();
+        VERIFY_IS_FALSE(lock.is_locked());
+    }
+
+    TEST_METHOD(SuspendShared)
+    {
+        til::recursive_shared_ticket_lock lock;
+
+        lock.lock_shared();
+        lock.lock_shared();
+        {
+            const auto suspension = lock.suspend();
+            VERIFY_IS_FALSE(lock.is_locked());
+
+            // This would deadlock if the suspension didn't release the shared hold.
+            std::thread{ [&]() {
+                lock.lock();
+                lock.unlock();
+            } }.join();
+        }
+        VERIFY_IS_TRUE(lock.is_locked());
+        VERIFY_IS_FALSE(lock.is_locked_exclusive());
+        VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+        lock.unlock_shared();
+        lock.unlock_shared();
+
+        lock.lock();
+        {
+            const auto suspension = lock.suspend();
+            VERIFY_IS_FALSE(lock.is_locked());
+        }
+        VERIFY_IS_TRUE(lock.is_locked_exclusive());
+        VERIFY_ARE_EQUAL(1u, lock.recursion_depth());
+        lock.unlock();
+        VERIFY_IS_FALSE(lock.is_locked());
+    }
+
+    TEST_METHOD(RecursiveSharedManyLocks)
+    {
+        // Each thread tracks its shared holds in a table. If it couldn't track all of them, a recursive
+        // lock_shared() would draw another ticket, which deadlocks behind a waiting writer.
+        std::array<til::recursive_shared_ticket_lock, 5> locks;
+        std::atomic<bool> acquired{ false };
+
+        for (auto& lock : locks)
+        {
+            lock.lock_shared();
+        }
+
+        std::thread writer{ [&]() {
+            locks.back().lock();
+            acquired.store(true);
+            locks.back().unlock();
+        } };
+
+        // Give the writer a chance to queue up behind our hold.
+        Sleep(50);
+        VERIFY_IS_FALSE(acquired.load());
+
+        for (auto& lock : locks)
+        {
+            lock.lock_shared();
+            VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+        }
+        VERIFY_IS_FALSE(acquired.load());
+
+        for (auto& lock : locks)
+        {
+            lock.unlock_shared();
+            lock.unlock_shared();
+            VERIFY_IS_FALSE(lock.is_locked());
+        }
+
+        writer.join();
+        VERIFY_IS_TRUE(acquired.load());
+    }
+
+    // The benchmarks below compare how many reads get through while a writer hammers the lock.
+    // The recursive_ticket_lock one serves as the baseline, as Terminal::LockForReading() used to be exclusive.
+    TEST_METHOD(BenchmarkRecursiveTicketLock)
+    {
+        benchmarkContention<til::recursive_ticket_lock, std::unique_lock>(L"recursive_ticket_lock");
+    }
+
+    TEST_METHOD(BenchmarkSharedTicketLock)
+    {
+        benchmarkContention<til::shared_ticket_lock, std::shared_lock>(L"shared_ticket_lock");
+    }
+
+    TEST_METHOD(BenchmarkRecursiveSharedTicketLock)
+    {
+        benchmarkContention<til::recursive_shared_ticket_lock, std::shared_lock>(L"recursive_shared_ticket_lock");
+    }
+};
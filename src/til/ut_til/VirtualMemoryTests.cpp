@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/virtual_memory.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class VirtualMemoryTests
+{
+    TEST_CLASS(VirtualMemoryTests);
+
+    TEST_METHOD(CommitDecommit)
+    {
+        const auto pageSize = til::virtual_memory::page_size();
+        til::virtual_memory memory{ 64 * pageSize + 1 };
+        const auto data = memory.get();
+
+        VERIFY_IS_NOT_NULL(data);
+        VERIFY_ARE_EQUAL(65 * pageSize, memory.size());
+        VERIFY_ARE_EQUAL(0u, memory.committed(data, memory.size()));
+
+        // Committing rounds outwards to whole pages.
+        memory.commit(data + 1, 16 * pageSize);
+        VERIFY_ARE_EQUAL(17 * pageSize, memory.committed(data, memory.size()));
+        memset(data, 0xff, 17 * pageSize);
+
+        // Decommitting rounds inwards, which leaves the 2 partially covered pages alone.
+        memory.decommit(data + 1, 16 * pageSize);
+        VERIFY_ARE_EQUAL(2 * pageSize, memory.committed(data, memory.size()));
+        VERIFY_ARE_EQUAL(std::byte{ 0xff }, data[0]);
+        VERIFY_ARE_EQUAL(std::byte{ 0xff }, data[16 * pageSize]);
+
+        // Pages that are committed again read as zero.
+        memory.commit(data, 17 * pageSize);
+        VERIFY_ARE_EQUAL(std::byte{ 0 }, data[pageSize]);
+        VERIFY_ARE_EQUAL(std::byte{ 0xff }, data[0]);
+    }
+
+    TEST_METHOD(Move)
+    {
+        til::virtual_memory a{ til::virtual_memory::page_size() };
+        const auto data = a.get();
+
+        til::virtual_memory b{ std::move(a) };
+        VERIFY_IS_NULL(a.get());
+        VERIFY_ARE_EQUAL(data, b.get());
+
+        a = std::move(b);
+        VERIFY_ARE_EQUAL(data, a.get());
+        VERIFY_ARE_EQUAL(0u, b.size());
+    }
+};
@@ -111,6 +111,119 @@ static constexpr Benchmark s_benchmarks[] = {
             }
         },
     },
+    Benchmark{
+        // Same as "WriteConsoleW 128Ki", but the renderer has nothing to paint while the window is hidden.
+        // The difference between the two is the cost the render thread imposes on the VT parser.
+        .title = "WriteConsoleW 128Ki (hidden)",
+        .exec = [](BenchmarkContext& ctx) {
+            ShowWindow(ctx.hwnd, SW_HIDE);
+
+            while (ctx.wants_more())
+            {
+                ctx.mark_beg();
+                const auto res = WriteConsoleW(ctx.output, ctx.utf16_128Ki.data(), static_cast<DWORD>(ctx.utf16_128Ki.size()), nullptr, nullptr);
+                ctx.mark_end();
+                debugAssert(res == TRUE);
+            }
+
+            ShowWindow(ctx.hwnd, SW_SHOWNOACTIVATE);
+        },
+    },
+    Benchmark{
+        // Same as "WriteConsoleW 128Ki", but with a key press every 100ms, like someone typing during a flood of output.
+        // Between the writes each key is read and written back, like a shell echoes what you type. The interval is
+        // deliberately longer than the 60 FPS frame pacing window, so that pacing gets a chance to kick back in.
+        // This measures the throughput, while the keystroke-to-paint latency is reported by the "RenderFrame"
+        // trace event of conhost's Microsoft.Windows.Console.Host provider (keyword 0x4000). To collect it:
+        //   logman start ConsoleBench -p {fe1ff234-1f09-50a8-d38d-c44fab43e818} 0x4000 5 -o ConsoleBench.etl -ets
+        //   ConsoleBench.exe
+        //   logman stop ConsoleBench -ets
+        //   tracerpt ConsoleBench.etl -of CSV -o ConsoleBench.csv
+        // The latency of each key press is the InputLatencyUs field of the RenderFrame events where it isn't 0.
+        // Frames of the other benchmarks don't have any, since they don't send input.
+        .title = "WriteConsoleW 128Ki (typing)",
+        .exec = [](BenchmarkContext& ctx) {
+            std::atomic<bool> done{ false };
+            std::thread typist{ [&]() {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    PostMessageW(ctx.hwnd, WM_CHAR, L'a', 1);
+                    Sleep(100);
+                }
+            } };
+
+            while (ctx.wants_more())
+            {
+                ctx.mark_beg();
+                const auto res = WriteConsoleW(ctx.output, ctx.utf16_128Ki.data(), static_cast<DWORD>(ctx.utf16_128Ki.size()), nullptr, nullptr);
+                ctx.mark_end();
+                debugAssert(res == TRUE);
+
+                DWORD pending = 0;
+                if (GetNumberOfConsoleInputEvents(ctx.input, &pending) && pending)
+                {
+                    INPUT_RECORD records[16];
+                    DWORD read = 0;
+                    if (ReadConsoleInputW(ctx.input, &records[0], 16, &read))
+                    {
+                        for (DWORD i = 0; i < read; ++i)
+                        {
+                            const auto& key = records[i].Event.KeyEvent;
+                            if (records[i].EventType == KEY_EVENT && key.bKeyDown && key.uChar.UnicodeChar)
+                            {
+                                WriteConsoleW(ctx.output, &key.uChar.UnicodeChar, 1, nullptr, nullptr);
+                            }
+                        }
+                    }
+                }
+            }
+
+            done.store(true, std::memory_order_relaxed);
+            typist.join();
+            FlushConsoleInputBuffer(ctx.input);
+        },
+    },
+    Benchmark{
+        // A full screen redraw written in several pieces, like TUIs do it.
+        .title = "TUI redraw",
+        .exec = [](BenchmarkContext& ctx) {
+            const auto chunk = ctx.utf16_4Ki.size() / 4;
+
+            while (ctx.wants_more())
+            {
+                ctx.mark_beg();
+                WriteConsoleW(ctx.output, L"\x1b[H", 3, nullptr, nullptr);
+                for (size_t off = 0; off < ctx.utf16_4Ki.size(); off += chunk)
+                {
+                    WriteConsoleW(ctx.output, ctx.utf16_4Ki.data() + off, static_cast<DWORD>(std::min(chunk, ctx.utf16_4Ki.size() - off)), nullptr, nullptr);
+                    // Give the renderer a chance to paint in between, like the latency of a real application would.
+                    Sleep(1);
+                }
+                ctx.mark_end();
+            }
+        },
+    },
+    Benchmark{
+        // Same as "TUI redraw", but wrapped in DECSET/DECRST 2026.
+        .title = "TUI redraw (synchronized)",
+        .exec = [](BenchmarkContext& ctx) {
+            const auto chunk = ctx.utf16_4Ki.size() / 4;
+
+            while (ctx.wants_more())
+            {
+                ctx.mark_beg();
+                WriteConsoleW(ctx.output, L"\x1b[?2026h\x1b[H", 11, nullptr, nullptr);
+                for (size_t off = 0; off < ctx.utf16_4Ki.size(); off += chunk)
+                {
+                    WriteConsoleW(ctx.output, ctx.utf16_4Ki.data() + off, static_cast<DWORD>(std::min(chunk, ctx.utf16_4Ki.size() - off)), nullptr, nullptr);
+                    // Give the renderer a chance to paint in between, like the latency of a real application would.
+                    Sleep(1);
+                }
+                WriteConsoleW(ctx.output, L"\x1b[?2026l", 8, nullptr, nullptr);
+                ctx.mark_end();
+            }
+        },
+    },
     Benchmark{
         .title = "WriteConsoleOutputAttribute 4Ki",
         .exec = [](BenchmarkContext& ctx) {
@@ -404,6 +517,57 @@ static constexpr Benchmark s_benchmarks[] = {
             }
         },
     },
+    Benchmark{
+        .title = "ReadConsoleW line input paste 128Ki",
+        .exec = [](BenchmarkContext& ctx) {
+            static constexpr INPUT_RECORD enter{
+                .EventType = KEY_EVENT,
+                .Event = {
+                    .KeyEvent = {
+                        .bKeyDown = TRUE,
+                        .wRepeatCount = 1,
+                        .wVirtualKeyCode = VK_RETURN,
+                        .wVirtualScanCode = 0,
+                        .uChar = '\r',
+                        .dwControlKeyState = 0,
+                    },
+                },
+            };
+
+            const auto scratch = mem::get_scratch_arena(ctx.arena);
+            const auto cap = static_cast<DWORD>(ctx.input_4Ki.size()) * 4;
+            const auto buf = scratch.arena.push_uninitialized<wchar_t>(cap);
+
+            SetConsoleMode(ctx.input, ENABLE_PROCESSED_INPUT | ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT);
+            FlushConsoleInputBuffer(ctx.input);
+
+            while (ctx.wants_more())
+            {
+                // A large paste arrives in chunks while the cooked read is already waiting for input.
+                // Each chunk results in a redisplay of the prompt, which is what we're measuring here.
+                std::thread writer{ [&]() {
+                    DWORD written;
+                    for (int i = 0; i < 32; ++i)
+                    {
+                        WriteConsoleInputW(ctx.input, ctx.input_4Ki.data(), static_cast<DWORD>(ctx.input_4Ki.size()), &written);
+                    }
+                    WriteConsoleInputW(ctx.input, &enter, 1, &written);
+                } };
+
+                ctx.mark_beg();
+                // The line is longer than our buffer, so we have to read it in pieces until we get the trailing newline.
+                for (DWORD read = 0; ReadConsoleW(ctx.input, buf, cap, &read, nullptr) && read != 0 && buf[read - 1] != L'\n';)
+                {
+                }
+                ctx.mark_end();
+
+                writer.join();
+                WriteConsoleW(ctx.output, L"\033c", 2, nullptr, nullptr);
+            }
+
+            SetConsoleMode(ctx.input, ENABLE_PROCESSED_INPUT | ENABLE_ECHO_INPUT);
+        },
+    },
 #endif
 #if ENABLE_TEST_CLIPBOARD
     Benchmark{
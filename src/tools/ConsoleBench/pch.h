@@ -11,7 +11,9 @@
 #include <wil/resource.h>
 
 #include <array>
+#include <atomic>
 #include <algorithm>
 #include <charconv>
 #include <span>
 #include <string_view>
+#include <thread>
@@ -0,0 +1,766 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// VtBench replays VT corpora through the same StateMachine, AdaptDispatch and TextBuffer
+// that conhost and Windows Terminal use, but without a console, window, pipe or renderer.
+// Unlike ConsoleBench it measures nothing but the parser and the buffer, which makes it
+// suitable for catching regressions in those two components in isolation.
+
+#include "pch.h"
+
+#include "../../buffer/out/textBuffer.hpp"
+#include "../../renderer/inc/RenderSettings.hpp"
+#include "../../terminal/adapter/adaptDispatch.hpp"
+#include "../../terminal/parser/OutputStateMachineEngine.hpp"
+#include "../../terminal/parser/stateMachine.hpp"
+#include "../../types/inc/CodepointWidthDetector.hpp"
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::VirtualTerminal;
+
+// Every allocation made while a corpus is being replayed passes through here.
+// The counter is only read on the benchmark thread and nothing else allocates concurrently.
+static size_t s_allocations = 0;
+
+void* operator new(size_t size)
+{
+    s_allocations++;
+    if (const auto p = malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    constexpr til::CoordType s_bufferWidth = 120;
+    constexpr til::CoordType s_bufferHeight = 9001;
+    constexpr til::CoordType s_viewportHeight = 30;
+    constexpr size_t s_corpusSize = 1024 * 1024;
+
+    // An ITerminalApi that owns nothing but a TextBuffer and behaves like a maximized
+    // terminal with a fixed size. Everything that would reach out to the outside world
+    // (responses, titles, the clipboard, etc.) is dropped on the floor.
+    class StubTerminalApi final : public ITerminalApi
+    {
+    public:
+        StubTerminalApi() :
+            _buffer{ { s_bufferWidth, s_bufferHeight }, TextAttribute{}, 0, true, nullptr }
+        {
+        }
+
+        void ReturnResponse(const std::wstring_view /*response*/) override
+        {
+        }
+
+        StateMachine& GetStateMachine() override
+        {
+            return *_stateMachine;
+        }
+
+        BufferState GetBufferAndViewport() override
+        {
+            return { _buffer, _viewport, true };
+        }
+
+        void SetViewportPosition(const til::point position) override
+        {
+            _viewport = { position.x, position.y, position.x + s_bufferWidth, position.y + s_viewportHeight };
+        }
+
+        bool IsVtInputEnabled() const override
+        {
+            return false;
+        }
+
+        void SetSystemMode(const Mode mode, const bool enabled) override
+        {
+            _systemMode.set(mode, enabled);
+        }
+
+        bool GetSystemMode(const Mode mode) const override
+        {
+            return _systemMode.test(mode);
+        }
+
+        void ReturnAnswerback() override
+        {
+        }
+
+        void WarningBell() override
+        {
+        }
+
+        void SetWindowTitle(const std::wstring_view /*title*/) override
+        {
+        }
+
+        // The corpora don't switch to the alternate screen, so there's only ever one buffer.
+        void UseAlternateScreenBuffer(const TextAttribute& /*attrs*/) override
+        {
+        }
+
+        void UseMainScreenBuffer() override
+        {
+        }
+
+        CursorType GetUserDefaultCursorStyle() const override
+        {
+            return CursorType::Legacy;
+        }
+
+        void ShowWindow(bool /*showOrHide*/) override
+        {
+        }
+
+        void SetCodePage(const unsigned int /*codepage*/) override
+        {
+        }
+
+        void ResetCodePage() override
+        {
+        }
+
+        unsigned int GetOutputCodePage() const override
+        {
+            return CP_UTF8;
+        }
+
+        unsigned int GetInputCodePage() const override
+        {
+            return CP_UTF8;
+        }
+
+        void CopyToClipboard(const wil::zwstring_view /*content*/) override
+        {
+        }
+
+        void SetTaskbarProgress(const DispatchTypes::TaskbarState /*state*/, const size_t /*progress*/) override
+        {
+        }
+
+        void SetWorkingDirectory(const std::wstring_view /*uri*/) override
+        {
+        }
+
+        void PlayMidiNote(const int /*noteNumber*/, const int /*velocity*/, const std::chrono::microseconds /*duration*/) override
+        {
+        }
+
+        bool ResizeWindow(const til::CoordType /*width*/, const til::CoordType /*height*/) override
+        {
+            return false;
+        }
+
+        void NotifyAccessibilityChange(const til::rect& /*changedRect*/) override
+        {
+        }
+
+        void NotifyBufferRotation(const int /*delta*/) override
+        {
+        }
+
+        void InvokeCompletions(std::wstring_view /*menuJson*/, unsigned int /*replaceLength*/) override
+        {
+        }
+
+        void SearchMissingCommand(const std::wstring_view /*command*/) override
+        {
+        }
+
+        StateMachine* _stateMachine = nullptr;
+
+    private:
+        TextBuffer _buffer;
+        til::rect _viewport{ 0, 0, s_bufferWidth, s_viewportHeight };
+        til::enumset<Mode> _systemMode{ Mode::AutoWrap };
+    };
+
+    // Wires up the output half of a terminal the same way conhost and Windows Terminal do.
+    struct Harness
+    {
+        Harness() :
+            stateMachine{ std::make_unique<OutputStateMachineEngine>(std::make_unique<AdaptDispatch>(api, nullptr, renderSettings, terminalInput)) }
+        {
+            api._stateMachine = &stateMachine;
+        }
+
+        StubTerminalApi api;
+        RenderSettings renderSettings;
+        TerminalInput terminalInput;
+        StateMachine stateMachine;
+    };
+
+    struct Corpus
+    {
+        std::string name;
+        std::string utf8;
+        std::wstring utf16;
+    };
+
+    // A xorshift generator, so that the generated corpora are identical across runs and machines.
+    struct Rng
+    {
+        uint32_t next() noexcept
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return gsl::narrow_cast<uint32_t>(state >> 32);
+        }
+
+        uint32_t next(const uint32_t max) noexcept
+        {
+            return next() % max;
+        }
+
+        uint64_t state = 0x853c49e6748fea9b;
+    };
+
+    void appendCodepoint(std::string& out, const char32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            out.push_back(gsl::narrow_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out.push_back(gsl::narrow_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(gsl::narrow_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(gsl::narrow_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(gsl::narrow_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(gsl::narrow_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(gsl::narrow_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(gsl::narrow_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(gsl::narrow_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(gsl::narrow_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    // Lines of printable ASCII of varying length, like the output of a build or `cat`.
+    std::string generateAscii(Rng& rng)
+    {
+        std::string out;
+        out.reserve(s_corpusSize + 256);
+        while (out.size() < s_corpusSize)
+        {
+            const auto length = rng.next(s_bufferWidth * 2);
+            for (uint32_t i = 0; i < length; i++)
+            {
+                out.push_back(gsl::narrow_cast<char>(' ' + rng.next(95)));
+            }
+            out.append("\r\n");
+        }
+        return out;
+    }
+
+    // Wide CJK Unified Ideographs, which exercise the width detection and the wide glyph wrapping.
+    std::string generateCjk(Rng& rng)
+    {
+        std::string out;
+        out.reserve(s_corpusSize + 512);
+        while (out.size() < s_corpusSize)
+        {
+            const auto length = rng.next(s_bufferWidth);
+            for (uint32_t i = 0; i < length; i++)
+            {
+                appendCodepoint(out, 0x4E00 + rng.next(0x5200));
+            }
+            out.append("\r\n");
+        }
+        return out;
+    }
+
+    // Accented Latin, Greek and Cyrillic words with the occasional combining mark and box drawing character.
+    // This is the kind of text that's neither ASCII nor wide and is a common case in non-English locales.
+    std::string generateLatin(Rng& rng)
+    {
+        static constexpr std::pair<char32_t, uint32_t> ranges[]{
+            { 0x0061, 26 }, // a-z
+            { 0x00E0, 31 }, // à-þ
+            { 0x0100, 128 }, // Latin Extended-A
+            { 0x03B1, 25 }, // α-ω
+            { 0x0430, 32 }, // а-я
+        };
+
+        std::string out;
+        out.reserve(s_corpusSize + 1024);
+        while (out.size() < s_corpusSize)
+        {
+            const auto length = rng.next(s_bufferWidth * 2);
+            for (uint32_t i = 0; i < length; i++)
+            {
+                const auto r = rng.next(64);
+                if (r < 8)
+                {
+                    out.push_back(' ');
+                }
+                else if (r == 8)
+                {
+                    appendCodepoint(out, 0x2500 + rng.next(0x80));
+                }
+                else if (r == 9 && i != 0)
+                {
+                    appendCodepoint(out, 0x0300 + rng.next(0x10));
+                }
+                else
+                {
+                    const auto& [first, count] = ranges[rng.next(static_cast<uint32_t>(std::size(ranges)))];
+                    appendCodepoint(out, first + rng.next(count));
+                }
+            }
+            out.append("\r\n");
+        }
+        return out;
+    }
+
+    // Emoji with modifiers, variation selectors and ZWJ sequences, which exercise the grapheme cluster segmentation.
+    std::string generateEmoji(Rng& rng)
+    {
+        static constexpr std::u32string_view clusters[]{
+            U"\U0001F469\u200D\U0001F469\u200D\U0001F467\u200D\U0001F466", // family: woman, woman, girl, boy
+            U"\U0001F3F3\uFE0F\u200D\U0001F308", // rainbow flag
+            U"\U0001F9D1\U0001F3FD\u200D\U0001F4BB", // technologist: medium skin tone
+            U"\U0001F44D\U0001F3FB", // thumbs up: light skin tone
+            U"\u2764\uFE0F", // red heart
+            U"\U0001F1E9\U0001F1EA", // flag: Germany
+            U"\U0001F600", // grinning face
+            U"a",
+        };
+
+        std::string out;
+        out.reserve(s_corpusSize + 1024);
+        while (out.size() < s_corpusSize)
+        {
+            const auto length = rng.next(s_bufferWidth / 2);
+            for (uint32_t i = 0; i < length; i++)
+            {
+                for (const auto cp : clusters[rng.next(static_cast<uint32_t>(std::size(clusters)))])
+                {
+                    appendCodepoint(out, cp);
+                }
+            }
+            out.append("\r\n");
+        }
+        return out;
+    }
+
+    // Short runs of text in between indexed, 256-color and RGB SGR sequences, like a colorized `ls` or `git log`.
+    std::string generateSgr(Rng& rng)
+    {
+        std::string out;
+        out.reserve(s_corpusSize + 256);
+        while (out.size() < s_corpusSize)
+        {
+            til::CoordType column = 0;
+            while (column < s_bufferWidth)
+            {
+                switch (rng.next(4))
+                {
+                case 0:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{};{}m"), 30 + rng.next(8), 40 + rng.next(8));
+                    break;
+                case 1:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[38;5;{}m"), rng.next(256));
+                    break;
+                case 2:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[1;4;48;2;{};{};{}m"), rng.next(256), rng.next(256), rng.next(256));
+                    break;
+                default:
+                    out.append("\x1b[m");
+                    break;
+                }
+
+                const auto length = std::min(gsl::narrow_cast<til::CoordType>(1 + rng.next(6)), s_bufferWidth - column);
+                for (til::CoordType i = 0; i < length; i++)
+                {
+                    out.push_back(gsl::narrow_cast<char>('a' + rng.next(26)));
+                }
+                column += length;
+            }
+            out.append("\x1b[m\r\n");
+        }
+        return out;
+    }
+
+    // Full screen redraws with absolute cursor positioning, followed by partial updates and
+    // margin scrolling, like the output of `htop` or a full screen editor.
+    std::string generateTui(Rng& rng)
+    {
+        std::string out;
+        out.reserve(s_corpusSize + 16 * 1024);
+        while (out.size() < s_corpusSize)
+        {
+            out.append("\x1b[?25l\x1b[H\x1b[7m");
+            out.append(s_bufferWidth, ' ');
+            out.append("\x1b[m");
+
+            for (til::CoordType y = 2; y < s_viewportHeight; y++)
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{};1H\x1b[3{}m{:>6} \x1b[m"), y, 1 + rng.next(7), rng.next(100000));
+                const auto length = rng.next(s_bufferWidth - 8);
+                for (uint32_t i = 0; i < length; i++)
+                {
+                    out.push_back(gsl::narrow_cast<char>(' ' + rng.next(95)));
+                }
+                out.append("\x1b[K");
+            }
+
+            for (int i = 0; i < 64; i++)
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{};{}H{:5.1f}%"), 2 + rng.next(s_viewportHeight - 2), 1 + rng.next(s_bufferWidth - 6), rng.next(1000) / 10.0);
+            }
+
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[2;{}r\x1b[{};1H"), s_viewportHeight - 1, s_viewportHeight - 1);
+            for (int i = 0; i < 8; i++)
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE("\nline {}\x1b[K"), rng.next());
+            }
+            out.append("\x1b[r\x1b[?25h");
+        }
+        return out;
+    }
+
+    // Scrolling within a DECSTBM region in between a header and a status line, like a pager, an editor or tmux do.
+    // Mixes linefeeds at the bottom margin, reverse indexes at the top margin, IL, DL, SU and SD.
+    std::string generateScroll(Rng& rng)
+    {
+        std::string out;
+        out.reserve(s_corpusSize + 1024);
+        while (out.size() < s_corpusSize)
+        {
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[2;{}r"), s_viewportHeight - 1);
+
+            for (int i = 0; i < 32; i++)
+            {
+                const auto length = rng.next(s_bufferWidth);
+                switch (rng.next(6))
+                {
+                case 0:
+                    out.append("\x1b[2H\x1bM");
+                    break;
+                case 1:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{}H\x1b[{}L"), 2 + rng.next(s_viewportHeight - 3), 1 + rng.next(3));
+                    break;
+                case 2:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{}H\x1b[{}M"), 2 + rng.next(s_viewportHeight - 3), 1 + rng.next(3));
+                    break;
+                case 3:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{}S\x1b[{}H"), 1 + rng.next(2), s_viewportHeight - 1);
+                    break;
+                default:
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[{}H\n"), s_viewportHeight - 1);
+                    break;
+                }
+                for (uint32_t j = 0; j < length; j++)
+                {
+                    out.push_back(gsl::narrow_cast<char>(' ' + rng.next(95)));
+                }
+                out.append("\x1b[K");
+            }
+
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[r\x1b[{}H\x1b[7m{:>8}\x1b[m\x1b[K"), s_viewportHeight, rng.next());
+        }
+        return out;
+    }
+
+    // 240x120 pixel images with a 16 color palette and run length encoded bands.
+    std::string generateSixel(Rng& rng)
+    {
+        static constexpr int width = 240;
+        static constexpr int bands = 120 / 6;
+        static constexpr int colors = 16;
+
+        std::string out;
+        out.reserve(s_corpusSize + 64 * 1024);
+        while (out.size() < s_corpusSize)
+        {
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1bP0;1;0q\"1;1;{};{}"), width, bands * 6);
+            for (int c = 0; c < colors; c++)
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE("#{};2;{};{};{}"), c, rng.next(101), rng.next(101), rng.next(101));
+            }
+
+            for (int band = 0; band < bands; band++)
+            {
+                for (int c = 0; c < colors; c++)
+                {
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("#{}"), c);
+                    for (int x = 0; x < width;)
+                    {
+                        const auto run = std::min(gsl::narrow_cast<int>(1 + rng.next(8)), width - x);
+                        const auto sixel = gsl::narrow_cast<char>('?' + rng.next(64));
+                        if (run > 3)
+                        {
+                            fmt::format_to(std::back_inserter(out), FMT_COMPILE("!{}{}"), run, sixel);
+                        }
+                        else
+                        {
+                            out.append(run, sixel);
+                        }
+                        x += run;
+                    }
+                    out.push_back(c + 1 < colors ? '$' : '-');
+                }
+            }
+            out.append("\x1b\\\r\n");
+        }
+        return out;
+    }
+
+    // 640x360 pixel frames with square pixels and a 64 color palette, drawn over each other at the
+    // top of the page, like the output of `mpv --vo=sixel`. Every color only covers some of each band.
+    std::string generateSixelVideo(Rng& rng)
+    {
+        static constexpr int width = 640;
+        static constexpr int bands = 360 / 6;
+        static constexpr int colors = 64;
+
+        std::string out;
+        out.reserve(s_corpusSize + 256 * 1024);
+        while (out.size() < s_corpusSize)
+        {
+            fmt::format_to(std::back_inserter(out), FMT_COMPILE("\x1b[H\x1bP0;1;0q\"1;1;{};{}"), width, bands * 6);
+            for (int c = 0; c < colors; c++)
+            {
+                fmt::format_to(std::back_inserter(out), FMT_COMPILE("#{};2;{};{};{}"), c, rng.next(101), rng.next(101), rng.next(101));
+            }
+
+            for (int band = 0; band < bands; band++)
+            {
+                for (int c = 0; c < colors; c += 1 + rng.next(4))
+                {
+                    fmt::format_to(std::back_inserter(out), FMT_COMPILE("#{}"), c);
+                    for (int x = 0; x < width;)
+                    {
+                        const auto run = std::min(gsl::narrow_cast<int>(1 + rng.next(24)), width - x);
+                        // Skip over the parts of the band that are drawn in other colors.
+                        const auto sixel = rng.next(2) ? '?' : gsl::narrow_cast<char>('?' + rng.next(64));
+                        if (run > 3)
+                        {
+                            fmt::format_to(std::back_inserter(out), FMT_COMPILE("!{}{}"), run, sixel);
+                        }
+                        else
+                        {
+                            out.append(run, sixel);
+                        }
+                        x += run;
+                    }
+                    out.push_back('$');
+                }
+                out.push_back('-');
+            }
+            out.append("\x1b\\");
+        }
+        return out;
+    }
+
+    Corpus makeCorpus(std::string name, std::string utf8)
+    {
+        auto utf16 = til::u8u16(utf8);
+        return { std::move(name), std::move(utf8), std::move(utf16) };
+    }
+
+    std::vector<Corpus> generateCorpora()
+    {
+        Rng rng;
+        std::vector<Corpus> corpora;
+        corpora.emplace_back(makeCorpus("ascii", generateAscii(rng)));
+        corpora.emplace_back(makeCorpus("cjk", generateCjk(rng)));
+        corpora.emplace_back(makeCorpus("latin", generateLatin(rng)));
+        corpora.emplace_back(makeCorpus("emoji", generateEmoji(rng)));
+        corpora.emplace_back(makeCorpus("sgr", generateSgr(rng)));
+        corpora.emplace_back(makeCorpus("tui", generateTui(rng)));
+        corpora.emplace_back(makeCorpus("scroll", generateScroll(rng)));
+        corpora.emplace_back(makeCorpus("sixel", generateSixel(rng)));
+        corpora.emplace_back(makeCorpus("sixelvideo", generateSixelVideo(rng)));
+        return corpora;
+    }
+
+    // Recorded corpora are raw UTF-8 output captured from an application, e.g. with `script` or by
+    // redirecting the output of `conhost --headless` into a file.
+    Corpus loadCorpus(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path, std::ios::binary };
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), !file);
+        std::string utf8{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+        return makeCorpus(path.filename().string(), std::move(utf8));
+    }
+
+    struct Result
+    {
+        double seconds = 0;
+        size_t iterations = 0;
+        size_t allocations = 0;
+        TextBuffer::MemoryStatistics memory;
+    };
+
+    // Replays the corpus into a fresh terminal until at least `timeLimit` has passed.
+    // The first iteration is a warmup and excluded from the results, because it
+    // pays for committing the buffer's memory and for growing the parser's buffers.
+    template<typename T>
+    Result measure(const std::basic_string_view<T> input, const std::chrono::duration<double> timeLimit)
+    {
+        const auto harness = std::make_unique<Harness>();
+        harness->stateMachine.ProcessString(input);
+
+        Result result;
+        const auto allocationsBeg = s_allocations;
+        const auto beg = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed{};
+
+        do
+        {
+            harness->stateMachine.ProcessString(input);
+            result.iterations++;
+            elapsed = std::chrono::steady_clock::now() - beg;
+        } while (elapsed < timeLimit || result.iterations < 3);
+
+        result.seconds = elapsed.count();
+        result.allocations = s_allocations - allocationsBeg;
+        result.memory = harness->api.GetBufferAndViewport().buffer.GetMemoryStatistics();
+        return result;
+    }
+
+    // Measures nothing but TextBuffer::FitTextIntoColumns(), which is what the buffer uses to measure text
+    // before writing it, for the given text measurement mode. Returns the time spent per UTF-16 code unit.
+    double measureWidth(const std::wstring_view input, const TextMeasurementMode mode, const std::chrono::duration<double> timeLimit)
+    {
+        auto& cwd = CodepointWidthDetector::Singleton();
+        cwd.Reset(mode);
+        // In console mode ambiguous characters are measured by asking the font. Pretend they're all narrow
+        // so that we measure the cache in front of the fallback instead of a particular font.
+        if (mode == TextMeasurementMode::Console)
+        {
+            cwd.SetFallbackMethod([](const std::wstring_view&) { return false; });
+        }
+
+        const auto fit = [&]() {
+            size_t columns = 0;
+            for (auto remaining = input; !remaining.empty();)
+            {
+                til::CoordType cols = 0;
+                const auto len = TextBuffer::FitTextIntoColumns(remaining, s_bufferWidth, cols);
+                // Nothing but a wide glyph in a 1 column wide buffer could fail to fit, but let's not loop forever.
+                remaining = remaining.substr(std::max<size_t>(len, 1));
+                columns += cols;
+            }
+            return columns;
+        };
+
+        fit();
+
+        size_t iterations = 0;
+        // volatile, so that the optimizer can't discard the otherwise unused measurements.
+        volatile size_t columns = 0;
+        const auto beg = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed{};
+
+        do
+        {
+            columns = columns + fit();
+            iterations++;
+            elapsed = std::chrono::steady_clock::now() - beg;
+        } while (elapsed < timeLimit || iterations < 3);
+
+        cwd.Reset(TextMeasurementMode::Graphemes);
+        cwd.SetFallbackMethod(nullptr);
+        return elapsed.count() * 1e9 / (static_cast<double>(input.size()) * iterations);
+    }
+
+    // MB/s and allocations/MB are based on the UTF-8 size of the corpus for both encodings,
+    // so that the two rows of a corpus can be compared directly. ns/char is per UTF-16 code unit.
+    // B/row is the average size of the buffer's committed rows, including those in the compact tier.
+    void printResult(const Corpus& corpus, const char* encoding, const Result& result)
+    {
+        const auto megabytes = static_cast<double>(corpus.utf8.size()) * result.iterations / 1e6;
+        const auto chars = static_cast<double>(corpus.utf16.size()) * result.iterations;
+        const auto& memory = result.memory;
+        const auto rows = std::max<size_t>(1, memory.hotRows + memory.compactRows);
+        fmt::print(FMT_COMPILE("{:<16} {:<6} {:>10.1f} {:>10.2f} {:>12.1f} {:>8} {:>8} {:>8.1f}\n"),
+                   corpus.name,
+                   encoding,
+                   megabytes / result.seconds,
+                   result.seconds * 1e9 / chars,
+                   result.allocations / megabytes,
+                   memory.hotRows,
+                   memory.compactRows,
+                   static_cast<double>(memory.hotBytes + memory.compactBytes) / rows);
+    }
+}
+
+int wmain(int argc, const wchar_t* argv[])
+try
+{
+    std::chrono::duration<double> timeLimit{ 1.0 };
+    std::vector<Corpus> corpora;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::wstring_view arg{ argv[i] };
+        if (arg == L"-t" && i + 1 < argc)
+        {
+            timeLimit = std::chrono::duration<double>{ std::wcstod(argv[++i], nullptr) };
+        }
+        else if (arg == L"-?" || arg == L"-h" || arg == L"--help")
+        {
+            fmt::print("Usage: VtBench [-t seconds] [paths to recorded UTF-8 output]...\n");
+            return 0;
+        }
+        else
+        {
+            corpora.emplace_back(loadCorpus(arg));
+        }
+    }
+
+    if (corpora.empty())
+    {
+        corpora = generateCorpora();
+    }
+
+    fmt::print(FMT_COMPILE("{:<16} {:<6} {:>10} {:>10} {:>12} {:>8} {:>8} {:>8}\n"), "corpus", "input", "MB/s", "ns/char", "allocs/MB", "hot", "compact", "B/row");
+    for (const auto& corpus : corpora)
+    {
+        printResult(corpus, "utf16", measure(std::wstring_view{ corpus.utf16 }, timeLimit));
+        printResult(corpus, "utf8", measure(std::string_view{ corpus.utf8 }, timeLimit));
+    }
+
+    fmt::print(FMT_COMPILE("\n{:<16} {:>10} {:>10} {:>10}\n"), "width ns/char", "graphemes", "wcswidth", "console");
+    for (const auto& corpus : corpora)
+    {
+        fmt::print(FMT_COMPILE("{:<16} {:>10.2f} {:>10.2f} {:>10.2f}\n"),
+                   corpus.name,
+                   measureWidth(corpus.utf16, TextMeasurementMode::Graphemes, timeLimit),
+                   measureWidth(corpus.utf16, TextMeasurementMode::Wcswidth, timeLimit),
+                   measureWidth(corpus.utf16, TextMeasurementMode::Console, timeLimit));
+    }
+
+    return 0;
+}
+catch (const wil::ResultException& e)
+{
+    fmt::print("Exception: {:08x}\n", static_cast<uint32_t>(e.GetErrorCode()));
+    return 1;
+}
+catch (...)
+{
+    fmt::print("Unknown exception\n");
+    return 1;
+}
@@ -685,6 +685,39 @@ constexpr int ucdToCharacterWidth(const int val) noexcept
 {
     return val >> 6;
 }
+
+// A 2048 bit bitmap over U+0000 to U+07FF, used by NarrowRunLength().
+struct NarrowRunBitmap
+{
+    uint64_t bits[32];
+
+    constexpr bool contains(const char32_t cp) const noexcept
+    {
+        return cp < 0x800 && ((bits[cp >> 6] >> (cp & 63)) & 1) != 0;
+    }
+};
+// Marks all codepoints that can be measured without going through the grapheme cluster algorithm:
+// All of ASCII (like the ASCII fast paths in our callers have always done) as well as anything that
+// is exactly 1 column wide and in the same grapheme class as ASCII letters, because those only ever
+// join with whatever follows them (for instance combining marks), but never with each other.
+constexpr NarrowRunBitmap ucdBuildNarrowRunBitmap(const bool includeAmbiguous) noexcept
+{
+    NarrowRunBitmap bitmap{};
+    const auto letterClass = ucdLookup(L'a') & 15;
+    for (char32_t cp = 0; cp < 0x800; ++cp)
+    {
+        const auto val = ucdLookup(cp);
+        const auto w = ucdToCharacterWidth(val);
+        if (cp < 0x80 || ((val & 15) == letterClass && (w == 1 || (includeAmbiguous && w == 3))))
+        {
+            bitmap.bits[cp >> 6] |= uint64_t{ 1 } << (cp & 63);
+        }
+    }
+    return bitmap;
+}
+static_assert(ucdGraphemeDone(ucdGraphemeJoins(0, ucdLookup(L'a'), ucdLookup(L'a'))));
+static constexpr auto s_narrowRun = ucdBuildNarrowRunBitmap(false);
+static constexpr auto s_narrowOrAmbiguousRun = ucdBuildNarrowRunBitmap(true);
 // clang-format on
 
 // Decodes the next codepoint from the given UTF-16 string.
@@ -800,6 +833,52 @@ bool CodepointWidthDetector::GraphemePrev(GraphemeState& s, const std::wstring_v
     return _graphemePrevConsole(s, str);
 }
 
+// Returns the length of the prefix of `str` in which every char is a single, 1 column wide grapheme cluster.
+// This allows callers to skip calling GraphemeNext() for the bulk of typical (mostly Latin, Greek,
+// Cyrillic, etc.) text. However, the last char of the run may still join with whatever follows it,
+// for instance "a" followed by U+0301. If the run doesn't span the entire string, callers need to
+// back up by 1 char before continuing with GraphemeNext(), just like they do for ASCII.
+size_t CodepointWidthDetector::NarrowRunLength(const std::wstring_view& str) const noexcept
+{
+    // Ambiguous width characters are narrow, unless we're in console mode, where we need to ask the font.
+    const auto& bitmap = _mode != TextMeasurementMode::Console && _ambiguousWidth == 1 ? s_narrowOrAmbiguousRun : s_narrowRun;
+    const auto beg = str.data();
+    const auto end = beg + str.size();
+    auto it = beg;
+
+    for (;;)
+    {
+#if defined(TIL_SSE_INTRINSICS)
+        // Skip over blocks of 8 ASCII chars at a time. It's still by far the most common type of text.
+        while (end - it >= 8)
+        {
+            const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            const auto ascii = _mm_cmpeq_epi16(_mm_and_si128(wch, _mm_set1_epi16(static_cast<short>(0xff80))), _mm_setzero_si128());
+            const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(ascii)) ^ 0xffff;
+
+            if (mask)
+            {
+                unsigned long offset;
+                _BitScanForward(&offset, mask);
+                it += offset / 2;
+                break;
+            }
+
+            it += 8;
+        }
+#endif
+
+        if (it == end || !bitmap.contains(*it))
+        {
+            break;
+        }
+
+        ++it;
+    }
+
+    return static_cast<size_t>(it - beg);
+}
+
 // Parses the next grapheme cluster from the given string. The algorithm largely follows "UAX #29: Unicode Text Segmentation",
 // but takes some mild liberties. Returns false if the end of the string was reached. Updates `s` with the cluster.
 bool CodepointWidthDetector::_graphemeNext(GraphemeState& s, const std::wstring_view& str) const noexcept
@@ -1215,6 +1294,11 @@ bool CodepointWidthDetector::_graphemePrevConsole(GraphemeState& s, const std::w
 
 // Call the function specified via SetFallbackMethod() to turn ambiguous (width = 3) into narrow/wide.
 // Caches the results in _fallbackCache.
+//
+// The cache is a fixed-size, open addressing hash table of atomics, because text may get measured on multiple
+// threads at once (for instance by TextBuffer::Reflow). Each slot holds `fallbackCacheUsed | codepoint << 1 | wide`.
+// Slots are only ever filled in and never modified, except by Reset(), which must not race with measurements.
+// Once the table is 3/4 full we simply stop caching new entries and call the fallback method every time.
 int CodepointWidthDetector::_checkFallbackViaCache(const char32_t codepoint) noexcept
 try
 {
@@ -1224,9 +1308,22 @@ try
         return 1;
     }
 
-    if (const auto it = _fallbackCache.find(codepoint); it != _fallbackCache.end())
+    static constexpr uint32_t fallbackCacheMask = fallbackCacheCapacity - 1;
+    const auto key = fallbackCacheUsed | (static_cast<uint32_t>(codepoint) << 1);
+    const auto hash = (static_cast<uint32_t>(codepoint) * 0x9E3779B1u) >> 16;
+    auto idx = hash & fallbackCacheMask;
+
+    for (uint32_t probes = 0; probes < fallbackCacheCapacity; ++probes, idx = (idx + 1) & fallbackCacheMask)
     {
-        return it->second;
+        const auto slot = _fallbackCache[idx].load(std::memory_order_relaxed);
+        if (slot == 0)
+        {
+            break;
+        }
+        if ((slot & ~uint32_t{ 1 }) == key)
+        {
+            return (slot & 1) ? 2 : 1;
+        }
     }
 
     wchar_t buf[2];
@@ -1244,7 +1341,27 @@ try
     }
 
     const int width = _pfnFallbackMethod({ &buf[0], len }) ? 2 : 1;
-    _fallbackCache.insert_or_assign(codepoint, width);
+
+    if (_fallbackCacheSize.load(std::memory_order_relaxed) < fallbackCacheCapacity / 4 * 3)
+    {
+        const auto entry = key | (width == 2 ? 1u : 0u);
+
+        // `idx` still points at the empty slot the lookup above stopped at, unless another thread got there first.
+        for (uint32_t probes = 0; probes < fallbackCacheCapacity; ++probes, idx = (idx + 1) & fallbackCacheMask)
+        {
+            uint32_t expected = 0;
+            if (_fallbackCache[idx].compare_exchange_strong(expected, entry, std::memory_order_relaxed))
+            {
+                _fallbackCacheSize.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            if ((expected & ~uint32_t{ 1 }) == key)
+            {
+                break;
+            }
+        }
+    }
+
     return width;
 }
 catch (...)
@@ -1276,5 +1393,9 @@ void CodepointWidthDetector::SetFallbackMethod(std::function<bool(const std::wst
 void CodepointWidthDetector::Reset(const TextMeasurementMode mode) noexcept
 {
     _mode = mode;
-    _fallbackCache.clear();
+    for (auto& slot : _fallbackCache)
+    {
+        slot.store(0, std::memory_order_relaxed);
+    }
+    _fallbackCacheSize.store(0, std::memory_order_relaxed);
 }
@@ -215,3 +215,20 @@ float ColorFix::GetLuminosity(COLORREF color) noexcept
 }
 
 TIL_FAST_MATH_END
+
+COLORREF ColorFix::PerceivableColorCache::GetPerceivableColor(COLORREF color, COLORREF reference, float minSquaredDistance) noexcept
+{
+    // The multipliers are arbitrary odd constants to mix the bits of both colors into the top 8 bits.
+    const auto hash = (color * 0x9E3779B1u) ^ (reference * 0x85EBCA77u) ^ std::bit_cast<uint32_t>(minSquaredDistance);
+    auto& entry = til::at(_entries, hash >> 24);
+
+    if (entry.color != color || entry.reference != reference || entry.minSquaredDistance != minSquaredDistance)
+    {
+        entry.color = color;
+        entry.reference = reference;
+        entry.minSquaredDistance = minSquaredDistance;
+        entry.result = ColorFix::GetPerceivableColor(color, reference, minSquaredDistance);
+    }
+
+    return entry.result;
+}
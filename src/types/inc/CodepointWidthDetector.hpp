@@ -54,6 +54,8 @@ struct CodepointWidthDetector
     // Returns false if the end of the string has been reached.
     bool GraphemeNext(GraphemeState& s, const std::wstring_view& str) noexcept;
     bool GraphemePrev(GraphemeState& s, const std::wstring_view& str) noexcept;
+    // Returns the number of leading chars in str that are each a narrow grapheme cluster on their own (see .cpp).
+    size_t NarrowRunLength(const std::wstring_view& str) const noexcept;
 
     TextMeasurementMode GetMode() const noexcept;
     void SetFallbackMethod(std::function<bool(const std::wstring_view&)> pfnFallback) noexcept;
@@ -68,7 +70,11 @@ private:
     bool _graphemePrevConsole(GraphemeState& s, const std::wstring_view& str) noexcept;
     __declspec(noinline) int _checkFallbackViaCache(char32_t codepoint) noexcept;
 
-    std::unordered_map<char32_t, int> _fallbackCache;
+    static constexpr uint32_t fallbackCacheCapacity = 8192;
+    static constexpr uint32_t fallbackCacheUsed = 0x80000000;
+
+    std::array<std::atomic<uint32_t>, fallbackCacheCapacity> _fallbackCache{};
+    std::atomic<uint32_t> _fallbackCacheSize{ 0 };
     std::function<bool(const std::wstring_view&)> _pfnFallbackMethod;
     TextMeasurementMode _mode = TextMeasurementMode::Graphemes;
     int _ambiguousWidth = 1;
@@ -11,4 +11,27 @@ namespace ColorFix
 {
     COLORREF GetPerceivableColor(COLORREF color, COLORREF reference, float minSquaredDistance) noexcept;
     float GetLuminosity(COLORREF color) noexcept;
+
+    // GetPerceivableColor() is expensive enough that calling it for every run of text in every frame
+    // shows up in profiles, while a screen typically only uses a handful of color pairs.
+    // This is a small direct-mapped cache in front of it. The result only depends on the arguments,
+    // which are also the key, so entries never go stale when the color table changes.
+    // It isn't thread-safe. Each user (the renderer's snapshot of the RenderSettings, BackendD3D) owns its own instance.
+    class PerceivableColorCache
+    {
+    public:
+        COLORREF GetPerceivableColor(COLORREF color, COLORREF reference, float minSquaredDistance) noexcept;
+
+    private:
+        // A zeroed entry is a valid one: GetPerceivableColor(0, 0, 0) is 0.
+        struct Entry
+        {
+            COLORREF color;
+            COLORREF reference;
+            float minSquaredDistance;
+            COLORREF result;
+        };
+
+        std::array<Entry, 256> _entries{};
+    };
 }
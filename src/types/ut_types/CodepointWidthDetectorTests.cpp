@@ -1247,6 +1247,42 @@ class CodepointWidthDetectorTests
         VERIFY_ARE_EQUAL(expectedWidths, actualWidths);
     }
 
+    TEST_METHOD(NarrowRunLength)
+    {
+        static constexpr std::array modes{ TextMeasurementMode::Graphemes, TextMeasurementMode::Wcswidth, TextMeasurementMode::Console };
+
+        CodepointWidthDetector cwd;
+
+        for (const auto mode : modes)
+        {
+            cwd.Reset(mode);
+
+            // Every char that's part of a narrow run must be a 1 column wide grapheme cluster of its own.
+            for (wchar_t ch = 0; ch < 0x800; ch++)
+            {
+                const wchar_t text[]{ ch, L'a' };
+                if (cwd.NarrowRunLength({ &text[0], 2 }) == 2)
+                {
+                    GraphemeState state;
+                    cwd.GraphemeNext(state, { &text[0], 2 });
+                    VERIFY_ARE_EQUAL(1, state.len);
+                    VERIFY_ARE_EQUAL(1, state.width);
+                }
+            }
+
+            // The first 16 chars are consumed by the SIMD loop and the "a" by the bitmap. U+0301 is a combining mark.
+            VERIFY_ARE_EQUAL(size_t{ 17 }, cwd.NarrowRunLength(std::wstring_view{ L"0123456789abcdefa\u0301" }));
+            VERIFY_ARE_EQUAL(size_t{ 3 }, cwd.NarrowRunLength(std::wstring_view{ L"abc\u4E00" }));
+            VERIFY_ARE_EQUAL(size_t{ 0 }, cwd.NarrowRunLength(std::wstring_view{ L"" }));
+        }
+
+        // Ambiguous width characters like "é" are only part of a run if they're guaranteed to be narrow.
+        cwd.Reset(TextMeasurementMode::Graphemes);
+        VERIFY_ARE_EQUAL(size_t{ 6 }, cwd.NarrowRunLength(std::wstring_view{ L"ab\u00E9\u0431yz" }));
+        cwd.Reset(TextMeasurementMode::Console);
+        VERIFY_ARE_EQUAL(size_t{ 2 }, cwd.NarrowRunLength(std::wstring_view{ L"ab\u00E9\u0431yz" }));
+    }
+
     TEST_METHOD(ChunkedText)
     {
         struct Test
@@ -1235,6 +1235,284 @@ plainSearch:
     return it;
 }
 
+// Returns true for C0 characters, DEL and 0xC2, which is the lead byte of the C1 controls U+0080-U+009F in UTF-8.
+constexpr bool isActionableFromGroundCandidate(const char ch) noexcept
+{
+    const auto b = static_cast<uint8_t>(ch);
+    return (b <= 0x1f) | (b == 0x7f) | (b == 0xc2);
+}
+
+// Finds the first byte for which isActionableFromGroundCandidate() returns true.
+static const char* findActionableFromGroundCandidate(const char* beg, const size_t len) noexcept
+{
+    auto it = beg;
+
+#if defined(TIL_SSE_INTRINSICS)
+
+    for (const auto end = beg + (len & ~size_t{ 15 }); it < end; it += 16)
+    {
+        const auto ch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+
+        // Check for (ch <= 0x1f) with the same saturated subtraction trick as above.
+        auto a = _mm_subs_epu8(ch, _mm_set1_epi8(0x1f));
+        a = _mm_cmpeq_epi8(a, _mm_setzero_si128());
+        const auto b = _mm_cmpeq_epi8(ch, _mm_set1_epi8(0x7f));
+        const auto c = _mm_cmpeq_epi8(ch, _mm_set1_epi8(static_cast<char>(0xc2)));
+
+        const auto d = _mm_or_si128(_mm_or_si128(a, b), c);
+        const auto mask = _mm_movemask_epi8(d);
+
+        if (mask)
+        {
+            unsigned long offset;
+            _BitScanForward(&offset, mask);
+            it += offset;
+            return it;
+        }
+    }
+
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+
+    uint64_t mask;
+
+    for (const auto end = beg + (len & ~size_t{ 15 });;)
+    {
+        if (it >= end)
+        {
+            goto plainSearch;
+        }
+
+        const auto ch = vld1q_u8(reinterpret_cast<const uint8_t*>(it));
+        const auto a = vcleq_u8(ch, vdupq_n_u8(0x1f));
+        const auto b = vceqq_u8(ch, vdupq_n_u8(0x7f));
+        const auto c = vceqq_u8(ch, vdupq_n_u8(0xc2));
+        const auto d = vorrq_u8(vorrq_u8(a, b), c);
+
+        mask = vgetq_lane_u64(d, 0);
+        if (mask)
+        {
+            break;
+        }
+        it += 8;
+
+        mask = vgetq_lane_u64(d, 1);
+        if (mask)
+        {
+            break;
+        }
+        it += 8;
+    }
+
+    unsigned long offset;
+    _BitScanForward64(&offset, mask);
+    it += offset / 8;
+    return it;
+
+plainSearch:
+
+#endif
+
+#pragma loop(no_vector)
+    for (const auto end = beg + len; it < end && !isActionableFromGroundCandidate(*it); ++it)
+    {
+    }
+
+    return it;
+}
+
+// The UTF-8 equivalent of FindActionableControlCharacter() above.
+// A C1 control character that's split up across two calls is considered
+// actionable, because we can't know yet whether it's a C1 control or not.
+const char* Utils::FindActionableControlCharacter(const char* beg, const size_t len) noexcept
+{
+    const auto end = beg + len;
+
+    for (auto it = beg;; ++it)
+    {
+        it = findActionableFromGroundCandidate(it, end - it);
+
+        // 0xC2 is followed by 0x80-0xBF in valid UTF-8. Of those, only 0x80-0x9F are C1 control characters.
+        if (it == end || static_cast<uint8_t>(*it) != 0xc2 || it + 1 == end || static_cast<uint8_t>(static_cast<uint8_t>(it[1]) - 0x80) < 0x20)
+        {
+            return it;
+        }
+    }
+}
+
+// Returns true for the characters that end a run of DCS pass-through data:
+// CAN, SUB and ESC, as well as DEL and everything above it (including C1).
+constexpr bool isActionableFromDcsPassThrough(const wchar_t wch) noexcept
+{
+    return (wch >= 0x7f) | (wch == 0x18) | (wch == 0x1a) | (wch == 0x1b);
+}
+
+// Finds the first character that the DcsPassThrough state can't simply hand
+// to the string handler as part of a bulk run.
+const wchar_t* Utils::FindActionableDcsCharacter(const wchar_t* beg, const size_t len) noexcept
+{
+    auto it = beg;
+
+#if defined(TIL_SSE_INTRINSICS)
+
+    for (const auto end = beg + (len & ~size_t{ 7 }); it < end; it += 8)
+    {
+        const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+
+        // Check for (wch <= 0x7e) with the saturated subtraction trick from above.
+        // Unlike the other checks, this one yields the characters we want to keep.
+        const auto a = _mm_cmpeq_epi16(_mm_subs_epu16(wch, _mm_set1_epi16(0x7e)), _mm_setzero_si128());
+        const auto b = _mm_cmpeq_epi16(wch, _mm_set1_epi16(0x18));
+        const auto c = _mm_cmpeq_epi16(wch, _mm_set1_epi16(0x1a));
+        const auto d = _mm_cmpeq_epi16(wch, _mm_set1_epi16(0x1b));
+
+        const auto e = _mm_andnot_si128(_mm_or_si128(_mm_or_si128(b, c), d), a);
+        const auto mask = ~_mm_movemask_epi8(e) & 0xffff;
+
+        if (mask)
+        {
+            unsigned long offset;
+            _BitScanForward(&offset, mask);
+            it += offset / 2;
+            return it;
+        }
+    }
+
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+
+    uint64_t mask;
+
+    for (const auto end = beg + (len & ~size_t{ 7 });;)
+    {
+        if (it >= end)
+        {
+            goto plainSearch;
+        }
+
+        const auto wch = vld1q_u16(it);
+        const auto a = vcgtq_u16(wch, vdupq_n_u16(0x7e));
+        const auto b = vceqq_u16(wch, vdupq_n_u16(0x18));
+        const auto c = vceqq_u16(wch, vdupq_n_u16(0x1a));
+        const auto d = vceqq_u16(wch, vdupq_n_u16(0x1b));
+        const auto e = vorrq_u16(vorrq_u16(a, b), vorrq_u16(c, d));
+
+        mask = vgetq_lane_u64(e, 0);
+        if (mask)
+        {
+            break;
+        }
+        it += 4;
+
+        mask = vgetq_lane_u64(e, 1);
+        if (mask)
+        {
+            break;
+        }
+        it += 4;
+    }
+
+    unsigned long offset;
+    _BitScanForward64(&offset, mask);
+    it += offset / 16;
+    return it;
+
+plainSearch:
+
+#endif
+
+#pragma loop(no_vector)
+    for (const auto end = beg + len; it < end && !isActionableFromDcsPassThrough(*it); ++it)
+    {
+    }
+
+    return it;
+}
+
+// Returns true for C0 and C1 controls. Everything else is collected as part of
+// an OSC string, while the controls either terminate it or are ignored.
+constexpr bool isActionableFromOscString(const wchar_t wch) noexcept
+{
+    return (wch <= 0x1f) | (static_cast<wchar_t>(wch - 0x80) <= 0x1f);
+}
+
+// Finds the first character that the OscString state can't simply append to
+// the OSC string as part of a bulk run.
+const wchar_t* Utils::FindActionableOscCharacter(const wchar_t* beg, const size_t len) noexcept
+{
+    auto it = beg;
+
+#if defined(TIL_SSE_INTRINSICS)
+
+    for (const auto end = beg + (len & ~size_t{ 7 }); it < end; it += 8)
+    {
+        const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        const auto z = _mm_setzero_si128();
+
+        // Check for (wch <= 0x1f) and ((wch - 0x80) <= 0x1f), like in FindActionableControlCharacter.
+        auto a = _mm_subs_epu16(wch, _mm_set1_epi16(0x1f));
+        auto b = _mm_subs_epu16(_mm_add_epi16(wch, _mm_set1_epi16(static_cast<short>(0xff80))), _mm_set1_epi16(0x1f));
+        a = _mm_cmpeq_epi16(a, z);
+        b = _mm_cmpeq_epi16(b, z);
+
+        const auto c = _mm_or_si128(a, b);
+        const auto mask = _mm_movemask_epi8(c);
+
+        if (mask)
+        {
+            unsigned long offset;
+            _BitScanForward(&offset, mask);
+            it += offset / 2;
+            return it;
+        }
+    }
+
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+
+    uint64_t mask;
+
+    for (const auto end = beg + (len & ~size_t{ 7 });;)
+    {
+        if (it >= end)
+        {
+            goto plainSearch;
+        }
+
+        const auto wch = vld1q_u16(it);
+        const auto a = vcleq_u16(wch, vdupq_n_u16(0x1f));
+        const auto b = vcleq_u16(vsubq_u16(wch, vdupq_n_u16(0x80)), vdupq_n_u16(0x1f));
+        const auto c = vorrq_u16(a, b);
+
+        mask = vgetq_lane_u64(c, 0);
+        if (mask)
+        {
+            break;
+        }
+        it += 4;
+
+        mask = vgetq_lane_u64(c, 1);
+        if (mask)
+        {
+            break;
+        }
+        it += 4;
+    }
+
+    unsigned long offset;
+    _BitScanForward64(&offset, mask);
+    it += offset / 16;
+    return it;
+
+plainSearch:
+
+#endif
+
+#pragma loop(no_vector)
+    for (const auto end = beg + len; it < end && !isActionableFromOscString(*it); ++it)
+    {
+    }
+
+    return it;
+}
+
 #pragma warning(pop)
 
 std::wstring Utils::EvaluateStartingDirectory(